@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// ============================================================================
+// Canned engine output shared by the benchmarks
+// ============================================================================
+// Shapes copied from real aria2 1.37 and yt-dlp 2024.x output, trimmed to the
+// fields the parsers look at plus the noise that surrounds them.
+// ============================================================================
+
+// aria2.tellStatus response for a download with one file
+inline std::string MakeTellStatusResponse(const std::string& gid, const char* status, uint64_t completed,
+                                          uint64_t total, uint64_t speed) {
+    return "{\"id\":\"foo_downloader\",\"jsonrpc\":\"2.0\",\"result\":{"
+           "\"bitfield\":\"ffffffffffffffffffffffffffffffffffffffffffffffff80\","
+           "\"completedLength\":\"" + std::to_string(completed) + "\","
+           "\"connections\":\"4\",\"dir\":\"/home/user/Music\",\"downloadSpeed\":\"" + std::to_string(speed) + "\","
+           "\"files\":[{\"completedLength\":\"" + std::to_string(completed) + "\",\"index\":\"1\","
+           "\"length\":\"" + std::to_string(total) + "\",\"path\":\"/home/user/Music/" + gid + " - Track.flac\","
+           "\"selected\":\"true\",\"uris\":[{\"status\":\"used\",\"uri\":\"https://cdn.example.com/a/" + gid +
+           ".flac\"},{\"status\":\"waiting\",\"uri\":\"https://cdn.example.com/a/" + gid + ".flac\"}]}],"
+           "\"gid\":\"" + gid + "\",\"numPieces\":\"49\",\"pieceLength\":\"1048576\","
+           "\"status\":\"" + status + "\",\"totalLength\":\"" + std::to_string(total) + "\","
+           "\"uploadLength\":\"0\",\"uploadSpeed\":\"0\"}}";
+}
+
+// One line of `yt-dlp -j` output. Real lines run to tens of kilobytes of
+// formats and thumbnails; `padding` stands in for them.
+inline std::string MakeYouTubeResultLine(int i, size_t padding) {
+    std::string id = "vid" + std::to_string(100000 + i);
+    std::string formats = "\"formats\":[";
+    while (formats.size() < padding) {
+        formats += "{\"format_id\":\"251\",\"ext\":\"webm\",\"acodec\":\"opus\",\"url\":\"https://rr1.example.com/"
+                   "videoplayback?expire=1700000000&id=" + id + "\"},";
+    }
+    formats += "{}]";
+    return "{\"id\":\"" + id + "\",\"title\":\"Artist " + std::to_string(i) + " - Song Title (Official Audio)\"," +
+           formats + ",\"channel\":\"Artist " + std::to_string(i) + "\",\"uploader\":\"Artist VEVO\","
+           "\"duration\":" + std::to_string(180 + i % 120) + ",\"view_count\":" + std::to_string(1000000 + i) +
+           ",\"upload_date\":\"20230115\",\"description\":\"Stream \\\"Song Title\\\" now: https://example.com\"}";
+}
+
+// One templated progress line, as requested by YtDlpReportingFlags()
+inline std::string MakeYtDlpProgressLine(uint64_t downloaded) {
+    return "[fdl-progress] " + std::to_string(downloaded) + " 3439329 null 1289748.3 " +
+           std::to_string((3439329 - downloaded) / 1289748) + "\n";
+}
+
+// yt-dlp output up to the `lines`-th progress line
+inline std::string MakeYtDlpOutput(int lines) {
+    std::string out;
+    for (int i = 0; i < lines; i++) out += MakeYtDlpProgressLine(3439329ull * i / lines);
+    return out;
+}
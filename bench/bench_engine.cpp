@@ -0,0 +1,279 @@
+#include "bench_host.h"
+
+#include "aria2_rpc.h"
+#include "download_manager.h"
+#include "host.h"
+#include "platform.h"
+
+#include <benchmark/benchmark.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <thread>
+#include <vector>
+
+// ============================================================================
+// End-to-end runs of the download engine
+// ============================================================================
+// Unlike the microbenchmarks these drive DownloadManager the way the
+// component does, poll thread and child processes included, so an iteration
+// takes seconds. Each one queues a batch through StartBulkDownload() and
+// stops the clock once nothing it queued is resolving, queued or active.
+// ============================================================================
+
+// aria2's RPC port for these runs, away from the default a user's own
+// aria2 or foo_downloader_cli may be listening on
+static const int BENCH_ARIA2_PORT = 16800;
+
+// Size of the file the stand-in server hands out
+static const size_t SERVED_FILE_SIZE = 64 * 1024;
+
+// Ports the server listens on. Each counts as a host of its own, so the
+// per-host transfer limit does not serialize the run.
+static const int SERVED_HOSTS = 16;
+
+// Entries with an id above `firstId` still being worked on
+static bool AnyLive(const std::vector<DownloadEntry>& entries, uint64_t firstId, bool* resolving) {
+    bool live = false;
+    *resolving = false;
+    for (const auto& e : entries) {
+        if (e.id <= firstId) continue;
+        if (e.status == "resolving") *resolving = true;
+        if (e.status == "resolving" || e.status == "queued" || e.status == "active" || e.status == "paused") {
+            live = true;
+        }
+    }
+    return live;
+}
+
+// Queues `inputs` as one bulk import and waits for all of it to finish.
+// Returns how many files arrived in the output folder, and empties it;
+// `importSeconds`, if given, receives the time until the last input was
+// resolved and queued.
+static size_t RunBatch(const std::string& sourceId, const std::vector<std::string>& inputs,
+                       double* importSeconds = nullptr) {
+    auto& manager = DownloadManager::instance();
+    uint64_t firstId = 0;
+    for (const auto& e : manager.GetDownloads()) firstId = (std::max)(firstId, e.id);
+
+    uint64_t start = TickMs();
+    if (manager.StartBulkDownload(sourceId, inputs) == 0) return 0;
+    bool imported = false;
+    for (;;) {
+        SleepMs(10);
+        // This loop is the main thread the manager publishes progress to
+        manager.DispatchUpdates();
+        bool resolving = false;
+        bool live = AnyLive(manager.GetDownloads(), firstId, &resolving);
+        if (!resolving && !imported) {
+            imported = true;
+            if (importSeconds) *importSeconds = (TickMs() - start) / 1000.0;
+        }
+        if (!live) break;
+    }
+
+    size_t files = 0;
+    for (const auto& name : ListFiles(BenchOutputDirectory())) {
+        RemoveFile(JoinPath(BenchOutputDirectory(), name));
+        files++;
+    }
+    return files;
+}
+
+// ============================================================================
+// yt-dlp job queue: default slot count against no limit
+// ============================================================================
+// The stand-in yt-dlp spends about as much CPU as a Python start-up,
+// extraction and transcode of a short track, then writes its file. With a
+// slot per job the processes compete for the cores; with half the cores,
+// PromoteYtDlpJobs() starts each as the one before it ends.
+// ============================================================================
+
+static const char* STUB_YTDLP =
+    "#!/usr/bin/env python3\n"
+    "import os, sys\n"
+    "out = sys.argv[sys.argv.index('-o') + 1]\n"
+    "video = sys.argv[-1].rsplit('=', 1)[-1]\n"
+    "n = 0\n"
+    "for i in range(2000000):\n"
+    "    n += i * i\n"
+    "path = os.path.join(os.path.dirname(out), video + '.flac')\n"
+    "open(path, 'wb').close()\n"
+    "print('[fdl-file] ' + path, flush=True)\n";
+
+static std::string StubYtDlpPath() {
+    static const std::string path = [] {
+        std::string p = JoinPath(BenchScratchDirectory(), "yt-dlp");
+        std::ofstream(p, std::ios::binary | std::ios::trunc) << STUB_YTDLP;
+        chmod(p.c_str(), 0755);
+        return p;
+    }();
+    return path;
+}
+
+static void BM_YtDlpJobQueue(benchmark::State& state, bool unlimited) {
+    const int jobs = (std::max)(8, 2 * (int)std::thread::hardware_concurrency());
+    BenchSettings().ytdlpPath = StubYtDlpPath();
+    BenchSettings().ytdlpJobs = unlimited ? (std::numeric_limits<int>::max)() : 0;
+
+    static int batch = 0;
+    size_t done = 0;
+    for (auto _ : state) {
+        std::vector<std::string> urls;
+        for (int i = 0; i < jobs; i++) {
+            urls.push_back("https://www.youtube.com/watch?v=b" + std::to_string(batch) + "j" + std::to_string(i));
+        }
+        batch++;
+        size_t completed = RunBatch("youtube", urls);
+        done += completed;
+        if (completed != urls.size()) {
+            state.SkipWithError("yt-dlp jobs failed; is python3 on PATH?");
+            break;
+        }
+    }
+    state.counters["jobs"] = jobs;
+    state.counters["max_jobs"] = unlimited ? jobs : GetConfigYtDlpMaxJobs();
+    state.counters["jobs_per_second"] = benchmark::Counter((double)done, benchmark::Counter::kIsRate);
+}
+BENCHMARK_CAPTURE(BM_YtDlpJobQueue, half_cores, false)->UseRealTime()->Unit(benchmark::kSecond);
+BENCHMARK_CAPTURE(BM_YtDlpJobQueue, unlimited, true)->UseRealTime()->Unit(benchmark::kSecond);
+
+// ============================================================================
+// Bulk import of direct URLs against a local HTTP server
+// ============================================================================
+// The server answers every GET with the same small file, one connection at
+// a time per port, so the figures are those of the import and of aria2
+// rather than of a network. The URLs go round the ports, and aria2 may run
+// as many transfers as the hosts admit together. It needs aria2c on PATH.
+// ============================================================================
+
+class LocalHttpServer {
+public:
+    // Ports it listens on, empty if it could not be started
+    static const std::vector<int>& Ports() {
+        static const std::vector<int> ports = [] {
+            std::vector<int> started;
+            for (int i = 0; i < SERVED_HOSTS; i++) {
+                int port = Listen();
+                if (port == 0) return std::vector<int>();
+                started.push_back(port);
+            }
+            return started;
+        }();
+        return ports;
+    }
+
+private:
+    static int Listen() {
+        int listener = socket(AF_INET, SOCK_STREAM, 0);
+        if (listener < 0) return 0;
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        if (bind(listener, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, 64) != 0 ||
+            getsockname(listener, (sockaddr*)&addr, &len) != 0) {
+            close(listener);
+            return 0;
+        }
+        // Serves until the process exits
+        std::thread([listener]() {
+            for (;;) {
+                int conn = accept(listener, nullptr, nullptr);
+                if (conn < 0) continue;
+                Serve(conn);
+                close(conn);
+            }
+        }).detach();
+        return ntohs(addr.sin_port);
+    }
+
+    static void Serve(int conn) {
+        static const std::string body(SERVED_FILE_SIZE, 'x');
+        std::string request;
+        char buf[4096];
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < 65536) {
+            ssize_t got = recv(conn, buf, sizeof(buf), 0);
+            if (got <= 0) return;
+            request.append(buf, (size_t)got);
+        }
+        std::string response = "HTTP/1.1 200 OK\r\n"
+                               "Content-Type: application/octet-stream\r\n"
+                               "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                               "Connection: close\r\n\r\n";
+        if (request.compare(0, 5, "HEAD ") != 0) response += body;
+        size_t sent = 0;
+        while (sent < response.size()) {
+            ssize_t n = send(conn, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) return;
+            sent += (size_t)n;
+        }
+    }
+};
+
+static bool StartAria2() {
+    static const bool started = [] {
+        auto& aria2 = Aria2RpcClient::instance();
+        aria2.SetPort(BENCH_ARIA2_PORT);
+        aria2.SetOutputDir(BenchOutputDirectory());
+        aria2.SetMaxConcurrent(SERVED_HOSTS * GetConfigAria2MaxPerHost());
+        return aria2.Start();
+    }();
+    return started;
+}
+
+static void BM_BulkImport(benchmark::State& state) {
+    const size_t count = (size_t)state.range(0);
+    const std::vector<int>& ports = LocalHttpServer::Ports();
+    if (ports.empty()) {
+        state.SkipWithError("cannot listen on 127.0.0.1");
+        return;
+    }
+    if (!StartAria2()) {
+        state.SkipWithError("cannot start aria2c; is it on PATH?");
+        return;
+    }
+
+    static int batch = 0;
+    size_t done = 0;
+    double importSeconds = 0;
+    for (auto _ : state) {
+        std::vector<std::string> urls;
+        for (size_t i = 0; i < count; i++) {
+            urls.push_back("http://127.0.0.1:" + std::to_string(ports[i % ports.size()]) + "/b" +
+                           std::to_string(batch) + "-" + std::to_string(i) + ".bin");
+        }
+        batch++;
+        double seconds = 0;
+        size_t completed = RunBatch("direct_url", urls, &seconds);
+        done += completed;
+        importSeconds += seconds;
+        if (completed != urls.size()) {
+            state.SkipWithError("downloads failed");
+            break;
+        }
+    }
+    state.SetItemsProcessed((int64_t)done);
+    // Resolved and queued, before aria2 has fetched them all
+    state.counters["imported_per_second"] = importSeconds > 0 ? done / importSeconds : 0.0;
+}
+BENCHMARK(BM_BulkImport)->Arg(1000)->UseRealTime()->Unit(benchmark::kSecond);
+
+// As in foo_downloader_cli, the engine is shut down before static
+// destruction; its poll thread would otherwise outlive the metrics registry
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    DownloadManager::instance().Shutdown();
+    Aria2RpcClient::instance().Stop();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,161 @@
+#include "history_db.h"
+#include "url_index.h"
+
+#include <benchmark/benchmark.h>
+#include <sqlite3.h>
+
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <memory>
+
+// ============================================================================
+// History database fixtures
+// ============================================================================
+// One on-disk database per row count, built on first use and shared by every
+// benchmark that asks for that size, so SQLite pays real page cache and WAL
+// costs. Files live in the system temp directory and are removed at exit.
+// ============================================================================
+
+static const int HISTORY_WINDOW_SIZE = 200;   // Rows LoadHistory() keeps in memory
+static const int SAVE_BATCH_SIZE = 50;        // Downloads finished between two saves
+
+static DownloadEntry MakeFinishedEntry(int64_t i) {
+    DownloadEntry e;
+    e.url = "https://www.youtube.com/watch?v=v" + std::to_string(1000000 + i);
+    e.title = "Artist - Track " + std::to_string(i) + ".opus";
+    e.outputPath = "/home/user/Music/" + e.title;
+    e.sourceId = "youtube";
+    e.engine = "ytdlp";
+    e.status = (i % 20 == 0) ? "error" : "complete";
+    if (e.status == "error") e.errorMessage = "ERROR: [youtube] Video unavailable";
+    e.times.resolveStart = 1000;
+    e.times.resolveEnd = 1850;
+    e.times.submitted = 1900;
+    e.times.firstByte = 2300;
+    e.times.transferEnd = 9100;
+    e.times.postProcessEnd = 9800;
+    e.times.playlistInsert = 9820;
+    return e;
+}
+
+class HistoryFixture {
+public:
+    explicit HistoryFixture(int rows) {
+        m_path = (std::filesystem::temp_directory_path() /
+                  ("foo_downloader_bench_" + std::to_string(rows) + ".db")).string();
+        RemoveFiles();
+
+        std::string error;
+        if (!OpenHistoryDb(m_path, &m_db, error) || !CreateHistorySchema(m_db, error)) {
+            fprintf(stderr, "history fixture: %s\n", error.c_str());
+            return;
+        }
+        std::vector<DownloadEntry> entries;
+        entries.reserve(rows);
+        for (int i = 0; i < rows; i++) entries.push_back(MakeFinishedEntry(i));
+        std::vector<std::string> keys;
+        InsertFinishedDownloads(m_db, entries, keys);
+        m_rows = rows;
+    }
+
+    ~HistoryFixture() {
+        if (m_db) sqlite3_close(m_db);
+        RemoveFiles();
+    }
+
+    sqlite3* db() const { return m_db; }
+    int rows() const { return m_rows; }
+
+    // Drop rows added by a benchmark so the next one sees the original size
+    void Truncate() {
+        std::string sql = "DELETE FROM downloads WHERE id > " + std::to_string(m_rows) + ";";
+        sqlite3_exec(m_db, sql.c_str(), nullptr, nullptr, nullptr);
+    }
+
+    static HistoryFixture& Get(int rows) {
+        static std::map<int, std::unique_ptr<HistoryFixture>> fixtures;
+        auto& fixture = fixtures[rows];
+        if (!fixture) fixture.reset(new HistoryFixture(rows));
+        return *fixture;
+    }
+
+private:
+    void RemoveFiles() {
+        std::error_code ec;
+        for (const char* suffix : { "", "-wal", "-shm" }) std::filesystem::remove(m_path + suffix, ec);
+    }
+
+    std::string m_path;
+    sqlite3* m_db = nullptr;
+    int m_rows = 0;
+};
+
+// ============================================================================
+// SaveHistory / LoadHistory
+// ============================================================================
+
+// One SaveHistory() call appending a batch of finished downloads to a table
+// of the given size
+static void BM_SaveHistory(benchmark::State& state) {
+    HistoryFixture& fixture = HistoryFixture::Get((int)state.range(0));
+    if (!fixture.db()) {
+        state.SkipWithError("could not create history database");
+        return;
+    }
+    std::vector<DownloadEntry> batch;
+    std::vector<std::string> keys;
+    for (auto _ : state) {
+        state.PauseTiming();
+        batch.clear();
+        keys.clear();
+        for (int i = 0; i < SAVE_BATCH_SIZE; i++) batch.push_back(MakeFinishedEntry(fixture.rows() + i));
+        state.ResumeTiming();
+
+        benchmark::DoNotOptimize(InsertFinishedDownloads(fixture.db(), batch, keys));
+
+        state.PauseTiming();
+        fixture.Truncate();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * SAVE_BATCH_SIZE);
+}
+BENCHMARK(BM_SaveHistory)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMicrosecond);
+
+// The startup path of LoadHistory(): url_key backfill (a no-op once done),
+// the duplicate filter rebuild and the newest window of rows
+static void BM_LoadHistory(benchmark::State& state) {
+    HistoryFixture& fixture = HistoryFixture::Get((int)state.range(0));
+    if (!fixture.db()) {
+        state.SkipWithError("could not create history database");
+        return;
+    }
+    BloomFilter filter;
+    std::vector<DownloadEntry> rows;
+    for (auto _ : state) {
+        rows.clear();
+        benchmark::DoNotOptimize(BackfillUrlKeys(fixture.db()));
+        LoadCompletedUrlKeys(fixture.db(), filter);
+        SelectHistoryRows(fixture.db(), INT64_MAX, HISTORY_WINDOW_SIZE, rows);
+        benchmark::DoNotOptimize(rows.data());
+    }
+    state.counters["keys"] = (double)filter.GetKeyCount();
+}
+BENCHMARK(BM_LoadHistory)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+// A history dialog page from the middle of the table
+static void BM_QueryHistoryPage(benchmark::State& state) {
+    int total = (int)state.range(0);
+    HistoryFixture& fixture = HistoryFixture::Get(total);
+    if (!fixture.db()) {
+        state.SkipWithError("could not create history database");
+        return;
+    }
+    std::vector<DownloadEntry> rows;
+    for (auto _ : state) {
+        rows.clear();
+        SelectHistoryRows(fixture.db(), total / 2, HISTORY_WINDOW_SIZE, rows);
+        benchmark::DoNotOptimize(rows.data());
+    }
+}
+BENCHMARK(BM_QueryHistoryPage)->Arg(1000)->Arg(10000)->Arg(100000)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,76 @@
+#include "bench_host.h"
+
+#include "host.h"
+#include "platform.h"
+
+#include <cstdlib>
+#include <thread>
+
+BenchHostSettings& BenchSettings() {
+    static BenchHostSettings settings;
+    return settings;
+}
+
+std::string BenchScratchDirectory() {
+    static const std::string dir = [] {
+        char pattern[] = "/tmp/foo_downloader_bench.XXXXXX";
+        const char* made = mkdtemp(pattern);
+        return JoinPath(made ? made : "/tmp", "");
+    }();
+    return dir;
+}
+
+std::string BenchOutputDirectory() {
+    static const std::string dir = [] {
+        std::string d = JoinPath(BenchScratchDirectory(), "out");
+        MakeDirectory(d);
+        return d;
+    }();
+    return dir;
+}
+
+void HostLog(const std::string&) {}
+
+void HostShowError(const std::string&) {}
+
+bool HostConfirm(const std::string&, const std::atomic<bool>&) {
+    return false;
+}
+
+void HostDownloadComplete(const std::string&, std::function<void()>) {}
+
+std::string HostDataDirectory() {
+    return BenchScratchDirectory();
+}
+
+// ============================================================================
+// Settings
+// ============================================================================
+
+const char* GetConfigOutputFolder() {
+    static const std::string dir = BenchOutputDirectory();
+    return dir.c_str();
+}
+bool GetConfigEmbedMetadata() { return true; }
+const char* GetConfigYtDlpPath() { return BenchSettings().ytdlpPath.c_str(); }
+const char* GetConfigYtDlpExtraFlags() { return ""; }
+int GetConfigYtQuality() { return 0; }
+// The stand-in yt-dlp is a script, not a module a worker could import
+bool GetConfigYtDlpWorker() { return false; }
+const char* GetConfigPythonPath() { return ""; }
+bool GetConfigYtDlpViaAria2() { return false; }
+int GetConfigRetryCount() { return 0; }
+int GetConfigAria2MaxPerHost() { return 2; }
+int GetConfigAria2HostGapMs() { return 0; }
+// Every run downloads again what the previous iteration did
+int GetConfigDuplicatePolicy() { return 2; }
+const char* GetConfigCustomSourceUrl() { return ""; }
+bool GetConfigEnableCustomSource() { return false; }
+bool GetConfigEnableYoutube() { return true; }
+bool GetConfigEnableDirectUrl() { return true; }
+
+int GetConfigYtDlpMaxJobs() {
+    if (BenchSettings().ytdlpJobs > 0) return BenchSettings().ytdlpJobs;
+    int cores = (int)std::thread::hardware_concurrency();
+    return cores >= 2 ? cores / 2 : 1;
+}
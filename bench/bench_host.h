@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+
+// ============================================================================
+// host.h for the engine benchmark
+// ============================================================================
+// Silent: log lines, errors and finished paths are dropped. Settings are the
+// component's defaults apart from the fields below, which a benchmark sets
+// before its run. The history database and downloads go to a scratch
+// directory under /tmp, made once per process.
+// ============================================================================
+
+struct BenchHostSettings {
+    std::string ytdlpPath;
+    int ytdlpJobs = 0;      // 0 = half the cores, as in the component
+};
+
+BenchHostSettings& BenchSettings();
+
+// The scratch directory, with a trailing separator
+std::string BenchScratchDirectory();
+
+// Where downloads are saved, inside the scratch directory
+std::string BenchOutputDirectory();
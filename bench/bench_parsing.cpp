@@ -0,0 +1,151 @@
+#include "bench_data.h"
+
+#include "aria2_protocol.h"
+#include "search_results.h"
+#include "url_index.h"
+#include "ytdlp_output.h"
+
+#include <benchmark/benchmark.h>
+
+// ============================================================================
+// aria2 responses
+// ============================================================================
+
+static void BM_Aria2TellStatus(benchmark::State& state) {
+    std::string response = MakeTellStatusResponse("2089b05ecca3d829", "active", 24117248, 51380224, 1572864);
+    for (auto _ : state) {
+        Aria2Status status = ParseAria2Status(response);
+        benchmark::DoNotOptimize(status);
+    }
+    state.SetBytesProcessed(state.iterations() * (int64_t)response.size());
+}
+BENCHMARK(BM_Aria2TellStatus);
+
+static void BM_Aria2MulticallGids(benchmark::State& state) {
+    size_t count = (size_t)state.range(0);
+    std::string response = "{\"id\":\"foo_downloader\",\"jsonrpc\":\"2.0\",\"result\":[";
+    for (size_t i = 0; i < count; i++) {
+        if (i > 0) response += ",";
+        if (i % 10 == 9) {
+            response += "{\"code\":1,\"message\":\"No URI to download.\"}";
+        } else {
+            response += "[\"" + std::to_string(0x2089b05ecca3d000ull + i) + "\"]";
+        }
+    }
+    response += "]}";
+
+    std::vector<std::string> gids, errors;
+    for (auto _ : state) {
+        gids.clear();
+        errors.clear();
+        benchmark::DoNotOptimize(ParseAria2MulticallGids(response, count, gids, errors));
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)count);
+}
+BENCHMARK(BM_Aria2MulticallGids)->Arg(1)->Arg(16)->Arg(256);
+
+// ============================================================================
+// yt-dlp progress
+// ============================================================================
+
+static void BM_YtDlpProgressLine(benchmark::State& state) {
+    std::string line = "[download]  42.3% of    5.12MiB at    1.23MiB/s ETA 00:03";
+    for (auto _ : state) {
+        YtDlpOutput out;
+        ParseYtDlpProgressLine(line, out);
+        benchmark::DoNotOptimize(out);
+    }
+}
+BENCHMARK(BM_YtDlpProgressLine);
+
+static void BM_YtDlpTemplateLine(benchmark::State& state) {
+    std::string line = MakeYtDlpProgressLine(1454000);
+    line.pop_back();
+    for (auto _ : state) {
+        YtDlpOutput out;
+        ParseYtDlpTemplateLine(line, out);
+        benchmark::DoNotOptimize(out);
+    }
+}
+BENCHMARK(BM_YtDlpTemplateLine);
+
+// Whole output of a download that printed N progress lines, parsed at once
+static void BM_YtDlpOutput(benchmark::State& state) {
+    std::string captured = MakeYtDlpOutput((int)state.range(0));
+    for (auto _ : state) {
+        YtDlpOutput out = ParseYtDlpOutput(captured);
+        benchmark::DoNotOptimize(out);
+    }
+    state.SetBytesProcessed(state.iterations() * (int64_t)captured.size());
+}
+BENCHMARK(BM_YtDlpOutput)->Arg(10)->Arg(1000)->Arg(100000);
+
+// One poll's worth of new output for a download that has already printed N
+// progress lines; should not depend on N
+static void BM_YtDlpOutputPoll(benchmark::State& state) {
+    YtDlpOutputParser parser;
+    parser.Feed(MakeYtDlpOutput((int)state.range(0)));
+    std::string chunk = MakeYtDlpProgressLine(1454000);
+    for (auto _ : state) {
+        parser.Feed(chunk);
+        benchmark::DoNotOptimize(parser.State());
+    }
+    state.SetBytesProcessed(state.iterations() * (int64_t)chunk.size());
+}
+BENCHMARK(BM_YtDlpOutputPoll)->Arg(10)->Arg(1000)->Arg(100000);
+
+// ============================================================================
+// Search results
+// ============================================================================
+
+static void BM_YouTubeSearchOutput(benchmark::State& state) {
+    std::string output;
+    for (int i = 0; i < 10; i++) output += MakeYouTubeResultLine(i, (size_t)state.range(0)) + "\n";
+    for (auto _ : state) {
+        auto results = ParseYouTubeSearchOutput(output);
+        benchmark::DoNotOptimize(results);
+    }
+    state.SetBytesProcessed(state.iterations() * (int64_t)output.size());
+}
+BENCHMARK(BM_YouTubeSearchOutput)->Arg(0)->Arg(16 << 10);
+
+static void BM_CustomSearchResponse(benchmark::State& state) {
+    int count = (int)state.range(0);
+    std::string response = "{\"data\":[";
+    for (int i = 0; i < count; i++) {
+        if (i > 0) response += ",";
+        response += "{\"id\":" + std::to_string(1000 + i) + ",\"title\":\"Track " + std::to_string(i) +
+                    "\",\"duration\":" + std::to_string(200 + i) + ",\"explicit\":false,"
+                    "\"artist\":{\"id\":7,\"name\":\"Some \\\"Quoted\\\" Artist\",\"picture\":null},"
+                    "\"album\":{\"id\":9,\"title\":\"Album [Deluxe]\",\"cover\":\"https://example.com/c.jpg\"}}";
+    }
+    response += "],\"total\":" + std::to_string(count) + "}";
+
+    for (auto _ : state) {
+        auto results = ParseCustomSearchResponse(response);
+        benchmark::DoNotOptimize(results);
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_CustomSearchResponse)->Arg(25)->Arg(100);
+
+// ============================================================================
+// URLs
+// ============================================================================
+
+static void BM_UrlEncode(benchmark::State& state) {
+    std::string query = "Sigur R\xc3\xb3s - Hopp\xc3\xadpolla (Live at Heima) & friends / 2007";
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(UrlEncode(query));
+    }
+    state.SetBytesProcessed(state.iterations() * (int64_t)query.size());
+}
+BENCHMARK(BM_UrlEncode);
+
+static void BM_NormalizeUrl(benchmark::State& state) {
+    std::string url = "https://music.YouTube.com/watch?v=dQw4w9WgXcQ&list=RDAMVM&feature=share#t=30";
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(NormalizeUrl(url));
+    }
+}
+BENCHMARK(BM_NormalizeUrl);
@@ -0,0 +1,80 @@
+#include "bench_data.h"
+
+#include "download_entry.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+
+// ============================================================================
+// Manager poll sweep against a mocked aria2
+// ============================================================================
+// Stands in for the aria2 half of DownloadManager::PollThread: every tick
+// reads each active job's tellStatus, folds it into the entry, and collects
+// the dirty entries into the delta handed to the UI. The engine replays
+// pre-rendered responses so only the manager's own work is measured.
+// ============================================================================
+
+class MockAria2Engine {
+public:
+    explicit MockAria2Engine(size_t jobs) {
+        const uint64_t total = 48ull << 20;
+        for (int frame = 0; frame < FRAME_COUNT; frame++) {
+            m_frames[frame].reserve(jobs);
+            for (size_t i = 0; i < jobs; i++) {
+                // Every fourth job is paused, so part of each sweep changes nothing
+                bool paused = (i % 4 == 3);
+                uint64_t done = paused ? total / 3 : total / FRAME_COUNT * frame + i;
+                m_frames[frame].push_back(MakeTellStatusResponse(Gid(i), paused ? "paused" : "active", done, total,
+                                                                  paused ? 0 : 1572864 + i));
+            }
+        }
+    }
+
+    static std::string Gid(size_t i) {
+        char gid[17];
+        snprintf(gid, sizeof(gid), "%016zx", i + 1);
+        return gid;
+    }
+
+    void NextTick() { m_frame = (m_frame + 1) % FRAME_COUNT; }
+    const std::string& TellStatus(size_t job) const { return m_frames[m_frame][job]; }
+
+private:
+    static const int FRAME_COUNT = 8;
+    std::vector<std::string> m_frames[FRAME_COUNT];
+    int m_frame = 0;
+};
+
+static void BM_PollSweep(benchmark::State& state) {
+    size_t jobs = (size_t)state.range(0);
+    MockAria2Engine engine(jobs);
+
+    std::vector<DownloadEntry> entries(jobs);
+    for (size_t i = 0; i < jobs; i++) {
+        entries[i].id = i + 1;
+        entries[i].gid = MockAria2Engine::Gid(i);
+        entries[i].engine = "aria2";
+        entries[i].status = "queued";
+    }
+
+    uint64_t now = 1000;
+    size_t published = 0;
+    std::vector<DownloadUpdate> delta;
+    for (auto _ : state) {
+        engine.NextTick();
+        delta.clear();
+        for (size_t i = 0; i < jobs; i++) {
+            Aria2Status status = ParseAria2Status(engine.TellStatus(i));
+            ApplyAria2Status(entries[i], status, now);
+            if (entries[i].dirtyFields == 0) continue;
+            MergeDownloadUpdate(delta, MakeDownloadUpdate(entries[i]));
+            entries[i].dirtyFields = 0;
+        }
+        published += delta.size();
+        now += 500;
+    }
+    state.SetItemsProcessed(state.iterations() * (int64_t)jobs);
+    state.counters["updates_per_tick"] = state.iterations() ? (double)published / state.iterations() : 0.0;
+}
+BENCHMARK(BM_PollSweep)->Arg(10)->Arg(100)->Arg(1000);
@@ -0,0 +1,97 @@
+#include "cli_options.h"
+
+#include "host.h"
+#include "platform.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+// ============================================================================
+// host.h for the command-line tool
+// ============================================================================
+// Log lines go to stderr, finished paths to stdout, so the output can be
+// piped into another program. There is nobody to ask questions.
+// ============================================================================
+
+CliOptions& Options() {
+    static CliOptions options;
+    return options;
+}
+
+std::atomic<int> g_errorsShown{ 0 };
+
+static std::mutex& OutputMutex() {
+    static std::mutex m;
+    return m;
+}
+
+void HostLog(const std::string& line) {
+    if (Options().quiet) return;
+    std::lock_guard<std::mutex> lock(OutputMutex());
+    fprintf(stderr, "%s\n", line.c_str());
+}
+
+void HostShowError(const std::string& message) {
+    g_errorsShown++;
+    std::lock_guard<std::mutex> lock(OutputMutex());
+    fprintf(stderr, "error: %s\n", message.c_str());
+}
+
+bool HostConfirm(const std::string&, const std::atomic<bool>&) {
+    return false;
+}
+
+void HostDownloadComplete(const std::string& path, std::function<void()>) {
+    std::lock_guard<std::mutex> lock(OutputMutex());
+    fprintf(stdout, "%s\n", path.c_str());
+    fflush(stdout);
+}
+
+std::string HostDataDirectory() {
+    static const std::string dir = [] {
+        std::string d = Options().dataDir;
+        if (d.empty()) {
+#ifdef _WIN32
+            d = ModuleDirectory();
+#else
+            const char* xdg = getenv("XDG_DATA_HOME");
+            const char* home = getenv("HOME");
+            if (xdg && *xdg) d = JoinPath(xdg, "foo_downloader");
+            else d = JoinPath(JoinPath(home && *home ? home : ".", ".local/share"), "foo_downloader");
+#endif
+        }
+        MakeDirectory(d);
+        return JoinPath(d, "");
+    }();
+    return dir;
+}
+
+// ============================================================================
+// Settings
+// ============================================================================
+
+const char* GetConfigOutputFolder() { return Options().outputDir.c_str(); }
+bool GetConfigEmbedMetadata() { return Options().embedMetadata; }
+const char* GetConfigYtDlpPath() { return Options().ytdlpPath.c_str(); }
+const char* GetConfigYtDlpExtraFlags() { return Options().ytdlpFlags.c_str(); }
+bool GetConfigYtDlpWorker() { return Options().ytdlpWorker; }
+bool GetConfigYtDlpViaAria2() { return Options().ytdlpViaAria2; }
+const char* GetConfigPythonPath() { return Options().pythonPath.c_str(); }
+int GetConfigYtQuality() { return Options().quality; }
+int GetConfigRetryCount() { return Options().retries; }
+int GetConfigAria2MaxPerHost() { return Options().perHost; }
+int GetConfigAria2HostGapMs() { return Options().hostGapMs; }
+// Bulk imports never prompt, so "ask" would behave like "skip" anyway
+int GetConfigDuplicatePolicy() { return Options().redownload ? 2 : 1; }
+const char* GetConfigCustomSourceUrl() { return Options().customSourceUrl.c_str(); }
+bool GetConfigEnableCustomSource() { return !Options().customSourceUrl.empty(); }
+bool GetConfigEnableYoutube() { return true; }
+bool GetConfigEnableDirectUrl() { return true; }
+
+int GetConfigYtDlpMaxJobs() {
+    if (Options().ytdlpJobs > 0) return Options().ytdlpJobs;
+    int cores = (int)std::thread::hardware_concurrency();
+    return cores >= 2 ? cores / 2 : 1;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// Command-line settings; the CLI's stand-in for the preferences page
+// ============================================================================
+// Defaults match the component's. cli_host.cpp serves the GetConfig*()
+// getters in host.h from these.
+// ============================================================================
+
+struct CliOptions {
+    std::string source = "direct_url";
+    std::vector<std::string> inputs;    // Positional arguments
+    std::string inputFile;              // One input per line; "-" = stdin
+    bool daemon = false;                // Keep queueing lines read from stdin
+    bool quiet = false;                 // Only finished paths and errors
+
+    std::string outputDir;              // Empty = <music folder>/foo_downloader
+    std::string dataDir;                // Empty = see HostDataDirectory()
+    int port = 6800;
+    std::string aria2Path;              // Empty = FindTool("aria2c")
+    int maxConcurrent = 3;
+    int retries = 3;
+    int perHost = 2;
+    int hostGapMs = 500;
+    bool redownload = false;
+
+    std::string ytdlpPath;              // Empty = FindTool("yt-dlp")
+    std::string ytdlpFlags;
+    int ytdlpJobs = 0;                  // 0 = half the cores
+    bool ytdlpWorker = true;            // Keep yt-dlp loaded between jobs
+    std::string pythonPath;             // Empty = python3/python on PATH
+    bool ytdlpViaAria2 = false;         // aria2 fetches the audio stream yt-dlp looked up
+    int quality = 0;                    // Index into g_ytQualities
+    bool embedMetadata = true;
+    std::string customSourceUrl;
+};
+
+CliOptions& Options();
+
+// HostShowError() calls so far; any makes the run fail
+extern std::atomic<int> g_errorsShown;
@@ -0,0 +1,264 @@
+// foo_downloader_cli — the download core without foobar2000
+//
+// Queues URLs or search queries through the same DownloadManager,
+// Aria2RpcClient and source providers as the component, prints each
+// finished file's path on stdout and exits when everything has settled.
+// With --daemon it keeps running and queues every line that arrives on
+// stdin until SIGINT/SIGTERM; unfinished jobs stay journaled in
+// downloads.db and resume on the next start.
+
+#include "cli_options.h"
+
+#include "aria2_rpc.h"
+#include "download_manager.h"
+#include "host.h"
+#include "platform.h"
+#include "source_manager.h"
+
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+
+static std::atomic<bool> g_stop{ false };
+
+static void OnSignal(int) {
+    g_stop = true;
+}
+
+static void PrintUsage() {
+    printf(
+        "Usage: foo_downloader_cli [options] [INPUT...]\n"
+        "\n"
+        "Downloads each INPUT (a URL, or a search query for the search sources)\n"
+        "and prints the path of every finished file.\n"
+        "\n"
+        "  -s, --source ID        direct_url (default), youtube or custom_source\n"
+        "  -i, --input FILE       Also read inputs from FILE, one per line ('-' = stdin)\n"
+        "  -d, --daemon           Keep running and queue each line read from stdin\n"
+        "  -o, --output DIR       Download folder (default: ~/Music/foo_downloader)\n"
+        "      --data-dir DIR     Where downloads.db is kept\n"
+        "                         (default: $XDG_DATA_HOME/foo_downloader)\n"
+        "  -j, --jobs N           Concurrent aria2 downloads (default 3)\n"
+        "      --ytdlp-jobs N     Concurrent yt-dlp downloads (default: half the cores)\n"
+        "      --retries N        Retries per download (default 3)\n"
+        "      --per-host N       aria2 transfers per host (default 2)\n"
+        "      --host-gap MS      Minimum gap between requests to one host (default 500)\n"
+        "      --redownload       Download items already in the history again\n"
+        "      --quality N        yt-dlp quality preset, 0 = FLAC (default 0)\n"
+        "      --no-embed         Do not embed metadata and thumbnails (yt-dlp)\n"
+        "      --ytdlp-flags STR  Extra yt-dlp arguments\n"
+        "      --custom-url URL   Base URL of the custom source\n"
+        "      --aria2c PATH      aria2c executable\n"
+        "      --yt-dlp PATH      yt-dlp executable\n"
+        "      --python PATH      Python for the yt-dlp worker (default: on PATH)\n"
+        "      --no-worker        Start yt-dlp anew for every job\n"
+        "      --ytdlp-aria2      Fetch YouTube audio with aria2; yt-dlp only looks up and converts\n"
+        "      --port N           aria2 RPC port (default 6800)\n"
+        "  -q, --quiet            Only print finished paths and errors\n"
+        "  -h, --help             Show this help\n");
+}
+
+// Returns false (after printing why) if the command line is invalid
+static bool ParseArgs(int argc, char** argv, bool& help) {
+    CliOptions& o = Options();
+    help = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        auto value = [&](std::string& out) {
+            if (i + 1 >= argc) {
+                fprintf(stderr, "foo_downloader_cli: %s needs a value\n", arg.c_str());
+                return false;
+            }
+            out = argv[++i];
+            return true;
+        };
+        auto number = [&](int& out) {
+            std::string s;
+            if (!value(s)) return false;
+            char* end = nullptr;
+            long n = strtol(s.c_str(), &end, 10);
+            if (s.empty() || *end != '\0' || n < 0) {
+                fprintf(stderr, "foo_downloader_cli: %s needs a non-negative number\n", arg.c_str());
+                return false;
+            }
+            out = (int)n;
+            return true;
+        };
+
+        bool ok = true;
+        if (arg == "-h" || arg == "--help") help = true;
+        else if (arg == "-s" || arg == "--source") ok = value(o.source);
+        else if (arg == "-i" || arg == "--input") ok = value(o.inputFile);
+        else if (arg == "-d" || arg == "--daemon") o.daemon = true;
+        else if (arg == "-o" || arg == "--output") ok = value(o.outputDir);
+        else if (arg == "--data-dir") ok = value(o.dataDir);
+        else if (arg == "-j" || arg == "--jobs") ok = number(o.maxConcurrent);
+        else if (arg == "--ytdlp-jobs") ok = number(o.ytdlpJobs);
+        else if (arg == "--retries") ok = number(o.retries);
+        else if (arg == "--per-host") ok = number(o.perHost);
+        else if (arg == "--host-gap") ok = number(o.hostGapMs);
+        else if (arg == "--redownload") o.redownload = true;
+        else if (arg == "--quality") ok = number(o.quality);
+        else if (arg == "--no-embed") o.embedMetadata = false;
+        else if (arg == "--ytdlp-flags") ok = value(o.ytdlpFlags);
+        else if (arg == "--custom-url") ok = value(o.customSourceUrl);
+        else if (arg == "--aria2c") ok = value(o.aria2Path);
+        else if (arg == "--yt-dlp") ok = value(o.ytdlpPath);
+        else if (arg == "--python") ok = value(o.pythonPath);
+        else if (arg == "--no-worker") o.ytdlpWorker = false;
+        else if (arg == "--ytdlp-aria2") o.ytdlpViaAria2 = true;
+        else if (arg == "--port") ok = number(o.port);
+        else if (arg == "-q" || arg == "--quiet") o.quiet = true;
+        else if (arg.size() > 1 && arg[0] == '-' && arg != "-") {
+            fprintf(stderr, "foo_downloader_cli: unknown option %s (see --help)\n", arg.c_str());
+            return false;
+        } else {
+            o.inputs.push_back(arg);
+        }
+        if (!ok) return false;
+    }
+
+    if (o.maxConcurrent < 1) o.maxConcurrent = 1;
+    if (o.perHost < 1) o.perHost = 1;
+    return true;
+}
+
+static void ReadLines(std::istream& in, std::vector<std::string>& lines) {
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        lines.push_back(line);
+    }
+}
+
+// Lines arriving on stdin in --daemon mode, handed from the reader thread to
+// the main loop
+struct StdinQueue {
+    std::mutex mutex;
+    std::vector<std::string> lines;
+};
+
+static bool IsLive(const DownloadEntry& e) {
+    return e.status == "resolving" || e.status == "queued" || e.status == "active" || e.status == "paused";
+}
+
+int main(int argc, char** argv) {
+    bool help = false;
+    if (!ParseArgs(argc, argv, help)) return 2;
+    if (help) {
+        PrintUsage();
+        return 0;
+    }
+    CliOptions& o = Options();
+
+    if (!SourceManager::instance().GetById(o.source)) {
+        fprintf(stderr, "foo_downloader_cli: unknown source '%s'\n", o.source.c_str());
+        return 2;
+    }
+
+    std::vector<std::string> inputs = o.inputs;
+    if (!o.inputFile.empty() && !(o.daemon && o.inputFile == "-")) {
+        if (o.inputFile == "-") {
+            ReadLines(std::cin, inputs);
+        } else {
+            std::ifstream f(o.inputFile);
+            if (!f) {
+                fprintf(stderr, "foo_downloader_cli: cannot read %s\n", o.inputFile.c_str());
+                return 2;
+            }
+            ReadLines(f, inputs);
+        }
+    }
+    if (inputs.empty() && !o.daemon) {
+        PrintUsage();
+        return 2;
+    }
+
+    std::signal(SIGINT, OnSignal);
+    std::signal(SIGTERM, OnSignal);
+
+    auto& aria2 = Aria2RpcClient::instance();
+    aria2.SetPort(o.port);
+    aria2.SetMaxConcurrent(o.maxConcurrent);
+    if (!o.aria2Path.empty()) aria2.SetAria2Path(o.aria2Path);
+    if (!o.outputDir.empty()) aria2.SetOutputDir(o.outputDir);
+    if (aria2.Start()) {
+        LogLine() << "[foo_downloader] aria2 daemon started.";
+    } else {
+        // yt-dlp downloads still work without it
+        LogLine() << "[foo_downloader] WARNING: Failed to start aria2.";
+    }
+
+    auto& manager = DownloadManager::instance();
+
+    // Entries already settled in the history are not this run's business
+    std::set<uint64_t> earlier;
+    for (const auto& e : manager.GetDownloads()) {
+        if (!IsLive(e)) earlier.insert(e.id);
+    }
+
+    manager.ResumeJobs();
+    if (!inputs.empty()) manager.StartBulkDownload(o.source, inputs);
+
+    std::shared_ptr<StdinQueue> stdinQueue;
+    if (o.daemon) {
+        // Blocking reads get their own thread; it is left behind at exit
+        stdinQueue = std::make_shared<StdinQueue>();
+        std::thread([queue = stdinQueue]() {
+            std::string line;
+            while (std::getline(std::cin, line)) {
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                std::lock_guard<std::mutex> lock(queue->mutex);
+                queue->lines.push_back(line);
+            }
+        }).detach();
+        LogLine() << "[foo_downloader] Daemon mode: reading inputs from stdin, Ctrl+C to stop.";
+    }
+
+    // The poll thread publishes progress for a main thread to collect; this
+    // loop is that main thread
+    uint64_t lastCheck = 0;
+    while (!g_stop) {
+        SleepMs(100);
+        manager.DispatchUpdates();
+
+        if (stdinQueue) {
+            std::vector<std::string> lines;
+            {
+                std::lock_guard<std::mutex> lock(stdinQueue->mutex);
+                lines.swap(stdinQueue->lines);
+            }
+            if (!lines.empty()) manager.StartBulkDownload(o.source, lines);
+            continue;
+        }
+
+        uint64_t now = TickMs();
+        if (now - lastCheck < 500) continue;
+        lastCheck = now;
+        auto entries = manager.GetDownloads();
+        bool live = std::any_of(entries.begin(), entries.end(), IsLive);
+        if (!live) break;
+    }
+
+    if (g_stop) LogLine() << "[foo_downloader] Stopping; unfinished downloads resume on the next run.";
+
+    int failed = 0;
+    for (const auto& e : manager.GetDownloads()) {
+        if (e.status == "error" && !earlier.count(e.id)) failed++;
+    }
+
+    manager.Shutdown();
+    aria2.Stop();
+
+    if (failed > 0) LogLine() << "[foo_downloader] " << failed << " download(s) failed.";
+    return (failed > 0 || g_errorsShown > 0) ? 1 : 0;
+}
@@ -0,0 +1,103 @@
+#include "aria2_protocol.h"
+#include "json_scan.h"
+
+std::string BuildAria2AddUriParams(const std::string& secret, const std::string& url,
+                                   const std::map<std::string, std::string>& options,
+                                   const std::vector<std::string>& headers) {
+    // Values are escaped: Windows paths in "dir", quotes in file names and
+    // in the headers yt-dlp hands over
+    std::string params = "[\"token:" + secret + "\", [" + JsonQuote(url) + "]";
+
+    if (!options.empty() || !headers.empty()) {
+        params += ", {";
+        bool first = true;
+        for (const auto& kv : options) {
+            if (!first) params += ", ";
+            params += "\"" + kv.first + "\": " + JsonQuote(kv.second);
+            first = false;
+        }
+        // Headers are passed as a JSON array
+        if (!headers.empty()) {
+            if (!first) params += ", ";
+            params += "\"header\": [";
+            for (size_t i = 0; i < headers.size(); i++) {
+                if (i > 0) params += ", ";
+                params += JsonQuote(headers[i]);
+            }
+            params += "]";
+        }
+        params += "}";
+    }
+
+    params += "]";
+    return params;
+}
+
+Aria2Status ParseAria2Status(const std::string& response) {
+    Aria2Status status;
+    std::string result = JsonRpcResult(response);
+    if (result.empty()) return status;
+
+    // Extract file paths from the "files" array first, then cut it out so
+    // that the nested "status" fields inside files[].uris[] don't shadow the
+    // top-level one
+    for (const auto& f : JsonObjectArray(result, "files")) {
+        std::string path = JsonString(f, "path");
+        if (!path.empty()) status.files.push_back(path);
+    }
+
+    std::string topLevel = result;
+    auto filesPos = topLevel.find("\"files\"");
+    if (filesPos != std::string::npos) {
+        auto bracketPos = topLevel.find('[', filesPos);
+        if (bracketPos != std::string::npos) {
+            topLevel.erase(filesPos, JsonSkipValue(topLevel, bracketPos) - filesPos);
+        }
+    }
+
+    status.gid = JsonString(topLevel, "gid");
+    status.status = JsonString(topLevel, "status");
+    status.totalLength = JsonQuotedNumber(topLevel, "totalLength");
+    status.completedLength = JsonQuotedNumber(topLevel, "completedLength");
+    status.downloadSpeed = JsonQuotedNumber(topLevel, "downloadSpeed");
+
+    if (status.status == "error") {
+        status.errorCode = JsonString(topLevel, "errorCode");
+        status.errorMessage = JsonString(topLevel, "errorMessage");
+    }
+    return status;
+}
+
+bool ParseAria2MulticallGids(const std::string& response, size_t count, std::vector<std::string>& gids,
+                             std::vector<std::string>& errors) {
+    gids.assign(count, std::string());
+
+    // Result is one element per call: ["GID"] on success, a fault object
+    // {"code":..,"message":..} on failure
+    std::string result = JsonRpcResult(response);
+    if (result.size() < 2 || result[0] != '[') return false;
+
+    size_t index = 0;
+    size_t pos = 1;
+    while (pos < result.size() && index < count) {
+        char c = result[pos];
+        if (c == ']') break;   // End of the outer array
+        if (c != '[' && c != '{') {
+            pos++;
+            continue;
+        }
+
+        size_t end = JsonSkipValue(result, pos);
+        std::string elem = result.substr(pos, end - pos);
+        if (c == '[') {
+            auto q1 = elem.find('"');
+            auto q2 = (q1 == std::string::npos) ? q1 : elem.find('"', q1 + 1);
+            if (q2 != std::string::npos) gids[index] = elem.substr(q1 + 1, q2 - q1 - 1);
+        } else {
+            errors.push_back(JsonString(elem, "message"));
+        }
+        index++;
+        pos = end;
+    }
+    return true;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// aria2 JSON-RPC messages
+// ============================================================================
+// Request building and response decoding, separate from the transport in
+// Aria2RpcClient, so they can be exercised without a running daemon.
+// ============================================================================
+
+struct Aria2Status {
+    std::string gid;
+    std::string status;      // "active", "waiting", "paused", "error", "complete", "removed"
+    uint64_t totalLength = 0;
+    uint64_t completedLength = 0;
+    uint64_t downloadSpeed = 0;
+    std::string errorCode;   // aria2 exit status code, e.g. "3" (resource not found)
+    std::string errorMessage;
+    std::vector<std::string> files;
+
+    double GetProgress() const {
+        if (totalLength == 0) return 0.0;
+        return static_cast<double>(completedLength) / static_cast<double>(totalLength) * 100.0;
+    }
+
+    bool IsComplete() const { return status == "complete"; }
+    bool IsError() const { return status == "error"; }
+    bool IsActive() const { return status == "active" || status == "waiting"; }
+};
+
+// One aria2.addUri call, for batched submission via AddUris()
+struct Aria2AddRequest {
+    std::string url;
+    std::map<std::string, std::string> options;
+    std::vector<std::string> headers;
+};
+
+// Params of aria2.addUri: ["token:SECRET", ["url"], {options}]
+std::string BuildAria2AddUriParams(const std::string& secret, const std::string& url,
+                                   const std::map<std::string, std::string>& options,
+                                   const std::vector<std::string>& headers);
+
+// Decode an aria2.tellStatus response. An empty or malformed response leaves
+// `status` empty.
+Aria2Status ParseAria2Status(const std::string& response);
+
+// Decode a system.multicall response of `count` aria2.addUri calls: one GID
+// per call, in order, empty where aria2 rejected the call. The fault message
+// of each rejected call is appended to `errors`. Returns false if the
+// response is not a multicall result at all.
+bool ParseAria2MulticallGids(const std::string& response, size_t count, std::vector<std::string>& gids,
+                             std::vector<std::string>& errors);
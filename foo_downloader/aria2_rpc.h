@@ -1,5 +1,8 @@
 #pragma once
 
+#include "aria2_protocol.h"
+#include "platform.h"
+
 #include <string>
 #include <vector>
 #include <map>
@@ -7,25 +10,6 @@
 #include <atomic>
 #include <cstdint>
 
-struct Aria2Status {
-    std::string gid;
-    std::string status;      // "active", "waiting", "paused", "error", "complete", "removed"
-    uint64_t totalLength = 0;
-    uint64_t completedLength = 0;
-    uint64_t downloadSpeed = 0;
-    std::string errorMessage;
-    std::vector<std::string> files;
-
-    double GetProgress() const {
-        if (totalLength == 0) return 0.0;
-        return static_cast<double>(completedLength) / static_cast<double>(totalLength) * 100.0;
-    }
-
-    bool IsComplete() const { return status == "complete"; }
-    bool IsError() const { return status == "error"; }
-    bool IsActive() const { return status == "active" || status == "waiting"; }
-};
-
 class Aria2RpcClient {
 public:
     static Aria2RpcClient& instance();
@@ -37,6 +21,9 @@ public:
     std::string AddUri(const std::string& url,
                        const std::map<std::string, std::string>& options = {},
                        const std::vector<std::string>& headers = {});
+    // Adds all requests in one system.multicall round trip. Returns one GID
+    // per request, in order; empty where aria2 rejected that request.
+    std::vector<std::string> AddUris(const std::vector<Aria2AddRequest>& requests);
     Aria2Status GetStatus(const std::string& gid);
     bool Pause(const std::string& gid);
     bool Unpause(const std::string& gid);
@@ -56,11 +43,7 @@ private:
 
     std::string RpcCall(const std::string& method, const std::string& params);
     std::string BuildRequest(const std::string& method, const std::string& params);
-    std::string ExtractJsonString(const std::string& json, const std::string& key);
-    uint64_t ExtractJsonNumber(const std::string& json, const std::string& key);
-    std::string ExtractJsonResult(const std::string& json);
-    std::vector<std::string> ExtractJsonArray(const std::string& json, const std::string& key);
-    std::string HttpPost(const std::string& host, int port, const std::string& path, const std::string& body);
+    std::string HttpPost(const std::string& body);
 
     bool SpawnAria2Process();
 
@@ -72,7 +55,7 @@ private:
     void KillAria2Process();
     bool DownloadAria2();
 
-    HANDLE m_aria2Process = nullptr;
+    ChildProcess m_aria2Process;
     int m_port = 6800;
     std::string m_secret;
     std::string m_aria2Path;
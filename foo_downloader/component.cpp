@@ -3,6 +3,8 @@
 #include "aria2_rpc.h"
 #include "source_manager.h"
 #include "download_manager.h"
+#include "metrics_export.h"
+#include "trace.h"
 
 DECLARE_COMPONENT_VERSION(
     "Downloader",
@@ -26,6 +28,7 @@ class DownloaderInitQuit : public initquit {
 public:
     void on_init() override {
         FB2K_console_formatter() << "[foo_downloader] Initializing...";
+        TraceSetThreadName("main");
 
         SourceManager::instance();
 
@@ -36,12 +39,14 @@ public:
             FB2K_console_formatter() << "[foo_downloader] WARNING: Failed to start aria2. Set the path in Preferences > Tools > Downloader.";
         }
 
-        DownloadManager::instance();
+        DownloadManager::instance().ResumeJobs();
+        StartMetricsExporter();
         FB2K_console_formatter() << "[foo_downloader] Ready.";
     }
 
     void on_quit() override {
         FB2K_console_formatter() << "[foo_downloader] Shutting down...";
+        StopMetricsExporter();
         DownloadManager::instance().Shutdown();
         Aria2RpcClient::instance().Stop();
         FB2K_console_formatter() << "[foo_downloader] Shutdown complete.";
@@ -7,6 +7,8 @@
 #include <helpers/atl-misc.h>
 #include <helpers/DarkMode.h>
 
+void ShowBulkImportDialog(HWND parent);
+
 namespace {
 
 // Context menu group: "Downloader" submenu
@@ -92,19 +94,124 @@ private:
     fb2k::CDarkModeHooks m_dark;
 };
 
+// "Bulk import..." modal dialog: a list of URLs (or searches), typed,
+// pasted or loaded from a .txt / .m3u file
+class CBulkImportDialog : public CDialogImpl<CBulkImportDialog> {
+public:
+    enum { IDD = IDD_BULK_IMPORT };
+
+    std::string m_sourceId;
+    std::vector<std::string> m_lines;
+
+    BEGIN_MSG_MAP_EX(CBulkImportDialog)
+        MSG_WM_INITDIALOG(OnInitDialog)
+        COMMAND_ID_HANDLER_EX(IDC_BULK_LOAD_FILE, OnLoadFile)
+        COMMAND_ID_HANDLER_EX(IDOK, OnOk)
+        COMMAND_ID_HANDLER_EX(IDCANCEL, OnCancel)
+    END_MSG_MAP()
+
+    BOOL OnInitDialog(CWindow, LPARAM) {
+        m_dark.AddDialogWithControls(*this);
+        CenterWindow(GetParent());
+
+        CComboBox combo(GetDlgItem(IDC_BULK_SOURCE_COMBO));
+        const auto& sources = SourceManager::instance().GetAll();
+        for (const auto& src : sources) {
+            combo.AddString(pfc::stringcvt::string_wide_from_utf8(src->GetName()));
+        }
+        if (!sources.empty()) {
+            combo.SetCurSel(0);
+        }
+
+        ::SetFocus(GetDlgItem(IDC_BULK_INPUT));
+        return FALSE;
+    }
+
+    void OnLoadFile(UINT, int, CWindow) {
+        pfc::string8 path;
+        if (!uGetOpenFileName(*this, "URL lists|*.txt;*.m3u;*.m3u8|All files|*.*", 0, nullptr,
+                              "Load URL list", nullptr, path, FALSE)) {
+            return;
+        }
+
+        FILE* f = _wfopen(pfc::stringcvt::string_wide_from_utf8(path), L"rb");
+        if (!f) {
+            popup_message::g_show("Could not open the selected file.", "foo_downloader", popup_message::icon_error);
+            return;
+        }
+
+        std::string content;
+        char buf[4096];
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+            content.append(buf, n);
+        }
+        fclose(f);
+
+        // Skip a UTF-8 BOM; the edit control wants CRLF line breaks
+        if (content.compare(0, 3, "\xEF\xBB\xBF") == 0) content.erase(0, 3);
+        std::string text;
+        for (const auto& line : SplitLines(content)) {
+            text += line;
+            text += "\r\n";
+        }
+        uSetDlgItemText(*this, IDC_BULK_INPUT, text.c_str());
+    }
+
+    void OnOk(UINT, int, CWindow) {
+        CComboBox combo(GetDlgItem(IDC_BULK_SOURCE_COMBO));
+        int selIdx = combo.GetCurSel();
+        if (selIdx >= 0) {
+            const auto& sources = SourceManager::instance().GetAll();
+            if (selIdx < (int)sources.size()) {
+                m_sourceId = sources[selIdx]->GetId();
+            }
+        }
+
+        pfc::string8 text;
+        uGetDlgItemText(*this, IDC_BULK_INPUT, text);
+        m_lines = SplitLines(text.get_ptr());
+
+        EndDialog(IDOK);
+    }
+
+    void OnCancel(UINT, int, CWindow) {
+        EndDialog(IDCANCEL);
+    }
+
+private:
+    static std::vector<std::string> SplitLines(const std::string& text) {
+        std::vector<std::string> lines;
+        size_t start = 0;
+        while (start < text.size()) {
+            size_t end = text.find('\n', start);
+            if (end == std::string::npos) end = text.size();
+            std::string line = text.substr(start, end - start);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            lines.push_back(std::move(line));
+            start = end + 1;
+        }
+        return lines;
+    }
+
+    fb2k::CDarkModeHooks m_dark;
+};
+
 // Context menu item
 class DownloaderContextMenuItem : public contextmenu_item_simple {
 public:
-    unsigned get_num_items() override { return 1; }
+    unsigned get_num_items() override { return 2; }
 
     GUID get_parent() override { return guid_downloader_contextmenu_group; }
 
     void get_item_name(unsigned p_index, pfc::string_base& p_out) override {
         if (p_index == 0) p_out = "Download from URL...";
+        else if (p_index == 1) p_out = "Bulk import...";
     }
 
     GUID get_item_guid(unsigned p_index) override {
         if (p_index == 0) return guid_downloader_contextmenu;
+        if (p_index == 1) return guid_downloader_contextmenu_bulk;
         return pfc::guid_null;
     }
 
@@ -113,10 +220,18 @@ public:
             p_out = "Download an audio file from a URL and add to Downloaded playlist";
             return true;
         }
+        if (p_index == 1) {
+            p_out = "Queue a list of URLs, pasted or loaded from a text or M3U file";
+            return true;
+        }
         return false;
     }
 
     void context_command(unsigned p_index, metadb_handle_list_cref p_data, const GUID& p_caller) override {
+        if (p_index == 1) {
+            ShowBulkImportDialog(core_api::get_main_window());
+            return;
+        }
         if (p_index != 0) return;
 
         CDownloadUrlDialog dlg;
@@ -131,3 +246,15 @@ public:
 static contextmenu_item_factory_t<DownloaderContextMenuItem> g_contextmenu_factory;
 
 } // namespace
+
+// Also opened from the panel's queue context menu
+void ShowBulkImportDialog(HWND parent) {
+    CBulkImportDialog dlg;
+    if (dlg.DoModal(parent) != IDOK) return;
+    if (dlg.m_sourceId.empty()) return;
+
+    size_t accepted = DownloadManager::instance().StartBulkDownload(dlg.m_sourceId, dlg.m_lines);
+    if (accepted == 0 && !dlg.m_lines.empty()) {
+        popup_message::g_show("No URLs to import.", "foo_downloader", popup_message::icon_information);
+    }
+}
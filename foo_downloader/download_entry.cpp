@@ -0,0 +1,93 @@
+#include "download_entry.h"
+
+// ============================================================================
+// Updates
+// ============================================================================
+
+DownloadUpdate MakeDownloadUpdate(const DownloadEntry& e) {
+    DownloadUpdate u;
+    u.id = e.id;
+    u.fields = e.dirtyFields;
+    u.entry.id = e.id;
+    u.entry.progress = e.progress;
+    u.entry.speed = e.speed;
+    u.entry.totalSize = e.totalSize;
+    if (e.dirtyFields & FieldStatus) u.entry.status = e.status;
+    if (e.dirtyFields & FieldTitle) u.entry.title = e.title;
+    if (e.dirtyFields & FieldOutputPath) u.entry.outputPath = e.outputPath;
+    if (e.dirtyFields & FieldErrorMessage) u.entry.errorMessage = e.errorMessage;
+    return u;
+}
+
+void ApplyDownloadUpdate(DownloadEntry& entry, const DownloadUpdate& u) {
+    entry.progress = u.entry.progress;
+    entry.speed = u.entry.speed;
+    entry.totalSize = u.entry.totalSize;
+    if (u.fields & FieldStatus) entry.status = u.entry.status;
+    if (u.fields & FieldTitle) entry.title = u.entry.title;
+    if (u.fields & FieldOutputPath) entry.outputPath = u.entry.outputPath;
+    if (u.fields & FieldErrorMessage) entry.errorMessage = u.entry.errorMessage;
+}
+
+void MergeDownloadUpdate(std::vector<DownloadUpdate>& updates, DownloadUpdate&& u) {
+    for (auto& existing : updates) {
+        if (existing.id != u.id) continue;
+        existing.fields |= u.fields;
+        existing.entry.progress = u.entry.progress;
+        existing.entry.speed = u.entry.speed;
+        existing.entry.totalSize = u.entry.totalSize;
+        if (u.fields & FieldStatus) existing.entry.status = std::move(u.entry.status);
+        if (u.fields & FieldTitle) existing.entry.title = std::move(u.entry.title);
+        if (u.fields & FieldOutputPath) existing.entry.outputPath = std::move(u.entry.outputPath);
+        if (u.fields & FieldErrorMessage) existing.entry.errorMessage = std::move(u.entry.errorMessage);
+        return;
+    }
+    updates.push_back(std::move(u));
+}
+
+// ============================================================================
+// Poll sweep
+// ============================================================================
+
+Aria2Transition ApplyAria2Status(DownloadEntry& entry, const Aria2Status& status, uint64_t now) {
+    UpdateField(entry, &DownloadEntry::progress, status.GetProgress(), FieldProgress);
+    UpdateField(entry, &DownloadEntry::speed, status.downloadSpeed, FieldSpeed);
+    UpdateField(entry, &DownloadEntry::totalSize, status.totalLength, FieldTotalSize);
+    if (status.completedLength > 0 && entry.times.firstByte == 0) {
+        entry.times.firstByte = now;
+    }
+
+    if (!status.files.empty() && !status.files[0].empty()) {
+        const std::string& filePath = status.files[0];
+        std::string outputPath = filePath;
+#ifdef _WIN32
+        // aria2 reports forward slashes
+        for (char& c : outputPath) {
+            if (c == '/') c = '\\';
+        }
+#endif
+        UpdateField(entry, &DownloadEntry::outputPath, outputPath, FieldOutputPath);
+        auto lastSlash = filePath.find_last_of("\\/");
+        if (lastSlash != std::string::npos && lastSlash + 1 < filePath.size()) {
+            UpdateField(entry, &DownloadEntry::title, filePath.substr(lastSlash + 1), FieldTitle);
+        }
+    }
+
+    if (status.IsComplete()) {
+        // Nothing runs after aria2 finishes; post-processing is empty
+        if (entry.times.firstByte == 0) entry.times.firstByte = now;
+        entry.times.transferEnd = entry.times.postProcessEnd = now;
+        UpdateField(entry, &DownloadEntry::status, std::string("complete"), FieldStatus);
+        UpdateField(entry, &DownloadEntry::errorMessage, std::string(), FieldErrorMessage);
+        return Aria2Transition::Completed;
+    }
+    if (status.IsError()) return Aria2Transition::Failed;
+
+    if (status.status == "paused") {
+        UpdateField(entry, &DownloadEntry::status, std::string("paused"), FieldStatus);
+        UpdateField(entry, &DownloadEntry::speed, (uint64_t)0, FieldSpeed);
+    } else if (status.IsActive()) {
+        UpdateField(entry, &DownloadEntry::status, std::string("active"), FieldStatus);
+    }
+    return Aria2Transition::None;
+}
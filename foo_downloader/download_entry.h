@@ -0,0 +1,91 @@
+#pragma once
+
+#include "aria2_protocol.h"
+#include "latency_stats.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// One row of the download queue and the deltas that describe its changes
+// ============================================================================
+
+struct DownloadEntry {
+    uint64_t id = 0;          // Manager-assigned, stable while the entry is in memory
+    std::string gid;
+    std::string sourceId;
+    std::string url;
+    std::string title;
+    std::string outputPath;
+    std::string status;       // "resolving", "queued", "active", "paused", "complete", "error"
+    std::string errorMessage;
+    std::string engine;       // "aria2" or "ytdlp"
+    double progress = 0.0;
+    uint64_t speed = 0;
+    uint64_t totalSize = 0;
+    int64_t historyId = 0;    // Row id in the downloads table, 0 until persisted
+    uint64_t leaderId = 0;    // Coalesced duplicate: mirrors this entry instead of running its own job
+    int64_t jobRowId = 0;     // Row in the jobs journal while the entry is unfinished, 0 otherwise
+    StageTimes times;         // Pipeline stage timestamps, persisted with the history row
+    uint32_t dirtyFields = 0; // DownloadField bits changed since the last published delta
+};
+
+// Bits identifying which fields of a DownloadEntry an update carries
+enum DownloadField : uint32_t {
+    FieldStatus       = 1 << 0,
+    FieldProgress     = 1 << 1,
+    FieldSpeed        = 1 << 2,
+    FieldTotalSize    = 1 << 3,
+    FieldTitle        = 1 << 4,
+    FieldOutputPath   = 1 << 5,
+    FieldErrorMessage = 1 << 6,
+};
+
+// One changed entry. Only the fields flagged in `fields` are filled in
+// `entry`; the rest are left default so unchanged strings are never copied.
+struct DownloadUpdate {
+    uint64_t id = 0;
+    uint32_t fields = 0;
+    DownloadEntry entry;
+};
+
+// All entries that changed during one poll tick
+struct DownloadDelta {
+    std::vector<DownloadUpdate> updates;
+};
+
+// Overwrite the fields of `entry` that `u` carries
+void ApplyDownloadUpdate(DownloadEntry& entry, const DownloadUpdate& u);
+
+// The entry's dirty fields as an update
+DownloadUpdate MakeDownloadUpdate(const DownloadEntry& e);
+
+// Fold `u` into `updates`, combining with an earlier update for the same entry
+void MergeDownloadUpdate(std::vector<DownloadUpdate>& updates, DownloadUpdate&& u);
+
+// Assign a field and record it in the entry's dirty mask if the value changed.
+// Everything the poll thread touches goes through here so that
+// DownloadManager::PublishUpdates() can emit only what actually changed
+// during the tick.
+template <typename T>
+void UpdateField(DownloadEntry& entry, T DownloadEntry::*field, const T& value, uint32_t bit) {
+    if (entry.*field == value) return;
+    entry.*field = value;
+    entry.dirtyFields |= bit;
+}
+
+// ============================================================================
+// Poll sweep
+// ============================================================================
+
+enum class Aria2Transition {
+    None,        // Still running, paused or waiting
+    Completed,   // Just finished; status is now "complete"
+    Failed,      // aria2 reported an error; the entry is unchanged otherwise
+};
+
+// Apply one aria2.tellStatus result to the entry doing that transfer. `now`
+// is the tick (ms) used for the stage timestamps. Retry, history and the
+// host breaker are left to the caller.
+Aria2Transition ApplyAria2Status(DownloadEntry& entry, const Aria2Status& status, uint64_t now);
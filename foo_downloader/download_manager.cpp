@@ -1,22 +1,118 @@
-#include "stdafx.h"
-#include "guids.h"
 #include "download_manager.h"
+#include "host.h"
+#include "history_db.h"
+#include "metrics.h"
 #include "source_manager.h"
-#include "playlist_utils.h"
+#include "trace.h"
+#include "ytdlp_info_cache.h"
 #include "sources/source_youtube.h"
 
-extern const char* GetConfigOutputFolder();
-extern bool GetConfigEmbedMetadata();
-extern const char* GetConfigYtDlpPath();
-extern const char* GetConfigYtDlpExtraFlags();
-extern int GetConfigRetryCount();
+#include <chrono>
+#include <set>
+
+// Number of persisted history rows kept in memory alongside live jobs
+static const size_t HISTORY_WINDOW_SIZE = 200;
+
+// Change-log records kept for GetChangesSince(). A consumer further behind
+// than this resyncs from a full snapshot instead. Progress is not logged
+// (see PublishUpdates), so running transfers alone never fill it.
+static const size_t CHANGE_LOG_CAPACITY = 4096;
+
+// Fields that change on every tick of a running transfer; an update with
+// nothing else in it goes through the update ring only
+static const uint32_t PROGRESS_FIELDS = FieldProgress | FieldSpeed | FieldTotalSize;
+
+// Most aria2.addUri calls folded into one system.multicall
+static const size_t ARIA2_ADD_BATCH = 64;
+
+// Connections aria2 opens for one YouTube audio stream (GetConfigYtDlpViaAria2())
+static const int STREAM_CONNECTIONS = 4;
+
+// Resolves that can run at once (searches, yt-dlp metadata lookups)
+static const size_t RESOLVE_THREADS = 4;
+
+// Bulk-import resolves that can run at once. They have a pool of their own,
+// so a long import never holds the threads a search or a paste waits for.
+static const size_t BULK_RESOLVE_THREADS = RESOLVE_THREADS - 1;
+
+// GetConfigDuplicatePolicy() values: what to do with an item whose URL is
+// already in the history as a completed download
+static const int DUPLICATE_ASK = 0;
+static const int DUPLICATE_SKIP = 1;
+static const int DUPLICATE_DOWNLOAD_AGAIN = 2;
+
+// Resolved bulk-import items handed to EnqueueItems() at a time
+static const size_t BULK_ENQUEUE_BATCH = 50;
+
+// Poll thread tick: aria2 status, retry timers, progress to the UI
+static const uint64_t POLL_INTERVAL_MS = 500;
+
+// Newest completed downloads GetLatencySummary() computes percentiles over
+static const size_t LATENCY_SAMPLE_ROWS = 5000;
+
+// ============================================================================
+// Metrics (see metrics.h); each is looked up once and kept
+// ============================================================================
+
+static MetricGauge& UpdateBacklogGauge() {
+    static MetricGauge& g = Metrics().Gauge("foo_downloader_main_thread_backlog",
+        "Work posted to the main thread and not yet run", { { "kind", "updates" } });
+    return g;
+}
+
+static MetricHistogram& SqliteWriteHistogram(bool journal) {
+    static MetricHistogram& history = Metrics().Histogram("foo_downloader_sqlite_write_seconds",
+        "Duration of one SQLite write transaction", { { "table", "downloads" } });
+    static MetricHistogram& jobs = Metrics().Histogram("foo_downloader_sqlite_write_seconds",
+        "Duration of one SQLite write transaction", { { "table", "jobs" } });
+    return journal ? jobs : history;
+}
+
+struct EngineMetrics {
+    MetricCounter& bytes;
+    MetricCounter& completed;
+    MetricCounter& failed;
+    MetricGauge& active;
+    MetricGauge& queued;
+};
+
+static EngineMetrics MakeEngineMetrics(const char* engine) {
+    MetricLabels labels = { { "engine", engine } };
+    return {
+        Metrics().Counter("foo_downloader_bytes_transferred_total", "Bytes downloaded", labels),
+        Metrics().Counter("foo_downloader_downloads_completed_total", "Downloads that completed", labels),
+        Metrics().Counter("foo_downloader_downloads_failed_total", "Downloads that failed for good", labels),
+        Metrics().Gauge("foo_downloader_active_jobs", "Transfers running", labels),
+        Metrics().Gauge("foo_downloader_queued_jobs", "Transfers waiting to start or retry", labels),
+    };
+}
+
+static EngineMetrics& EngineMetricsFor(const std::string& engine) {
+    static EngineMetrics aria2 = MakeEngineMetrics("aria2");
+    static EngineMetrics ytdlp = MakeEngineMetrics("ytdlp");
+    return engine == "ytdlp" ? ytdlp : aria2;
+}
+
+// Lower-cased host[:port] of a URL, used as the politeness key
+static std::string HostOf(const std::string& url) {
+    size_t start = url.find("://");
+    start = (start == std::string::npos) ? 0 : start + 3;
+    size_t end = url.find_first_of("/?#", start);
+    std::string host = url.substr(start, end == std::string::npos ? std::string::npos : end - start);
+    auto at = host.rfind('@');
+    if (at != std::string::npos) host = host.substr(at + 1);
+    for (char& c : host) {
+        if (c >= 'A' && c <= 'Z') c = c - 'A' + 'a';
+    }
+    return host;
+}
 
 DownloadManager& DownloadManager::instance() {
     static DownloadManager inst;
     return inst;
 }
 
-DownloadManager::DownloadManager() {
+DownloadManager::DownloadManager() : m_resolvePool(RESOLVE_THREADS), m_bulkPool(BULK_RESOLVE_THREADS) {
     LoadHistory();
 }
 
@@ -28,59 +124,20 @@ DownloadManager::~DownloadManager() {
 // History persistence (SQLite)
 // ============================================================================
 
-std::string DownloadManager::GetDllDirectory() {
-    char dllPath[MAX_PATH] = {};
-    HMODULE hMod = NULL;
-    GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
-                       (LPCSTR)&GetDllDirectory, &hMod);
-    if (hMod) {
-        GetModuleFileNameA(hMod, dllPath, MAX_PATH);
-        std::string dir(dllPath);
-        auto pos = dir.find_last_of("\\/");
-        if (pos != std::string::npos) dir = dir.substr(0, pos + 1);
-        return dir;
-    }
-    return "";
-}
-
 std::string DownloadManager::GetDatabasePath() {
-    return GetDllDirectory() + "downloads.db";
+    return HostDataDirectory() + "downloads.db";
 }
 
 void DownloadManager::OpenDb() {
     if (m_db) return;
 
-    std::string path = GetDatabasePath();
-    int rc = sqlite3_open(path.c_str(), &m_db);
-    if (rc != SQLITE_OK) {
-        FB2K_console_formatter() << "[foo_downloader] Failed to open database: " << sqlite3_errmsg(m_db);
-        sqlite3_close(m_db);
-        m_db = nullptr;
+    std::string error;
+    if (!OpenHistoryDb(GetDatabasePath(), &m_db, error)) {
+        LogLine() << "[foo_downloader] Failed to open database: " << error.c_str();
         return;
     }
-
-    // Enable WAL mode for better concurrent access
-    sqlite3_exec(m_db, "PRAGMA journal_mode=WAL;", nullptr, nullptr, nullptr);
-
-    // Create table
-    const char* createSql =
-        "CREATE TABLE IF NOT EXISTS downloads ("
-        "  id INTEGER PRIMARY KEY AUTOINCREMENT,"
-        "  title TEXT NOT NULL DEFAULT '',"
-        "  status TEXT NOT NULL DEFAULT '',"
-        "  output_path TEXT NOT NULL DEFAULT '',"
-        "  source_id TEXT NOT NULL DEFAULT '',"
-        "  url TEXT NOT NULL DEFAULT '',"
-        "  engine TEXT NOT NULL DEFAULT '',"
-        "  error_message TEXT NOT NULL DEFAULT '',"
-        "  created_at INTEGER NOT NULL DEFAULT (strftime('%s','now'))"
-        ");";
-
-    char* errMsg = nullptr;
-    rc = sqlite3_exec(m_db, createSql, nullptr, nullptr, &errMsg);
-    if (rc != SQLITE_OK) {
-        FB2K_console_formatter() << "[foo_downloader] Failed to create table: " << (errMsg ? errMsg : "unknown error");
-        sqlite3_free(errMsg);
+    if (!CreateHistorySchema(m_db, error)) {
+        LogLine() << "[foo_downloader] " << error.c_str();
     }
 }
 
@@ -91,45 +148,62 @@ void DownloadManager::CloseDb() {
     }
 }
 
-void DownloadManager::SaveHistory() {
+void DownloadManager::DeleteHistoryRow(int64_t historyId) {
     // NOTE: caller must hold m_mutex
+    if (historyId <= 0) return;
     if (!m_db) OpenDb();
     if (!m_db) return;
 
-    sqlite3_exec(m_db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
-
-    // Delete all rows and re-insert
-    sqlite3_exec(m_db, "DELETE FROM downloads;", nullptr, nullptr, nullptr);
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(m_db, "DELETE FROM downloads WHERE id = ?;", -1, &stmt, nullptr) != SQLITE_OK) {
+        LogLine() << "[foo_downloader] Failed to prepare delete: " << sqlite3_errmsg(m_db);
+        return;
+    }
+    sqlite3_bind_int64(stmt, 1, historyId);
+    sqlite3_step(stmt);
+    sqlite3_finalize(stmt);
+}
 
-    const char* insertSql =
-        "INSERT INTO downloads (title, status, output_path, source_id, url, engine, error_message) "
-        "VALUES (?, ?, ?, ?, ?, ?, ?);";
+void DownloadManager::SaveHistory() {
+    // NOTE: caller must hold m_mutex
+    if (!m_db) OpenDb();
+    if (!m_db) return;
+    TRACE_SCOPE("SaveHistory");
+    MetricTimer timer(SqliteWriteHistogram(false));
 
-    sqlite3_stmt* stmt = nullptr;
-    int rc = sqlite3_prepare_v2(m_db, insertSql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        FB2K_console_formatter() << "[foo_downloader] Failed to prepare insert: " << sqlite3_errmsg(m_db);
-        sqlite3_exec(m_db, "ROLLBACK;", nullptr, nullptr, nullptr);
+    std::vector<std::string> completedKeys;
+    if (InsertFinishedDownloads(m_db, m_downloads, completedKeys) < 0) {
+        LogLine() << "[foo_downloader] Failed to prepare insert: " << sqlite3_errmsg(m_db);
         return;
     }
+    for (const auto& key : completedKeys) m_urlFilter.Add(key);
+}
 
+void DownloadManager::TrimHistoryWindow() {
+    // NOTE: caller must hold m_mutex
+    // Keep live jobs plus the newest HISTORY_WINDOW_SIZE persisted rows in
+    // memory. Dropped rows are still in SQLite and reachable via QueryHistory().
+    std::vector<int64_t> ids;
     for (const auto& e : m_downloads) {
-        if (e.status != "complete" && e.status != "error") continue;
+        if (e.historyId > 0) ids.push_back(e.historyId);
+    }
+    if (ids.size() <= HISTORY_WINDOW_SIZE) return;
 
-        sqlite3_bind_text(stmt, 1, e.title.c_str(), -1, SQLITE_TRANSIENT);
-        sqlite3_bind_text(stmt, 2, e.status.c_str(), -1, SQLITE_TRANSIENT);
-        sqlite3_bind_text(stmt, 3, e.outputPath.c_str(), -1, SQLITE_TRANSIENT);
-        sqlite3_bind_text(stmt, 4, e.sourceId.c_str(), -1, SQLITE_TRANSIENT);
-        sqlite3_bind_text(stmt, 5, e.url.c_str(), -1, SQLITE_TRANSIENT);
-        sqlite3_bind_text(stmt, 6, e.engine.c_str(), -1, SQLITE_TRANSIENT);
-        sqlite3_bind_text(stmt, 7, e.errorMessage.c_str(), -1, SQLITE_TRANSIENT);
+    std::nth_element(ids.begin(), ids.begin() + (ids.size() - HISTORY_WINDOW_SIZE), ids.end());
+    int64_t cutoff = ids[ids.size() - HISTORY_WINDOW_SIZE];
 
-        sqlite3_step(stmt);
-        sqlite3_reset(stmt);
+    auto trimmed = [cutoff](const DownloadEntry& e) {
+        return e.historyId > 0 && e.historyId < cutoff;
+    };
+    for (const auto& e : m_downloads) {
+        if (trimmed(e)) RecordChange(DownloadChangeKind::Removed, e);
     }
+    m_downloads.erase(
+        std::remove_if(m_downloads.begin(), m_downloads.end(), trimmed),
+        m_downloads.end());
 
-    sqlite3_finalize(stmt);
-    sqlite3_exec(m_db, "COMMIT;", nullptr, nullptr, nullptr);
+    if (cutoff > m_historyWindowStart) m_historyWindowStart = cutoff;
+    m_listVersion++;
 }
 
 void DownloadManager::LoadHistory() {
@@ -137,10 +211,8 @@ void DownloadManager::LoadHistory() {
     if (!m_db) return;
 
     // Migrate from old txt file if it exists
-    std::string dir = GetDllDirectory();
-    std::string txtPath = dir + "download_history.txt";
-    DWORD attrs = GetFileAttributesA(txtPath.c_str());
-    if (attrs != INVALID_FILE_ATTRIBUTES) {
+    std::string txtPath = HostDataDirectory() + "download_history.txt";
+    if (PathExists(txtPath)) {
         // Parse old TSV file
         FILE* f = fopen(txtPath.c_str(), "r");
         if (f) {
@@ -223,451 +295,1327 @@ void DownloadManager::LoadHistory() {
                 sqlite3_finalize(stmt);
                 sqlite3_exec(m_db, "COMMIT;", nullptr, nullptr, nullptr);
 
-                FB2K_console_formatter() << "[foo_downloader] Migrated " << (uint32_t)migrated.size() << " entries from download_history.txt to SQLite.";
+                LogLine() << "[foo_downloader] Migrated " << (uint32_t)migrated.size() << " entries from download_history.txt to SQLite.";
             }
 
             // Delete old txt file
-            DeleteFileA(txtPath.c_str());
+            RemoveFile(txtPath);
         }
     }
 
-    // Load entries from SQLite
-    const char* selectSql =
-        "SELECT title, status, output_path, source_id, url, engine, error_message FROM downloads ORDER BY id;";
-
-    sqlite3_stmt* stmt = nullptr;
-    int rc = sqlite3_prepare_v2(m_db, selectSql, -1, &stmt, nullptr);
-    if (rc != SQLITE_OK) {
-        FB2K_console_formatter() << "[foo_downloader] Failed to query downloads: " << sqlite3_errmsg(m_db);
-        return;
+    size_t backfilled = BackfillUrlKeys(m_db);
+    if (backfilled > 0) {
+        LogLine() << "[foo_downloader] Indexed " << (uint32_t)backfilled << " history URLs.";
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        LoadCompletedUrlKeys(m_db, m_urlFilter);
     }
 
-    while (sqlite3_step(stmt) == SQLITE_ROW) {
-        DownloadEntry entry;
-        entry.title        = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 0));
-        entry.status       = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
-        entry.outputPath   = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
-        entry.sourceId     = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
-        entry.url          = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
-        entry.engine       = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
-        entry.errorMessage = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 6));
+    sqlite3_stmt* maxStmt = nullptr;
+    if (sqlite3_prepare_v2(m_db, "SELECT COALESCE(MAX(id), 0) FROM jobs;", -1, &maxStmt, nullptr) == SQLITE_OK) {
+        if (sqlite3_step(maxStmt) == SQLITE_ROW) {
+            m_nextJobRow = m_journalDurableRow = sqlite3_column_int64(maxStmt, 0);
+        }
+        sqlite3_finalize(maxStmt);
+    }
 
-        if (entry.status == "complete") entry.progress = 100.0;
+    // Load only the most recent rows; older history is paged in on demand
+    std::vector<DownloadEntry> recent;
+    if (!SelectHistoryRows(m_db, INT64_MAX, (int)HISTORY_WINDOW_SIZE, recent)) {
+        LogLine() << "[foo_downloader] Failed to query downloads: " << sqlite3_errmsg(m_db);
+        return;
+    }
 
+    // Rows come back newest first; the queue shows oldest first
+    std::reverse(recent.begin(), recent.end());
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& entry : recent) {
+        entry.id = ++m_nextId;
         m_downloads.push_back(std::move(entry));
+        RecordChange(DownloadChangeKind::Inserted, m_downloads.back());
     }
-
-    sqlite3_finalize(stmt);
+    m_listVersion++;
 
     if (!m_downloads.empty()) {
-        FB2K_console_formatter() << "[foo_downloader] Loaded " << (uint32_t)m_downloads.size() << " entries from history.";
+        m_historyWindowStart = m_downloads.front().historyId;
+        LogLine() << "[foo_downloader] Loaded " << (uint32_t)m_downloads.size() << " entries from history.";
     }
 }
 
+bool DownloadManager::WasDownloaded(const std::string& urlKey) {
+    // NOTE: caller must hold m_mutex
+    if (urlKey.empty() || !m_urlFilter.MayContain(urlKey)) return false;
+
+    // Possible hit (or a ~1% false positive): confirm against the index
+    if (!m_db) OpenDb();
+    if (!m_db) return false;
+
+    sqlite3_stmt* stmt = nullptr;
+    const char* sql = "SELECT 1 FROM downloaded_urls WHERE url_key = ?;";
+    if (sqlite3_prepare_v2(m_db, sql, -1, &stmt, nullptr) != SQLITE_OK) return false;
+    sqlite3_bind_text(stmt, 1, urlKey.c_str(), -1, SQLITE_TRANSIENT);
+    bool found = sqlite3_step(stmt) == SQLITE_ROW;
+    sqlite3_finalize(stmt);
+    return found;
+}
+
 // ============================================================================
-// Start download
+// Job journal
 // ============================================================================
 
-bool DownloadManager::StartDownload(const std::string& sourceId, const std::string& input) {
-    ISourceProvider* source = SourceManager::instance().GetById(sourceId);
-    if (!source) {
-        FB2K_console_formatter() << "[foo_downloader] Unknown source: " << sourceId.c_str();
-        popup_message::g_show("Unknown download source selected.", "foo_downloader", popup_message::icon_error);
-        return false;
+void DownloadManager::JournalUpdate(DownloadEntry& entry) {
+    // NOTE: caller must hold m_mutex
+    JournalOp op;
+    op.rowId = entry.jobRowId;
+    if (entry.status == "complete" || entry.status == "error") {
+        // Terminal entries live on in the downloads table (SaveHistory)
+        op.kind = JournalOp::Delete;
+        entry.jobRowId = 0;
+    } else {
+        op.kind = JournalOp::Update;
+        op.status = entry.status;
+        auto job = m_jobs.find(entry.id);
+        if (job != m_jobs.end()) op.attempts = job->second.attempts;
     }
+    m_journalOps.push_back(std::move(op));
+}
 
-    std::vector<DownloadItem> items;
-    std::string errorMsg;
-
-    if (!source->Resolve(input.c_str(), items, errorMsg)) {
-        if (!errorMsg.empty()) {
-            FB2K_console_formatter() << "[foo_downloader] Resolve failed: " << errorMsg.c_str();
-            popup_message::g_show(errorMsg.c_str(), "foo_downloader", popup_message::icon_error);
-        }
-        return false;
+void DownloadManager::FlushJournal() {
+    // NOTE: poll thread (or Shutdown after it has stopped), without m_mutex.
+    // Everything queued since the last flush goes in one transaction, so a
+    // bulk enqueue costs one commit rather than one per item.
+    std::vector<JournalOp> ops;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ops.swap(m_journalOps);
     }
+    if (ops.empty()) return;
 
-    if (items.empty()) {
-        popup_message::g_show("No downloadable items found.", "foo_downloader", popup_message::icon_error);
-        return false;
+    int64_t lastRow = 0;
+    for (const auto& op : ops) {
+        if (op.kind == JournalOp::Insert && op.rowId > lastRow) lastRow = op.rowId;
     }
 
-    for (const auto& item : items) {
-        if (item.useYtDlp) {
-            // Use yt-dlp for this download
-            std::string gid = StartYtDlpDownload(item);
-            if (gid.empty()) {
-                FB2K_console_formatter() << "[foo_downloader] Failed to start yt-dlp for: " << item.url.c_str();
-                continue;
-            }
-
-            DownloadEntry entry;
-            entry.gid = gid;
-            entry.sourceId = sourceId;
-            entry.url = item.url;
-            entry.title = item.title.empty() ? item.url : item.title;
-            entry.status = "active";
-            entry.engine = "ytdlp";
-
-            {
-                std::lock_guard<std::mutex> lock(m_mutex);
-                m_downloads.push_back(std::move(entry));
-            }
-
-            FB2K_console_formatter() << "[foo_downloader] yt-dlp started: " << item.title.c_str();
+    if (!m_journalDb) {
+        if (sqlite3_open(GetDatabasePath().c_str(), &m_journalDb) != SQLITE_OK) {
+            LogLine() << "[foo_downloader] Failed to open job journal: " << sqlite3_errmsg(m_journalDb);
+            sqlite3_close(m_journalDb);
+            m_journalDb = nullptr;
         } else {
-            // Use aria2 for this download
-            auto& aria2 = Aria2RpcClient::instance();
-            if (!aria2.IsRunning()) {
-                popup_message::g_show("aria2 daemon is not running. Check Preferences > Tools > Downloader.", "foo_downloader", popup_message::icon_error);
-                return false;
-            }
-
-            std::map<std::string, std::string> options;
-            std::vector<std::string> headers;
+            sqlite3_busy_timeout(m_journalDb, 5000);
+            // WAL + NORMAL: a commit survives a crash of foobar2000, which is
+            // what the journal is for, without an fsync per commit
+            sqlite3_exec(m_journalDb, "PRAGMA synchronous=NORMAL;", nullptr, nullptr, nullptr);
+        }
+    }
 
-            int retries = GetConfigRetryCount();
-            if (retries > 0) {
-                options["max-tries"] = std::to_string(retries);
-                options["retry-wait"] = "2";
+    if (m_journalDb) {
+        TRACE_SCOPE("FlushJournal");
+        MetricTimer timer(SqliteWriteHistogram(true));
+        sqlite3_stmt* insert = nullptr;
+        sqlite3_stmt* update = nullptr;
+        sqlite3_stmt* remove = nullptr;
+        sqlite3_prepare_v2(m_journalDb,
+            "INSERT OR REPLACE INTO jobs (id, source_id, status, attempts, url, filename, title, artist, album, "
+            "use_ytdlp, audio_format, audio_quality, headers) VALUES (?, ?, ?, 0, ?, ?, ?, ?, ?, ?, ?, ?, ?);",
+            -1, &insert, nullptr);
+        sqlite3_prepare_v2(m_journalDb, "UPDATE jobs SET status = ?, attempts = ? WHERE id = ?;", -1, &update, nullptr);
+        sqlite3_prepare_v2(m_journalDb, "DELETE FROM jobs WHERE id = ?;", -1, &remove, nullptr);
+
+        sqlite3_exec(m_journalDb, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+        for (const auto& op : ops) {
+            sqlite3_stmt* stmt = nullptr;
+            if (op.kind == JournalOp::Insert && insert) {
+                std::string headers;
+                for (const auto& h : op.item.headers) {
+                    if (!headers.empty()) headers += '\n';
+                    headers += h;
+                }
+                stmt = insert;
+                sqlite3_bind_int64(stmt, 1, op.rowId);
+                sqlite3_bind_text(stmt, 2, op.sourceId.c_str(), -1, SQLITE_TRANSIENT);
+                sqlite3_bind_text(stmt, 3, op.status.c_str(), -1, SQLITE_TRANSIENT);
+                sqlite3_bind_text(stmt, 4, op.item.url.c_str(), -1, SQLITE_TRANSIENT);
+                sqlite3_bind_text(stmt, 5, op.item.filename.c_str(), -1, SQLITE_TRANSIENT);
+                sqlite3_bind_text(stmt, 6, op.item.title.c_str(), -1, SQLITE_TRANSIENT);
+                sqlite3_bind_text(stmt, 7, op.item.artist.c_str(), -1, SQLITE_TRANSIENT);
+                sqlite3_bind_text(stmt, 8, op.item.album.c_str(), -1, SQLITE_TRANSIENT);
+                sqlite3_bind_int(stmt, 9, op.item.useYtDlp ? 1 : 0);
+                sqlite3_bind_text(stmt, 10, op.item.audioFormat.c_str(), -1, SQLITE_TRANSIENT);
+                sqlite3_bind_text(stmt, 11, op.item.audioQuality.c_str(), -1, SQLITE_TRANSIENT);
+                sqlite3_bind_text(stmt, 12, headers.c_str(), -1, SQLITE_TRANSIENT);
+            } else if (op.kind == JournalOp::Update && update) {
+                stmt = update;
+                sqlite3_bind_text(stmt, 1, op.status.c_str(), -1, SQLITE_TRANSIENT);
+                sqlite3_bind_int(stmt, 2, op.attempts);
+                sqlite3_bind_int64(stmt, 3, op.rowId);
+            } else if (op.kind == JournalOp::Delete && remove) {
+                stmt = remove;
+                sqlite3_bind_int64(stmt, 1, op.rowId);
             }
+            if (!stmt) continue;
+            sqlite3_step(stmt);
+            sqlite3_reset(stmt);
+        }
+        if (sqlite3_exec(m_journalDb, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+            LogLine() << "[foo_downloader] Job journal commit failed: " << sqlite3_errmsg(m_journalDb);
+            sqlite3_exec(m_journalDb, "ROLLBACK;", nullptr, nullptr, nullptr);
+        }
+        sqlite3_finalize(insert);
+        sqlite3_finalize(update);
+        sqlite3_finalize(remove);
+    }
 
-            if (!item.filename.empty() && item.filename.find('.') != std::string::npos) {
-                options["out"] = item.filename;
-            }
+    // Jobs are released for submission even if the journal is unavailable;
+    // they just won't survive a restart
+    if (lastRow > 0) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (lastRow > m_journalDurableRow) m_journalDurableRow = lastRow;
+    }
+}
 
-            // Apply any custom headers provided by the source
-            for (const auto& h : item.headers) {
-                headers.push_back(h);
-            }
+void DownloadManager::ResumeJobs() {
+    std::vector<std::pair<DownloadEntry, DownloadItem>> resumed;
+    std::vector<int> attempts;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_db) OpenDb();
+        if (!m_db) return;
+
+        const char* selectSql =
+            "SELECT id, source_id, attempts, url, filename, title, artist, album, use_ytdlp, "
+            "audio_format, audio_quality, headers FROM jobs ORDER BY id;";
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v2(m_db, selectSql, -1, &stmt, nullptr) != SQLITE_OK) {
+            LogLine() << "[foo_downloader] Failed to read job journal: " << sqlite3_errmsg(m_db);
+            return;
+        }
 
-            std::string gid;
-            int rpcRetries = (retries > 0) ? retries : 1;
-            for (int attempt = 0; attempt < rpcRetries; attempt++) {
-                gid = aria2.AddUri(item.url, options, headers);
-                if (!gid.empty()) break;
-                if (attempt + 1 < rpcRetries) {
-                    FB2K_console_formatter() << "[foo_downloader] AddUri failed, retrying (" << (uint32_t)(attempt + 1) << "/" << (uint32_t)rpcRetries << ")...";
-                    Sleep(1000);
-                }
-            }
-            if (gid.empty()) {
-                FB2K_console_formatter() << "[foo_downloader] Failed to add after " << (uint32_t)rpcRetries << " attempts: " << item.url.c_str();
-                continue;
+        auto text = [stmt](int col) -> std::string {
+            const char* v = (const char*)sqlite3_column_text(stmt, col);
+            return v ? v : "";
+        };
+        while (sqlite3_step(stmt) == SQLITE_ROW) {
+            DownloadItem item;
+            item.url = text(3);
+            item.filename = text(4);
+            item.title = text(5);
+            item.artist = text(6);
+            item.album = text(7);
+            item.useYtDlp = sqlite3_column_int(stmt, 8) != 0;
+            item.audioFormat = text(9);
+            item.audioQuality = text(10);
+            std::string headers = text(11);
+            size_t start = 0;
+            while (start < headers.size()) {
+                size_t end = headers.find('\n', start);
+                if (end == std::string::npos) end = headers.size();
+                item.headers.push_back(headers.substr(start, end - start));
+                start = end + 1;
             }
 
+            // Whatever state it was in, it starts over from the queue; aria2
+            // and yt-dlp continue their partial files
             DownloadEntry entry;
-            entry.gid = gid;
-            entry.sourceId = sourceId;
+            entry.jobRowId = sqlite3_column_int64(stmt, 0);
+            entry.sourceId = text(1);
             entry.url = item.url;
             entry.title = item.title.empty() ? item.url : item.title;
             entry.status = "queued";
-            entry.engine = "aria2";
-
-            {
-                std::lock_guard<std::mutex> lock(m_mutex);
-                m_downloads.push_back(std::move(entry));
-            }
-
-            FB2K_console_formatter() << "[foo_downloader] Queued: " << item.title.c_str() << " (GID: " << gid.c_str() << ")";
+            entry.engine = item.useYtDlp ? "ytdlp" : "aria2";
+            entry.times.resolveStart = entry.times.resolveEnd = TickMs();
+            resumed.emplace_back(std::move(entry), std::move(item));
+            attempts.push_back(sqlite3_column_int(stmt, 2));
         }
+        sqlite3_finalize(stmt);
+        if (resumed.empty()) return;
+
+        for (size_t i = 0; i < resumed.size(); i++) {
+            JournalOp op;
+            op.rowId = resumed[i].first.jobRowId;
+            op.status = "queued";
+            op.attempts = attempts[i];
+            m_journalOps.push_back(std::move(op));
+            AddJob(std::move(resumed[i].first), resumed[i].second, attempts[i]);
+        }
+        m_listVersion++;
     }
 
-    // Start poll thread on first download
+    LogLine() << "[foo_downloader] Resumed " << (uint32_t)resumed.size() << " unfinished download(s).";
     if (!m_pollThread.joinable()) {
         m_pollThread = std::thread(&DownloadManager::PollThread, this);
     }
-
-    return true;
 }
 
-// ============================================================================
-// yt-dlp download management
-// ============================================================================
+std::vector<LatencyGroup> DownloadManager::GetLatencySummary() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_db) OpenDb();
+    if (!m_db) return {};
 
-std::string DownloadManager::StartYtDlpDownload(const DownloadItem& item) {
-    // Use configured path first, fall back to auto-detect
-    const char* cfgPath = GetConfigYtDlpPath();
-    std::string ytdlpPath = (cfgPath && *cfgPath) ? cfgPath : YouTubeSource::GetYtDlpPath();
+    // Most recent completed downloads only, so old runs (another network,
+    // older tools) age out of the figures
+    const char* sql =
+        "SELECT source_id, engine, t_submit_ms, t_first_byte_ms, t_playlist_ms FROM downloads "
+        "WHERE status = 'complete' AND t_submit_ms IS NOT NULL ORDER BY id DESC LIMIT ?;";
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(m_db, sql, -1, &stmt, nullptr) != SQLITE_OK) return {};
+    sqlite3_bind_int(stmt, 1, (int)LATENCY_SAMPLE_ROWS);
 
-    // Build output directory
-    std::string outputDir = GetConfigOutputFolder();
-    if (outputDir.empty()) {
-        // Default: user's Music folder
-        char musicPath[MAX_PATH];
-        if (SHGetFolderPathA(NULL, CSIDL_MYMUSIC, NULL, 0, musicPath) == S_OK) {
-            outputDir = std::string(musicPath) + "\\foo_downloader";
-        } else {
-            outputDir = "C:\\Music\\foo_downloader";
+    struct Samples { std::vector<uint64_t> firstByte, toPlaylist; };
+    std::map<std::string, Samples> groups;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char* source = (const char*)sqlite3_column_text(stmt, 0);
+        const char* engine = (const char*)sqlite3_column_text(stmt, 1);
+        Samples* targets[] = {
+            &groups[std::string("source:") + (source ? source : "")],
+            &groups[std::string("engine:") + (engine ? engine : "")],
+        };
+        for (Samples* t : targets) {
+            if (sqlite3_column_type(stmt, 3) != SQLITE_NULL) {
+                int64_t ttfb = sqlite3_column_int64(stmt, 3) - sqlite3_column_int64(stmt, 2);
+                if (ttfb >= 0) t->firstByte.push_back((uint64_t)ttfb);
+            }
+            if (sqlite3_column_type(stmt, 4) != SQLITE_NULL) {
+                t->toPlaylist.push_back((uint64_t)sqlite3_column_int64(stmt, 4));
+            }
         }
     }
+    sqlite3_finalize(stmt);
 
-    // Ensure output dir exists
-    CreateDirectoryA(outputDir.c_str(), NULL);
+    std::vector<LatencyGroup> result;
+    for (auto& [name, samples] : groups) {
+        LatencyGroup g;
+        g.name = name;
+        g.firstByte = ComputePercentiles(samples.firstByte);
+        g.toPlaylist = ComputePercentiles(samples.toPlaylist);
+        result.push_back(std::move(g));
+    }
+    return result;
+}
 
-    // Build yt-dlp command
-    std::string audioFmt = item.audioFormat.empty() ? "flac" : item.audioFormat;
-    std::string audioQual = item.audioQuality.empty() ? "0" : item.audioQuality;
+std::vector<DownloadEntry> DownloadManager::QueryHistory(int64_t beforeId, int limit) {
+    std::vector<DownloadEntry> result;
+    if (limit <= 0) return result;
 
-    std::string embedFlags;
-    if (GetConfigEmbedMetadata()) {
-        // Thumbnail embedding only works with: mp3, mkv/mka, ogg/opus/flac, m4a/mp4/m4v/mov
-        if (audioFmt == "wav") {
-            embedFlags = "--embed-metadata ";
-        } else {
-            embedFlags = "--embed-metadata --embed-thumbnail ";
-        }
-    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_db) OpenDb();
+    if (!m_db) return result;
 
-    // User-specified extra flags
-    std::string extraFlags;
-    const char* cfgExtra = GetConfigYtDlpExtraFlags();
-    if (cfgExtra && *cfgExtra) {
-        extraFlags = std::string(cfgExtra) + " ";
+    if (!SelectHistoryRows(m_db, beforeId, limit, result)) {
+        LogLine() << "[foo_downloader] Failed to query history page: " << sqlite3_errmsg(m_db);
     }
+    return result;
+}
 
-    std::string retryFlags;
-    int retries = GetConfigRetryCount();
-    if (retries > 0) {
-        retryFlags = "--retries " + std::to_string(retries) + " "
-                     "--file-access-retries " + std::to_string(retries) + " "
-                     "--fragment-retries " + std::to_string(retries) + " ";
-    }
-
-    std::string cmd = "\"" + ytdlpPath + "\" "
-        "-x "
-        "--audio-format " + audioFmt + " "
-        "--audio-quality " + audioQual + " "
-        + embedFlags
-        + extraFlags
-        + retryFlags +
-        "--newline "
-        "--no-warnings "
-        "--no-playlist "
-        "-o \"" + outputDir + "\\%(title)s.%(ext)s\" "
-        "\"" + item.url + "\"";
-
-    FB2K_console_formatter() << "[foo_downloader] yt-dlp cmd: " << cmd.c_str();
-
-    // Create pipe for stdout
-    SECURITY_ATTRIBUTES sa = {};
-    sa.nLength = sizeof(sa);
-    sa.bInheritHandle = TRUE;
-
-    HANDLE hReadPipe = NULL, hWritePipe = NULL;
-    if (!CreatePipe(&hReadPipe, &hWritePipe, &sa, 0)) {
-        return "";
-    }
-    SetHandleInformation(hReadPipe, HANDLE_FLAG_INHERIT, 0);
+int64_t DownloadManager::GetHistoryWindowStart() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_historyWindowStart;
+}
 
-    STARTUPINFOA si = {};
-    si.cb = sizeof(si);
-    si.dwFlags = STARTF_USESTDHANDLES | STARTF_USESHOWWINDOW;
-    si.hStdOutput = hWritePipe;
-    si.hStdError = hWritePipe;
-    si.wShowWindow = SW_HIDE;
+void DownloadManager::RemoveHistoryEntry(int64_t historyId) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    DeleteHistoryRow(historyId);
+}
 
-    PROCESS_INFORMATION pi = {};
-    std::vector<char> cmdBuf(cmd.begin(), cmd.end());
-    cmdBuf.push_back(0);
+// ============================================================================
+// Start download
+// ============================================================================
 
-    if (!CreateProcessA(NULL, cmdBuf.data(), NULL, NULL, TRUE, CREATE_NO_WINDOW, NULL, NULL, &si, &pi)) {
-        CloseHandle(hReadPipe);
-        CloseHandle(hWritePipe);
-        FB2K_console_formatter() << "[foo_downloader] Failed to start yt-dlp process.";
-        return "";
+bool DownloadManager::StartDownload(const std::string& sourceId, const std::string& input) {
+    TRACE_SCOPE("StartDownload");
+    ISourceProvider* source = SourceManager::instance().GetById(sourceId);
+    if (!source) {
+        LogLine() << "[foo_downloader] Unknown source: " << sourceId.c_str();
+        HostShowError("Unknown download source selected.");
+        return false;
     }
 
-    CloseHandle(hWritePipe); // Close write end in parent
-    CloseHandle(pi.hThread);
+    // Placeholder row while the source resolves on a worker thread
+    auto cancel = std::make_shared<ResolveCancel>();
+    uint64_t placeholderId = 0;
+    {
+        DownloadEntry entry;
+        entry.sourceId = sourceId;
+        entry.url = input;
+        entry.title = input;
+        entry.status = "resolving";
 
-    // Generate unique GID
-    std::string gid = "ytdlp_" + std::to_string(++m_ytdlpCounter);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // A prefetch of another input is no use any more
+        if (m_prefetch && m_prefetch->key != sourceId + "\n" + input) {
+            m_prefetch->cancel.cancelled = true;
+            m_prefetch.reset();
+        }
+        entry.id = placeholderId = ++m_nextId;
+        m_resolving[placeholderId] = cancel;
+        m_downloads.push_back(std::move(entry));
+        RecordChange(DownloadChangeKind::Inserted, m_downloads.back());
+        m_listVersion++;
+    }
 
-    YtDlpProcess proc;
-    proc.hProcess = pi.hProcess;
-    proc.hStdoutRead = hReadPipe;
+    bool submitted = m_resolvePool.Submit([this, source, sourceId, input, placeholderId, cancel]() {
+        ResolveAndQueue(source, sourceId, input, placeholderId, *cancel);
+    });
+    if (!submitted) {
+        // Shutting down
+        std::lock_guard<std::mutex> lock(m_mutex);
+        CancelResolve(placeholderId);
+        return false;
+    }
+
+    // Start poll thread on first download
+    if (!m_pollThread.joinable()) {
+        m_pollThread = std::thread(&DownloadManager::PollThread, this);
+    }
 
+    return true;
+}
+
+void DownloadManager::Prefetch(const std::string& sourceId, const std::string& input) {
+    ISourceProvider* source = SourceManager::instance().GetById(sourceId);
+    auto run = std::make_shared<PrefetchRun>();
+    run->key = sourceId + "\n" + input;
     {
         std::lock_guard<std::mutex> lock(m_mutex);
-        m_ytdlpProcs[gid] = proc;
+        if (m_prefetch && m_prefetch->key == run->key) return;  // Running or done already
+        if (m_prefetch) m_prefetch->cancel.cancelled = true;
+        m_prefetch.reset();
+        if (!source || input.empty()) return;
+        m_prefetch = run;
     }
 
-    return gid;
+    // Queued behind real resolves; one overtaken while waiting never starts
+    m_resolvePool.Submit([this, source, input, run]() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (run->cancel.IsCancelled()) return;
+            run->started = true;
+        }
+        {
+            TRACE_SCOPE("Prefetch");
+            source->Prefetch(input.c_str(), run->cancel);
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        run->done = true;
+        m_prefetchDone.notify_all();
+    });
 }
 
-void DownloadManager::PollYtDlpDownload(DownloadEntry& entry) {
-    auto it = m_ytdlpProcs.find(entry.gid);
-    if (it == m_ytdlpProcs.end()) {
-        entry.status = "error";
-        entry.errorMessage = "yt-dlp process not found";
+void DownloadManager::WaitForPrefetch(const std::string& key, const ResolveCancel& cancel) {
+    // NOTE: runs on a resolve worker. The search would run again next to
+    // the prefetch's; wait for that one to fill the search cache instead.
+    // A prefetch still queued would only start after us and is dropped.
+    std::unique_lock<std::mutex> lock(m_mutex);
+    std::shared_ptr<PrefetchRun> run = m_prefetch;
+    if (!run || run->key != key) return;
+    if (!run->started) {
+        run->cancel.cancelled = true;
+        m_prefetch.reset();
         return;
     }
 
-    auto& proc = it->second;
+    TRACE_SCOPE("WaitForPrefetch");
+    while (!run->done && !cancel.IsCancelled()) {
+        m_prefetchDone.wait_for(lock, std::chrono::milliseconds(100));
+    }
+}
 
-    // Non-blocking read from stdout pipe
-    DWORD avail = 0;
-    if (PeekNamedPipe(proc.hStdoutRead, NULL, 0, NULL, &avail, NULL) && avail > 0) {
-        char buf[4096];
-        DWORD toRead = (avail < sizeof(buf) - 1) ? avail : sizeof(buf) - 1;
-        DWORD bytesRead = 0;
-        if (ReadFile(proc.hStdoutRead, buf, toRead, &bytesRead, NULL) && bytesRead > 0) {
-            buf[bytesRead] = 0;
-            proc.capturedOutput += buf;
-        }
+void DownloadManager::CancelResolve(uint64_t id) {
+    // NOTE: caller must hold m_mutex
+    auto token = m_resolving.find(id);
+    if (token != m_resolving.end()) {
+        token->second->cancelled = true;
+        m_resolving.erase(token);
     }
 
-    // Parse progress from captured output
+    auto it = std::find_if(m_downloads.begin(), m_downloads.end(),
+        [id](const DownloadEntry& e) { return e.id == id; });
+    if (it != m_downloads.end() && it->status == "resolving") {
+        RecordChange(DownloadChangeKind::Removed, *it);
+        m_downloads.erase(it);
+        m_listVersion++;
+    }
+}
+
+void DownloadManager::ResolveAndQueue(ISourceProvider* source, const std::string& sourceId,
+                                      const std::string& input, uint64_t placeholderId,
+                                      const ResolveCancel& cancel) {
+    // NOTE: runs on a resolve worker
+    std::vector<DownloadItem> items;
+    std::string errorMsg;
+    StageTimes times;
+    times.resolveStart = TickMs();
+    WaitForPrefetch(sourceId + "\n" + input, cancel);
+    bool ok;
     {
-        auto& out = proc.capturedOutput;
-
-        auto lastDl = out.rfind("[download]");
-        if (lastDl != std::string::npos) {
-            auto lineEnd = out.find('\n', lastDl);
-            std::string line = (lineEnd != std::string::npos)
-                ? out.substr(lastDl, lineEnd - lastDl)
-                : out.substr(lastDl);
-
-            auto pctPos = line.find('%');
-            if (pctPos != std::string::npos) {
-                size_t numStart = pctPos;
-                while (numStart > 0 && (isdigit(line[numStart - 1]) || line[numStart - 1] == '.')) {
-                    numStart--;
-                }
-                std::string pctStr = line.substr(numStart, pctPos - numStart);
-                try { entry.progress = std::stod(pctStr); } catch (...) {}
-            }
+        TRACE_SCOPE("Resolve");
+        ok = source->Resolve(input.c_str(), items, errorMsg, cancel);
+    }
+    times.resolveEnd = TickMs();
+    times.selection = cancel.userWaitMs;
 
-            auto atPos = line.find(" at ");
-            if (atPos != std::string::npos) {
-                std::string speedPart = line.substr(atPos + 4);
-                size_t start = speedPart.find_first_not_of(' ');
-                if (start != std::string::npos) {
-                    speedPart = speedPart.substr(start);
-                    double speedVal = 0;
-                    try { speedVal = std::stod(speedPart); } catch (...) {}
-
-                    if (speedPart.find("GiB/s") != std::string::npos) {
-                        entry.speed = (uint64_t)(speedVal * 1024 * 1024 * 1024);
-                    } else if (speedPart.find("MiB/s") != std::string::npos) {
-                        entry.speed = (uint64_t)(speedVal * 1024 * 1024);
-                    } else if (speedPart.find("KiB/s") != std::string::npos) {
-                        entry.speed = (uint64_t)(speedVal * 1024);
-                    } else if (speedPart.find("B/s") != std::string::npos) {
-                        entry.speed = (uint64_t)speedVal;
-                    }
-                }
-            }
-        }
+    {
+        // The placeholder goes away whatever the outcome; if it is already
+        // gone the user cancelled and the result is dropped.
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (cancel.IsCancelled() || !m_resolving.count(placeholderId)) return;
+        CancelResolve(placeholderId);
+    }
 
-        // Check for ExtractAudio destination (final output path)
-        auto extractPos = out.rfind("[ExtractAudio] Destination: ");
-        if (extractPos != std::string::npos) {
-            size_t pathStart = extractPos + strlen("[ExtractAudio] Destination: ");
-            auto pathEnd = out.find('\n', pathStart);
-            std::string path = (pathEnd != std::string::npos)
-                ? out.substr(pathStart, pathEnd - pathStart)
-                : out.substr(pathStart);
-            while (!path.empty() && (path.back() == '\r' || path.back() == '\n' || path.back() == ' ')) {
-                path.pop_back();
-            }
-            if (!path.empty()) entry.outputPath = path;
-        }
-
-        if (entry.outputPath.empty()) {
-            auto destPos = out.rfind("[download] Destination: ");
-            if (destPos != std::string::npos) {
-                size_t pathStart = destPos + strlen("[download] Destination: ");
-                auto pathEnd = out.find('\n', pathStart);
-                std::string path = (pathEnd != std::string::npos)
-                    ? out.substr(pathStart, pathEnd - pathStart)
-                    : out.substr(pathStart);
-                while (!path.empty() && (path.back() == '\r' || path.back() == '\n' || path.back() == ' ')) {
-                    path.pop_back();
-                }
-                if (!path.empty()) entry.outputPath = path;
-            }
+    if (!ok) {
+        if (!errorMsg.empty()) {
+            LogLine() << "[foo_downloader] Resolve failed: " << errorMsg.c_str();
+            HostShowError(errorMsg);
         }
+        return;
     }
 
-    // Check if process has exited
-    DWORD exitCode = STILL_ACTIVE;
-    if (GetExitCodeProcess(proc.hProcess, &exitCode) && exitCode != STILL_ACTIVE) {
-        // Read any remaining output
-        DWORD avail2 = 0;
-        while (PeekNamedPipe(proc.hStdoutRead, NULL, 0, NULL, &avail2, NULL) && avail2 > 0) {
-            char buf[4096];
-            DWORD toRead = (avail2 < sizeof(buf) - 1) ? avail2 : sizeof(buf) - 1;
-            DWORD bytesRead = 0;
-            if (ReadFile(proc.hStdoutRead, buf, toRead, &bytesRead, NULL) && bytesRead > 0) {
-                buf[bytesRead] = 0;
-                proc.capturedOutput += buf;
-            } else {
-                break;
-            }
-        }
+    if (items.empty()) {
+        HostShowError("No downloadable items found.");
+        return;
+    }
 
-        // Re-parse output path from final output
-        auto& out = proc.capturedOutput;
-        auto extractPos = out.rfind("[ExtractAudio] Destination: ");
-        if (extractPos != std::string::npos) {
-            size_t pathStart = extractPos + strlen("[ExtractAudio] Destination: ");
-            auto pathEnd = out.find('\n', pathStart);
-            std::string path = (pathEnd != std::string::npos)
-                ? out.substr(pathStart, pathEnd - pathStart)
-                : out.substr(pathStart);
-            while (!path.empty() && (path.back() == '\r' || path.back() == '\n' || path.back() == ' ')) {
-                path.pop_back();
-            }
-            if (!path.empty()) entry.outputPath = path;
-        }
+    EnqueueItems(sourceId, items, std::vector<StageTimes>(items.size(), times), true);
+}
 
-        if (exitCode == 0) {
-            entry.status = "complete";
-            entry.progress = 100.0;
-            entry.speed = 0;
+size_t DownloadManager::StartBulkDownload(const std::string& sourceId, const std::vector<std::string>& inputs) {
+    ISourceProvider* source = SourceManager::instance().GetById(sourceId);
+    if (!source) {
+        LogLine() << "[foo_downloader] Unknown source: " << sourceId.c_str();
+        HostShowError("Unknown download source selected.");
+        return 0;
+    }
 
-            if (!entry.outputPath.empty()) {
-                auto lastSlash = entry.outputPath.find_last_of("\\/");
-                if (lastSlash != std::string::npos && lastSlash + 1 < entry.outputPath.size()) {
-                    entry.title = entry.outputPath.substr(lastSlash + 1);
-                }
+    auto bulk = std::make_shared<BulkImport>();
+    bulk->source = source;
+    bulk->sourceId = sourceId;
+
+    std::set<std::string> seen;
+    for (const auto& line : inputs) {
+        size_t b = line.find_first_not_of(" \t\r\n");
+        if (b == std::string::npos) continue;
+        size_t e = line.find_last_not_of(" \t\r\n");
+        std::string input = line.substr(b, e - b + 1);
+        if (input[0] == '#') continue;   // M3U directives and comments
+        if (seen.insert(input).second) bulk->inputs.push_back(std::move(input));
+    }
+    if (bulk->inputs.empty()) return 0;
+
+    bulk->cancel = std::make_shared<ResolveCancel>();
+    bulk->startTick = TickMs();
+
+    // One placeholder row for the whole import; its progress is the share of
+    // inputs resolved so far and Cancel on it stops the remaining ones
+    {
+        DownloadEntry entry;
+        entry.sourceId = sourceId;
+        entry.title = "Bulk import (" + std::to_string(bulk->inputs.size()) + " items)";
+        entry.url = entry.title;
+        entry.status = "resolving";
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        entry.id = bulk->placeholderId = ++m_nextId;
+        m_resolving[entry.id] = bulk->cancel;
+        m_downloads.push_back(std::move(entry));
+        RecordChange(DownloadChangeKind::Inserted, m_downloads.back());
+        m_listVersion++;
+    }
+
+    int workers = (std::max)(1, (std::min)(source->GetBulkParallelism(), (int)BULK_RESOLVE_THREADS));
+    workers = (std::min)(workers, (int)bulk->inputs.size());
+    bulk->workersLeft = workers;
+
+    for (int i = 0; i < workers; i++) {
+        if (!m_bulkPool.Submit([this, bulk]() { RunBulkImport(bulk); })) {
+            // Shutting down; workers already submitted see the cancel flag
+            std::lock_guard<std::mutex> lock(m_mutex);
+            CancelResolve(bulk->placeholderId);
+            return 0;
+        }
+    }
+
+    // Start poll thread on first download
+    if (!m_pollThread.joinable()) {
+        m_pollThread = std::thread(&DownloadManager::PollThread, this);
+    }
+
+    LogLine() << "[foo_downloader] Bulk import started: " << (int)bulk->inputs.size()
+                             << " inputs, " << workers << " workers";
+    return bulk->inputs.size();
+}
+
+void DownloadManager::RunBulkImport(std::shared_ptr<BulkImport> bulk) {
+    // NOTE: runs on a bulk worker, alongside up to GetBulkParallelism()-1
+    // others for the same import
+    const size_t total = bulk->inputs.size();
+    std::vector<DownloadItem> batch;
+    std::vector<StageTimes> batchTimes;
+
+    for (;;) {
+        if (bulk->cancel->IsCancelled()) break;
+        size_t index = bulk->nextInput++;
+        if (index >= total) break;
+
+        const std::string& input = bulk->inputs[index];
+        std::vector<DownloadItem> items;
+        std::string errorMsg;
+        StageTimes times;
+        times.resolveStart = TickMs();
+        bool ok;
+        {
+            TRACE_SCOPE("Resolve");
+            ok = bulk->source->ResolveUnattended(input.c_str(), items, errorMsg, *bulk->cancel);
+        }
+        times.resolveEnd = TickMs();
+        if (ok && !items.empty()) {
+            bulk->queuedItems += items.size();
+            batchTimes.insert(batchTimes.end(), items.size(), times);
+            batch.insert(batch.end(), std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+        } else if (!bulk->cancel->IsCancelled()) {
+            bulk->failed++;
+            LogLine() << "[foo_downloader] Bulk import: skipped " << input.c_str()
+                                     << (errorMsg.empty() ? "" : ": ") << errorMsg.c_str();
+        }
+
+        size_t resolved = ++bulk->resolved;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = std::find_if(m_downloads.begin(), m_downloads.end(),
+                [&](const DownloadEntry& e) { return e.id == bulk->placeholderId; });
+            if (it != m_downloads.end()) {
+                UpdateField(*it, &DownloadEntry::progress, resolved * 100.0 / total, FieldProgress);
             }
+        }
 
-            OnDownloadComplete(entry);
-            FB2K_console_formatter() << "[foo_downloader] yt-dlp complete: " << entry.title.c_str();
+        if (batch.size() >= BULK_ENQUEUE_BATCH) {
+            if (!EnqueueItems(bulk->sourceId, batch, batchTimes, false)) bulk->cancel->cancelled = true;
+            batch.clear();
+            batchTimes.clear();
+        }
+    }
+
+    if (!batch.empty() && !bulk->cancel->IsCancelled()) {
+        EnqueueItems(bulk->sourceId, batch, batchTimes, false);
+    }
+
+    // Last worker out removes the placeholder and reports
+    if (--bulk->workersLeft > 0) return;
+
+    bool cancelled = bulk->cancel->IsCancelled();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        CancelResolve(bulk->placeholderId);
+    }
+
+    double seconds = (TickMs() - bulk->startTick) / 1000.0;
+    double rate = seconds > 0 ? bulk->queuedItems / seconds : 0.0;
+    LogLine() << "[foo_downloader] Bulk import " << (cancelled ? "cancelled" : "finished") << ": "
+                             << (int)bulk->resolved.load() << "/" << (int)total << " inputs, "
+                             << (int)bulk->queuedItems.load() << " items queued, "
+                             << (int)bulk->failed.load() << " failed, "
+                             << seconds << " s (" << rate << " items/s)";
+}
+
+static Aria2Job MakeAria2Job(uint64_t id, const DownloadItem& item) {
+    Aria2Job job;
+    job.id = id;
+    job.host = HostOf(item.url);
+    job.url = item.url;
+
+    // Retries belong to the manager (see HandleFailure); a re-added
+    // download picks up aria2's partial file instead of starting over
+    job.options["max-tries"] = "1";
+    job.options["continue"] = "true";
+
+    if (!item.filename.empty() && item.filename.find('.') != std::string::npos) {
+        job.options["out"] = item.filename;
+    }
+
+    // Apply any custom headers provided by the source
+    for (const auto& h : item.headers) {
+        job.headers.push_back(h);
+    }
+    return job;
+}
+
+bool DownloadManager::AddJob(DownloadEntry&& entry, const DownloadItem& item, int attempts) {
+    // NOTE: caller must hold m_mutex. Returns true if the entry was attached
+    // to an identical in-flight transfer instead of getting its own job.
+    entry.id = ++m_nextId;
+
+    // Journaled before anything is submitted; resumed entries already have a row
+    if (entry.jobRowId == 0) {
+        JournalOp op;
+        op.kind = JournalOp::Insert;
+        op.rowId = entry.jobRowId = ++m_nextJobRow;
+        op.status = entry.status;
+        op.sourceId = entry.sourceId;
+        op.item = item;
+        m_journalOps.push_back(std::move(op));
+    }
+
+    // Same resource already transferring (double-click, overlapping
+    // imports): follow that entry rather than start a second job
+    std::string key = NormalizeUrl(item.url);
+    auto inFlight = key.empty() ? m_inFlightKeys.end() : m_inFlightKeys.find(key);
+    if (inFlight != m_inFlightKeys.end()) {
+        uint64_t leaderId = inFlight->second;
+        auto leader = std::find_if(m_downloads.begin(), m_downloads.end(),
+            [leaderId](const DownloadEntry& e) { return e.id == leaderId; });
+        if (leader != m_downloads.end() && leader->status != "complete" && leader->status != "error") {
+            entry.leaderId = leaderId;
+            entry.engine = leader->engine;
+            entry.status = leader->status;
+            entry.progress = leader->progress;
+            entry.totalSize = leader->totalSize;
+            m_downloads.push_back(std::move(entry));
+            RecordChange(DownloadChangeKind::Inserted, m_downloads.back());
+            return true;
+        }
+    }
+    if (!key.empty()) m_inFlightKeys[key] = entry.id;
+
+    JobRecord& job = m_jobs[entry.id];
+    job.item = item;
+    job.host = HostOf(item.url);
+    job.attempts = attempts;
+    job.jobRowId = entry.jobRowId;
+    SubmitJob(entry.id, job);
+    m_downloads.push_back(std::move(entry));
+    RecordChange(DownloadChangeKind::Inserted, m_downloads.back());
+    return false;
+}
+
+void DownloadManager::SubmitJob(uint64_t id, const JobRecord& job) {
+    // NOTE: caller must hold m_mutex; the entry must be "queued"
+    if (job.item.useYtDlp) {
+        m_ytdlpQueue.push_back({ id, job.jobRowId, job.item });
+        WakePollThread();   // A slot may be free now
+    } else {
+        Aria2Job aria2Job = MakeAria2Job(id, job.item);
+        aria2Job.jobRowId = job.jobRowId;
+        m_aria2Queue.push_back(std::move(aria2Job));
+    }
+}
+
+void DownloadManager::HandleFailure(DownloadEntry& entry, FailureKind kind, const std::string& message,
+                                    bool hostFault) {
+    // NOTE: caller must hold m_mutex and saves history afterwards
+    auto job = m_jobs.find(entry.id);
+    uint64_t now = TickMs();
+
+    if (hostFault && kind != FailureKind::Permanent && job != m_jobs.end()) {
+        uint64_t cooldown = m_breaker.RecordFailure(job->second.host, now);
+        if (cooldown > 0) {
+            LogLine() << "[foo_downloader] " << job->second.host.c_str()
+                                     << " keeps failing, pausing new requests to it for "
+                                     << (int)(cooldown / 1000) << " s";
+        }
+    }
+
+    int maxRetries = GetConfigRetryCount();
+    if (kind == FailureKind::Permanent || job == m_jobs.end() || job->second.attempts >= maxRetries) {
+        UpdateField(entry, &DownloadEntry::status, std::string("error"), FieldStatus);
+        UpdateField(entry, &DownloadEntry::errorMessage, message, FieldErrorMessage);
+        UpdateField(entry, &DownloadEntry::speed, (uint64_t)0, FieldSpeed);
+        LogLine() << "[foo_downloader] Error (" << FailureKindName(kind) << "): "
+                                 << entry.title.c_str() << " - " << message.c_str();
+        EngineMetricsFor(entry.engine).failed.Add();
+        if (job != m_jobs.end()) m_jobs.erase(job);
+        return;
+    }
+
+    // Back to "queued" with a timer; the poll thread resubmits it when due
+    int attempt = ++job->second.attempts;
+    uint64_t delay = RetryDelayMs(attempt, kind);
+    m_retryTimers.emplace(now + delay, entry.id);
+
+    entry.gid.clear();
+    StageTimes resolved;
+    resolved.resolveStart = entry.times.resolveStart;
+    resolved.resolveEnd = entry.times.resolveEnd;
+    resolved.selection = entry.times.selection;
+    entry.times = resolved;
+    UpdateField(entry, &DownloadEntry::status, std::string("queued"), FieldStatus);
+    UpdateField(entry, &DownloadEntry::errorMessage, message, FieldErrorMessage);
+    UpdateField(entry, &DownloadEntry::speed, (uint64_t)0, FieldSpeed);
+    LogLine() << "[foo_downloader] Retry " << attempt << "/" << maxRetries << " in "
+                             << (double)delay / 1000.0 << " s (" << FailureKindName(kind) << "): "
+                             << entry.title.c_str() << " - " << message.c_str();
+}
+
+void DownloadManager::FireRetryTimers() {
+    // NOTE: caller must hold m_mutex
+    uint64_t now = TickMs();
+    while (!m_retryTimers.empty() && m_retryTimers.begin()->first <= now) {
+        uint64_t id = m_retryTimers.begin()->second;
+        m_retryTimers.erase(m_retryTimers.begin());
+
+        // Dropped if the entry was cancelled or removed while waiting
+        auto job = m_jobs.find(id);
+        if (job == m_jobs.end()) continue;
+        auto it = std::find_if(m_downloads.begin(), m_downloads.end(),
+            [id](const DownloadEntry& e) { return e.id == id; });
+        if (it == m_downloads.end() || it->status != "queued") continue;
+
+        SubmitJob(id, job->second);
+    }
+}
+
+bool DownloadManager::EnqueueItems(const std::string& sourceId, const std::vector<DownloadItem>& allItems,
+                                   const std::vector<StageTimes>& allTimes, bool interactive) {
+    // Items that were downloaded before: the Bloom filter rules out almost
+    // every new URL without touching the database
+    std::vector<DownloadItem> fresh;
+    std::vector<StageTimes> freshTimes;
+    size_t duplicates = 0;
+    if (GetConfigDuplicatePolicy() != DUPLICATE_DOWNLOAD_AGAIN) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (size_t i = 0; i < allItems.size(); i++) {
+            if (WasDownloaded(NormalizeUrl(allItems[i].url))) {
+                duplicates++;
+            } else {
+                fresh.push_back(allItems[i]);
+                freshTimes.push_back(allTimes[i]);
+            }
+        }
+    }
+
+    bool skipDuplicates = duplicates > 0;
+    if (skipDuplicates && interactive && GetConfigDuplicatePolicy() == DUPLICATE_ASK) {
+        std::string msg;
+        if (allItems.size() == 1) {
+            msg = "\"" + (allItems[0].title.empty() ? allItems[0].url : allItems[0].title)
+                + "\" has already been downloaded.\n\nDownload it again?";
+        } else {
+            msg = std::to_string(duplicates) + " of the " + std::to_string(allItems.size())
+                + " selected items have already been downloaded.\n\nDownload them again?";
+        }
+        skipDuplicates = !HostConfirm(msg, m_shutdown);
+    }
+
+    if (skipDuplicates) {
+        LogLine() << "[foo_downloader] Skipped " << (int)duplicates << " already downloaded item(s)";
+        if (fresh.empty()) return true;
+    }
+    const std::vector<DownloadItem>& items = skipDuplicates ? fresh : allItems;
+    const std::vector<StageTimes>& times = skipDuplicates ? freshTimes : allTimes;
+
+    bool needsAria2 = std::any_of(items.begin(), items.end(),
+        [](const DownloadItem& item) { return !item.useYtDlp; });
+    if (needsAria2 && !Aria2RpcClient::instance().IsRunning()) {
+        HostShowError("aria2 daemon is not running. Check Preferences > Tools > Downloader.");
+        return false;
+    }
+
+    // Entries are built outside the lock and published in one go, so a bulk
+    // batch costs one lock round-trip rather than one per item
+    std::vector<DownloadEntry> entries;
+    entries.reserve(items.size());
+
+    for (size_t i = 0; i < items.size(); i++) {
+        const DownloadItem& item = items[i];
+        DownloadEntry entry;
+        entry.sourceId = sourceId;
+        entry.times = times[i];
+        entry.url = item.url;
+        entry.title = item.title.empty() ? item.url : item.title;
+        entry.status = "queued";
+        // yt-dlp jobs wait for a job slot (see PromoteYtDlpJobs), aria2 jobs
+        // for host admission (see AdmitAria2Jobs)
+        entry.engine = item.useYtDlp ? "ytdlp" : "aria2";
+        entries.push_back(std::move(entry));
+    }
+
+    size_t coalesced = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        TrimHistoryWindow();
+
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (AddJob(std::move(entries[i]), items[i], 0)) coalesced++;
+        }
+        m_listVersion++;
+    }
+
+    if (coalesced > 0) {
+        LogLine() << "[foo_downloader] " << (int)coalesced << " item(s) already downloading, attached to the running job";
+    }
+
+    if (items.size() == 1) {
+        LogLine() << "[foo_downloader] Queued: " << items[0].title.c_str();
+    } else {
+        LogLine() << "[foo_downloader] Queued " << (int)items.size() << " items";
+    }
+    return true;
+}
+
+// ============================================================================
+// yt-dlp download management
+// ============================================================================
+
+std::string DownloadManager::StartYtDlpDownload(const DownloadItem& item) {
+    YtDlpProcess proc;
+    proc.item = item;
+
+    // A pasted URL was already looked up while resolving; start from that
+    // JSON instead of running the extractor again
+    std::string urlKey = NormalizeUrl(item.url);
+    std::string videoId = urlKey.compare(0, 8, "youtube:") == 0 ? urlKey.substr(8) : "";
+    if (!videoId.empty()) proc.infoJsonPath = FindYtDlpInfo(videoId);
+
+    // Without the daemon, yt-dlp fetches the stream itself as before. With
+    // it, the lookup saves its JSON for the conversion to start from.
+    bool viaAria2 = GetConfigYtDlpViaAria2() && Aria2RpcClient::instance().IsRunning();
+    if (viaAria2 && proc.infoJsonPath.empty()) proc.lookupInfoPath = NewYtDlpInfoPath(videoId);
+    if (!StartYtDlpRun(proc, viaAria2 ? YtDlpStage::LookUp : YtDlpStage::Download)) {
+        LogLine() << "[foo_downloader] Failed to start yt-dlp process.";
+        return "";
+    }
+
+    // Generate unique GID
+    std::string gid = "ytdlp_" + std::to_string(++m_ytdlpCounter);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_ytdlpProcs[gid] = std::move(proc);
+    }
+
+    return gid;
+}
+
+bool DownloadManager::StartYtDlpRun(YtDlpProcess& proc, YtDlpStage stage) {
+    const DownloadItem& item = proc.item;
+
+    // Configured path first, else auto-detect
+    std::string ytdlpPath = YouTubeSource::GetYtDlpPath();
+
+    // Asking the executable for its version can take a yt-dlp start, which
+    // the poll thread must not wait for: runs go one-shot until a resolve
+    // thread has asked (a search or URL lookup usually has already)
+    if (ytdlpPath != m_ytdlpProbedPath) {
+        m_ytdlpProbedPath = ytdlpPath;
+        m_resolvePool.Submit([ytdlpPath]() { ProbeYtDlpVersion(ytdlpPath); });
+    }
+
+    // Build output directory
+    std::string outputDir = GetConfigOutputFolder();
+    if (outputDir.empty()) {
+        // Default: user's Music folder
+        outputDir = JoinPath(MusicDirectory(), "foo_downloader");
+    }
+
+    // Ensure output dir exists
+    MakeDirectory(outputDir);
+
+    // Build yt-dlp command
+    std::string audioFmt = item.audioFormat.empty() ? "flac" : item.audioFormat;
+    std::string audioQual = item.audioQuality.empty() ? "0" : item.audioQuality;
+
+    std::string embedFlags;
+    if (GetConfigEmbedMetadata()) {
+        // Thumbnail embedding only works with: mp3, mkv/mka, ogg/opus/flac, m4a/mp4/m4v/mov
+        if (audioFmt == "wav") {
+            embedFlags = "--embed-metadata ";
         } else {
-            entry.status = "error";
-            entry.speed = 0;
-
-            auto errPos = out.rfind("ERROR:");
-            if (errPos != std::string::npos) {
-                auto errEnd = out.find('\n', errPos);
-                entry.errorMessage = (errEnd != std::string::npos)
-                    ? out.substr(errPos, errEnd - errPos)
-                    : out.substr(errPos);
+            embedFlags = "--embed-metadata --embed-thumbnail ";
+        }
+    }
+
+    // User-specified extra flags
+    std::string extraFlags;
+    const char* cfgExtra = GetConfigYtDlpExtraFlags();
+    if (cfgExtra && *cfgExtra) {
+        extraFlags = std::string(cfgExtra) + " ";
+    }
+
+    // As for aria2 (max-tries=1): retrying a failed request belongs to the
+    // manager, whose backoff and host breaker would otherwise see one failure
+    // where yt-dlp had already made eleven attempts. A lost fragment is still
+    // retried in place: it is one piece of a transfer that is otherwise going.
+    std::string retryFlags = "--retries 0 --file-access-retries 0 ";
+    int retries = GetConfigRetryCount();
+    if (retries > 0) {
+        retryFlags += "--fragment-retries " + std::to_string(retries) + " ";
+    }
+
+    std::string input = proc.infoJsonPath.empty() ? "\"" + item.url + "\""
+                                                  : "--load-info-json \"" + proc.infoJsonPath + "\"";
+    std::string output = "-o \"" + JoinPath(outputDir, "%(title)s.%(ext)s") + "\" ";
+
+    std::string cmd = "\"" + ytdlpPath + "\" ";
+    if (stage == YtDlpStage::LookUp) {
+        // The format -x picks by default, unless the extra flags choose one
+        cmd += "-f bestaudio/best "
+            + extraFlags
+            + YtDlpStreamFlags();
+        if (!proc.lookupInfoPath.empty()) cmd += "--print-to-file \"video:%()j\" \"" + proc.lookupInfoPath + "\" ";
+        cmd += "--no-warnings "
+            "--no-playlist "
+            + output
+            + input;
+    } else {
+        cmd += "-x "
+            "--audio-format " + audioFmt + " "
+            "--audio-quality " + audioQual + " "
+            + embedFlags
+            + extraFlags
+            + retryFlags;
+        // Exactly the format aria2 fetched, so yt-dlp finds its file in place
+        // and goes straight to post-processing
+        if (stage == YtDlpStage::Convert) cmd += "-f " + proc.stream.formatId + " ";
+        cmd += YtDlpReportingFlags() +
+            "--newline "
+            "--no-warnings "
+            "--no-playlist "
+            + output
+            + input;
+    }
+
+    LogLine() << "[foo_downloader] yt-dlp cmd: " << cmd.c_str();
+
+    proc.stage = stage;
+    proc.output = YtDlpOutputParser();
+    // Its slot is refilled as soon as it ends, not at the next tick
+    return proc.process.Start(cmd, [this]() { WakePollThread(); });
+}
+
+bool DownloadManager::StartYtDlpTransfer(YtDlpProcess& proc) {
+    const std::string& path = proc.stream.filePath;
+    auto lastSlash = path.find_last_of("\\/");
+    if (lastSlash == std::string::npos || lastSlash + 1 >= path.size()) return false;
+
+    std::map<std::string, std::string> options;
+    options["dir"] = path.substr(0, lastSlash);
+    options["out"] = path.substr(lastSlash + 1);
+    options["split"] = std::to_string(STREAM_CONNECTIONS);
+    options["max-connection-per-server"] = std::to_string(STREAM_CONNECTIONS);
+    options["min-split-size"] = "1M";
+    // As for MakeAria2Job: retries belong to the manager, and a retry picks
+    // up the partial file. A renamed file would not be found by yt-dlp.
+    options["max-tries"] = "1";
+    options["continue"] = "true";
+    options["auto-file-renaming"] = "false";
+
+    proc.aria2Gid = Aria2RpcClient::instance().AddUri(proc.stream.url, options, proc.stream.headers);
+    return !proc.aria2Gid.empty();
+}
+
+void DownloadManager::PollYtDlpTransfer(DownloadEntry& entry, YtDlpProcess& proc) {
+    // NOTE: caller must hold m_mutex
+    auto& aria2 = Aria2RpcClient::instance();
+    if (!aria2.IsRunning()) return;
+
+    Aria2Status status = aria2.GetStatus(proc.aria2Gid);
+    uint64_t now = TickMs();
+    UpdateField(entry, &DownloadEntry::progress, status.GetProgress(), FieldProgress);
+    UpdateField(entry, &DownloadEntry::speed, status.downloadSpeed, FieldSpeed);
+    UpdateField(entry, &DownloadEntry::totalSize, status.totalLength, FieldTotalSize);
+    if (status.completedLength > 0 && entry.times.firstByte == 0) entry.times.firstByte = now;
+
+    if (status.IsComplete()) {
+        entry.times.transferEnd = now;
+        UpdateField(entry, &DownloadEntry::speed, (uint64_t)0, FieldSpeed);
+        LogLine() << "[foo_downloader] Stream fetched, converting: " << entry.title.c_str();
+        m_ytdlpNextStages.emplace_back(entry.gid, YtDlpStage::Convert);
+        return;
+    }
+    if (!status.IsError() && status.status != "removed") return;
+
+    // Drop aria2's record of the failed attempt; a retry looks the stream up again
+    aria2.Remove(proc.aria2Gid);
+    std::string message = status.errorMessage.empty() ? "aria2 stopped the download" : status.errorMessage;
+    FailureKind kind = ClassifyAria2Error(status.errorCode, status.errorMessage);
+    if (kind == FailureKind::Permanent && status.errorMessage.find("status=") != std::string::npos) {
+        // An HTTP refusal of a signed stream URL says nothing about the
+        // video; the next lookup signs a new one
+        kind = FailureKind::Transient;
+    }
+    if (!proc.infoJsonPath.empty()) ForgetYtDlpInfo(proc.infoJsonPath);
+
+    std::string gid = entry.gid;
+    HandleFailure(entry, kind, message, true);
+    SaveHistory();
+    m_ytdlpProcs.erase(gid);
+}
+
+void DownloadManager::PollYtDlpDownload(DownloadEntry& entry) {
+    TRACE_SCOPE("PollYtDlpDownload");
+    auto it = m_ytdlpProcs.find(entry.gid);
+    if (it == m_ytdlpProcs.end()) {
+        UpdateField(entry, &DownloadEntry::status, std::string("error"), FieldStatus);
+        UpdateField(entry, &DownloadEntry::errorMessage, std::string("yt-dlp process not found"), FieldErrorMessage);
+        return;
+    }
+
+    auto& proc = it->second;
+    if (proc.stage == YtDlpStage::Transfer) {
+        PollYtDlpTransfer(entry, proc);
+        return;
+    }
+
+    // Non-blocking read from stdout pipe; only the new bytes get parsed
+    proc.readBuffer.clear();
+    proc.process.ReadAvailable(proc.readBuffer);
+    proc.output.Feed(proc.readBuffer);
+
+    const YtDlpOutput& parsed = proc.output.State();
+    if (parsed.hasProgress) {
+        UpdateField(entry, &DownloadEntry::progress, parsed.progress, FieldProgress);
+
+        // Anything after 100% is yt-dlp's post-processing
+        uint64_t now = TickMs();
+        if (entry.progress > 0.0 && entry.times.firstByte == 0) entry.times.firstByte = now;
+        if (entry.progress >= 100.0 && entry.times.transferEnd == 0) entry.times.transferEnd = now;
+    }
+    if (parsed.hasSpeed) UpdateField(entry, &DownloadEntry::speed, parsed.speed, FieldSpeed);
+    if (parsed.totalBytes > 0) UpdateField(entry, &DownloadEntry::totalSize, parsed.totalBytes, FieldTotalSize);
+
+    // The printed file path is final; before that the ExtractAudio
+    // destination is, and until the conversion starts, show the file being
+    // downloaded
+    if (!parsed.filePath.empty()) {
+        UpdateField(entry, &DownloadEntry::outputPath, parsed.filePath, FieldOutputPath);
+    } else if (!parsed.extractPath.empty()) {
+        UpdateField(entry, &DownloadEntry::outputPath, parsed.extractPath, FieldOutputPath);
+    } else if (entry.outputPath.empty() && !parsed.downloadPath.empty()) {
+        UpdateField(entry, &DownloadEntry::outputPath, parsed.downloadPath, FieldOutputPath);
+    }
+
+    // Check if process has exited
+    int exitCode = 0;
+    if (proc.process.HasExited(exitCode)) {
+        // Read any remaining output
+        proc.readBuffer.clear();
+        proc.process.ReadAvailable(proc.readBuffer);
+        proc.output.Feed(proc.readBuffer);
+        proc.output.Finish();
+
+        if (proc.stage == YtDlpStage::LookUp && !proc.lookupInfoPath.empty()) {
+            uint64_t infoSize = 0;
+            if (exitCode == 0 && FileSizeOf(proc.lookupInfoPath, infoSize) && infoSize > 0) {
+                proc.infoJsonPath = proc.lookupInfoPath;
             } else {
-                entry.errorMessage = "yt-dlp exited with code " + std::to_string(exitCode);
+                ForgetYtDlpInfo(proc.lookupInfoPath);
+            }
+            proc.lookupInfoPath.clear();
+        }
+
+        if (proc.stage == YtDlpStage::LookUp && exitCode == 0) {
+            // Hand the stream to aria2 (one RPC round trip, as for the
+            // GetStatus calls of this sweep), or let yt-dlp fetch it after all
+            if (ParseYtDlpStream(parsed.streamInfo, proc.stream) && StartYtDlpTransfer(proc)) {
+                proc.stage = YtDlpStage::Transfer;
+                UpdateField(entry, &DownloadEntry::outputPath, proc.stream.filePath, FieldOutputPath);
+                LogLine() << "[foo_downloader] aria2 fetching stream: " << entry.title.c_str()
+                          << " (GID: " << proc.aria2Gid.c_str() << ")";
+                return;
+            }
+            LogLine() << "[foo_downloader] No stream aria2 can fetch; yt-dlp downloads " << entry.title.c_str();
+            m_ytdlpNextStages.emplace_back(entry.gid, YtDlpStage::Download);
+            return;
+        }
+
+        if (!parsed.filePath.empty()) {
+            UpdateField(entry, &DownloadEntry::outputPath, parsed.filePath, FieldOutputPath);
+        } else if (!parsed.extractPath.empty()) {
+            UpdateField(entry, &DownloadEntry::outputPath, parsed.extractPath, FieldOutputPath);
+        }
+
+        if (exitCode == 0) {
+            uint64_t now = TickMs();
+            if (entry.times.firstByte == 0) entry.times.firstByte = now;
+            if (entry.times.transferEnd == 0) entry.times.transferEnd = now;
+            entry.times.postProcessEnd = now;
+            UpdateField(entry, &DownloadEntry::status, std::string("complete"), FieldStatus);
+            UpdateField(entry, &DownloadEntry::progress, 100.0, FieldProgress);
+            UpdateField(entry, &DownloadEntry::speed, (uint64_t)0, FieldSpeed);
+            UpdateField(entry, &DownloadEntry::errorMessage, std::string(), FieldErrorMessage);
+            m_breaker.RecordSuccess(HostOf(entry.url));
+            m_jobs.erase(entry.id);
+
+            // yt-dlp reports no byte counts we can trust across fragments
+            // and conversions; count the file it produced
+            EngineMetrics& metrics = EngineMetricsFor("ytdlp");
+            metrics.completed.Add();
+            uint64_t fileSize = 0;
+            if (!entry.outputPath.empty() && FileSizeOf(entry.outputPath, fileSize)) {
+                metrics.bytes.Add(fileSize);
+            }
+
+            if (!entry.outputPath.empty()) {
+                auto lastSlash = entry.outputPath.find_last_of("\\/");
+                if (lastSlash != std::string::npos && lastSlash + 1 < entry.outputPath.size()) {
+                    UpdateField(entry, &DownloadEntry::title, entry.outputPath.substr(lastSlash + 1), FieldTitle);
+                }
+            }
+
+            if (!proc.infoJsonPath.empty()) ForgetYtDlpInfo(proc.infoJsonPath);
+            OnDownloadComplete(entry);
+            LogLine() << "[foo_downloader] yt-dlp complete: " << entry.title.c_str();
+        } else {
+            std::string message = parsed.errorLine;
+            if (message.empty()) message = "yt-dlp exited with code " + std::to_string(exitCode);
+            LogLine() << "[foo_downloader] yt-dlp error: " << message.c_str();
+            FailureKind kind = ClassifyYtDlpError(proc.output.RecentLines());
+            if (!proc.infoJsonPath.empty()) {
+                // Most likely its stream URLs stopped working (HTTP 403);
+                // the retry extracts afresh and gets a real verdict
+                ForgetYtDlpInfo(proc.infoJsonPath);
+                kind = FailureKind::Transient;
             }
-            FB2K_console_formatter() << "[foo_downloader] yt-dlp error: " << entry.errorMessage.c_str();
+            HandleFailure(entry, kind, message, true);
         }
 
         // Save history after status change
         SaveHistory();
 
-        CloseHandle(proc.hStdoutRead);
-        CloseHandle(proc.hProcess);
         m_ytdlpProcs.erase(it);
     }
 }
 
+void DownloadManager::PromoteYtDlpJobs() {
+    // NOTE: called by the poll thread without m_mutex held; spawning a process
+    // is too slow to do under the lock. Only this thread promotes, so the slot
+    // count cannot change under us except downwards.
+    const int maxJobs = GetConfigYtDlpMaxJobs();
+
+    for (;;) {
+        YtDlpJob job;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if ((int)m_ytdlpProcs.size() >= maxJobs) return;
+
+            // Skip jobs whose entry was removed or cancelled while waiting,
+            // and leave jobs that aren't journaled yet or are for a tripped
+            // host in the queue
+            std::map<std::string, int> running;
+            for (const auto& e : m_downloads) {
+                if (e.engine == "ytdlp" && e.status == "active" && e.leaderId == 0) running[HostOf(e.url)]++;
+            }
+            uint64_t now = TickMs();
+            bool found = false;
+            auto qi = m_ytdlpQueue.begin();
+            while (qi != m_ytdlpQueue.end() && !found) {
+                uint64_t id = qi->id;
+                auto e = std::find_if(m_downloads.begin(), m_downloads.end(),
+                    [id](const DownloadEntry& d) { return d.id == id; });
+                if (e == m_downloads.end() || e->status != "queued") {
+                    qi = m_ytdlpQueue.erase(qi);
+                    continue;
+                }
+                std::string host = HostOf(qi->item.url);
+                if (qi->jobRowId > m_journalDurableRow || !m_breaker.AllowRequest(host, now, running[host])) {
+                    ++qi;
+                    continue;
+                }
+                job = std::move(*qi);
+                m_ytdlpQueue.erase(qi);
+                found = true;
+            }
+            if (!found) return;
+        }
+
+        std::string gid = StartYtDlpDownload(job.item);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = std::find_if(m_downloads.begin(), m_downloads.end(),
+            [&job](const DownloadEntry& e) { return e.id == job.id; });
+        if (it == m_downloads.end() || it->status != "queued") {
+            // Removed or cancelled while the process was starting
+            if (!gid.empty()) CleanupYtDlpProcess(gid);
+            continue;
+        }
+
+        auto& entry = *it;
+        if (gid.empty()) {
+            LogLine() << "[foo_downloader] Failed to start yt-dlp for: " << job.item.url.c_str();
+            HandleFailure(entry, FailureKind::Permanent, "Failed to start yt-dlp", false);
+            SaveHistory();
+            continue;
+        }
+
+        entry.gid = gid;
+        entry.times.submitted = TickMs();
+        UpdateField(entry, &DownloadEntry::status, std::string("active"), FieldStatus);
+        LogLine() << "[foo_downloader] yt-dlp started: " << entry.title.c_str();
+    }
+}
+
+void DownloadManager::StartYtDlpStages() {
+    // NOTE: called by the poll thread without m_mutex held, as for
+    // PromoteYtDlpJobs(). PollYtDlpDownload() queues the stage that follows
+    // a lookup or a transfer; the process is taken out of m_ytdlpProcs while
+    // it starts, and is put back only if its entry is still active.
+    std::vector<std::pair<std::string, YtDlpStage>> starts;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        starts.swap(m_ytdlpNextStages);
+    }
+
+    for (const auto& [gid, stage] : starts) {
+        YtDlpProcess proc;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_ytdlpProcs.find(gid);
+            if (it == m_ytdlpProcs.end()) continue;
+            proc = std::move(it->second);
+            m_ytdlpProcs.erase(it);
+        }
+
+        bool started = StartYtDlpRun(proc, stage);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = std::find_if(m_downloads.begin(), m_downloads.end(),
+            [&gid](const DownloadEntry& e) { return e.gid == gid && e.leaderId == 0; });
+        m_ytdlpProcs[gid] = std::move(proc);
+        if (it == m_downloads.end() || it->status != "active") {
+            // Removed or cancelled while the process was starting
+            CleanupYtDlpProcess(gid);
+            continue;
+        }
+        if (!started) {
+            HandleFailure(*it, FailureKind::Permanent, "Failed to start yt-dlp", false);
+            SaveHistory();
+            CleanupYtDlpProcess(gid);
+        }
+    }
+}
+
+void DownloadManager::PollYtDlpRuns() {
+    // NOTE: poll thread, without m_mutex held, when woken between ticks.
+    // Finishes the yt-dlp runs that have ended and gives their slots to
+    // the next jobs; everything else waits for the tick.
+    FlushJournal();   // Newly queued jobs start once journaled
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& entry : m_downloads) {
+            if (entry.engine != "ytdlp" || entry.status != "active" || entry.leaderId != 0) continue;
+            auto proc = m_ytdlpProcs.find(entry.gid);
+            if (proc == m_ytdlpProcs.end() || proc->second.stage == YtDlpStage::Transfer) continue;
+            int exitCode = 0;
+            if (proc->second.process.HasExited(exitCode)) PollYtDlpDownload(entry);
+        }
+        SyncFollowers();
+        PublishUpdates();
+    }
+    PromoteYtDlpJobs();
+    StartYtDlpStages();
+}
+
+void DownloadManager::WakePollThread() {
+    // NOTE: any thread, with or without m_mutex held
+    std::lock_guard<std::mutex> lock(m_wakeMutex);
+    m_wakePending = true;
+    m_pollWake.notify_one();
+}
+
 void DownloadManager::CleanupYtDlpProcess(const std::string& gid) {
     auto it = m_ytdlpProcs.find(gid);
     if (it != m_ytdlpProcs.end()) {
-        TerminateProcess(it->second.hProcess, 1);
-        CloseHandle(it->second.hStdoutRead);
-        CloseHandle(it->second.hProcess);
+        it->second.process.Terminate();
+        if (!it->second.aria2Gid.empty()) Aria2RpcClient::instance().Remove(it->second.aria2Gid);
         m_ytdlpProcs.erase(it);
     }
 }
@@ -676,102 +1624,374 @@ void DownloadManager::CleanupYtDlpProcess(const std::string& gid) {
 // Standard operations
 // ============================================================================
 
-std::vector<DownloadEntry> DownloadManager::GetDownloads() const {
+std::vector<DownloadEntry> DownloadManager::GetDownloads(uint64_t* version) const {
     std::lock_guard<std::mutex> lock(m_mutex);
+    if (version) *version = m_changeVersion;
     return m_downloads;
 }
 
 void DownloadManager::ClearCompleted() {
     std::lock_guard<std::mutex> lock(m_mutex);
+    auto finished = [](const DownloadEntry& e) {
+        return e.status == "complete" || e.status == "error";
+    };
+    for (const auto& e : m_downloads) {
+        if (finished(e)) RecordChange(DownloadChangeKind::Removed, e);
+    }
     m_downloads.erase(
-        std::remove_if(m_downloads.begin(), m_downloads.end(),
-            [](const DownloadEntry& e) {
-                return e.status == "complete" || e.status == "error";
-            }),
+        std::remove_if(m_downloads.begin(), m_downloads.end(), finished),
         m_downloads.end());
-    SaveHistory();
+    m_listVersion++;
+
+    // Clears the paged-out history as well, not just the in-memory window.
+    // Their URLs stay in downloaded_urls, so they still count as downloaded.
+    if (!m_db) OpenDb();
+    if (m_db) {
+        sqlite3_exec(m_db, "DELETE FROM downloads WHERE status IN ('complete', 'error');", nullptr, nullptr, nullptr);
+    }
 }
 
-void DownloadManager::RemoveByIndex(int idx) {
+void DownloadManager::RemoveById(uint64_t id) {
     std::lock_guard<std::mutex> lock(m_mutex);
-    if (idx >= 0 && idx < (int)m_downloads.size()) {
-        auto& entry = m_downloads[idx];
-        if (entry.status == "queued" || entry.status == "active" || entry.status == "paused") {
-            if (entry.engine == "ytdlp") {
-                CleanupYtDlpProcess(entry.gid);
-            } else {
-                Aria2RpcClient::instance().Remove(entry.gid);
-            }
+    if (m_resolving.count(id)) {
+        CancelResolve(id);
+        return;
+    }
+    auto it = std::find_if(m_downloads.begin(), m_downloads.end(),
+        [id](const DownloadEntry& e) { return e.id == id; });
+    if (it == m_downloads.end()) return;
+
+    auto& entry = *it;
+    bool ownsJob = entry.leaderId == 0;
+    if (ownsJob && (entry.status == "queued" || entry.status == "active" || entry.status == "paused")) {
+        if (entry.engine == "ytdlp") {
+            CleanupYtDlpProcess(entry.gid);
+        } else {
+            Aria2RpcClient::instance().Remove(entry.gid);
         }
-        m_downloads.erase(m_downloads.begin() + idx);
-        SaveHistory();
     }
+    m_jobs.erase(entry.id);
+    if (entry.jobRowId != 0) {
+        JournalOp op;
+        op.kind = JournalOp::Delete;
+        op.rowId = entry.jobRowId;
+        m_journalOps.push_back(std::move(op));
+    }
+    DeleteHistoryRow(entry.historyId);
+    RecordChange(DownloadChangeKind::Removed, entry);
+    m_downloads.erase(it);
+    m_listVersion++;
 }
 
-void DownloadManager::PauseByIndex(int idx) {
+void DownloadManager::PauseById(uint64_t id) {
     std::lock_guard<std::mutex> lock(m_mutex);
-    if (idx >= 0 && idx < (int)m_downloads.size()) {
-        auto& entry = m_downloads[idx];
-        if (entry.engine == "aria2" && (entry.status == "active" || entry.status == "queued")) {
-            if (Aria2RpcClient::instance().Pause(entry.gid)) {
-                entry.status = "paused";
-                entry.speed = 0;
+    for (auto& entry : m_downloads) {
+        if (entry.id != id) continue;
+        std::string gid = entry.gid;
+        if (entry.engine == "ytdlp") {
+            // yt-dlp itself can't pause; a stream being fetched by aria2 can
+            auto proc = m_ytdlpProcs.find(entry.gid);
+            if (proc == m_ytdlpProcs.end() || proc->second.stage != YtDlpStage::Transfer) break;
+            gid = proc->second.aria2Gid;
+        }
+        if (entry.status == "active" || entry.status == "queued") {
+            if (Aria2RpcClient::instance().Pause(gid)) {
+                UpdateField(entry, &DownloadEntry::status, std::string("paused"), FieldStatus);
+                UpdateField(entry, &DownloadEntry::speed, (uint64_t)0, FieldSpeed);
+                RecordChange(DownloadChangeKind::Updated, entry);
+                m_listVersion++;
             }
         }
-        // yt-dlp doesn't support pause - would need to kill and restart
+        break;
     }
 }
 
-void DownloadManager::ResumeByIndex(int idx) {
+void DownloadManager::ResumeById(uint64_t id) {
     std::lock_guard<std::mutex> lock(m_mutex);
-    if (idx >= 0 && idx < (int)m_downloads.size()) {
-        auto& entry = m_downloads[idx];
-        if (entry.engine == "aria2" && entry.status == "paused") {
-            if (Aria2RpcClient::instance().Unpause(entry.gid)) {
-                entry.status = "active";
+    for (auto& entry : m_downloads) {
+        if (entry.id != id) continue;
+        std::string gid = entry.gid;
+        if (entry.engine == "ytdlp") {
+            auto proc = m_ytdlpProcs.find(entry.gid);
+            if (proc == m_ytdlpProcs.end() || proc->second.stage != YtDlpStage::Transfer) break;
+            gid = proc->second.aria2Gid;
+        }
+        if (entry.status == "paused") {
+            if (Aria2RpcClient::instance().Unpause(gid)) {
+                UpdateField(entry, &DownloadEntry::status, std::string("active"), FieldStatus);
+                RecordChange(DownloadChangeKind::Updated, entry);
+                m_listVersion++;
             }
         }
+        break;
     }
 }
 
-void DownloadManager::CancelByIndex(int idx) {
+void DownloadManager::CancelById(uint64_t id) {
     std::lock_guard<std::mutex> lock(m_mutex);
-    if (idx >= 0 && idx < (int)m_downloads.size()) {
-        auto& entry = m_downloads[idx];
+    if (m_resolving.count(id)) {
+        CancelResolve(id);
+        return;
+    }
+    for (auto& entry : m_downloads) {
+        if (entry.id != id) continue;
         if (entry.status == "queued" || entry.status == "active" || entry.status == "paused") {
-            if (entry.engine == "ytdlp") {
+            // A follower just detaches; cancelling the leader cancels the
+            // transfer for every follower too
+            m_jobs.erase(entry.id);
+            if (entry.leaderId != 0) {
+                entry.leaderId = 0;
+            } else if (entry.engine == "ytdlp") {
                 CleanupYtDlpProcess(entry.gid);
             } else {
                 Aria2RpcClient::instance().Remove(entry.gid);
             }
-            entry.status = "error";
-            entry.errorMessage = "Cancelled";
-            entry.speed = 0;
+            UpdateField(entry, &DownloadEntry::status, std::string("error"), FieldStatus);
+            UpdateField(entry, &DownloadEntry::errorMessage, std::string("Cancelled"), FieldErrorMessage);
+            UpdateField(entry, &DownloadEntry::speed, (uint64_t)0, FieldSpeed);
             SaveHistory();
+            RecordChange(DownloadChangeKind::Updated, entry);
+            m_listVersion++;
+        }
+        break;
+    }
+}
+
+// ============================================================================
+// Update delivery
+// ============================================================================
+
+void DownloadManager::SyncFollowers() {
+    // NOTE: caller must hold m_mutex; poll thread only.
+    // Followers copy their leader's state each tick, so completion (one
+    // transfer, one post-process) and failure fan out to every requester.
+    bool finished = false;
+    for (auto& f : m_downloads) {
+        if (f.leaderId == 0 || f.status == "complete" || f.status == "error") continue;
+
+        uint64_t leaderId = f.leaderId;
+        auto leader = std::find_if(m_downloads.begin(), m_downloads.end(),
+            [leaderId](const DownloadEntry& e) { return e.id == leaderId; });
+        if (leader == m_downloads.end()) {
+            // Leader removed from the queue before finishing
+            UpdateField(f, &DownloadEntry::status, std::string("error"), FieldStatus);
+            UpdateField(f, &DownloadEntry::errorMessage, std::string("Cancelled"), FieldErrorMessage);
+            UpdateField(f, &DownloadEntry::speed, (uint64_t)0, FieldSpeed);
+            finished = true;
+            continue;
+        }
+
+        UpdateField(f, &DownloadEntry::status, leader->status, FieldStatus);
+        UpdateField(f, &DownloadEntry::progress, leader->progress, FieldProgress);
+        UpdateField(f, &DownloadEntry::speed, leader->speed, FieldSpeed);
+        UpdateField(f, &DownloadEntry::totalSize, leader->totalSize, FieldTotalSize);
+        UpdateField(f, &DownloadEntry::outputPath, leader->outputPath, FieldOutputPath);
+        UpdateField(f, &DownloadEntry::errorMessage, leader->errorMessage, FieldErrorMessage);
+        if (f.status == "complete" || f.status == "error") finished = true;
+    }
+
+    // A finished transfer no longer absorbs new requests
+    for (auto it = m_inFlightKeys.begin(); it != m_inFlightKeys.end();) {
+        uint64_t leaderId = it->second;
+        auto leader = std::find_if(m_downloads.begin(), m_downloads.end(),
+            [leaderId](const DownloadEntry& e) { return e.id == leaderId; });
+        if (leader == m_downloads.end() || leader->status == "complete" || leader->status == "error") {
+            it = m_inFlightKeys.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (finished) SaveHistory();
+}
+
+void DownloadManager::PublishUpdates() {
+    // NOTE: caller must hold m_mutex; only the poll thread publishes.
+    // Entries that did not change this tick contribute nothing. If the UI has
+    // not drained the ring, keep folding into m_pendingDelta so that at most
+    // one update per entry is held back, however long the UI stalls.
+    // Progress alone stays out of the change log: with a hundred transfers
+    // running it would wrap the log within seconds.
+    bool logged = false;
+    for (auto& e : m_downloads) {
+        if (e.dirtyFields == 0) continue;
+        if ((e.dirtyFields & FieldStatus) && e.jobRowId != 0) JournalUpdate(e);
+        if (e.dirtyFields & ~PROGRESS_FIELDS) {
+            RecordChange(DownloadChangeKind::Updated, e);
+            logged = true;
+        }
+        if (m_pendingDelta.updates.empty()) {
+            m_pendingDelta.updates.push_back(MakeDownloadUpdate(e));
+        } else {
+            MergeDownloadUpdate(m_pendingDelta.updates, MakeDownloadUpdate(e));
+        }
+        e.dirtyFields = 0;
+    }
+    if (logged) m_listVersion++;
+
+    if (m_pendingDelta.updates.empty()) return;
+    if (m_updateRing.TryPush(std::move(m_pendingDelta))) {
+        m_pendingDelta = DownloadDelta();
+        UpdateBacklogGauge().Add(1);
+    }
+}
+
+int DownloadManager::AddUpdateListener(DownloadUpdateCallback cb) {
+    int token = ++m_nextListenerToken;
+    m_listeners[token] = std::move(cb);
+    return token;
+}
+
+void DownloadManager::RemoveUpdateListener(int token) {
+    m_listeners.erase(token);
+}
+
+void DownloadManager::DispatchUpdates() {
+    // Drain everything published since the last call into a single batch, so
+    // a UI that polls once per frame sees at most one batch per frame no
+    // matter how many ticks went by.
+    TRACE_SCOPE("DispatchUpdates");
+    std::vector<DownloadUpdate> merged;
+    DownloadDelta delta;
+    while (m_updateRing.TryPop(delta)) {
+        UpdateBacklogGauge().Add(-1);
+        for (auto& u : delta.updates) {
+            MergeDownloadUpdate(merged, std::move(u));
         }
     }
+    if (merged.empty()) return;
+
+    // Copy the listener map: a listener may unregister itself while handling
+    auto listeners = m_listeners;
+    for (const auto& [token, cb] : listeners) {
+        if (cb) cb(merged);
+    }
+}
+
+uint64_t DownloadManager::GetListVersion() const {
+    return m_listVersion.load();
+}
+
+// ============================================================================
+// Change log
+// ============================================================================
+
+void DownloadManager::RecordChange(DownloadChangeKind kind, const DownloadEntry& entry) {
+    // NOTE: caller must hold m_mutex
+    DownloadChange change;
+    change.version = ++m_changeVersion;
+    change.kind = kind;
+    if (kind == DownloadChangeKind::Inserted) {
+        change.update.id = entry.id;
+        change.update.fields = ~0u;
+        change.update.entry = entry;
+        change.update.entry.dirtyFields = 0;
+    } else if (kind == DownloadChangeKind::Updated) {
+        change.update = MakeDownloadUpdate(entry);
+    } else {
+        change.update.id = entry.id;
+    }
+    m_changeLog.push_back(std::move(change));
+
+    while (m_changeLog.size() > CHANGE_LOG_CAPACITY) {
+        m_changeLogFloor = m_changeLog.front().version;
+        m_changeLog.pop_front();
+    }
 }
 
-void DownloadManager::SetUpdateCallback(DownloadUpdateCallback cb) {
+DownloadChanges DownloadManager::GetChangesSince(uint64_t version) const {
     std::lock_guard<std::mutex> lock(m_mutex);
-    m_callback = std::move(cb);
+    DownloadChanges changes;
+    changes.version = m_changeVersion;
+    if (version >= m_changeVersion) return changes;
+    if (version < m_changeLogFloor) {
+        changes.resync = true;
+        return changes;
+    }
+
+    auto findInserted = [&changes](uint64_t id) {
+        return std::find_if(changes.inserted.begin(), changes.inserted.end(),
+            [id](const DownloadEntry& e) { return e.id == id; });
+    };
+
+    auto it = std::upper_bound(m_changeLog.begin(), m_changeLog.end(), version,
+        [](uint64_t v, const DownloadChange& c) { return v < c.version; });
+    for (; it != m_changeLog.end(); ++it) {
+        const auto& u = it->update;
+        switch (it->kind) {
+        case DownloadChangeKind::Inserted:
+            changes.inserted.push_back(u.entry);
+            break;
+        case DownloadChangeKind::Updated: {
+            // Updates to an entry the consumer has not seen yet fold into the insert
+            auto ins = findInserted(u.id);
+            if (ins != changes.inserted.end()) {
+                ApplyDownloadUpdate(*ins, u);
+            } else {
+                MergeDownloadUpdate(changes.updated, DownloadUpdate(u));
+            }
+            break;
+        }
+        case DownloadChangeKind::Removed: {
+            auto ins = findInserted(u.id);
+            if (ins != changes.inserted.end()) {
+                changes.inserted.erase(ins);
+                break;
+            }
+            changes.updated.erase(
+                std::remove_if(changes.updated.begin(), changes.updated.end(),
+                    [&u](const DownloadUpdate& x) { return x.id == u.id; }),
+                changes.updated.end());
+            changes.removed.push_back(u.id);
+            break;
+        }
+        }
+    }
+    return changes;
 }
 
 void DownloadManager::Shutdown() {
-    m_shutdown = true;
+    // Once only: the destructor runs during static destruction, after the
+    // metrics registry may already be gone
+    if (m_shutdown.exchange(true)) return;
+    WakePollThread();
     if (m_pollThread.joinable()) {
         m_pollThread.join();
     }
 
+    // Cancelled resolves give up on their child process or pending dialog;
+    // the pool then joins without waiting on the main thread
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto& [id, cancel] : m_resolving) {
+            cancel->cancelled = true;
+        }
+        if (m_prefetch) m_prefetch->cancel.cancelled = true;
+    }
+    m_resolvePool.Shutdown();
+    m_bulkPool.Shutdown();
+
+    // Last journal writes; unfinished jobs stay in it and resume next start
+    FlushJournal();
+    if (m_journalDb) {
+        sqlite3_close(m_journalDb);
+        m_journalDb = nullptr;
+    }
+
     std::lock_guard<std::mutex> lock(m_mutex);
 
     // Kill any active yt-dlp processes
     for (auto& [gid, proc] : m_ytdlpProcs) {
-        TerminateProcess(proc.hProcess, 1);
-        CloseHandle(proc.hStdoutRead);
-        CloseHandle(proc.hProcess);
+        proc.process.Terminate();
+        if (!proc.aria2Gid.empty()) Aria2RpcClient::instance().Remove(proc.aria2Gid);
     }
     m_ytdlpProcs.clear();
+    ShutdownYtDlpWorkers();
+    m_ytdlpQueue.clear();
+    m_aria2Queue.clear();
+    m_inFlightKeys.clear();
+    m_jobs.clear();
+    m_retryTimers.clear();
 
     // Remove active aria2 downloads
     auto& aria2 = Aria2RpcClient::instance();
@@ -781,94 +2001,232 @@ void DownloadManager::Shutdown() {
         }
     }
 
-    // Mark any active downloads as cancelled before saving
-    for (auto& entry : m_downloads) {
-        if (entry.status == "queued" || entry.status == "active" || entry.status == "paused") {
-            entry.status = "error";
-            entry.errorMessage = "Interrupted (foobar2000 closed)";
-        }
-    }
-
+    // Unfinished entries are left as they are: every one queued through
+    // AddJob() has a journal row, and ResumeJobs() picks them up again
     SaveHistory();
     CloseDb();
 }
 
 void DownloadManager::PollThread() {
-    FB2K_console_formatter() << "[foo_downloader] Poll thread started.";
+    LogLine() << "[foo_downloader] Poll thread started.";
+    TraceSetThreadName("poll");
 
+    uint64_t nextTick = TickMs() + POLL_INTERVAL_MS;
     while (!m_shutdown) {
-        for (int i = 0; i < 50 && !m_shutdown; i++) {
-            Sleep(10);
+        {
+            std::unique_lock<std::mutex> wake(m_wakeMutex);
+            uint64_t now = TickMs();
+            if (now < nextTick) {
+                m_pollWake.wait_for(wake, std::chrono::milliseconds(nextTick - now),
+                    [this] { return m_wakePending || m_shutdown; });
+            }
+            m_wakePending = false;
         }
         if (m_shutdown) break;
+        if (TickMs() < nextTick) {
+            // A yt-dlp run ended or a job was queued
+            PollYtDlpRuns();
+            continue;
+        }
+        nextTick = TickMs() + POLL_INTERVAL_MS;
 
-        std::lock_guard<std::mutex> lock(m_mutex);
+        static MetricHistogram& tickHistogram = Metrics().Histogram("foo_downloader_poll_tick_seconds",
+            "Duration of one poll thread tick, sleep excluded");
+        MetricTimer tickTimer(tickHistogram);
+        TRACE_SCOPE("PollTick");
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            FireRetryTimers();
+        }
+        FlushJournal();
+        PromoteYtDlpJobs();
+        AdmitAria2Jobs();
+        ReapIdleYtDlpWorkers(TickMs());
+
+        std::unique_lock<std::mutex> lock(m_mutex);
 
         for (auto& entry : m_downloads) {
             if (entry.status == "complete" || entry.status == "error") continue;
-            if (entry.status == "paused") continue;
+            if (entry.status == "paused" || entry.status == "resolving") continue;
+            if (entry.leaderId != 0) continue;   // Mirrors its leader, see SyncFollowers
 
             if (entry.engine == "ytdlp") {
+                if (entry.status == "queued") continue;   // Waiting for a job slot
                 PollYtDlpDownload(entry);
             } else {
+                if (entry.gid.empty()) continue;   // Waiting for host admission
                 auto& aria2 = Aria2RpcClient::instance();
                 if (!aria2.IsRunning()) continue;
 
                 Aria2Status status = aria2.GetStatus(entry.gid);
+                Aria2Transition transition = ApplyAria2Status(entry, status, TickMs());
 
-                entry.progress = status.GetProgress();
-                entry.speed = status.downloadSpeed;
-                entry.totalSize = status.totalLength;
-
-                if (!status.files.empty() && !status.files[0].empty()) {
-                    entry.outputPath = status.files[0];
-                    for (char& c : entry.outputPath) {
-                        if (c == '/') c = '\\';
-                    }
-                    std::string filePath = status.files[0];
-                    auto lastSlash = filePath.find_last_of("\\/");
-                    if (lastSlash != std::string::npos && lastSlash + 1 < filePath.size()) {
-                        entry.title = filePath.substr(lastSlash + 1);
-                    }
+                auto job = m_jobs.find(entry.id);
+                if (job != m_jobs.end() && status.completedLength > job->second.bytesReported) {
+                    EngineMetricsFor("aria2").bytes.Add(status.completedLength - job->second.bytesReported);
+                    job->second.bytesReported = status.completedLength;
                 }
 
-                if (status.IsComplete()) {
-                    entry.status = "complete";
+                if (transition == Aria2Transition::Completed) {
+                    m_breaker.RecordSuccess(HostOf(entry.url));
+                    m_jobs.erase(entry.id);
+                    EngineMetricsFor("aria2").completed.Add();
                     OnDownloadComplete(entry);
                     SaveHistory();
-                } else if (status.IsError()) {
-                    entry.status = "error";
-                    entry.errorMessage = status.errorMessage;
-                    FB2K_console_formatter() << "[foo_downloader] Error: " << entry.title.c_str() << " - " << entry.errorMessage.c_str();
+                } else if (transition == Aria2Transition::Failed) {
+                    // Drop aria2's record of the failed attempt; a retry gets a new gid
+                    aria2.Remove(entry.gid);
+                    HandleFailure(entry, ClassifyAria2Error(status.errorCode, status.errorMessage),
+                                  status.errorMessage, true);
                     SaveHistory();
-                } else if (status.status == "paused") {
-                    entry.status = "paused";
-                    entry.speed = 0;
-                } else if (status.IsActive()) {
-                    entry.status = "active";
                 }
             }
 
-            if (m_callback) {
-                DownloadEntry snapshot = entry;
-                fb2k::inMainThread([this, snapshot]() {
-                    if (m_callback) {
-                        m_callback(snapshot);
-                    }
-                });
+        }
+
+        SyncFollowers();
+        PublishUpdates();
+
+        int active[2] = {}, queued[2] = {};   // aria2, ytdlp
+        for (const auto& e : m_downloads) {
+            if (e.leaderId != 0) continue;
+            int engine = e.engine == "ytdlp" ? 1 : 0;
+            if (e.status == "active") active[engine]++;
+            else if (e.status == "queued") queued[engine]++;
+        }
+        EngineMetricsFor("aria2").active.Set(active[0]);
+        EngineMetricsFor("aria2").queued.Set(queued[0]);
+        EngineMetricsFor("ytdlp").active.Set(active[1]);
+        EngineMetricsFor("ytdlp").queued.Set(queued[1]);
+
+        lock.unlock();
+        StartYtDlpStages();
+    }
+}
+
+void DownloadManager::AdmitAria2Jobs() {
+    // NOTE: called by the poll thread without m_mutex held; AddUri is an
+    // RPC round trip and must not stall the UI waiting on the lock.
+    auto& aria2 = Aria2RpcClient::instance();
+    if (!aria2.IsRunning()) return;
+
+    const int maxPerHost = GetConfigAria2MaxPerHost();
+    const uint64_t gapMs = (uint64_t)GetConfigAria2HostGapMs();
+
+    std::vector<Aria2Job> batch;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_aria2Queue.empty()) return;
+
+        std::map<std::string, int> inFlight;
+        std::set<uint64_t> waiting;
+        for (const auto& e : m_downloads) {
+            if (e.engine != "aria2") continue;
+            if (e.gid.empty()) {
+                if (e.status == "queued") waiting.insert(e.id);
+            } else if (e.status == "queued" || e.status == "active") {
+                inFlight[HostOf(e.url)]++;
             }
         }
+
+        // Every job, in FIFO order, whose host has room and isn't tripped.
+        // A busy or failing host only holds back its own jobs. Admitted jobs go to aria2 in one round trip.
+        uint64_t now = TickMs();
+        auto it = m_aria2Queue.begin();
+        while (it != m_aria2Queue.end() && batch.size() < ARIA2_ADD_BATCH) {
+            if (!waiting.count(it->id)) {
+                it = m_aria2Queue.erase(it);    // Removed or cancelled while waiting
+                continue;
+            }
+            if (it->jobRowId > m_journalDurableRow) {
+                ++it;                           // Not journaled yet
+                continue;
+            }
+            auto last = m_hostLastRequest.find(it->host);
+            bool tooSoon = last != m_hostLastRequest.end() && now - last->second < gapMs;
+            bool circuitOpen = !m_breaker.AllowRequest(it->host, now, inFlight[it->host]);
+            if (tooSoon || circuitOpen || inFlight[it->host] >= maxPerHost) {
+                ++it;
+                continue;
+            }
+            inFlight[it->host]++;
+            m_hostLastRequest[it->host] = now;
+            batch.push_back(std::move(*it));
+            it = m_aria2Queue.erase(it);
+        }
     }
+    if (batch.empty()) return;
+
+    std::vector<std::string> gids;
+    if (batch.size() == 1) {
+        gids.push_back(aria2.AddUri(batch[0].url, batch[0].options, batch[0].headers));
+    } else {
+        std::vector<Aria2AddRequest> requests;
+        requests.reserve(batch.size());
+        for (const auto& job : batch) {
+            requests.push_back({ job.url, job.options, job.headers });
+        }
+        gids = aria2.AddUris(requests);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    bool failed = false;
+    for (size_t i = 0; i < batch.size(); i++) {
+        auto& job = batch[i];
+        const std::string& gid = gids[i];
+
+        auto it = std::find_if(m_downloads.begin(), m_downloads.end(),
+            [&job](const DownloadEntry& e) { return e.id == job.id; });
+        if (it == m_downloads.end() || it->status != "queued") {
+            if (!gid.empty()) aria2.Remove(gid);
+            continue;
+        }
+
+        auto& entry = *it;
+        if (gid.empty()) {
+            // The daemon refused or didn't answer; not the host's fault
+            HandleFailure(entry, FailureKind::Transient, "aria2 rejected the download", false);
+            failed = true;
+            continue;
+        }
+
+        entry.gid = gid;
+        entry.times.submitted = TickMs();
+        LogLine() << "[foo_downloader] Admitted: " << entry.title.c_str() << " (GID: " << gid.c_str() << ")";
+    }
+    if (failed) SaveHistory();
 }
 
 void DownloadManager::OnDownloadComplete(DownloadEntry& entry) {
-    FB2K_console_formatter() << "[foo_downloader] Complete: " << entry.title.c_str() << " -> " << entry.outputPath.c_str();
+    LogLine() << "[foo_downloader] Complete: " << entry.title.c_str() << " -> " << entry.outputPath.c_str();
 
     if (!entry.outputPath.empty()) {
         std::string path = entry.outputPath;
+        uint64_t id = entry.id;
+
+        HostDownloadComplete(path, [this, id]() { RecordPlaylistInsert(id); });
+    }
+}
 
-        fb2k::inMainThread([path]() {
-            PlaylistUtils::AddToDownloadedPlaylist(path);
-        });
+void DownloadManager::RecordPlaylistInsert(uint64_t id) {
+    // NOTE: called by the host once the file is in a playlist (the main
+    // thread in foobar2000). The history row was written by the poll thread
+    // when the download completed, before this ran.
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = std::find_if(m_downloads.begin(), m_downloads.end(),
+        [id](const DownloadEntry& e) { return e.id == id; });
+    if (it == m_downloads.end()) return;
+
+    it->times.playlistInsert = TickMs();
+    int64_t offset = it->times.Offset(it->times.playlistInsert);
+    if (it->historyId == 0 || offset < 0 || !m_db) return;
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(m_db, "UPDATE downloads SET t_playlist_ms = ? WHERE id = ?;", -1, &stmt, nullptr) == SQLITE_OK) {
+        sqlite3_bind_int64(stmt, 1, offset);
+        sqlite3_bind_int64(stmt, 2, it->historyId);
+        sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
     }
 }
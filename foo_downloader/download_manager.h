@@ -1,56 +1,197 @@
 #pragma once
 
 #include "aria2_rpc.h"
+#include "download_entry.h"
+#include "latency_stats.h"
+#include "platform.h"
 #include "source_provider.h"
-#include "../vendor/sqlite3.h"
+#include "spsc_ring.h"
+#include "retry_policy.h"
+#include "url_index.h"
+#include "worker_pool.h"
+#include "ytdlp_output.h"
+#include "ytdlp_worker.h"
+#include <sqlite3.h>
 #include <string>
 #include <vector>
 #include <map>
+#include <deque>
 #include <mutex>
+#include <condition_variable>
 #include <atomic>
 #include <thread>
 #include <functional>
-#include <windows.h>
+#include <memory>
 
-struct DownloadEntry {
-    std::string gid;
-    std::string sourceId;
+enum class DownloadChangeKind { Inserted, Updated, Removed };
+
+// One record in the manager's change log
+struct DownloadChange {
+    uint64_t version = 0;
+    DownloadChangeKind kind = DownloadChangeKind::Updated;
+    DownloadUpdate update;    // Inserted carries every field; Removed only the id
+};
+
+// Net effect of all changes after some version, merged per entry. An entry
+// inserted and removed within the range appears in neither list.
+struct DownloadChanges {
+    uint64_t version = 0;     // Pass to the next GetChangesSince() call
+    bool resync = false;      // The log no longer reaches back that far; re-read GetDownloads()
+    std::vector<DownloadEntry> inserted;
+    std::vector<DownloadUpdate> updated;
+    std::vector<uint64_t> removed;
+};
+
+// An aria2 download held back until its host admits another transfer
+struct Aria2Job {
+    uint64_t id = 0;          // DownloadEntry::id
+    int64_t jobRowId = 0;     // Not submitted until this journal row is committed
+    std::string host;
     std::string url;
-    std::string title;
-    std::string outputPath;
-    std::string status;       // "queued", "active", "paused", "complete", "error"
-    std::string errorMessage;
-    std::string engine;       // "aria2" or "ytdlp"
-    double progress = 0.0;
-    uint64_t speed = 0;
-    uint64_t totalSize = 0;
+    std::map<std::string, std::string> options;
+    std::vector<std::string> headers;
+};
+
+// What an entry that owns a transfer needs to run it again: the resolved
+// item and how many retries it has used
+struct JobRecord {
+    DownloadItem item;
+    std::string host;
+    int attempts = 0;
+    int64_t jobRowId = 0;
+    uint64_t bytesReported = 0;   // aria2 completedLength already counted in the metrics
+};
+
+// One pending write to the jobs journal. Writes are queued under the
+// manager's lock and committed together by FlushJournal() (group commit).
+struct JournalOp {
+    enum Kind { Insert, Update, Delete };
+    Kind kind = Update;
+    int64_t rowId = 0;
+    std::string status;
+    int attempts = 0;
+    std::string sourceId;     // Insert only
+    DownloadItem item;        // Insert only
+};
+
+// A yt-dlp download waiting for a free job slot
+struct YtDlpJob {
+    uint64_t id = 0;          // DownloadEntry::id
+    int64_t jobRowId = 0;     // Not started until this journal row is committed
+    DownloadItem item;
+};
+
+// Shared state of one StartBulkDownload() run; each bulk worker claims
+// the next input until all are taken
+struct BulkImport {
+    ISourceProvider* source = nullptr;
+    std::string sourceId;
+    std::vector<std::string> inputs;
+    uint64_t placeholderId = 0;
+    std::shared_ptr<ResolveCancel> cancel;
+    uint64_t startTick = 0;
+    std::atomic<size_t> nextInput{ 0 };
+    std::atomic<size_t> resolved{ 0 };
+    std::atomic<size_t> failed{ 0 };
+    std::atomic<size_t> queuedItems{ 0 };
+    std::atomic<int> workersLeft{ 0 };
+};
+
+// One Prefetch() run; `started` and `done` are guarded by m_mutex
+struct PrefetchRun {
+    std::string key;            // Source id + "\n" + input
+    ResolveCancel cancel;
+    bool started = false;       // Still queued in m_resolvePool until then
+    bool done = false;
+};
+
+// A yt-dlp download runs in one go, or, with GetConfigYtDlpViaAria2(), as
+// a lookup whose stream aria2 fetches, followed by the conversion
+enum class YtDlpStage {
+    Download,       // yt-dlp fetches and converts
+    LookUp,         // yt-dlp picks the format and prints its URL
+    Transfer,       // aria2 fetches the stream to where yt-dlp would have saved it
+    Convert,        // yt-dlp finds the file in place and only post-processes it
 };
 
 struct YtDlpProcess {
-    HANDLE hProcess = NULL;
-    HANDLE hStdoutRead = NULL;
-    std::string capturedOutput;
+    YtDlpStage stage = YtDlpStage::Download;
+    YtDlpRun process;
+    DownloadItem item;
+    std::string infoJsonPath;   // Started from the resolve step's lookup; "" = from the URL
+    std::string lookupInfoPath; // LookUp: where yt-dlp saves the info JSON for the later stages
+    YtDlpOutputParser output;
+    std::string readBuffer;     // This tick's new bytes; reused to avoid allocations
+    std::string aria2Gid;       // Transfer stage
+    YtDlpStream stream;         // LookUp result
 };
 
-using DownloadUpdateCallback = std::function<void(const DownloadEntry& entry)>;
+using DownloadUpdateCallback = std::function<void(const std::vector<DownloadUpdate>& updates)>;
 
 class DownloadManager {
 public:
     static DownloadManager& instance();
 
+    // Asynchronous: adds a "resolving" placeholder and resolves `input` on a
+    // worker thread; the resulting items replace the placeholder when ready.
+    // Returns false only if the request could not be accepted at all.
     bool StartDownload(const std::string& sourceId, const std::string& input);
-    std::vector<DownloadEntry> GetDownloads() const;
+    // Bulk ingest of a URL list (one input per element). Blank lines, `#`
+    // comment lines (M3U) and repeats are dropped. Inputs are resolved
+    // unattended, up to the source's GetBulkParallelism() at a time, behind a
+    // single "resolving" row that tracks progress; items are queued in
+    // batches as they resolve. Returns the number of inputs accepted.
+    size_t StartBulkDownload(const std::string& sourceId, const std::vector<std::string>& inputs);
+    // Search-as-you-type: warm the source's search cache for `input` on a
+    // worker thread (ISourceProvider::Prefetch), so a StartDownload of the
+    // same input that follows opens its results at once; one pressed while
+    // the prefetch is still running waits for it rather than searching
+    // again. Cancels the previous prefetch unless it was for the same input;
+    // an empty `input` only cancels.
+    void Prefetch(const std::string& sourceId, const std::string& input);
+    // Full snapshot. `version`, if given, receives the change-log version the
+    // snapshot corresponds to, for use with GetChangesSince().
+    std::vector<DownloadEntry> GetDownloads(uint64_t* version = nullptr) const;
+    // Entries inserted, updated and removed since `version`. New entries are
+    // always appended, so applying `inserted` in order keeps the snapshot order.
+    DownloadChanges GetChangesSince(uint64_t version) const;
     void ClearCompleted();
-    void RemoveByIndex(int idx);
-    void PauseByIndex(int idx);
-    void ResumeByIndex(int idx);
-    void CancelByIndex(int idx);
-    void SetUpdateCallback(DownloadUpdateCallback cb);
+    void RemoveById(uint64_t id);
+    void PauseById(uint64_t id);
+    void ResumeById(uint64_t id);
+    void CancelById(uint64_t id);
     void Shutdown();
 
+    // Progress delivery (main thread only). The poll thread publishes one
+    // coalesced delta per tick into a lock-free ring; DispatchUpdates() drains
+    // it and hands the merged updates to every registered listener. Every
+    // change but progress (entries added or removed, status, user actions)
+    // also goes to the change log and bumps GetListVersion(); listeners then
+    // pull them with GetChangesSince(). Progress, speed and size are in the
+    // ring only.
+    int AddUpdateListener(DownloadUpdateCallback cb);
+    void RemoveUpdateListener(int token);
+    void DispatchUpdates();
+    uint64_t GetListVersion() const;
+
     // Persistence
     void SaveHistory();
     void LoadHistory();
+    // Re-queue jobs left unfinished by the previous session (crash or exit),
+    // from the journal, without resolving them again. Call once at startup.
+    void ResumeJobs();
+
+    // Paged history access. Only live jobs and the most recent history rows
+    // are kept in memory; anything older than GetHistoryWindowStart() is read
+    // from SQLite on demand. Returns up to `limit` rows with id < beforeId,
+    // newest first.
+    std::vector<DownloadEntry> QueryHistory(int64_t beforeId, int limit);
+    int64_t GetHistoryWindowStart() const;
+    void RemoveHistoryEntry(int64_t historyId);
+
+    // p50/p95/p99 time to first byte and time to playlist over recent
+    // completed downloads, one group per source and per engine
+    std::vector<LatencyGroup> GetLatencySummary();
 
 private:
     DownloadManager();
@@ -58,27 +199,110 @@ private:
     DownloadManager(const DownloadManager&) = delete;
     DownloadManager& operator=(const DownloadManager&) = delete;
 
+    void ResolveAndQueue(ISourceProvider* source, const std::string& sourceId,
+                         const std::string& input, uint64_t placeholderId, const ResolveCancel& cancel);
+    void WaitForPrefetch(const std::string& key, const ResolveCancel& cancel);
+    void RunBulkImport(std::shared_ptr<BulkImport> bulk);
+    // Returns false if nothing could be queued (aria2 not running). Items
+    // already in the history follow the duplicate policy; `interactive`
+    // allows the "ask" policy to prompt, otherwise they are skipped.
+    // `times` holds each item's resolve timestamps, parallel to `items`.
+    bool EnqueueItems(const std::string& sourceId, const std::vector<DownloadItem>& items,
+                      const std::vector<StageTimes>& times, bool interactive);
+    void CancelResolve(uint64_t id);
     void PollThread();
+    void AdmitAria2Jobs();
+    bool AddJob(DownloadEntry&& entry, const DownloadItem& item, int attempts);
+    void SubmitJob(uint64_t id, const JobRecord& job);
+    void HandleFailure(DownloadEntry& entry, FailureKind kind, const std::string& message, bool hostFault);
+    void FireRetryTimers();
+    void SyncFollowers();
+    void PublishUpdates();
+    void RecordChange(DownloadChangeKind kind, const DownloadEntry& entry);
     void OnDownloadComplete(DownloadEntry& entry);
+    void RecordPlaylistInsert(uint64_t id);
 
     // yt-dlp support
     std::string StartYtDlpDownload(const DownloadItem& item);
+    bool StartYtDlpRun(YtDlpProcess& proc, YtDlpStage stage);
+    bool StartYtDlpTransfer(YtDlpProcess& proc);
+    void PollYtDlpTransfer(DownloadEntry& entry, YtDlpProcess& proc);
+    void PromoteYtDlpJobs();
     void PollYtDlpDownload(DownloadEntry& entry);
+    void StartYtDlpStages();
+    void PollYtDlpRuns();
+    void WakePollThread();
     void CleanupYtDlpProcess(const std::string& gid);
 
-    static std::string GetDllDirectory();
     static std::string GetDatabasePath();
     void OpenDb();
     void CloseDb();
+    void DeleteHistoryRow(int64_t historyId);
+    void TrimHistoryWindow();
+    void JournalUpdate(DownloadEntry& entry);
+    void FlushJournal();
+    bool WasDownloaded(const std::string& urlKey);
 
     sqlite3* m_db = nullptr;
     std::vector<DownloadEntry> m_downloads;
+    int64_t m_historyWindowStart = 0;   // Rows below this id live only in SQLite
+    sqlite3* m_journalDb = nullptr;      // Second connection, poll thread only (FlushJournal)
+    std::vector<JournalOp> m_journalOps; // Not yet committed
+    int64_t m_nextJobRow = 0;
+    int64_t m_journalDurableRow = 0;     // Every jobs row up to this id is committed
+    BloomFilter m_urlFilter;             // url_key of every completed download, in front of the SQLite index
     mutable std::mutex m_mutex;
     std::atomic<bool> m_shutdown{ false };
     std::thread m_pollThread;
-    DownloadUpdateCallback m_callback;
+
+    // Wakes the poll thread between ticks (WakePollThread). A mutex of its
+    // own: yt-dlp reader threads signal it while m_mutex may be held by the
+    // thread stopping their run.
+    std::mutex m_wakeMutex;
+    std::condition_variable m_pollWake;
+    bool m_wakePending = false;
+    uint64_t m_nextId = 0;
+
+    // Poll thread -> main thread progress deltas
+    SpscRing<DownloadDelta, 64> m_updateRing;
+    DownloadDelta m_pendingDelta;        // Held back while the ring is full (poll thread only)
+    std::atomic<uint64_t> m_listVersion{ 0 };
+
+    // Versioned change log, bounded; consumers that fall further behind than
+    // the oldest record are told to resync
+    std::deque<DownloadChange> m_changeLog;
+    uint64_t m_changeVersion = 0;
+    uint64_t m_changeLogFloor = 0;       // Changes after this version are all in the log
+    std::map<int, DownloadUpdateCallback> m_listeners;  // Main thread only
+    int m_nextListenerToken = 0;
+
+    // Resolve stage: sources run on these workers, never on the UI thread
+    WorkerPool m_resolvePool;
+    std::map<uint64_t, std::shared_ptr<ResolveCancel>> m_resolving;   // Placeholder id -> cancel flag
+    std::shared_ptr<PrefetchRun> m_prefetch;   // Latest prefetch, if any
+    std::condition_variable m_prefetchDone;
+    WorkerPool m_bulkPool;                     // StartBulkDownload() resolves only
+
+    // In-flight transfers by url_key; a second request for the same key
+    // becomes a follower of the entry doing the transfer (see SyncFollowers)
+    std::map<std::string, uint64_t> m_inFlightKeys;
+
+    // Retry engine: job records of live transfers, retries due at a tick
+    // (fired by the poll thread, no thread sleeps on them), and a circuit
+    // breaker that stops submissions to a failing host
+    std::map<uint64_t, JobRecord> m_jobs;
+    std::multimap<uint64_t, uint64_t> m_retryTimers;
+    HostCircuitBreaker m_breaker;
+
+    // Per-host admission for aria2: jobs wait here, before AddUri, until
+    // their host is below the transfer limit and past the request gap
+    std::deque<Aria2Job> m_aria2Queue;
+    std::map<std::string, uint64_t> m_hostLastRequest;
 
     // yt-dlp process tracking
     std::map<std::string, YtDlpProcess> m_ytdlpProcs;
+    std::deque<YtDlpJob> m_ytdlpQueue;  // FIFO; entries stay "queued" until promoted
+    std::vector<std::pair<std::string, YtDlpStage>> m_ytdlpNextStages;  // gid and stage, see StartYtDlpStages()
     int m_ytdlpCounter = 0;
+    std::string m_ytdlpProbedPath;      // Last handed to ProbeYtDlpVersion() (poll thread only)
 };
@@ -18,6 +18,18 @@ static constexpr GUID guid_downloader_contextmenu =
 static constexpr GUID guid_downloader_contextmenu_group =
 { 0xe5f6a7b8, 0xc9d0, 0x1234, { 0xef, 0xab, 0x34, 0x56, 0x78, 0x90, 0x12, 0x34 } };
 
+// {B7E2C4A1-5D93-4F08-A6C2-1E9D3B7F5A40} - context menu item: bulk import
+static constexpr GUID guid_downloader_contextmenu_bulk =
+{ 0xb7e2c4a1, 0x5d93, 0x4f08, { 0xa6, 0xc2, 0x1e, 0x9d, 0x3b, 0x7f, 0x5a, 0x40 } };
+
+// {1B8E2D57-A781-459D-85A3-DA8E7F2A8E89} - main menu command: dump metrics
+static constexpr GUID guid_downloader_mainmenu_dump_metrics =
+{ 0x1b8e2d57, 0xa781, 0x459d, { 0x85, 0xa3, 0xda, 0x8e, 0x7f, 0x2a, 0x8e, 0x89 } };
+
+// {04B6F450-8B55-4F53-AD30-455EC25E3B47} - main menu command: save trace
+static constexpr GUID guid_downloader_mainmenu_save_trace =
+{ 0x04b6f450, 0x8b55, 0x4f53, { 0xad, 0x30, 0x45, 0x5e, 0xc2, 0x5e, 0x3b, 0x47 } };
+
 // Configuration variable GUIDs
 // {F6A7B8C9-D0E1-2345-FABC-456789012345} - cfg: output folder
 static constexpr GUID guid_cfg_output_folder =
@@ -75,6 +87,34 @@ static constexpr GUID guid_cfg_enable_direct_url =
 static constexpr GUID guid_cfg_ytdlp_extra_flags =
 { 0xd48ba29d, 0xbecf, 0x0123, { 0x12, 0xde, 0x89, 0x01, 0x23, 0x45, 0x67, 0x89 } };
 
+// {CE9712AF-46AE-4065-BA54-29C746200D90} - cfg: max simultaneous yt-dlp jobs
+static constexpr GUID guid_cfg_ytdlp_max_jobs =
+{ 0xce9712af, 0x46ae, 0x4065, { 0xba, 0x54, 0x29, 0xc7, 0x46, 0x20, 0x0d, 0x90 } };
+
+// {69A293B8-33D5-4BBD-8A71-2B0B965E1AF5} - cfg: keep yt-dlp loaded in a worker process
+static constexpr GUID guid_cfg_ytdlp_worker =
+{ 0x69a293b8, 0x33d5, 0x4bbd, { 0x8a, 0x71, 0x2b, 0x0b, 0x96, 0x5e, 0x1a, 0xf5 } };
+
+// {0A2FB63C-33DA-4161-AC76-1B987EB051CF} - cfg: Python used for the yt-dlp worker
+static constexpr GUID guid_cfg_python_path =
+{ 0x0a2fb63c, 0x33da, 0x4161, { 0xac, 0x76, 0x1b, 0x98, 0x7e, 0xb0, 0x51, 0xcf } };
+
+// {9BF6F3CF-C1E4-4205-91FB-49593ED8B6AC} - cfg: fetch YouTube audio streams with aria2
+static constexpr GUID guid_cfg_ytdlp_via_aria2 =
+{ 0x9bf6f3cf, 0xc1e4, 0x4205, { 0x91, 0xfb, 0x49, 0x59, 0x3e, 0xd8, 0xb6, 0xac } };
+
+// {AA2C35CD-CD4B-4756-A037-304465C61D36} - cfg: search in the background while typing
+static constexpr GUID guid_cfg_search_prefetch =
+{ 0xaa2c35cd, 0xcd4b, 0x4756, { 0xa0, 0x37, 0x30, 0x44, 0x65, 0xc6, 0x1d, 0x36 } };
+
+// {132CF722-A773-4D83-BB33-06C1764FFFA9} - cfg: max aria2 transfers per host
+static constexpr GUID guid_cfg_aria2_max_per_host =
+{ 0x132cf722, 0xa773, 0x4d83, { 0xbb, 0x33, 0x06, 0xc1, 0x76, 0x4f, 0xff, 0xa9 } };
+
+// {6E21A6BE-F84F-4AF1-A939-71977F02563F} - cfg: min gap between requests to one host
+static constexpr GUID guid_cfg_aria2_host_gap_ms =
+{ 0x6e21a6be, 0xf84f, 0x4af1, { 0xa9, 0x39, 0x71, 0x97, 0x7f, 0x02, 0x56, 0x3f } };
+
 // {B269807B-9CAD-EF01-F0BC-678901234567} - preferences sub-page: YouTube
 static constexpr GUID guid_pref_youtube =
 { 0xb269807b, 0x9cad, 0xef01, { 0xf0, 0xbc, 0x67, 0x89, 0x01, 0x23, 0x45, 0x67 } };
@@ -87,6 +127,26 @@ static constexpr GUID guid_pref_aria2 =
 static constexpr GUID guid_pref_custom_source =
 { 0xd4abb29d, 0xbfdf, 0x2345, { 0x45, 0xf1, 0xbc, 0x12, 0x34, 0x56, 0x78, 0x90 } };
 
+// {CC4A4588-BA39-4D5E-BDAF-AB2338E30553} - preferences sub-page: Diagnostics
+static constexpr GUID guid_pref_diagnostics =
+{ 0xcc4a4588, 0xba39, 0x4d5e, { 0xbd, 0xaf, 0xab, 0x23, 0x38, 0xe3, 0x05, 0x53 } };
+
 // {E59CA3AD-CFDF-1234-23EF-9A0123456789} - cfg: retry count
 static constexpr GUID guid_cfg_retry_count =
-{ 0xe59ca3ad, 0xcfdf, 0x1234, { 0x23, 0xef, 0x9a, 0x01, 0x23, 0x45, 0x67, 0x89 } };
\ No newline at end of file
+{ 0xe59ca3ad, 0xcfdf, 0x1234, { 0x23, 0xef, 0x9a, 0x01, 0x23, 0x45, 0x67, 0x89 } };
+
+// {4C8D2E61-9A37-4B15-8F0E-D36A5B21C7E9} - cfg: what to do with already downloaded URLs
+static constexpr GUID guid_cfg_duplicate_policy =
+{ 0x4c8d2e61, 0x9a37, 0x4b15, { 0x8f, 0x0e, 0xd3, 0x6a, 0x5b, 0x21, 0xc7, 0xe9 } };
+
+// {75747039-B73B-443B-93A2-48E25F974C3A} - cfg: metrics snapshot interval (s)
+static constexpr GUID guid_cfg_metrics_interval =
+{ 0x75747039, 0xb73b, 0x443b, { 0x93, 0xa2, 0x48, 0xe2, 0x5f, 0x97, 0x4c, 0x3a } };
+
+// {15D5540B-A0B0-495F-9B65-2E41D0A376BD} - cfg: metrics snapshot format
+static constexpr GUID guid_cfg_metrics_format =
+{ 0x15d5540b, 0xa0b0, 0x495f, { 0x9b, 0x65, 0x2e, 0x41, 0xd0, 0xa3, 0x76, 0xbd } };
+
+// {243DCD3C-0271-47E5-BA90-CE03CA3DE423} - cfg: metrics snapshot file
+static constexpr GUID guid_cfg_metrics_path =
+{ 0x243dcd3c, 0x0271, 0x47e5, { 0xba, 0x90, 0xce, 0x03, 0xca, 0x3d, 0xe4, 0x23 } };
@@ -0,0 +1,294 @@
+#include "history_db.h"
+#include "url_index.h"
+
+#include <sqlite3.h>
+
+#include <cstring>
+#include <set>
+
+static DownloadEntry ReadHistoryRow(sqlite3_stmt* stmt) {
+    // Columns: id, title, status, output_path, source_id, url, engine, error_message
+    DownloadEntry entry;
+    entry.historyId    = sqlite3_column_int64(stmt, 0);
+    entry.title        = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 1));
+    entry.status       = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 2));
+    entry.outputPath   = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 3));
+    entry.sourceId     = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 4));
+    entry.url          = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 5));
+    entry.engine       = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 6));
+    entry.errorMessage = reinterpret_cast<const char*>(sqlite3_column_text(stmt, 7));
+
+    if (entry.status == "complete") entry.progress = 100.0;
+    return entry;
+}
+
+// Stage offset in ms, or NULL for a stage that wasn't reached
+static void BindOffset(sqlite3_stmt* stmt, int index, int64_t offsetMs) {
+    if (offsetMs < 0) sqlite3_bind_null(stmt, index);
+    else sqlite3_bind_int64(stmt, index, offsetMs);
+}
+
+// ============================================================================
+// Schema
+// ============================================================================
+
+bool OpenHistoryDb(const std::string& path, sqlite3** db, std::string& error) {
+    *db = nullptr;
+    sqlite3* handle = nullptr;
+    if (sqlite3_open(path.c_str(), &handle) != SQLITE_OK) {
+        error = handle ? sqlite3_errmsg(handle) : "out of memory";
+        sqlite3_close(handle);
+        return false;
+    }
+
+    // Enable WAL mode for better concurrent access
+    sqlite3_exec(handle, "PRAGMA journal_mode=WAL;", nullptr, nullptr, nullptr);
+    *db = handle;
+    return true;
+}
+
+bool CreateHistorySchema(sqlite3* db, std::string& error) {
+    auto exec = [db, &error](const char* sql, const char* what) {
+        char* errMsg = nullptr;
+        if (sqlite3_exec(db, sql, nullptr, nullptr, &errMsg) == SQLITE_OK) return;
+        if (error.empty()) error = std::string(what) + ": " + (errMsg ? errMsg : "unknown error");
+        sqlite3_free(errMsg);
+    };
+
+    exec("CREATE TABLE IF NOT EXISTS downloads ("
+         "  id INTEGER PRIMARY KEY AUTOINCREMENT,"
+         "  title TEXT NOT NULL DEFAULT '',"
+         "  status TEXT NOT NULL DEFAULT '',"
+         "  output_path TEXT NOT NULL DEFAULT '',"
+         "  source_id TEXT NOT NULL DEFAULT '',"
+         "  url TEXT NOT NULL DEFAULT '',"
+         "  engine TEXT NOT NULL DEFAULT '',"
+         "  error_message TEXT NOT NULL DEFAULT '',"
+         "  created_at INTEGER NOT NULL DEFAULT (strftime('%s','now'))"
+         ");", "Failed to create table");
+
+    // Columns added later; older databases get them here. url_key
+    // (NormalizeUrl of url) is filled in by BackfillUrlKeys(); the stage
+    // timings (ms after resolve start, less t_select_ms spent picking search
+    // results; NULL if the stage wasn't reached) stay NULL.
+    std::set<std::string> columns;
+    sqlite3_stmt* info = nullptr;
+    if (sqlite3_prepare_v2(db, "PRAGMA table_info(downloads);", -1, &info, nullptr) == SQLITE_OK) {
+        while (sqlite3_step(info) == SQLITE_ROW) {
+            const char* name = (const char*)sqlite3_column_text(info, 1);
+            if (name) columns.insert(name);
+        }
+        sqlite3_finalize(info);
+    }
+    static const char* addedColumns[][2] = {
+        { "url_key",          "url_key TEXT NOT NULL DEFAULT ''" },
+        { "t_resolve_ms",     "t_resolve_ms INTEGER" },
+        { "t_submit_ms",      "t_submit_ms INTEGER" },
+        { "t_first_byte_ms",  "t_first_byte_ms INTEGER" },
+        { "t_transfer_ms",    "t_transfer_ms INTEGER" },
+        { "t_postprocess_ms", "t_postprocess_ms INTEGER" },
+        { "t_playlist_ms",    "t_playlist_ms INTEGER" },
+        { "t_select_ms",      "t_select_ms INTEGER" },
+    };
+    for (const auto& column : addedColumns) {
+        if (columns.count(column[0])) continue;
+        std::string alter = std::string("ALTER TABLE downloads ADD COLUMN ") + column[1] + ";";
+        sqlite3_exec(db, alter.c_str(), nullptr, nullptr, nullptr);
+    }
+    sqlite3_exec(db, "CREATE INDEX IF NOT EXISTS idx_downloads_url_key ON downloads(url_key);",
+                 nullptr, nullptr, nullptr);
+
+    // url_key of every download that completed, behind WasDownloaded(). Kept
+    // apart from the history rows so clearing or removing those doesn't
+    // forget what was downloaded; seeded from the rows when first created.
+    bool hadUrlIndex = false;
+    sqlite3_stmt* table = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'downloaded_urls';",
+                           -1, &table, nullptr) == SQLITE_OK) {
+        hadUrlIndex = sqlite3_step(table) == SQLITE_ROW;
+        sqlite3_finalize(table);
+    }
+    exec("CREATE TABLE IF NOT EXISTS downloaded_urls (url_key TEXT PRIMARY KEY) WITHOUT ROWID;",
+         "Failed to create URL index table");
+    if (!hadUrlIndex) {
+        exec("INSERT OR IGNORE INTO downloaded_urls (url_key) "
+             "SELECT url_key FROM downloads WHERE status = 'complete' AND url_key <> '';",
+             "Failed to fill URL index table");
+    }
+
+    // Journal of unfinished jobs: one row per resolved item from enqueue
+    // until it completes, fails or is removed (see DownloadManager::FlushJournal)
+    exec("CREATE TABLE IF NOT EXISTS jobs ("
+         "  id INTEGER PRIMARY KEY,"
+         "  source_id TEXT NOT NULL DEFAULT '',"
+         "  status TEXT NOT NULL DEFAULT 'queued',"
+         "  attempts INTEGER NOT NULL DEFAULT 0,"
+         "  url TEXT NOT NULL DEFAULT '',"
+         "  filename TEXT NOT NULL DEFAULT '',"
+         "  title TEXT NOT NULL DEFAULT '',"
+         "  artist TEXT NOT NULL DEFAULT '',"
+         "  album TEXT NOT NULL DEFAULT '',"
+         "  use_ytdlp INTEGER NOT NULL DEFAULT 0,"
+         "  audio_format TEXT NOT NULL DEFAULT '',"
+         "  audio_quality TEXT NOT NULL DEFAULT '',"
+         "  headers TEXT NOT NULL DEFAULT '',"
+         "  created_at INTEGER NOT NULL DEFAULT (strftime('%s','now'))"
+         ");", "Failed to create jobs table");
+
+    return error.empty();
+}
+
+// ============================================================================
+// Downloads
+// ============================================================================
+
+int InsertFinishedDownloads(sqlite3* db, std::vector<DownloadEntry>& entries,
+                            std::vector<std::string>& completedKeys) {
+    // Rows are append-only: entries that reached a terminal state are inserted
+    // once and remember their row id. Older history that is no longer held in
+    // memory stays untouched in the table.
+    const char* insertSql =
+        "INSERT INTO downloads (title, status, output_path, source_id, url, engine, error_message, url_key, "
+        "t_resolve_ms, t_submit_ms, t_first_byte_ms, t_transfer_ms, t_postprocess_ms, t_playlist_ms, t_select_ms) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);";
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, insertSql, -1, &stmt, nullptr) != SQLITE_OK) return -1;
+    sqlite3_stmt* indexStmt = nullptr;
+    if (sqlite3_prepare_v2(db, "INSERT OR IGNORE INTO downloaded_urls (url_key) VALUES (?);",
+                           -1, &indexStmt, nullptr) != SQLITE_OK) {
+        sqlite3_finalize(stmt);
+        return -1;
+    }
+
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+
+    int inserted = 0;
+    for (auto& e : entries) {
+        if (e.status != "complete" && e.status != "error") continue;
+        if (e.historyId != 0) continue;
+
+        sqlite3_bind_text(stmt, 1, e.title.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 2, e.status.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 3, e.outputPath.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 4, e.sourceId.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 5, e.url.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 6, e.engine.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_text(stmt, 7, e.errorMessage.c_str(), -1, SQLITE_TRANSIENT);
+        std::string urlKey = NormalizeUrl(e.url);
+        sqlite3_bind_text(stmt, 8, urlKey.c_str(), -1, SQLITE_TRANSIENT);
+        BindOffset(stmt, 9, e.times.Offset(e.times.resolveEnd));
+        BindOffset(stmt, 10, e.times.Offset(e.times.submitted));
+        BindOffset(stmt, 11, e.times.Offset(e.times.firstByte));
+        BindOffset(stmt, 12, e.times.Offset(e.times.transferEnd));
+        BindOffset(stmt, 13, e.times.Offset(e.times.postProcessEnd));
+        BindOffset(stmt, 14, e.times.Offset(e.times.playlistInsert));
+        BindOffset(stmt, 15, e.times.resolveStart == 0 ? -1 : (int64_t)e.times.selection);
+
+        if (sqlite3_step(stmt) == SQLITE_DONE) {
+            e.historyId = sqlite3_last_insert_rowid(db);
+            inserted++;
+            if (e.status == "complete" && !urlKey.empty()) {
+                sqlite3_bind_text(indexStmt, 1, urlKey.c_str(), -1, SQLITE_TRANSIENT);
+                sqlite3_step(indexStmt);
+                sqlite3_reset(indexStmt);
+                completedKeys.push_back(std::move(urlKey));
+            }
+        }
+        sqlite3_reset(stmt);
+    }
+
+    sqlite3_finalize(stmt);
+    sqlite3_finalize(indexStmt);
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    return inserted;
+}
+
+bool SelectHistoryRows(sqlite3* db, int64_t beforeId, int limit, std::vector<DownloadEntry>& rows) {
+    const char* selectSql =
+        "SELECT id, title, status, output_path, source_id, url, engine, error_message "
+        "FROM downloads WHERE id < ? ORDER BY id DESC LIMIT ?;";
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, selectSql, -1, &stmt, nullptr) != SQLITE_OK) return false;
+
+    sqlite3_bind_int64(stmt, 1, beforeId);
+    sqlite3_bind_int(stmt, 2, limit);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        rows.push_back(ReadHistoryRow(stmt));
+    }
+    sqlite3_finalize(stmt);
+    return true;
+}
+
+// ============================================================================
+// URL keys
+// ============================================================================
+
+size_t BackfillUrlKeys(sqlite3* db) {
+    // Rows written before url_key existed, or migrated from the text history
+    std::vector<std::pair<int64_t, std::string>> rows;
+    std::vector<std::string> completedKeys;
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT id, url, status FROM downloads WHERE url_key = '' AND url <> '';",
+                           -1, &stmt, nullptr) != SQLITE_OK) {
+        return 0;
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char* url = (const char*)sqlite3_column_text(stmt, 1);
+        const char* status = (const char*)sqlite3_column_text(stmt, 2);
+        std::string key = NormalizeUrl(url ? url : "");
+        if (key.empty()) continue;
+        if (status && strcmp(status, "complete") == 0) completedKeys.push_back(key);
+        rows.emplace_back(sqlite3_column_int64(stmt, 0), std::move(key));
+    }
+    sqlite3_finalize(stmt);
+    if (rows.empty()) return 0;
+
+    if (sqlite3_prepare_v2(db, "UPDATE downloads SET url_key = ? WHERE id = ?;", -1, &stmt, nullptr) != SQLITE_OK) {
+        return 0;
+    }
+    sqlite3_stmt* indexStmt = nullptr;
+    if (sqlite3_prepare_v2(db, "INSERT OR IGNORE INTO downloaded_urls (url_key) VALUES (?);",
+                           -1, &indexStmt, nullptr) != SQLITE_OK) {
+        sqlite3_finalize(stmt);
+        return 0;
+    }
+    sqlite3_exec(db, "BEGIN TRANSACTION;", nullptr, nullptr, nullptr);
+    for (const auto& row : rows) {
+        sqlite3_bind_text(stmt, 1, row.second.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int64(stmt, 2, row.first);
+        sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+    }
+    for (const auto& key : completedKeys) {
+        sqlite3_bind_text(indexStmt, 1, key.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_step(indexStmt);
+        sqlite3_reset(indexStmt);
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_finalize(indexStmt);
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+    return rows.size();
+}
+
+void LoadCompletedUrlKeys(sqlite3* db, BloomFilter& filter) {
+    sqlite3_stmt* stmt = nullptr;
+    const char* countSql = "SELECT COUNT(*) FROM downloaded_urls;";
+    size_t expected = 0;
+    if (sqlite3_prepare_v2(db, countSql, -1, &stmt, nullptr) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) expected = (size_t)sqlite3_column_int64(stmt, 0);
+        sqlite3_finalize(stmt);
+    }
+
+    // Headroom so the filter stays accurate as this session adds keys
+    filter.Reset(expected * 2);
+
+    const char* keySql = "SELECT url_key FROM downloaded_urls;";
+    if (sqlite3_prepare_v2(db, keySql, -1, &stmt, nullptr) != SQLITE_OK) return;
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char* key = (const char*)sqlite3_column_text(stmt, 0);
+        if (key) filter.Add(key);
+    }
+    sqlite3_finalize(stmt);
+}
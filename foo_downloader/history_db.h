@@ -0,0 +1,47 @@
+#pragma once
+
+#include "download_entry.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct sqlite3;
+class BloomFilter;
+
+// ============================================================================
+// Download history and job journal tables (SQLite)
+// ============================================================================
+// The statements behind DownloadManager's persistence. Callers own the
+// connection and any locking; functions that can fail return false (or -1)
+// and leave the reason in sqlite3_errmsg().
+// ============================================================================
+
+// Open or create the database at `path` in WAL mode. On failure `*db` is
+// null and `error` says why.
+bool OpenHistoryDb(const std::string& path, sqlite3** db, std::string& error);
+
+// Create the downloads and jobs tables, and add columns introduced since an
+// older database was written. `error` names the first statement that failed;
+// the rest are still attempted.
+bool CreateHistorySchema(sqlite3* db, std::string& error);
+
+// Append every entry that reached a terminal state and has no row yet, in
+// one transaction, and store the new row ids in historyId. The url_key of
+// each completed row goes into downloaded_urls and is appended to
+// `completedKeys`. Returns the number of
+// rows written, or -1 if the insert could not be prepared.
+int InsertFinishedDownloads(sqlite3* db, std::vector<DownloadEntry>& entries,
+                            std::vector<std::string>& completedKeys);
+
+// Up to `limit` rows with id < beforeId, newest first (keyset pagination on
+// the primary key, so the cost does not depend on how deep the page is)
+bool SelectHistoryRows(sqlite3* db, int64_t beforeId, int limit, std::vector<DownloadEntry>& rows);
+
+// Fill in url_key for rows written before it existed, adding completed ones
+// to downloaded_urls. Returns the number of rows updated.
+size_t BackfillUrlKeys(sqlite3* db);
+
+// Rebuild `filter` from downloaded_urls, the url_key of every completed
+// download, including those since cleared from the history
+void LoadCompletedUrlKeys(sqlite3* db, BloomFilter& filter);
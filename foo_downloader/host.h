@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <sstream>
+#include <string>
+
+// ============================================================================
+// Services the embedding application provides to the download core
+// ============================================================================
+// The foobar2000 component implements these in host_fb2k.cpp (console,
+// popups, playlists, preferences); the CLI in cli/cli_host.cpp (stderr,
+// command-line options); the engine benchmark in bench/bench_host.cpp.
+// All may be called from any thread.
+// ============================================================================
+
+// One line of diagnostic output
+void HostLog(const std::string& line);
+
+// Tell the user something failed. Must not block.
+void HostShowError(const std::string& message);
+
+// Ask a yes/no question. Returns false if `cancelled` becomes set first or
+// there is nobody to ask.
+bool HostConfirm(const std::string& question, const std::atomic<bool>& cancelled);
+
+// A download finished at `path`. Hosts that add it to a playlist call
+// `inserted` once they have; others never call it.
+void HostDownloadComplete(const std::string& path, std::function<void()> inserted);
+
+// Where the history database lives, with a trailing separator
+std::string HostDataDirectory();
+
+// Builds one log line and hands it to HostLog() when the statement ends:
+//   LogLine() << "[foo_downloader] Queued " << count << " items";
+class LogLine {
+public:
+    LogLine() = default;
+    LogLine(const LogLine&) = delete;
+    LogLine& operator=(const LogLine&) = delete;
+    ~LogLine() { HostLog(m_stream.str()); }
+
+    template <typename T>
+    LogLine& operator<<(const T& value) {
+        m_stream << value;
+        return *this;
+    }
+
+private:
+    std::ostringstream m_stream;
+};
+
+// ============================================================================
+// Settings (preferences.cpp in the component, options in the CLI)
+// ============================================================================
+
+const char* GetConfigOutputFolder();
+bool GetConfigEmbedMetadata();
+const char* GetConfigYtDlpPath();
+const char* GetConfigYtDlpExtraFlags();
+int GetConfigYtQuality();
+int GetConfigYtDlpMaxJobs();
+bool GetConfigYtDlpWorker();
+const char* GetConfigPythonPath();   // Empty = python3/python on PATH
+bool GetConfigYtDlpViaAria2();
+int GetConfigRetryCount();
+int GetConfigAria2MaxPerHost();
+int GetConfigAria2HostGapMs();
+int GetConfigDuplicatePolicy();
+const char* GetConfigCustomSourceUrl();
+bool GetConfigEnableCustomSource();
+bool GetConfigEnableYoutube();
+bool GetConfigEnableDirectUrl();
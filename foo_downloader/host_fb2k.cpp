@@ -0,0 +1,43 @@
+#include "stdafx.h"
+#include "host.h"
+#include "main_thread.h"
+#include "platform.h"
+#include "playlist_utils.h"
+
+// ============================================================================
+// host.h for the foobar2000 component
+// ============================================================================
+// Settings come from preferences.cpp; everything that touches the UI or the
+// playlist manager is marshalled to the main thread.
+// ============================================================================
+
+void HostLog(const std::string& line) {
+    FB2K_console_formatter() << line.c_str();
+}
+
+void HostShowError(const std::string& message) {
+    // popup_message must be shown from the main thread
+    PostToMainThread([message]() {
+        popup_message::g_show(message.c_str(), "foo_downloader", popup_message::icon_error);
+    });
+}
+
+bool HostConfirm(const std::string& question, const std::atomic<bool>& cancelled) {
+    auto answer = CallInMainThread([question]() {
+        return uMessageBox(core_api::get_main_window(), question.c_str(), "foo_downloader",
+                           MB_YESNO | MB_ICONQUESTION) == IDYES;
+    }, cancelled);
+    return answer.value_or(false);
+}
+
+void HostDownloadComplete(const std::string& path, std::function<void()> inserted) {
+    PostToMainThread([path, inserted = std::move(inserted)]() {
+        PlaylistUtils::AddToDownloadedPlaylist(path);
+        if (inserted) inserted();
+    });
+}
+
+std::string HostDataDirectory() {
+    // downloads.db has always lived next to the DLL
+    return ModuleDirectory();
+}
@@ -0,0 +1,190 @@
+#include "json_scan.h"
+
+#include <cctype>
+#include <cstdio>
+
+// Position of the value of "key" (past the colon and any spaces), or npos.
+// An occurrence not followed by a colon is a string value that happens to
+// equal the key; keep looking.
+static size_t FindValue(const std::string& json, const std::string& key) {
+    std::string quoted = "\"" + key + "\"";
+    size_t pos = json.find(quoted);
+    while (pos != std::string::npos) {
+        size_t p = pos + quoted.size();
+        while (p < json.size() && json[p] == ' ') p++;
+        if (p < json.size() && json[p] == ':') {
+            p++;
+            while (p < json.size() && json[p] == ' ') p++;
+            return p;
+        }
+        pos = json.find(quoted, pos + 1);
+    }
+    return std::string::npos;
+}
+
+// Unescaped string starting just past an opening quote
+static std::string ReadString(const std::string& json, size_t pos) {
+    std::string result;
+    while (pos < json.size()) {
+        char c = json[pos];
+        if (c == '"') break;
+        if (c == '\\' && pos + 1 < json.size()) {
+            char next = json[pos + 1];
+            if (next == '\\') { result += '\\'; pos += 2; continue; }
+            if (next == '"')  { result += '"';  pos += 2; continue; }
+            if (next == '/')  { result += '/';  pos += 2; continue; }
+            if (next == 'n')  { result += '\n'; pos += 2; continue; }
+            if (next == 'r')  { result += '\r'; pos += 2; continue; }
+            if (next == 't')  { result += '\t'; pos += 2; continue; }
+            // Pass through unknown escapes
+            result += next; pos += 2; continue;
+        }
+        result += c;
+        pos++;
+    }
+    return result;
+}
+
+// Index just past the closing quote of the string opening at `pos`
+static size_t SkipString(const std::string& json, size_t pos) {
+    for (pos++; pos < json.size(); pos++) {
+        if (json[pos] == '\\') pos++;
+        else if (json[pos] == '"') return pos + 1;
+    }
+    return json.size();
+}
+
+std::string JsonString(const std::string& json, const std::string& key) {
+    size_t pos = FindValue(json, key);
+    if (pos == std::string::npos || pos >= json.size() || json[pos] != '"') return "";
+    return ReadString(json, pos + 1);
+}
+
+int64_t JsonInt(const std::string& json, const std::string& key) {
+    size_t pos = FindValue(json, key);
+    if (pos == std::string::npos) return 0;
+
+    // Digits only: a fractional part (yt-dlp's "duration": 213.0) is dropped
+    std::string num;
+    while (pos < json.size() && (isdigit((unsigned char)json[pos]) || json[pos] == '-')) {
+        num += json[pos++];
+    }
+    if (num.empty()) return 0;
+    try { return std::stoll(num); } catch (...) { return 0; }
+}
+
+uint64_t JsonQuotedNumber(const std::string& json, const std::string& key) {
+    std::string val = JsonString(json, key);
+    if (val.empty()) return 0;
+    try { return std::stoull(val); } catch (...) { return 0; }
+}
+
+std::string JsonQuote(const std::string& s) {
+    std::string out = "\"";
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += (char)c;
+        } else if (c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        } else {
+            out += (char)c;
+        }
+    }
+    return out + "\"";
+}
+
+size_t JsonSkipValue(const std::string& json, size_t pos) {
+    int depth = 0;
+    bool inString = false;
+    for (; pos < json.size(); pos++) {
+        char c = json[pos];
+        if (inString) {
+            if (c == '\\') pos++;
+            else if (c == '"') inString = false;
+            continue;
+        }
+        if (c == '"') {
+            inString = true;
+        } else if (c == '{' || c == '[') {
+            depth++;
+        } else if (c == '}' || c == ']') {
+            if (--depth == 0) return pos + 1;
+        }
+    }
+    return json.size();
+}
+
+std::string JsonRpcResult(const std::string& json) {
+    size_t pos = FindValue(json, "result");
+    if (pos == std::string::npos || pos >= json.size()) return "";
+
+    // A string result (like a GID)
+    if (json[pos] == '"') {
+        auto end = json.find('"', pos + 1);
+        if (end == std::string::npos) return "";
+        return json.substr(pos + 1, end - pos - 1);
+    }
+
+    if (json[pos] == '{' || json[pos] == '[') {
+        return json.substr(pos, JsonSkipValue(json, pos) - pos);
+    }
+    return "";
+}
+
+std::vector<std::pair<std::string, std::string>> JsonStringMembers(const std::string& json, const std::string& key) {
+    std::vector<std::pair<std::string, std::string>> result;
+    size_t pos = FindValue(json, key);
+    if (pos == std::string::npos || pos >= json.size() || json[pos] != '{') return result;
+    size_t end = JsonSkipValue(json, pos) - 1;   // The closing brace
+
+    pos++;
+    while (pos < end) {
+        while (pos < end && json[pos] != '"' && json[pos] != '}') pos++;
+        if (pos >= end || json[pos] != '"') break;
+        std::string name = ReadString(json, pos + 1);
+        pos = SkipString(json, pos);
+
+        while (pos < end && (json[pos] == ' ' || json[pos] == ':')) pos++;
+        if (pos >= end) break;
+        if (json[pos] == '"') {
+            result.emplace_back(std::move(name), ReadString(json, pos + 1));
+            pos = SkipString(json, pos);
+        } else if (json[pos] == '{' || json[pos] == '[') {
+            pos = JsonSkipValue(json, pos);
+        } else {
+            while (pos < end && json[pos] != ',') pos++;   // Number, true, false, null
+        }
+    }
+    return result;
+}
+
+std::vector<std::string> JsonObjectArray(const std::string& json, const std::string& key) {
+    std::vector<std::string> result;
+    size_t pos = FindValue(json, key);
+    if (pos == std::string::npos || pos >= json.size() || json[pos] != '[') return result;
+
+    pos++;   // Skip '['
+    while (pos < json.size()) {
+        // Skip whitespace and commas
+        while (pos < json.size() && (json[pos] == ' ' || json[pos] == ',' || json[pos] == '\n' || json[pos] == '\r')) pos++;
+        if (pos >= json.size() || json[pos] == ']') break;
+
+        if (json[pos] == '{') {
+            size_t end = JsonSkipValue(json, pos);
+            result.push_back(json.substr(pos, end - pos));
+            pos = end;
+        } else {
+            pos++;
+        }
+    }
+    return result;
+}
+
+std::string JsonNestedString(const std::string& json, const std::string& object, const std::string& key) {
+    size_t pos = FindValue(json, object);
+    if (pos == std::string::npos || pos >= json.size() || json[pos] != '{') return "";
+    return JsonString(json.substr(pos, JsonSkipValue(json, pos) - pos), key);
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// ============================================================================
+// Minimal JSON scanning
+// ============================================================================
+// Key lookups by substring search, sufficient for the flat objects aria2,
+// yt-dlp and the custom source API return. The first occurrence of a key
+// wins, whatever its nesting depth, so callers strip or split out nested
+// objects whose keys would collide. No external JSON library dependency.
+// ============================================================================
+
+// String value of "key", unescaped; empty if missing or not a string
+std::string JsonString(const std::string& json, const std::string& key);
+
+// Unquoted integer value of "key"; 0 if missing or not a number
+int64_t JsonInt(const std::string& json, const std::string& key);
+
+// Integer stored as a string ("key":"12345"), as aria2 reports sizes
+uint64_t JsonQuotedNumber(const std::string& json, const std::string& key);
+
+// Raw text of the JSON-RPC "result" member: the contents of a string (without
+// quotes) or an entire object/array including its brackets
+std::string JsonRpcResult(const std::string& json);
+
+// Each object element of the array "key", as raw text
+std::vector<std::string> JsonObjectArray(const std::string& json, const std::string& key);
+
+// String "key" inside the object "object" ("object":{..., "key":"..."})
+std::string JsonNestedString(const std::string& json, const std::string& object, const std::string& key);
+
+// Members of the object "key" whose values are strings, in order, e.g. a
+// header map; members of any other type are skipped
+std::vector<std::pair<std::string, std::string>> JsonStringMembers(const std::string& json, const std::string& key);
+
+// `s` as a JSON string literal, quotes included
+std::string JsonQuote(const std::string& s);
+
+// Index just past the bracket closing the object/array that opens at `pos`,
+// skipping brackets inside strings; json.size() if unterminated
+size_t JsonSkipValue(const std::string& json, size_t pos);
@@ -0,0 +1,52 @@
+#include "latency_stats.h"
+
+#include <algorithm>
+#include <cstdio>
+
+LatencyPercentiles ComputePercentiles(std::vector<uint64_t>& samples) {
+    LatencyPercentiles result;
+    result.count = samples.size();
+    if (samples.empty()) return result;
+
+    std::sort(samples.begin(), samples.end());
+    auto rank = [&samples](int p) {
+        // Smallest sample with at least p% of the samples at or below it
+        size_t n = samples.size();
+        size_t index = (n * p + 99) / 100;
+        return samples[index == 0 ? 0 : index - 1];
+    };
+    result.p50 = rank(50);
+    result.p95 = rank(95);
+    result.p99 = rank(99);
+    return result;
+}
+
+static std::string FormatSeconds(uint64_t ms) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.1f s", ms / 1000.0);
+    return buf;
+}
+
+static void AppendRow(std::string& out, const char* label, const LatencyPercentiles& p) {
+    out += "  ";
+    out += label;
+    if (p.count == 0) {
+        out += "no samples\n";
+        return;
+    }
+    out += "p50 " + FormatSeconds(p.p50) + ", p95 " + FormatSeconds(p.p95) + ", p99 " + FormatSeconds(p.p99)
+        + " (" + std::to_string(p.count) + " downloads)\n";
+}
+
+std::string FormatLatencyReport(const std::vector<LatencyGroup>& groups) {
+    if (groups.empty()) return "No completed downloads with timing data yet.";
+
+    std::string out;
+    for (const auto& g : groups) {
+        out += g.name + "\n";
+        AppendRow(out, "First byte:       ", g.firstByte);
+        AppendRow(out, "Time to playlist: ", g.toPlaylist);
+        out += "\n";
+    }
+    return out;
+}
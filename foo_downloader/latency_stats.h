@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// Per-stage timestamps of one download
+// ============================================================================
+// GetTickCount64() values (monotonic, ms), 0 while the stage hasn't been
+// reached. A retry clears everything from `submitted` on, so the engine
+// stages always describe the attempt that succeeded. The time a search
+// source's results dialog waited for the user to pick is kept apart, in
+// `selection`, and left out of every offset.
+// ============================================================================
+struct StageTimes {
+    uint64_t resolveStart = 0;
+    uint64_t resolveEnd = 0;
+    uint64_t submitted = 0;       // Handed to aria2 / yt-dlp process started
+    uint64_t firstByte = 0;
+    uint64_t transferEnd = 0;
+    uint64_t postProcessEnd = 0;  // yt-dlp conversion/tagging done; same as transferEnd for aria2
+    uint64_t playlistInsert = 0;
+    uint64_t selection = 0;       // Milliseconds, not a timestamp
+
+    // Milliseconds from resolveStart to `stamp` less `selection`, or -1 if
+    // either is unset. Every stamp after resolveStart comes after the
+    // selection too.
+    int64_t Offset(uint64_t stamp) const {
+        if (resolveStart == 0 || stamp == 0 || stamp < resolveStart + selection) return -1;
+        return (int64_t)(stamp - resolveStart - selection);
+    }
+};
+
+// ============================================================================
+// Latency percentiles
+// ============================================================================
+struct LatencyPercentiles {
+    size_t count = 0;
+    uint64_t p50 = 0;
+    uint64_t p95 = 0;
+    uint64_t p99 = 0;
+};
+
+// Nearest-rank percentiles of `samples` (ms); reorders the vector
+LatencyPercentiles ComputePercentiles(std::vector<uint64_t>& samples);
+
+// Time to first byte (engine submit -> first byte) and total time (resolve
+// start -> playlist insert) for one source or engine
+struct LatencyGroup {
+    std::string name;             // "source:<id>" or "engine:<name>"
+    LatencyPercentiles firstByte;
+    LatencyPercentiles toPlaylist;
+};
+
+// Plain-text table for a popup or the console
+std::string FormatLatencyReport(const std::vector<LatencyGroup>& groups);
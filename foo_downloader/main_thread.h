@@ -0,0 +1,51 @@
+#pragma once
+
+// foobar2000 main-thread helpers for the component's UI code. The download
+// core does not use these; it reaches the UI through host.h.
+
+#include "metrics.h"
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <optional>
+
+// ============================================================================
+// fb2k::inMainThread, counted in the main-thread backlog gauge until it runs
+// ============================================================================
+template <typename Fn>
+void PostToMainThread(Fn fn) {
+    static MetricGauge& backlog = Metrics().Gauge("foo_downloader_main_thread_backlog",
+        "Work posted to the main thread and not yet run", { { "kind", "callbacks" } });
+    backlog.Add(1);
+    fb2k::inMainThread([fn = std::move(fn)]() mutable {
+        backlog.Add(-1);
+        fn();
+    });
+}
+
+// ============================================================================
+// Run `fn` on the main thread and wait for its result
+// ============================================================================
+// For worker-thread code that needs UI (modal dialogs). Runs `fn` directly
+// when already on the main thread. Returns nullopt without waiting further if
+// `cancelled` becomes set first; `fn` still runs later, so it must own what it
+// touches (capture by value).
+// ============================================================================
+template <typename Fn>
+auto CallInMainThread(Fn fn, const std::atomic<bool>& cancelled) -> std::optional<decltype(fn())> {
+    using Result = decltype(fn());
+    if (core_api::is_main_thread()) return fn();
+
+    auto promise = std::make_shared<std::promise<Result>>();
+    auto future = promise->get_future();
+    PostToMainThread([promise, fn = std::move(fn)]() mutable {
+        promise->set_value(fn());
+    });
+
+    while (future.wait_for(std::chrono::milliseconds(100)) != std::future_status::ready) {
+        if (cancelled) return std::nullopt;
+    }
+    return future.get();
+}
@@ -0,0 +1,267 @@
+#include "metrics.h"
+
+#include <chrono>
+#include <cstdio>
+
+// ============================================================================
+// Striping
+// ============================================================================
+
+static size_t ThreadStripe() {
+    // Threads are dealt stripes round-robin as they first touch a metric
+    static std::atomic<size_t> nextStripe{ 0 };
+    thread_local size_t stripe = nextStripe.fetch_add(1, std::memory_order_relaxed) % METRIC_STRIPES;
+    return stripe;
+}
+
+uint64_t MetricNowMicros() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// ============================================================================
+// Counter
+// ============================================================================
+
+void MetricCounter::Add(uint64_t n) {
+    m_stripes[ThreadStripe()].value.fetch_add(n, std::memory_order_relaxed);
+}
+
+uint64_t MetricCounter::Value() const {
+    uint64_t total = 0;
+    for (const auto& s : m_stripes) total += s.value.load(std::memory_order_relaxed);
+    return total;
+}
+
+// ============================================================================
+// Histogram
+// ============================================================================
+
+static int HighestBit(uint64_t v) {
+    int bit = 0;
+    while (v >>= 1) bit++;
+    return bit;
+}
+
+size_t MetricHistogram::BucketOf(uint64_t micros) {
+    if (micros < 16) return (size_t)micros;
+    int e = HighestBit(micros);                       // >= 4
+    size_t sub = (size_t)(micros >> (e - 3)) & 7;     // Next 3 bits below the leading one
+    size_t bucket = 16 + (size_t)(e - 4) * 8 + sub;
+    return bucket < BUCKETS ? bucket : BUCKETS - 1;
+}
+
+uint64_t MetricHistogram::BucketMidpoint(size_t bucket) {
+    if (bucket < 16) return bucket;
+    int e = (int)((bucket - 16) / 8) + 4;
+    uint64_t sub = (bucket - 16) % 8;
+    uint64_t lower = (8 + sub) << (e - 3);
+    uint64_t width = (uint64_t)1 << (e - 3);
+    return lower + width / 2;
+}
+
+void MetricHistogram::Record(uint64_t micros) {
+    Stripe& s = m_stripes[ThreadStripe()];
+    s.buckets[BucketOf(micros)].fetch_add(1, std::memory_order_relaxed);
+    s.sum.fetch_add(micros, std::memory_order_relaxed);
+    s.count.fetch_add(1, std::memory_order_relaxed);
+}
+
+MetricHistogram::Snapshot MetricHistogram::Read() const {
+    // Not an atomic cut across stripes; a record landing mid-read may show
+    // up in `buckets` but not yet in `count`, which Quantile() tolerates
+    Snapshot snap;
+    snap.buckets.assign(BUCKETS, 0);
+    for (size_t i = 0; i < METRIC_STRIPES; i++) {
+        const Stripe& s = m_stripes[i];
+        snap.count += s.count.load(std::memory_order_relaxed);
+        snap.sum += s.sum.load(std::memory_order_relaxed);
+        for (size_t b = 0; b < BUCKETS; b++) {
+            snap.buckets[b] += s.buckets[b].load(std::memory_order_relaxed);
+        }
+    }
+    return snap;
+}
+
+uint64_t MetricHistogram::Snapshot::Quantile(double q) const {
+    uint64_t total = 0;
+    for (uint64_t n : buckets) total += n;
+    if (total == 0) return 0;
+
+    uint64_t rank = (uint64_t)(q * (double)total + 0.5);
+    if (rank < 1) rank = 1;
+    uint64_t seen = 0;
+    for (size_t b = 0; b < buckets.size(); b++) {
+        seen += buckets[b];
+        if (seen >= rank) return BucketMidpoint(b);
+    }
+    return BucketMidpoint(buckets.size() - 1);
+}
+
+MetricTimer::MetricTimer(MetricHistogram& histogram) : m_histogram(histogram), m_start(MetricNowMicros()) {}
+
+MetricTimer::~MetricTimer() {
+    m_histogram.Record(MetricNowMicros() - m_start);
+}
+
+// ============================================================================
+// Registry
+// ============================================================================
+
+MetricsRegistry& MetricsRegistry::instance() {
+    static MetricsRegistry inst;
+    return inst;
+}
+
+MetricCounter& MetricsRegistry::Counter(const std::string& name, const char* help, const MetricLabels& labels) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Family& f = m_families[name];
+    if (f.help.empty()) {
+        f.help = help;
+        f.kind = Kind::Counter;
+    }
+    auto& slot = f.counters[labels];
+    if (!slot) slot.reset(new MetricCounter());
+    return *slot;
+}
+
+MetricGauge& MetricsRegistry::Gauge(const std::string& name, const char* help, const MetricLabels& labels) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Family& f = m_families[name];
+    if (f.help.empty()) {
+        f.help = help;
+        f.kind = Kind::Gauge;
+    }
+    auto& slot = f.gauges[labels];
+    if (!slot) slot.reset(new MetricGauge());
+    return *slot;
+}
+
+MetricHistogram& MetricsRegistry::Histogram(const std::string& name, const char* help, const MetricLabels& labels) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Family& f = m_families[name];
+    if (f.help.empty()) {
+        f.help = help;
+        f.kind = Kind::Histogram;
+    }
+    auto& slot = f.histograms[labels];
+    if (!slot) slot.reset(new MetricHistogram());
+    return *slot;
+}
+
+// ============================================================================
+// Rendering
+// ============================================================================
+
+static const double EXPORT_QUANTILES[] = { 0.5, 0.9, 0.95, 0.99 };
+
+static std::string EscapeLabelValue(const std::string& v) {
+    // Same escapes in the Prometheus label syntax and JSON strings
+    std::string out;
+    for (char c : v) {
+        if (c == '\\' || c == '"') { out += '\\'; out += c; }
+        else if (c == '\n') out += "\\n";
+        else out += c;
+    }
+    return out;
+}
+
+static std::string PromLabels(const MetricLabels& labels, const char* extraKey = nullptr,
+                              const std::string& extraValue = std::string()) {
+    if (labels.empty() && !extraKey) return "";
+    std::string out = "{";
+    bool first = true;
+    for (const auto& [k, v] : labels) {
+        if (!first) out += ",";
+        out += k + "=\"" + EscapeLabelValue(v) + "\"";
+        first = false;
+    }
+    if (extraKey) {
+        if (!first) out += ",";
+        out += std::string(extraKey) + "=\"" + extraValue + "\"";
+    }
+    return out + "}";
+}
+
+static std::string FormatDouble(double v) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.9g", v);
+    return buf;
+}
+
+std::string MetricsRegistry::RenderPrometheus() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::string out;
+    for (const auto& [name, f] : m_families) {
+        out += "# HELP " + name + " " + f.help + "\n";
+        switch (f.kind) {
+        case Kind::Counter:
+            out += "# TYPE " + name + " counter\n";
+            for (const auto& [labels, c] : f.counters) {
+                out += name + PromLabels(labels) + " " + std::to_string(c->Value()) + "\n";
+            }
+            break;
+        case Kind::Gauge:
+            out += "# TYPE " + name + " gauge\n";
+            for (const auto& [labels, g] : f.gauges) {
+                out += name + PromLabels(labels) + " " + std::to_string(g->Value()) + "\n";
+            }
+            break;
+        case Kind::Histogram:
+            out += "# TYPE " + name + " summary\n";
+            for (const auto& [labels, h] : f.histograms) {
+                auto snap = h->Read();
+                for (double q : EXPORT_QUANTILES) {
+                    out += name + PromLabels(labels, "quantile", FormatDouble(q)) + " "
+                         + FormatDouble(snap.Quantile(q) / 1e6) + "\n";
+                }
+                out += name + "_sum" + PromLabels(labels) + " " + FormatDouble(snap.sum / 1e6) + "\n";
+                out += name + "_count" + PromLabels(labels) + " " + std::to_string(snap.count) + "\n";
+            }
+            break;
+        }
+    }
+    return out;
+}
+
+static std::string JsonLabels(const MetricLabels& labels) {
+    std::string out = "{";
+    for (size_t i = 0; i < labels.size(); i++) {
+        if (i > 0) out += ",";
+        out += "\"" + EscapeLabelValue(labels[i].first) + "\":\"" + EscapeLabelValue(labels[i].second) + "\"";
+    }
+    return out + "}";
+}
+
+std::string MetricsRegistry::RenderJson() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::string out = "{\"metrics\":[";
+    bool first = true;
+    auto begin = [&](const std::string& name, const char* type, const MetricLabels& labels) {
+        if (!first) out += ",";
+        first = false;
+        out += "\n{\"name\":\"" + name + "\",\"type\":\"" + type + "\",\"labels\":" + JsonLabels(labels);
+    };
+
+    for (const auto& [name, f] : m_families) {
+        for (const auto& [labels, c] : f.counters) {
+            begin(name, "counter", labels);
+            out += ",\"value\":" + std::to_string(c->Value()) + "}";
+        }
+        for (const auto& [labels, g] : f.gauges) {
+            begin(name, "gauge", labels);
+            out += ",\"value\":" + std::to_string(g->Value()) + "}";
+        }
+        for (const auto& [labels, h] : f.histograms) {
+            auto snap = h->Read();
+            begin(name, "histogram", labels);
+            out += ",\"count\":" + std::to_string(snap.count) + ",\"sum\":" + FormatDouble(snap.sum / 1e6);
+            for (double q : EXPORT_QUANTILES) {
+                out += ",\"p" + std::to_string((int)(q * 100 + 0.5)) + "\":" + FormatDouble(snap.Quantile(q) / 1e6);
+            }
+            out += "}";
+        }
+    }
+    out += "\n]}\n";
+    return out;
+}
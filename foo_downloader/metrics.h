@@ -0,0 +1,136 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// ============================================================================
+// In-process metrics
+// ============================================================================
+// Counters and histograms are striped: each thread updates its own
+// cache-line-aligned slot with a relaxed atomic add, so hot paths never take
+// a lock or contend on a shared line. Readers sum the stripes. Gauges hold a
+// single value and are a plain atomic.
+//
+// Instances are created through MetricsRegistry, which owns them for the
+// life of the process; callers look a metric up once and keep the reference:
+//
+//     static MetricCounter& calls = Metrics().Counter("foo_x_total", "...");
+//     calls.Add();
+// ============================================================================
+
+static const size_t METRIC_STRIPES = 8;
+
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+class MetricCounter {
+public:
+    void Add(uint64_t n = 1);
+    uint64_t Value() const;
+
+private:
+    struct alignas(64) Stripe { std::atomic<uint64_t> value{ 0 }; };
+    Stripe m_stripes[METRIC_STRIPES];
+};
+
+class MetricGauge {
+public:
+    void Set(int64_t v) { m_value.store(v, std::memory_order_relaxed); }
+    void Add(int64_t n) { m_value.fetch_add(n, std::memory_order_relaxed); }
+    int64_t Value() const { return m_value.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<int64_t> m_value{ 0 };
+};
+
+// HDR-style histogram of durations in microseconds: values below 16 us are
+// exact, above that each power of two is split into 8 linear sub-buckets, so
+// any recorded value is known to within 12.5%. Covers up to ~12 days.
+class MetricHistogram {
+public:
+    static const size_t BUCKETS = 16 + 37 * 8;
+
+    void Record(uint64_t micros);
+
+    struct Snapshot {
+        uint64_t count = 0;
+        uint64_t sum = 0;               // us
+        std::vector<uint64_t> buckets;  // BUCKETS entries
+
+        // Representative value (us) of the bucket holding quantile q (0..1)
+        uint64_t Quantile(double q) const;
+    };
+    Snapshot Read() const;
+
+    static size_t BucketOf(uint64_t micros);
+    static uint64_t BucketMidpoint(size_t bucket);
+
+private:
+    struct alignas(64) Stripe {
+        std::atomic<uint64_t> count{ 0 };
+        std::atomic<uint64_t> sum{ 0 };
+        std::atomic<uint64_t> buckets[BUCKETS] = {};
+    };
+    std::unique_ptr<Stripe[]> m_stripes{ new Stripe[METRIC_STRIPES] };
+};
+
+// Records the time from construction to destruction into a histogram
+class MetricTimer {
+public:
+    explicit MetricTimer(MetricHistogram& histogram);
+    ~MetricTimer();
+
+    MetricTimer(const MetricTimer&) = delete;
+    MetricTimer& operator=(const MetricTimer&) = delete;
+
+private:
+    MetricHistogram& m_histogram;
+    uint64_t m_start;
+};
+
+// Monotonic microseconds, for callers timing something by hand
+uint64_t MetricNowMicros();
+
+// ============================================================================
+// Registry
+// ============================================================================
+// Metric names follow Prometheus conventions (snake_case, `_total` for
+// counters, `_seconds` for histograms, which are recorded in us and exported
+// in seconds). A name is bound to one kind on first use.
+// ============================================================================
+class MetricsRegistry {
+public:
+    static MetricsRegistry& instance();
+
+    MetricCounter& Counter(const std::string& name, const char* help, const MetricLabels& labels = {});
+    MetricGauge& Gauge(const std::string& name, const char* help, const MetricLabels& labels = {});
+    MetricHistogram& Histogram(const std::string& name, const char* help, const MetricLabels& labels = {});
+
+    // Prometheus text exposition format (histograms as summaries with
+    // 0.5/0.9/0.95/0.99 quantiles)
+    std::string RenderPrometheus() const;
+    // {"metrics":[{"name":..,"type":..,"labels":{..},"value":..}, ...]}
+    std::string RenderJson() const;
+
+private:
+    MetricsRegistry() = default;
+
+    enum class Kind { Counter, Gauge, Histogram };
+    struct Family {
+        std::string help;
+        Kind kind = Kind::Counter;
+        std::map<MetricLabels, std::unique_ptr<MetricCounter>> counters;
+        std::map<MetricLabels, std::unique_ptr<MetricGauge>> gauges;
+        std::map<MetricLabels, std::unique_ptr<MetricHistogram>> histograms;
+    };
+
+    mutable std::mutex m_mutex;   // Guards registration and rendering, not updates
+    std::map<std::string, Family> m_families;
+};
+
+inline MetricsRegistry& Metrics() { return MetricsRegistry::instance(); }
@@ -0,0 +1,138 @@
+#include "stdafx.h"
+#include "guids.h"
+#include "metrics.h"
+#include "metrics_export.h"
+#include "trace.h"
+
+#include <condition_variable>
+#include <fstream>
+#include <thread>
+
+extern int GetConfigMetricsInterval();
+extern int GetConfigMetricsFormat();
+extern std::string GetConfigMetricsPath();
+
+// GetConfigMetricsFormat() values
+static const int METRICS_FORMAT_PROMETHEUS = 0;
+
+static std::thread g_exporterThread;
+static std::mutex g_exporterMutex;
+static std::condition_variable g_exporterCv;
+static bool g_exporterStop = false;
+
+static bool WriteSnapshot(const std::string& path, const std::string& text) {
+    // Write beside the target and swap it in
+    std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+        out << text;
+        if (!out) return false;
+    }
+    return MoveFileExA(tmp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+static void ExporterThread() {
+    TraceSetThreadName("metrics exporter");
+    bool reportedFailure = false;
+    std::unique_lock<std::mutex> lock(g_exporterMutex);
+    while (!g_exporterStop) {
+        // Re-read every round so preference changes apply without a restart
+        int interval = GetConfigMetricsInterval();
+        if (interval <= 0) {
+            g_exporterCv.wait_for(lock, std::chrono::seconds(5));
+            continue;
+        }
+        if (g_exporterCv.wait_for(lock, std::chrono::seconds(interval), [] { return g_exporterStop; })) break;
+
+        lock.unlock();
+        bool json = GetConfigMetricsFormat() != METRICS_FORMAT_PROMETHEUS;
+        std::string path = GetConfigMetricsPath();
+        std::string text = json ? Metrics().RenderJson() : Metrics().RenderPrometheus();
+        bool ok = WriteSnapshot(path, text);
+        if (!ok && !reportedFailure) {
+            FB2K_console_formatter() << "[foo_downloader] Failed to write metrics to " << path.c_str();
+        }
+        reportedFailure = !ok;
+        lock.lock();
+    }
+}
+
+void StartMetricsExporter() {
+    std::lock_guard<std::mutex> lock(g_exporterMutex);
+    if (g_exporterThread.joinable()) return;
+    g_exporterStop = false;
+    g_exporterThread = std::thread(ExporterThread);
+}
+
+void StopMetricsExporter() {
+    {
+        std::lock_guard<std::mutex> lock(g_exporterMutex);
+        g_exporterStop = true;
+    }
+    g_exporterCv.notify_all();
+    if (g_exporterThread.joinable()) g_exporterThread.join();
+}
+
+void DumpMetricsToConsole() {
+    std::string text = Metrics().RenderPrometheus();
+    if (text.empty()) text = "(no metrics recorded yet)\n";
+    FB2K_console_formatter() << "[foo_downloader] Metrics:\n" << text.c_str();
+}
+
+// ============================================================================
+// Main menu: View > Downloader: dump metrics to console
+//            View > Downloader: save trace... (FOO_DOWNLOADER_TRACE builds)
+// ============================================================================
+
+namespace {
+
+enum { CMD_DUMP_METRICS = 0, CMD_SAVE_TRACE, CMD_COUNT };
+
+static void SaveTrace() {
+    pfc::string8 path;
+    if (!uGetOpenFileName(core_api::get_main_window(), "Chrome trace|*.json|All files|*.*", 0, "json",
+                          "Save trace", nullptr, path, TRUE)) {
+        return;
+    }
+    if (TraceWriteChromeJson(path.get_ptr())) {
+        FB2K_console_formatter() << "[foo_downloader] Trace written to " << path.get_ptr();
+    } else {
+        std::string message = std::string("Could not write the trace to ") + path.get_ptr();
+        popup_message::g_show(message.c_str(), "foo_downloader", popup_message::icon_error);
+    }
+}
+
+class DownloaderMetricsMenu : public mainmenu_commands {
+public:
+    t_uint32 get_command_count() override { return TRACE_ENABLED ? CMD_COUNT : CMD_SAVE_TRACE; }
+
+    GUID get_command(t_uint32 p_index) override {
+        return p_index == CMD_SAVE_TRACE ? guid_downloader_mainmenu_save_trace
+                                         : guid_downloader_mainmenu_dump_metrics;
+    }
+
+    void get_name(t_uint32 p_index, pfc::string_base& p_out) override {
+        p_out = p_index == CMD_SAVE_TRACE ? "Downloader: save trace..." : "Downloader: dump metrics to console";
+    }
+
+    bool get_description(t_uint32 p_index, pfc::string_base& p_out) override {
+        if (p_index == CMD_SAVE_TRACE) {
+            p_out = "Save the recorded pipeline spans as Chrome trace-event JSON (open in Perfetto)";
+        } else {
+            p_out = "Write the download manager's counters, gauges and latency histograms to the console";
+        }
+        return true;
+    }
+
+    GUID get_parent() override { return mainmenu_groups::view; }
+
+    void execute(t_uint32 p_index, service_ptr_t<service_base> p_callback) override {
+        if (p_index == CMD_SAVE_TRACE) SaveTrace();
+        else DumpMetricsToConsole();
+    }
+};
+
+static mainmenu_commands_factory_t<DownloaderMetricsMenu> g_metrics_menu_factory;
+
+} // namespace
@@ -0,0 +1,15 @@
+#pragma once
+
+// ============================================================================
+// Metrics snapshots
+// ============================================================================
+// A background thread writes MetricsRegistry to a file every N seconds
+// (Preferences > Tools > Downloader > Diagnostics), in Prometheus text format
+// for node_exporter's textfile collector or as JSON. The file is replaced
+// atomically so scrapers never read a partial snapshot.
+// ============================================================================
+void StartMetricsExporter();
+void StopMetricsExporter();
+
+// Prometheus text of the current values to the foobar2000 console
+void DumpMetricsToConsole();
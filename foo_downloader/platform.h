@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// Operating system services used by the download core
+// ============================================================================
+// Implemented once per OS: platform_win32.cpp (the component, and a Windows
+// build of the CLI) and platform_posix.cpp (Linux). Nothing here knows about
+// foobar2000; see host.h for what the embedding application provides.
+// ============================================================================
+
+// Monotonic milliseconds, for timeouts and stage timings
+uint64_t TickMs();
+void SleepMs(unsigned ms);
+
+// ----------------------------------------------------------------------------
+// Paths and files
+// ----------------------------------------------------------------------------
+
+extern const char PATH_SEPARATOR;
+
+// Directory of the running module (component DLL or executable), with a
+// trailing separator
+std::string ModuleDirectory();
+// The user's music folder
+std::string MusicDirectory();
+std::string JoinPath(const std::string& dir, const std::string& name);
+
+bool PathExists(const std::string& path);
+bool FileSizeOf(const std::string& path, uint64_t& size);
+// Create `path` and any missing parents; true if it exists afterwards
+bool MakeDirectory(const std::string& path);
+bool RemoveFile(const std::string& path);
+// Names of the regular files in `dir`, in no particular order
+std::vector<std::string> ListFiles(const std::string& dir);
+
+// Full path of a helper program (`name` without ".exe"). On Windows this is
+// always the copy next to the component, which may still have to be
+// downloaded; elsewhere the copy next to the executable, else the first one
+// on PATH, else the bare name.
+std::string FindTool(const std::string& name);
+// First `name` (without ".exe") on PATH, or "" if there is none
+std::string FindOnPath(const std::string& name);
+
+// ----------------------------------------------------------------------------
+// Child processes
+// ----------------------------------------------------------------------------
+
+// The arguments ChildProcess passes for `commandLine`, program first
+std::vector<std::string> SplitCommandLine(const std::string& commandLine);
+
+// A program started from a command line. Arguments are split the way the
+// Windows C runtime does it (whitespace-separated, double quotes group) on
+// every platform, so callers build one string for both, and no shell ever
+// sees it. Not copyable; closing the object does not stop the process.
+class ChildProcess {
+public:
+    ChildProcess() = default;
+    ~ChildProcess();
+    ChildProcess(ChildProcess&& other) noexcept;
+    ChildProcess& operator=(ChildProcess&& other) noexcept;
+    ChildProcess(const ChildProcess&) = delete;
+    ChildProcess& operator=(const ChildProcess&) = delete;
+
+    // With `captureOutput`, stdout and stderr go to one pipe read by
+    // ReadAvailable(); otherwise they are discarded. With `pipeInput`, stdin
+    // is a pipe fed by WriteInput(); otherwise it is empty.
+    bool Start(const std::string& commandLine, bool captureOutput, bool pipeInput = false);
+    bool IsStarted() const;
+
+    // Blocks until all of `data` is written; false if the process closed
+    // its stdin
+    bool WriteInput(const std::string& data);
+
+    // Append whatever output is buffered without blocking. Returns false once
+    // the pipe is closed and drained.
+    bool ReadAvailable(std::string& out);
+    // Block until some output arrives, then append what is buffered; same
+    // return value. May run on another thread than the other calls.
+    bool ReadSome(std::string& out);
+    // Non-blocking; true once the process has ended, with its exit code
+    bool HasExited(int& exitCode);
+    // Block up to `timeoutMs` for the process to end
+    bool Wait(int timeoutMs, int& exitCode);
+    void Terminate();
+
+private:
+    void Close();
+
+#ifdef _WIN32
+    void* m_process = nullptr;
+    void* m_stdout = nullptr;
+    void* m_stdin = nullptr;
+#else
+    int m_pid = -1;
+    int m_stdout = -1;
+    int m_stdin = -1;
+    bool m_reaped = false;
+    int m_exitCode = 0;
+#endif
+};
+
+// Kill leftover processes of the helper at `exePath` from an earlier session:
+// those running that executable with `argument` among their arguments, so a
+// copy the user started for something else is left alone. Windows does not
+// expose another process's arguments, so there only the path is matched.
+// Returns how many were killed.
+int KillHelperProcesses(const std::string& exePath, const std::string& argument);
+
+// ----------------------------------------------------------------------------
+// HTTP
+// ----------------------------------------------------------------------------
+
+struct HttpRequest {
+    std::string method = "GET";
+    std::string url;
+    std::string body;
+    std::vector<std::string> headers;   // "Name: value"
+    std::string userAgent = "foo_downloader/0.1";
+    bool verifyCertificate = true;
+    int timeoutMs = 30000;
+};
+
+// Body of the response, or "" if the request failed to complete
+std::string HttpFetch(const HttpRequest& request);
@@ -0,0 +1,427 @@
+#include "platform.h"
+
+#include <curl/curl.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <mutex>
+#include <utility>
+
+const char PATH_SEPARATOR = '/';
+
+uint64_t TickMs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+void SleepMs(unsigned ms) {
+    timespec ts = { (time_t)(ms / 1000), (long)(ms % 1000) * 1000000L };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR) {}
+}
+
+// ============================================================================
+// Paths and files
+// ============================================================================
+
+std::string ModuleDirectory() {
+    char path[PATH_MAX];
+    ssize_t len = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if (len <= 0) return "";
+    std::string dir(path, (size_t)len);
+    auto pos = dir.rfind('/');
+    return pos == std::string::npos ? "" : dir.substr(0, pos + 1);
+}
+
+std::string MusicDirectory() {
+    const char* xdg = getenv("XDG_MUSIC_DIR");
+    if (xdg && *xdg) return xdg;
+    const char* home = getenv("HOME");
+    return JoinPath(home && *home ? home : "/tmp", "Music");
+}
+
+std::string JoinPath(const std::string& dir, const std::string& name) {
+    if (dir.empty() || dir.back() == '/') return dir + name;
+    return dir + PATH_SEPARATOR + name;
+}
+
+bool PathExists(const std::string& path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+bool FileSizeOf(const std::string& path, uint64_t& size) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return false;
+    size = (uint64_t)st.st_size;
+    return true;
+}
+
+bool MakeDirectory(const std::string& path) {
+    for (size_t pos = 1; pos <= path.size(); pos++) {
+        if (pos < path.size() && path[pos] != '/') continue;
+        std::string prefix = path.substr(0, pos);
+        if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST) return false;
+    }
+    return PathExists(path);
+}
+
+bool RemoveFile(const std::string& path) {
+    return unlink(path.c_str()) == 0;
+}
+
+std::vector<std::string> ListFiles(const std::string& dir) {
+    std::vector<std::string> names;
+    DIR* d = opendir(dir.c_str());
+    if (!d) return names;
+    while (dirent* e = readdir(d)) {
+        struct stat st;
+        if (stat(JoinPath(dir, e->d_name).c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+            names.push_back(e->d_name);
+        }
+    }
+    closedir(d);
+    return names;
+}
+
+std::string FindTool(const std::string& name) {
+    std::string local = ModuleDirectory() + name;
+    if (access(local.c_str(), X_OK) == 0) return local;
+    std::string onPath = FindOnPath(name);
+    return onPath.empty() ? name : onPath;
+}
+
+std::string FindOnPath(const std::string& name) {
+    const char* pathEnv = getenv("PATH");
+    std::string dirs = pathEnv ? pathEnv : "";
+    size_t start = 0;
+    while (start <= dirs.size()) {
+        size_t end = dirs.find(':', start);
+        if (end == std::string::npos) end = dirs.size();
+        if (end > start) {
+            std::string candidate = JoinPath(dirs.substr(start, end - start), name);
+            if (access(candidate.c_str(), X_OK) == 0) return candidate;
+        }
+        start = end + 1;
+    }
+    return "";
+}
+
+// ============================================================================
+// Child processes
+// ============================================================================
+
+// Split a command line the way the MSVC runtime does for the common cases:
+// whitespace separates arguments, double quotes group, \" is a literal quote
+std::vector<std::string> SplitCommandLine(const std::string& cmd) {
+    std::vector<std::string> args;
+    std::string current;
+    bool inQuotes = false, hasArg = false;
+    for (size_t i = 0; i < cmd.size(); i++) {
+        char c = cmd[i];
+        if (c == '\\' && i + 1 < cmd.size() && cmd[i + 1] == '"') {
+            current += '"';
+            hasArg = true;
+            i++;
+        } else if (c == '"') {
+            inQuotes = !inQuotes;
+            hasArg = true;
+        } else if ((c == ' ' || c == '\t') && !inQuotes) {
+            if (hasArg) args.push_back(std::move(current));
+            current.clear();
+            hasArg = false;
+        } else {
+            current += c;
+            hasArg = true;
+        }
+    }
+    if (hasArg) args.push_back(std::move(current));
+    return args;
+}
+
+ChildProcess::~ChildProcess() {
+    Close();
+}
+
+ChildProcess::ChildProcess(ChildProcess&& other) noexcept {
+    *this = std::move(other);
+}
+
+ChildProcess& ChildProcess::operator=(ChildProcess&& other) noexcept {
+    if (this != &other) {
+        Close();
+        m_pid = other.m_pid;
+        m_stdout = other.m_stdout;
+        m_stdin = other.m_stdin;
+        m_reaped = other.m_reaped;
+        m_exitCode = other.m_exitCode;
+        other.m_pid = -1;
+        other.m_stdout = -1;
+        other.m_stdin = -1;
+    }
+    return *this;
+}
+
+void ChildProcess::Close() {
+    if (m_stdout >= 0) close(m_stdout);
+    if (m_stdin >= 0) close(m_stdin);
+    // A process that is still running is left alone; if it already ended,
+    // collect it so it does not linger as a zombie
+    if (m_pid > 0 && !m_reaped) waitpid(m_pid, nullptr, WNOHANG);
+    m_stdout = -1;
+    m_stdin = -1;
+    m_pid = -1;
+    m_reaped = false;
+}
+
+bool ChildProcess::Start(const std::string& commandLine, bool captureOutput, bool pipeInput) {
+    Close();
+
+    std::vector<std::string> args = SplitCommandLine(commandLine);
+    if (args.empty()) return false;
+    std::vector<char*> argv;
+    for (auto& a : args) argv.push_back(&a[0]);
+    argv.push_back(nullptr);
+
+    // Close-on-exec, so transfers started concurrently from other threads do
+    // not inherit each other's pipes (dup2 clears the flag on stdout/stderr)
+    int fds[2] = { -1, -1 };
+    int inFds[2] = { -1, -1 };
+    auto closePipes = [&]() {
+        for (int fd : { fds[0], fds[1], inFds[0], inFds[1] }) {
+            if (fd >= 0) close(fd);
+        }
+    };
+    if ((captureOutput && pipe2(fds, O_CLOEXEC) != 0) || (pipeInput && pipe2(inFds, O_CLOEXEC) != 0)) {
+        closePipes();
+        return false;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        closePipes();
+        return false;
+    }
+
+    if (pid == 0) {
+        int out = captureOutput ? fds[1] : open("/dev/null", O_WRONLY);
+        if (out >= 0) {
+            dup2(out, STDOUT_FILENO);
+            dup2(out, STDERR_FILENO);
+        }
+        int in = pipeInput ? inFds[0] : open("/dev/null", O_RDONLY);
+        if (in >= 0) dup2(in, STDIN_FILENO);
+        // Own process group, so a Ctrl+C meant for the daemon is not also
+        // delivered to every transfer
+        setpgid(0, 0);
+        execvp(argv[0], argv.data());
+        _exit(127);
+    }
+
+    if (captureOutput) {
+        close(fds[1]);
+        fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+        m_stdout = fds[0];
+    }
+    if (pipeInput) {
+        close(inFds[0]);
+        m_stdin = inFds[1];
+    }
+    m_pid = pid;
+    m_reaped = false;
+    return true;
+}
+
+bool ChildProcess::IsStarted() const {
+    return m_pid > 0;
+}
+
+bool ChildProcess::WriteInput(const std::string& data) {
+    if (m_stdin < 0) return false;
+
+    // A child that has gone away would raise SIGPIPE and end the whole
+    // program; hold it for this thread, and swallow it if it was raised
+    sigset_t pipeSet, oldSet;
+    sigemptyset(&pipeSet);
+    sigaddset(&pipeSet, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipeSet, &oldSet);
+
+    bool ok = true;
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t n = write(m_stdin, data.data() + written, data.size() - written);
+        if (n >= 0) {
+            written += (size_t)n;
+        } else if (errno != EINTR) {
+            ok = false;
+            break;
+        }
+    }
+
+    if (!ok && errno == EPIPE) {
+        timespec zero = { 0, 0 };
+        sigtimedwait(&pipeSet, nullptr, &zero);
+    }
+    pthread_sigmask(SIG_SETMASK, &oldSet, nullptr);
+    return ok;
+}
+
+bool ChildProcess::ReadAvailable(std::string& out) {
+    if (m_stdout < 0) return false;
+    char buf[4096];
+    for (;;) {
+        ssize_t n = read(m_stdout, buf, sizeof(buf));
+        if (n > 0) {
+            out.append(buf, (size_t)n);
+            continue;
+        }
+        if (n == 0) return false;                       // Closed and drained
+        if (errno == EINTR) continue;
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+}
+
+bool ChildProcess::ReadSome(std::string& out) {
+    if (m_stdout < 0) return false;
+    size_t before = out.size();
+    for (;;) {
+        if (!ReadAvailable(out)) return false;
+        if (out.size() > before) return true;
+        pollfd wait = { m_stdout, POLLIN, 0 };
+        if (poll(&wait, 1, -1) < 0 && errno != EINTR) return false;
+    }
+}
+
+bool ChildProcess::HasExited(int& exitCode) {
+    if (m_pid <= 0) return true;
+    if (!m_reaped) {
+        int status = 0;
+        pid_t rc = waitpid(m_pid, &status, WNOHANG);
+        if (rc == 0) return false;
+        m_reaped = true;
+        if (rc < 0) m_exitCode = -1;
+        else if (WIFEXITED(status)) m_exitCode = WEXITSTATUS(status);
+        else m_exitCode = 128 + (WIFSIGNALED(status) ? WTERMSIG(status) : 0);
+    }
+    exitCode = m_exitCode;
+    return true;
+}
+
+bool ChildProcess::Wait(int timeoutMs, int& exitCode) {
+    uint64_t deadline = TickMs() + (uint64_t)timeoutMs;
+    while (!HasExited(exitCode)) {
+        if (TickMs() >= deadline) return false;
+        SleepMs(10);
+    }
+    return true;
+}
+
+void ChildProcess::Terminate() {
+    if (m_pid <= 0 || m_reaped) return;
+    kill(m_pid, SIGKILL);
+    int status = 0;
+    if (waitpid(m_pid, &status, 0) == m_pid) {
+        m_reaped = true;
+        m_exitCode = 128 + SIGKILL;
+    }
+}
+
+static std::string RealPath(const std::string& path) {
+    char buf[PATH_MAX];
+    return realpath(path.c_str(), buf) ? std::string(buf) : std::string();
+}
+
+int KillHelperProcesses(const std::string& exePath, const std::string& argument) {
+    // /proc/<pid>/cmdline holds the NUL-separated arguments, /proc/<pid>/comm
+    // the executable name (truncated to 15 chars)
+    size_t slash = exePath.find_last_of('/');
+    std::string comm = exePath.substr(slash == std::string::npos ? 0 : slash + 1).substr(0, 15);
+    std::string target = RealPath(exePath);
+
+    DIR* proc = opendir("/proc");
+    if (!proc) return 0;
+    int killed = 0;
+    while (dirent* d = readdir(proc)) {
+        char* end = nullptr;
+        long pid = strtol(d->d_name, &end, 10);
+        if (*end != '\0' || pid <= 0 || pid == (long)getpid()) continue;
+
+        std::string dir = std::string("/proc/") + d->d_name;
+        std::ifstream c(dir + "/cmdline");
+        std::vector<std::string> args;
+        for (std::string arg; std::getline(c, arg, '\0');) args.push_back(arg);
+        if (std::find(args.begin(), args.end(), argument) == args.end()) continue;
+
+        bool same = false;
+        if (!target.empty()) {
+            // The executable itself, or the script an interpreter is running
+            same = RealPath(dir + "/exe") == target;
+            for (size_t i = 0; i < args.size() && i < 2 && !same; i++) same = RealPath(args[i]) == target;
+        } else {
+            std::ifstream f(dir + "/comm");
+            std::string procName;
+            same = std::getline(f, procName) && procName == comm;
+        }
+        if (same && kill((pid_t)pid, SIGTERM) == 0) killed++;
+    }
+    closedir(proc);
+    return killed;
+}
+
+// ============================================================================
+// HTTP (libcurl)
+// ============================================================================
+
+static size_t AppendBody(char* data, size_t size, size_t count, void* userdata) {
+    static_cast<std::string*>(userdata)->append(data, size * count);
+    return size * count;
+}
+
+std::string HttpFetch(const HttpRequest& request) {
+    static std::once_flag s_init;
+    std::call_once(s_init, [] { curl_global_init(CURL_GLOBAL_DEFAULT); });
+
+    std::string result;
+    CURL* curl = curl_easy_init();
+    if (!curl) return result;
+
+    curl_slist* headers = nullptr;
+    for (const auto& h : request.headers) headers = curl_slist_append(headers, h.c_str());
+
+    curl_easy_setopt(curl, CURLOPT_URL, request.url.c_str());
+    curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, request.method.c_str());
+    if (!request.body.empty() || request.method == "POST") {
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, request.body.c_str());
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, (long)request.body.size());
+    }
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, request.userAgent.c_str());
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, (long)request.timeoutMs);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);   // Called from worker threads
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_NOPROXY, "localhost,127.0.0.1,::1");
+    if (!request.verifyCertificate) {
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
+        curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
+    }
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, AppendBody);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &result);
+
+    if (curl_easy_perform(curl) != CURLE_OK) result.clear();
+
+    curl_slist_free_all(headers);
+    curl_easy_cleanup(curl);
+    return result;
+}
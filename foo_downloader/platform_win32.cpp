@@ -0,0 +1,395 @@
+#include "platform.h"
+
+#include <windows.h>
+#include <winhttp.h>
+#include <shellapi.h>
+#include <shlobj.h>
+#include <tlhelp32.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+#pragma comment(lib, "winhttp.lib")
+
+const char PATH_SEPARATOR = '\\';
+
+uint64_t TickMs() {
+    return GetTickCount64();
+}
+
+void SleepMs(unsigned ms) {
+    Sleep(ms);
+}
+
+// ============================================================================
+// Paths and files
+// ============================================================================
+
+std::string ModuleDirectory() {
+    char modulePath[MAX_PATH] = {};
+    HMODULE hMod = NULL;
+    GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                       (LPCSTR)&ModuleDirectory, &hMod);
+    if (!hMod) return "";
+    GetModuleFileNameA(hMod, modulePath, MAX_PATH);
+    std::string dir(modulePath);
+    auto pos = dir.find_last_of("\\/");
+    if (pos != std::string::npos) dir = dir.substr(0, pos + 1);
+    return dir;
+}
+
+std::string MusicDirectory() {
+    char musicPath[MAX_PATH] = {};
+    if (SHGetFolderPathA(NULL, CSIDL_MYMUSIC, NULL, 0, musicPath) == S_OK) return musicPath;
+    return "C:\\Music";
+}
+
+std::string JoinPath(const std::string& dir, const std::string& name) {
+    if (dir.empty() || dir.back() == '\\' || dir.back() == '/') return dir + name;
+    return dir + PATH_SEPARATOR + name;
+}
+
+bool PathExists(const std::string& path) {
+    return GetFileAttributesA(path.c_str()) != INVALID_FILE_ATTRIBUTES;
+}
+
+bool FileSizeOf(const std::string& path, uint64_t& size) {
+    WIN32_FILE_ATTRIBUTE_DATA attrs;
+    if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &attrs)) return false;
+    size = ((uint64_t)attrs.nFileSizeHigh << 32) | attrs.nFileSizeLow;
+    return true;
+}
+
+bool MakeDirectory(const std::string& path) {
+    // SHCreateDirectoryExA creates intermediate folders too
+    int rc = SHCreateDirectoryExA(NULL, path.c_str(), NULL);
+    return rc == ERROR_SUCCESS || rc == ERROR_ALREADY_EXISTS || rc == ERROR_FILE_EXISTS;
+}
+
+bool RemoveFile(const std::string& path) {
+    return DeleteFileA(path.c_str()) != 0;
+}
+
+std::vector<std::string> ListFiles(const std::string& dir) {
+    std::vector<std::string> names;
+    WIN32_FIND_DATAA fd;
+    HANDLE hFind = FindFirstFileA(JoinPath(dir, "*").c_str(), &fd);
+    if (hFind == INVALID_HANDLE_VALUE) return names;
+    do {
+        if (!(fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) names.push_back(fd.cFileName);
+    } while (FindNextFileA(hFind, &fd));
+    FindClose(hFind);
+    return names;
+}
+
+std::string FindTool(const std::string& name) {
+    // Always the copy next to the DLL; a missing one is downloaded there
+    return ModuleDirectory() + name + ".exe";
+}
+
+std::string FindOnPath(const std::string& name) {
+    char found[MAX_PATH] = {};
+    DWORD len = SearchPathA(NULL, name.c_str(), ".exe", MAX_PATH, found, NULL);
+    if (len == 0 || len >= MAX_PATH) return "";
+    return found;
+}
+
+// ============================================================================
+// Child processes
+// ============================================================================
+
+std::vector<std::string> SplitCommandLine(const std::string& commandLine) {
+    // CreateProcessA hands the child the ANSI command line, which its C
+    // runtime splits as CommandLineToArgvW does
+    std::vector<std::string> args;
+    int wlen = MultiByteToWideChar(CP_ACP, 0, commandLine.c_str(), -1, nullptr, 0);
+    if (wlen <= 1) return args;
+    std::wstring wide(wlen, L'\0');
+    MultiByteToWideChar(CP_ACP, 0, commandLine.c_str(), -1, &wide[0], wlen);
+
+    int argc = 0;
+    LPWSTR* argv = CommandLineToArgvW(wide.c_str(), &argc);
+    if (!argv) return args;
+    for (int i = 0; i < argc; i++) {
+        int len = WideCharToMultiByte(CP_ACP, 0, argv[i], -1, nullptr, 0, nullptr, nullptr);
+        std::string arg(len > 0 ? len - 1 : 0, '\0');
+        if (len > 1) WideCharToMultiByte(CP_ACP, 0, argv[i], -1, &arg[0], len, nullptr, nullptr);
+        args.push_back(std::move(arg));
+    }
+    LocalFree(argv);
+    return args;
+}
+
+ChildProcess::~ChildProcess() {
+    Close();
+}
+
+ChildProcess::ChildProcess(ChildProcess&& other) noexcept {
+    *this = std::move(other);
+}
+
+ChildProcess& ChildProcess::operator=(ChildProcess&& other) noexcept {
+    if (this != &other) {
+        Close();
+        m_process = other.m_process;
+        m_stdout = other.m_stdout;
+        m_stdin = other.m_stdin;
+        other.m_process = nullptr;
+        other.m_stdout = nullptr;
+        other.m_stdin = nullptr;
+    }
+    return *this;
+}
+
+void ChildProcess::Close() {
+    if (m_stdout) CloseHandle(m_stdout);
+    if (m_stdin) CloseHandle(m_stdin);
+    if (m_process) CloseHandle(m_process);
+    m_stdout = m_stdin = m_process = nullptr;
+}
+
+bool ChildProcess::Start(const std::string& commandLine, bool captureOutput, bool pipeInput) {
+    Close();
+
+    SECURITY_ATTRIBUTES sa = {};
+    sa.nLength = sizeof(sa);
+    sa.bInheritHandle = TRUE;
+
+    HANDLE hReadPipe = NULL, hWritePipe = NULL;
+    HANDLE hInRead = NULL, hInWrite = NULL;
+    auto closePipes = [&]() {
+        for (HANDLE h : { hReadPipe, hWritePipe, hInRead, hInWrite }) {
+            if (h) CloseHandle(h);
+        }
+    };
+    if (captureOutput) {
+        if (!CreatePipe(&hReadPipe, &hWritePipe, &sa, 0)) return false;
+        SetHandleInformation(hReadPipe, HANDLE_FLAG_INHERIT, 0);
+    }
+    if (pipeInput) {
+        if (!CreatePipe(&hInRead, &hInWrite, &sa, 0)) {
+            closePipes();
+            return false;
+        }
+        SetHandleInformation(hInWrite, HANDLE_FLAG_INHERIT, 0);
+    }
+
+    STARTUPINFOA si = {};
+    si.cb = sizeof(si);
+    si.dwFlags = STARTF_USESHOWWINDOW;
+    si.wShowWindow = SW_HIDE;
+    if (captureOutput || pipeInput) {
+        si.dwFlags |= STARTF_USESTDHANDLES;
+        si.hStdOutput = hWritePipe;
+        si.hStdError = hWritePipe;
+        si.hStdInput = hInRead;
+    }
+
+    PROCESS_INFORMATION pi = {};
+    std::vector<char> cmdBuf(commandLine.begin(), commandLine.end());
+    cmdBuf.push_back(0);
+
+    BOOL inherit = (captureOutput || pipeInput) ? TRUE : FALSE;
+    if (!CreateProcessA(NULL, cmdBuf.data(), NULL, NULL, inherit, CREATE_NO_WINDOW,
+                        NULL, NULL, &si, &pi)) {
+        closePipes();
+        return false;
+    }
+
+    // Close the child's ends in the parent
+    if (hWritePipe) CloseHandle(hWritePipe);
+    if (hInRead) CloseHandle(hInRead);
+    CloseHandle(pi.hThread);
+    m_process = pi.hProcess;
+    m_stdout = hReadPipe;
+    m_stdin = hInWrite;
+    return true;
+}
+
+bool ChildProcess::IsStarted() const {
+    return m_process != nullptr;
+}
+
+bool ChildProcess::WriteInput(const std::string& data) {
+    if (!m_stdin) return false;
+    size_t written = 0;
+    while (written < data.size()) {
+        DWORD n = 0;
+        DWORD chunk = (DWORD)std::min<size_t>(data.size() - written, 1 << 20);
+        if (!WriteFile(m_stdin, data.data() + written, chunk, &n, NULL)) return false;
+        written += n;
+    }
+    return true;
+}
+
+bool ChildProcess::ReadAvailable(std::string& out) {
+    if (!m_stdout) return false;
+    DWORD avail = 0;
+    while (PeekNamedPipe(m_stdout, NULL, 0, NULL, &avail, NULL)) {
+        if (avail == 0) return true;
+        char buf[4096];
+        DWORD toRead = (avail < sizeof(buf)) ? avail : (DWORD)sizeof(buf);
+        DWORD bytesRead = 0;
+        if (!ReadFile(m_stdout, buf, toRead, &bytesRead, NULL) || bytesRead == 0) return false;
+        out.append(buf, bytesRead);
+    }
+    return false;   // Broken pipe: the process closed its end
+}
+
+bool ChildProcess::ReadSome(std::string& out) {
+    if (!m_stdout) return false;
+    char buf[4096];
+    DWORD bytesRead = 0;
+    if (!ReadFile(m_stdout, buf, (DWORD)sizeof(buf), &bytesRead, NULL) || bytesRead == 0) return false;
+    out.append(buf, bytesRead);
+    return ReadAvailable(out);
+}
+
+bool ChildProcess::HasExited(int& exitCode) {
+    if (!m_process) return true;
+    DWORD code = STILL_ACTIVE;
+    if (!GetExitCodeProcess(m_process, &code) || code == STILL_ACTIVE) return false;
+    exitCode = (int)code;
+    return true;
+}
+
+bool ChildProcess::Wait(int timeoutMs, int& exitCode) {
+    if (!m_process) return true;
+    if (WaitForSingleObject(m_process, (DWORD)timeoutMs) != WAIT_OBJECT_0) return false;
+    return HasExited(exitCode);
+}
+
+void ChildProcess::Terminate() {
+    if (m_process) TerminateProcess(m_process, 1);
+}
+
+int KillHelperProcesses(const std::string& exePath, const std::string& argument) {
+    (void)argument;
+    int wlen = MultiByteToWideChar(CP_ACP, 0, exePath.c_str(), -1, nullptr, 0);
+    if (wlen <= 1) return 0;
+    std::wstring path(wlen, L'\0');
+    MultiByteToWideChar(CP_ACP, 0, exePath.c_str(), -1, &path[0], wlen);
+    path.resize(wlen - 1);
+    size_t slash = path.find_last_of(L"\\/");
+    std::wstring exe = path.substr(slash == std::wstring::npos ? 0 : slash + 1);
+
+    int killed = 0;
+    HANDLE hSnap = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+    if (hSnap == INVALID_HANDLE_VALUE) return 0;
+    PROCESSENTRY32W pe = {};
+    pe.dwSize = sizeof(pe);
+    if (Process32FirstW(hSnap, &pe)) {
+        do {
+            if (_wcsicmp(pe.szExeFile, exe.c_str()) != 0) continue;
+            HANDLE hProc = OpenProcess(PROCESS_TERMINATE | PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pe.th32ProcessID);
+            if (!hProc) continue;
+            wchar_t image[MAX_PATH];
+            DWORD len = MAX_PATH;
+            if (QueryFullProcessImageNameW(hProc, 0, image, &len) && _wcsicmp(image, path.c_str()) == 0) {
+                if (TerminateProcess(hProc, 0)) killed++;
+            }
+            CloseHandle(hProc);
+        } while (Process32NextW(hSnap, &pe));
+    }
+    CloseHandle(hSnap);
+    return killed;
+}
+
+// ============================================================================
+// HTTP (WinHTTP)
+// ============================================================================
+
+std::string HttpFetch(const HttpRequest& request) {
+    std::string result;
+
+    // Parse URL: scheme://host[:port]/path
+    size_t schemeEnd = request.url.find("://");
+    if (schemeEnd == std::string::npos) return result;
+    bool useSSL = request.url.compare(0, schemeEnd, "https") == 0;
+    int port = useSSL ? 443 : 80;
+
+    std::string host, path;
+    size_t hostStart = schemeEnd + 3;
+    size_t pathStart = request.url.find('/', hostStart);
+    if (pathStart == std::string::npos) {
+        host = request.url.substr(hostStart);
+        path = "/";
+    } else {
+        host = request.url.substr(hostStart, pathStart - hostStart);
+        path = request.url.substr(pathStart);
+    }
+    size_t colonPos = host.find(':');
+    if (colonPos != std::string::npos) {
+        port = atoi(host.c_str() + colonPos + 1);
+        host = host.substr(0, colonPos);
+    }
+
+    std::wstring wAgent(request.userAgent.begin(), request.userAgent.end());
+    HINTERNET hSession = WinHttpOpen(
+        wAgent.c_str(),
+        WINHTTP_ACCESS_TYPE_NO_PROXY,
+        WINHTTP_NO_PROXY_NAME,
+        WINHTTP_NO_PROXY_BYPASS,
+        0);
+    if (!hSession) return result;
+    WinHttpSetTimeouts(hSession, request.timeoutMs, request.timeoutMs, request.timeoutMs, request.timeoutMs);
+
+    std::wstring wHost(host.begin(), host.end());
+    HINTERNET hConnect = WinHttpConnect(hSession, wHost.c_str(), static_cast<INTERNET_PORT>(port), 0);
+    if (!hConnect) {
+        WinHttpCloseHandle(hSession);
+        return result;
+    }
+
+    std::wstring wMethod(request.method.begin(), request.method.end());
+    std::wstring wPath(path.begin(), path.end());
+    HINTERNET hRequest = WinHttpOpenRequest(
+        hConnect, wMethod.c_str(), wPath.c_str(),
+        nullptr, WINHTTP_NO_REFERER,
+        WINHTTP_DEFAULT_ACCEPT_TYPES,
+        useSSL ? WINHTTP_FLAG_SECURE : 0);
+    if (!hRequest) {
+        WinHttpCloseHandle(hConnect);
+        WinHttpCloseHandle(hSession);
+        return result;
+    }
+
+    if (useSSL && !request.verifyCertificate) {
+        DWORD secFlags = SECURITY_FLAG_IGNORE_UNKNOWN_CA |
+                         SECURITY_FLAG_IGNORE_CERT_DATE_INVALID |
+                         SECURITY_FLAG_IGNORE_CERT_CN_INVALID;
+        WinHttpSetOption(hRequest, WINHTTP_OPTION_SECURITY_FLAGS, &secFlags, sizeof(secFlags));
+    }
+
+    for (const auto& h : request.headers) {
+        std::wstring wHeader(h.begin(), h.end());
+        WinHttpAddRequestHeaders(hRequest, wHeader.c_str(), (DWORD)-1,
+                                 WINHTTP_ADDREQ_FLAG_ADD | WINHTTP_ADDREQ_FLAG_REPLACE);
+    }
+
+    BOOL ok = WinHttpSendRequest(
+        hRequest,
+        WINHTTP_NO_ADDITIONAL_HEADERS, 0,
+        request.body.empty() ? WINHTTP_NO_REQUEST_DATA : (LPVOID)request.body.c_str(),
+        (DWORD)request.body.size(),
+        (DWORD)request.body.size(),
+        0);
+    if (ok) ok = WinHttpReceiveResponse(hRequest, nullptr);
+
+    if (ok) {
+        DWORD bytesAvailable = 0;
+        while (WinHttpQueryDataAvailable(hRequest, &bytesAvailable) && bytesAvailable > 0) {
+            std::vector<char> buffer(bytesAvailable);
+            DWORD bytesRead = 0;
+            if (WinHttpReadData(hRequest, buffer.data(), bytesAvailable, &bytesRead)) {
+                result.append(buffer.data(), bytesRead);
+            }
+        }
+    }
+
+    WinHttpCloseHandle(hRequest);
+    WinHttpCloseHandle(hConnect);
+    WinHttpCloseHandle(hSession);
+    return result;
+}
@@ -1,5 +1,6 @@
 #include "stdafx.h"
 #include "playlist_utils.h"
+#include "trace.h"
 
 // Declared in preferences.cpp
 extern const char* GetConfigPlaylistName();
@@ -27,6 +28,7 @@ size_t FindOrCreateDownloadedPlaylist() {
 }
 
 void AddToDownloadedPlaylist(const std::string& filePath) {
+    TRACE_SCOPE("AddToDownloadedPlaylist");
     if (filePath.empty()) return;
 
     // Check if auto-add is enabled
@@ -9,6 +9,7 @@
 #include <helpers/DarkMode.h>
 
 #include "aria2_rpc.h"
+#include "metrics_export.h"
 #include "sources/source_youtube.h"
 
 // ============================================================================
@@ -19,6 +20,7 @@
 static cfg_string cfg_output_folder(guid_cfg_output_folder, "");
 static cfg_uint   cfg_max_concurrent(guid_cfg_max_concurrent, 3);
 static cfg_uint   cfg_retry_count(guid_cfg_retry_count, 3);
+static cfg_uint   cfg_duplicate_policy(guid_cfg_duplicate_policy, 0);   // 0 = ask, 1 = skip, 2 = download again
 
 // Playlist
 static cfg_string cfg_playlist_name(guid_cfg_playlist_name, "Downloaded");
@@ -28,6 +30,7 @@ static cfg_bool   cfg_auto_playlist(guid_cfg_auto_playlist, true);
 static cfg_bool   cfg_enable_custom_source(guid_cfg_enable_custom_source, true);
 static cfg_bool   cfg_enable_youtube(guid_cfg_enable_youtube, true);
 static cfg_bool   cfg_enable_direct_url(guid_cfg_enable_direct_url, true);
+static cfg_bool   cfg_search_prefetch(guid_cfg_search_prefetch, false);
 
 
 // Custom Source
@@ -38,10 +41,21 @@ static cfg_string cfg_ytdlp_path(guid_cfg_ytdlp_path, "");
 static cfg_uint   cfg_yt_quality(guid_cfg_yt_quality, 0);
 static cfg_bool   cfg_embed_metadata(guid_cfg_embed_metadata, true);
 static cfg_string cfg_ytdlp_extra_flags(guid_cfg_ytdlp_extra_flags, "");
+static cfg_uint   cfg_ytdlp_max_jobs(guid_cfg_ytdlp_max_jobs, 0);   // 0 = auto
+static cfg_bool   cfg_ytdlp_worker(guid_cfg_ytdlp_worker, true);
+static cfg_string cfg_python_path(guid_cfg_python_path, "");
+static cfg_bool   cfg_ytdlp_via_aria2(guid_cfg_ytdlp_via_aria2, false);
 
 // aria2
 static cfg_string cfg_aria2_path(guid_cfg_aria2_path, "");
 static cfg_uint   cfg_aria2_port(guid_cfg_aria2_port, 6800);
+static cfg_uint   cfg_aria2_max_per_host(guid_cfg_aria2_max_per_host, 2);
+static cfg_uint   cfg_aria2_host_gap_ms(guid_cfg_aria2_host_gap_ms, 500);
+
+// Diagnostics
+static cfg_uint   cfg_metrics_interval(guid_cfg_metrics_interval, 0);   // Seconds, 0 = off
+static cfg_uint   cfg_metrics_format(guid_cfg_metrics_format, 0);       // 0 = Prometheus, 1 = JSON
+static cfg_string cfg_metrics_path(guid_cfg_metrics_path, "");
 
 // ============================================================================
 // Quality labels (same order as source_youtube.cpp)
@@ -62,6 +76,21 @@ static const char* g_pref_quality_labels[] = {
 };
 static const int g_numPrefQualities = sizeof(g_pref_quality_labels) / sizeof(g_pref_quality_labels[0]);
 
+// Already-downloaded policy labels (values of cfg_duplicate_policy)
+static const char* g_duplicate_policy_labels[] = {
+    "Ask",
+    "Skip",
+    "Download again",
+};
+static const int g_numDuplicatePolicies = sizeof(g_duplicate_policy_labels) / sizeof(g_duplicate_policy_labels[0]);
+
+// Metrics file format labels (values of cfg_metrics_format)
+static const char* g_metrics_format_labels[] = {
+    "Prometheus text",
+    "JSON",
+};
+static const int g_numMetricsFormats = sizeof(g_metrics_format_labels) / sizeof(g_metrics_format_labels[0]);
+
 // ============================================================================
 // Helper: get the directory containing our component DLL
 // ============================================================================
@@ -91,13 +120,37 @@ bool GetConfigEnableCustomSource() { return cfg_enable_custom_source && strlen(c
 const char* GetConfigCustomSourceUrl() { return cfg_custom_source_url; }
 bool GetConfigEnableYoutube() { return cfg_enable_youtube; }
 bool GetConfigEnableDirectUrl() { return cfg_enable_direct_url; }
+bool GetConfigSearchPrefetch() { return cfg_search_prefetch; }
 const char* GetConfigYtDlpPath() { return cfg_ytdlp_path; }
 int GetConfigYtQuality() { return (int)cfg_yt_quality.get(); }
 bool GetConfigEmbedMetadata() { return cfg_embed_metadata; }
 const char* GetConfigYtDlpExtraFlags() { return cfg_ytdlp_extra_flags; }
+bool GetConfigYtDlpWorker() { return cfg_ytdlp_worker; }
+const char* GetConfigPythonPath() { return cfg_python_path; }
+bool GetConfigYtDlpViaAria2() { return cfg_ytdlp_via_aria2; }
 const char* GetConfigAria2Path() { return cfg_aria2_path; }
 int GetConfigAria2Port() { return (int)cfg_aria2_port.get(); }
 int GetConfigRetryCount() { return (int)cfg_retry_count.get(); }
+int GetConfigDuplicatePolicy() { return (int)cfg_duplicate_policy.get(); }
+int GetConfigAria2MaxPerHost() { return (int)cfg_aria2_max_per_host.get(); }
+int GetConfigAria2HostGapMs() { return (int)cfg_aria2_host_gap_ms.get(); }
+
+int GetConfigMetricsInterval() { return (int)cfg_metrics_interval.get(); }
+int GetConfigMetricsFormat() { return (int)cfg_metrics_format.get(); }
+
+std::string GetConfigMetricsPath() {
+    if (strlen(cfg_metrics_path) > 0) return cfg_metrics_path.get_ptr();
+    return GetComponentDir() + (cfg_metrics_format.get() == 1 ? "metrics.json" : "metrics.prom");
+}
+
+int GetConfigYtDlpMaxJobs() {
+    int jobs = (int)cfg_ytdlp_max_jobs.get();
+    if (jobs > 0) return jobs;
+    // Each job is a Python interpreter plus an ffmpeg transcode; leave half
+    // the cores for everything else.
+    int cores = (int)std::thread::hardware_concurrency();
+    return cores >= 2 ? cores / 2 : 1;
+}
 
 namespace {
 
@@ -130,12 +183,17 @@ public:
         UINT retryCount = GetDlgItemInt(IDC_RETRY_COUNT, nullptr, FALSE);
         if (retryCount <= 99) cfg_retry_count = retryCount;
 
+        CComboBox dupCombo(GetDlgItem(IDC_DUPLICATE_POLICY));
+        int dupIdx = dupCombo.GetCurSel();
+        if (dupIdx >= 0 && dupIdx < g_numDuplicatePolicies) cfg_duplicate_policy = (t_uint32)dupIdx;
+
         cfg_auto_playlist = (IsDlgButtonChecked(IDC_AUTO_ADD_PLAYLIST) == BST_CHECKED);
         if (playlistName.length() > 0) cfg_playlist_name = playlistName;
 
         cfg_enable_custom_source = (IsDlgButtonChecked(IDC_ENABLE_CUSTOM_SOURCE) == BST_CHECKED);
         cfg_enable_youtube = (IsDlgButtonChecked(IDC_ENABLE_YOUTUBE) == BST_CHECKED);
         cfg_enable_direct_url = (IsDlgButtonChecked(IDC_ENABLE_DIRECT_URL) == BST_CHECKED);
+        cfg_search_prefetch = (IsDlgButtonChecked(IDC_SEARCH_PREFETCH) == BST_CHECKED);
 
         // Apply output dir to aria2
         auto& aria2 = Aria2RpcClient::instance();
@@ -149,11 +207,14 @@ public:
         uSetDlgItemText(*this, IDC_OUTPUT_FOLDER, GetDefaultOutputFolder().c_str());
         SetDlgItemInt(IDC_MAX_CONCURRENT, 3, FALSE);
         SetDlgItemInt(IDC_RETRY_COUNT, 3, FALSE);
+        CComboBox dupCombo(GetDlgItem(IDC_DUPLICATE_POLICY));
+        dupCombo.SetCurSel(0);
         CheckDlgButton(IDC_AUTO_ADD_PLAYLIST, BST_CHECKED);
         uSetDlgItemText(*this, IDC_PLAYLIST_NAME, "Downloaded");
         CheckDlgButton(IDC_ENABLE_CUSTOM_SOURCE, BST_CHECKED);
         CheckDlgButton(IDC_ENABLE_YOUTUBE, BST_CHECKED);
         CheckDlgButton(IDC_ENABLE_DIRECT_URL, BST_CHECKED);
+        CheckDlgButton(IDC_SEARCH_PREFETCH, BST_UNCHECKED);
         OnChanged();
     }
 
@@ -164,11 +225,13 @@ public:
         COMMAND_HANDLER_EX(IDC_OUTPUT_FOLDER, EN_CHANGE, OnEditChange)
         COMMAND_HANDLER_EX(IDC_MAX_CONCURRENT, EN_CHANGE, OnEditChange)
         COMMAND_HANDLER_EX(IDC_RETRY_COUNT, EN_CHANGE, OnEditChange)
+        COMMAND_HANDLER_EX(IDC_DUPLICATE_POLICY, CBN_SELCHANGE, OnEditChange)
         COMMAND_HANDLER_EX(IDC_PLAYLIST_NAME, EN_CHANGE, OnEditChange)
         COMMAND_HANDLER_EX(IDC_AUTO_ADD_PLAYLIST, BN_CLICKED, OnEditChange)
         COMMAND_HANDLER_EX(IDC_ENABLE_CUSTOM_SOURCE, BN_CLICKED, OnEditChange)
         COMMAND_HANDLER_EX(IDC_ENABLE_YOUTUBE, BN_CLICKED, OnEditChange)
         COMMAND_HANDLER_EX(IDC_ENABLE_DIRECT_URL, BN_CLICKED, OnEditChange)
+        COMMAND_HANDLER_EX(IDC_SEARCH_PREFETCH, BN_CLICKED, OnEditChange)
     END_MSG_MAP()
 
 private:
@@ -189,11 +252,20 @@ private:
         uSetDlgItemText(*this, IDC_OUTPUT_FOLDER, folder);
         SetDlgItemInt(IDC_MAX_CONCURRENT, (UINT)cfg_max_concurrent.get(), FALSE);
         SetDlgItemInt(IDC_RETRY_COUNT, (UINT)cfg_retry_count.get(), FALSE);
+
+        CComboBox dupCombo(GetDlgItem(IDC_DUPLICATE_POLICY));
+        for (int i = 0; i < g_numDuplicatePolicies; i++) {
+            dupCombo.AddString(pfc::stringcvt::string_wide_from_utf8(g_duplicate_policy_labels[i]));
+        }
+        int dupIdx = (int)cfg_duplicate_policy.get();
+        dupCombo.SetCurSel(dupIdx < g_numDuplicatePolicies ? dupIdx : 0);
+
         CheckDlgButton(IDC_AUTO_ADD_PLAYLIST, cfg_auto_playlist ? BST_CHECKED : BST_UNCHECKED);
         uSetDlgItemText(*this, IDC_PLAYLIST_NAME, cfg_playlist_name);
         CheckDlgButton(IDC_ENABLE_CUSTOM_SOURCE, cfg_enable_custom_source ? BST_CHECKED : BST_UNCHECKED);
         CheckDlgButton(IDC_ENABLE_YOUTUBE, cfg_enable_youtube ? BST_CHECKED : BST_UNCHECKED);
         CheckDlgButton(IDC_ENABLE_DIRECT_URL, cfg_enable_direct_url ? BST_CHECKED : BST_UNCHECKED);
+        CheckDlgButton(IDC_SEARCH_PREFETCH, cfg_search_prefetch ? BST_CHECKED : BST_UNCHECKED);
         return FALSE;
     }
 
@@ -230,19 +302,24 @@ private:
         uGetDlgItemText(*this, IDC_PLAYLIST_NAME, playlistName);
         UINT maxDl = GetDlgItemInt(IDC_MAX_CONCURRENT, nullptr, FALSE);
         UINT retryCount = GetDlgItemInt(IDC_RETRY_COUNT, nullptr, FALSE);
+        CComboBox dupCombo(GetDlgItem(IDC_DUPLICATE_POLICY));
+        int dupIdx = dupCombo.GetCurSel();
         bool autoPlaylist = (IsDlgButtonChecked(IDC_AUTO_ADD_PLAYLIST) == BST_CHECKED);
         bool enCustom = (IsDlgButtonChecked(IDC_ENABLE_CUSTOM_SOURCE) == BST_CHECKED);
         bool enYt = (IsDlgButtonChecked(IDC_ENABLE_YOUTUBE) == BST_CHECKED);
         bool enDirect = (IsDlgButtonChecked(IDC_ENABLE_DIRECT_URL) == BST_CHECKED);
+        bool prefetch = (IsDlgButtonChecked(IDC_SEARCH_PREFETCH) == BST_CHECKED);
 
         return strcmp(folder, cfg_output_folder) != 0
             || strcmp(playlistName, cfg_playlist_name) != 0
             || maxDl != cfg_max_concurrent.get()
             || retryCount != cfg_retry_count.get()
+            || (dupIdx >= 0 && (t_uint32)dupIdx != cfg_duplicate_policy.get())
             || autoPlaylist != (bool)cfg_auto_playlist
             || enCustom != (bool)cfg_enable_custom_source
             || enYt != (bool)cfg_enable_youtube
-            || enDirect != (bool)cfg_enable_direct_url;
+            || enDirect != (bool)cfg_enable_direct_url
+            || prefetch != (bool)cfg_search_prefetch;
     }
 
     void OnChanged() { m_callback->on_state_changed(); }
@@ -281,6 +358,15 @@ public:
         }
 
         cfg_embed_metadata = (IsDlgButtonChecked(IDC_EMBED_METADATA) == BST_CHECKED);
+
+        UINT maxJobs = GetDlgItemInt(IDC_YTDLP_MAX_JOBS, nullptr, FALSE);
+        if (maxJobs <= 64) cfg_ytdlp_max_jobs = maxJobs;
+
+        cfg_ytdlp_worker = (IsDlgButtonChecked(IDC_YTDLP_WORKER) == BST_CHECKED);
+        pfc::string8 pythonPath;
+        uGetDlgItemText(*this, IDC_PYTHON_PATH, pythonPath);
+        cfg_python_path = pythonPath;
+        cfg_ytdlp_via_aria2 = (IsDlgButtonChecked(IDC_YTDLP_VIA_ARIA2) == BST_CHECKED);
         OnChanged();
     }
 
@@ -291,6 +377,10 @@ public:
         CComboBox qualCombo(GetDlgItem(IDC_YT_DEFAULT_QUALITY));
         qualCombo.SetCurSel(0);
         CheckDlgButton(IDC_EMBED_METADATA, BST_CHECKED);
+        SetDlgItemInt(IDC_YTDLP_MAX_JOBS, 0, FALSE);
+        CheckDlgButton(IDC_YTDLP_WORKER, BST_CHECKED);
+        uSetDlgItemText(*this, IDC_PYTHON_PATH, "");
+        CheckDlgButton(IDC_YTDLP_VIA_ARIA2, BST_UNCHECKED);
         OnChanged();
     }
 
@@ -301,6 +391,10 @@ public:
         COMMAND_HANDLER_EX(IDC_YTDLP_EXTRA_FLAGS, EN_CHANGE, OnEditChange)
         COMMAND_HANDLER_EX(IDC_YT_DEFAULT_QUALITY, CBN_SELCHANGE, OnEditChange)
         COMMAND_HANDLER_EX(IDC_EMBED_METADATA, BN_CLICKED, OnEditChange)
+        COMMAND_HANDLER_EX(IDC_YTDLP_MAX_JOBS, EN_CHANGE, OnEditChange)
+        COMMAND_HANDLER_EX(IDC_YTDLP_WORKER, BN_CLICKED, OnEditChange)
+        COMMAND_HANDLER_EX(IDC_PYTHON_PATH, EN_CHANGE, OnEditChange)
+        COMMAND_HANDLER_EX(IDC_YTDLP_VIA_ARIA2, BN_CLICKED, OnEditChange)
     END_MSG_MAP()
 
 private:
@@ -326,6 +420,10 @@ private:
         qualCombo.SetCurSel(selQual);
 
         CheckDlgButton(IDC_EMBED_METADATA, cfg_embed_metadata ? BST_CHECKED : BST_UNCHECKED);
+        SetDlgItemInt(IDC_YTDLP_MAX_JOBS, (UINT)cfg_ytdlp_max_jobs.get(), FALSE);
+        CheckDlgButton(IDC_YTDLP_WORKER, cfg_ytdlp_worker ? BST_CHECKED : BST_UNCHECKED);
+        uSetDlgItemText(*this, IDC_PYTHON_PATH, cfg_python_path);
+        CheckDlgButton(IDC_YTDLP_VIA_ARIA2, cfg_ytdlp_via_aria2 ? BST_CHECKED : BST_UNCHECKED);
         return FALSE;
     }
 
@@ -347,11 +445,20 @@ private:
         int qualIdx = qualCombo.GetCurSel();
         if (qualIdx < 0) qualIdx = 0;
         bool embedMeta = (IsDlgButtonChecked(IDC_EMBED_METADATA) == BST_CHECKED);
+        UINT maxJobs = GetDlgItemInt(IDC_YTDLP_MAX_JOBS, nullptr, FALSE);
+        bool worker = (IsDlgButtonChecked(IDC_YTDLP_WORKER) == BST_CHECKED);
+        pfc::string8 pythonPath;
+        uGetDlgItemText(*this, IDC_PYTHON_PATH, pythonPath);
+        bool viaAria2 = (IsDlgButtonChecked(IDC_YTDLP_VIA_ARIA2) == BST_CHECKED);
 
         return strcmp(ytdlpPath, cfg_ytdlp_path) != 0
             || strcmp(extraFlags, cfg_ytdlp_extra_flags) != 0
             || (UINT)qualIdx != cfg_yt_quality.get()
-            || embedMeta != (bool)cfg_embed_metadata;
+            || embedMeta != (bool)cfg_embed_metadata
+            || maxJobs != cfg_ytdlp_max_jobs.get()
+            || worker != (bool)cfg_ytdlp_worker
+            || strcmp(pythonPath, cfg_python_path) != 0
+            || viaAria2 != (bool)cfg_ytdlp_via_aria2;
     }
 
     void OnChanged() { m_callback->on_state_changed(); }
@@ -384,6 +491,11 @@ public:
         UINT port = GetDlgItemInt(IDC_ARIA2_PORT, nullptr, FALSE);
         if (port > 0 && port < 65536) cfg_aria2_port = port;
 
+        UINT perHost = GetDlgItemInt(IDC_ARIA2_MAX_PER_HOST, nullptr, FALSE);
+        if (perHost > 0 && perHost <= 16) cfg_aria2_max_per_host = perHost;
+        UINT gapMs = GetDlgItemInt(IDC_ARIA2_HOST_GAP, nullptr, FALSE);
+        if (gapMs <= 60000) cfg_aria2_host_gap_ms = gapMs;
+
         auto& aria2 = Aria2RpcClient::instance();
         aria2.SetPort((int)cfg_aria2_port.get());
         if (aria2path.length() > 0) aria2.SetAria2Path(aria2path.get_ptr());
@@ -395,6 +507,8 @@ public:
         std::string defaultAria2 = GetComponentDir() + "aria2c.exe";
         uSetDlgItemText(*this, IDC_ARIA2_PATH, defaultAria2.c_str());
         SetDlgItemInt(IDC_ARIA2_PORT, 6800, FALSE);
+        SetDlgItemInt(IDC_ARIA2_MAX_PER_HOST, 2, FALSE);
+        SetDlgItemInt(IDC_ARIA2_HOST_GAP, 500, FALSE);
         OnChanged();
     }
 
@@ -403,6 +517,8 @@ public:
         COMMAND_HANDLER_EX(IDC_BROWSE_ARIA2, BN_CLICKED, OnBrowseAria2)
         COMMAND_HANDLER_EX(IDC_ARIA2_PATH, EN_CHANGE, OnEditChange)
         COMMAND_HANDLER_EX(IDC_ARIA2_PORT, EN_CHANGE, OnEditChange)
+        COMMAND_HANDLER_EX(IDC_ARIA2_MAX_PER_HOST, EN_CHANGE, OnEditChange)
+        COMMAND_HANDLER_EX(IDC_ARIA2_HOST_GAP, EN_CHANGE, OnEditChange)
     END_MSG_MAP()
 
 private:
@@ -417,6 +533,8 @@ private:
         }
         uSetDlgItemText(*this, IDC_ARIA2_PATH, ariaPath);
         SetDlgItemInt(IDC_ARIA2_PORT, (UINT)cfg_aria2_port.get(), FALSE);
+        SetDlgItemInt(IDC_ARIA2_MAX_PER_HOST, (UINT)cfg_aria2_max_per_host.get(), FALSE);
+        SetDlgItemInt(IDC_ARIA2_HOST_GAP, (UINT)cfg_aria2_host_gap_ms.get(), FALSE);
         return FALSE;
     }
 
@@ -434,9 +552,13 @@ private:
         pfc::string8 aria2path;
         uGetDlgItemText(*this, IDC_ARIA2_PATH, aria2path);
         UINT port = GetDlgItemInt(IDC_ARIA2_PORT, nullptr, FALSE);
+        UINT perHost = GetDlgItemInt(IDC_ARIA2_MAX_PER_HOST, nullptr, FALSE);
+        UINT gapMs = GetDlgItemInt(IDC_ARIA2_HOST_GAP, nullptr, FALSE);
 
         return strcmp(aria2path, cfg_aria2_path) != 0
-            || port != cfg_aria2_port.get();
+            || port != cfg_aria2_port.get()
+            || perHost != cfg_aria2_max_per_host.get()
+            || gapMs != cfg_aria2_host_gap_ms.get();
     }
 
     void OnChanged() { m_callback->on_state_changed(); }
@@ -526,6 +648,99 @@ private:
     fb2k::CDarkModeHooks m_dark;
 };
 
+// ============================================================================
+// Diagnostics sub-page
+// ============================================================================
+
+class CDiagnosticsPreferences : public CDialogImpl<CDiagnosticsPreferences>, public preferences_page_instance {
+public:
+    CDiagnosticsPreferences(preferences_page_callback::ptr callback) : m_callback(callback) {}
+
+    enum { IDD = IDD_PREF_DIAGNOSTICS };
+
+    t_uint32 get_state() {
+        t_uint32 state = preferences_state::resettable | preferences_state::dark_mode_supported;
+        if (HasChanged()) state |= preferences_state::changed;
+        return state;
+    }
+
+    void apply() {
+        UINT interval = GetDlgItemInt(IDC_METRICS_INTERVAL, nullptr, FALSE);
+        if (interval <= 86400) cfg_metrics_interval = interval;
+
+        int formatIdx = (int)SendDlgItemMessage(IDC_METRICS_FORMAT, CB_GETCURSEL, 0, 0);
+        if (formatIdx >= 0 && formatIdx < g_numMetricsFormats) cfg_metrics_format = (t_uint32)formatIdx;
+
+        pfc::string8 path;
+        uGetDlgItemText(*this, IDC_METRICS_PATH, path);
+        cfg_metrics_path = path;
+
+        OnChanged();
+    }
+
+    void reset() {
+        SetDlgItemInt(IDC_METRICS_INTERVAL, 0, FALSE);
+        SendDlgItemMessage(IDC_METRICS_FORMAT, CB_SETCURSEL, 0, 0);
+        uSetDlgItemText(*this, IDC_METRICS_PATH, "");
+        OnChanged();
+    }
+
+    BEGIN_MSG_MAP_EX(CDiagnosticsPreferences)
+        MSG_WM_INITDIALOG(OnInitDialog)
+        COMMAND_HANDLER_EX(IDC_METRICS_INTERVAL, EN_CHANGE, OnEditChange)
+        COMMAND_HANDLER_EX(IDC_METRICS_PATH, EN_CHANGE, OnEditChange)
+        COMMAND_HANDLER_EX(IDC_METRICS_FORMAT, CBN_SELCHANGE, OnEditChange)
+        COMMAND_HANDLER_EX(IDC_BROWSE_METRICS, BN_CLICKED, OnBrowse)
+        COMMAND_HANDLER_EX(IDC_METRICS_DUMP, BN_CLICKED, OnDump)
+    END_MSG_MAP()
+
+private:
+    BOOL OnInitDialog(CWindow, LPARAM) {
+        m_dark.AddDialogWithControls(*this);
+
+        SetDlgItemInt(IDC_METRICS_INTERVAL, (UINT)cfg_metrics_interval.get(), FALSE);
+
+        CComboBox combo(GetDlgItem(IDC_METRICS_FORMAT));
+        for (int i = 0; i < g_numMetricsFormats; i++) {
+            combo.AddString(pfc::stringcvt::string_wide_from_utf8(g_metrics_format_labels[i]));
+        }
+        int formatIdx = (int)cfg_metrics_format.get();
+        combo.SetCurSel((formatIdx >= 0 && formatIdx < g_numMetricsFormats) ? formatIdx : 0);
+
+        uSetDlgItemText(*this, IDC_METRICS_PATH, cfg_metrics_path);
+        return FALSE;
+    }
+
+    void OnBrowse(UINT, int, CWindow) {
+        pfc::string8 path;
+        if (uGetOpenFileName(*this, "Prometheus text|*.prom|JSON|*.json|All files|*.*", 0, nullptr,
+                             "Metrics file", nullptr, path, TRUE)) {
+            uSetDlgItemText(*this, IDC_METRICS_PATH, path);
+            OnChanged();
+        }
+    }
+
+    void OnDump(UINT, int, CWindow) { DumpMetricsToConsole(); }
+
+    void OnEditChange(UINT, int, CWindow) { OnChanged(); }
+
+    bool HasChanged() {
+        UINT interval = GetDlgItemInt(IDC_METRICS_INTERVAL, nullptr, FALSE);
+        int formatIdx = (int)SendDlgItemMessage(IDC_METRICS_FORMAT, CB_GETCURSEL, 0, 0);
+        pfc::string8 path;
+        uGetDlgItemText(*this, IDC_METRICS_PATH, path);
+
+        return interval != cfg_metrics_interval.get()
+            || (formatIdx >= 0 && (t_uint32)formatIdx != cfg_metrics_format.get())
+            || strcmp(path, cfg_metrics_path) != 0;
+    }
+
+    void OnChanged() { m_callback->on_state_changed(); }
+
+    const preferences_page_callback::ptr m_callback;
+    fb2k::CDarkModeHooks m_dark;
+};
+
 // ============================================================================
 // Page factories
 // ============================================================================
@@ -562,10 +777,19 @@ public:
     GUID get_parent_guid() { return guid_downloader_preferences; }
 };
 
+// Sub-page: Tools > Downloader > Diagnostics
+class preferences_page_diagnostics : public preferences_page_impl<CDiagnosticsPreferences> {
+public:
+    const char* get_name() { return "Diagnostics"; }
+    GUID get_guid() { return guid_pref_diagnostics; }
+    GUID get_parent_guid() { return guid_downloader_preferences; }
+};
+
 static preferences_page_factory_t<preferences_page_main> g_pref_main_factory;
 static preferences_page_factory_t<preferences_page_youtube> g_pref_youtube_factory;
 static preferences_page_factory_t<preferences_page_aria2> g_pref_aria2_factory;
 static preferences_page_factory_t<preferences_page_custom_source> g_pref_custom_source_factory;
+static preferences_page_factory_t<preferences_page_diagnostics> g_pref_diagnostics_factory;
 
 } // namespace
 
@@ -34,6 +34,13 @@
 #define IDC_CM_SOURCE_COMBO         3001
 #define IDC_CM_URL_INPUT            3002
 
+// Bulk import dialog (IDD_BULK_IMPORT)
+#define IDD_BULK_IMPORT             7000
+#define IDC_BULK_SOURCE_COMBO       7001
+#define IDC_BULK_INPUT              7002
+#define IDC_BULK_LOAD_FILE          7003
+#define IDC_BULK_INFO               7004
+
 // Search results selection dialog
 #define IDD_SEARCH_RESULTS          4000
 #define IDC_RESULTS_LIST            4001
@@ -54,9 +61,36 @@
 #define IDC_ENABLE_YOUTUBE          1015
 #define IDC_ENABLE_DIRECT_URL       1016
 
+// Search-as-you-type prefetch (IDD_PREFERENCES)
+#define IDC_SEARCH_PREFETCH         1033
+
 // YouTube extra flags
 #define IDC_YTDLP_EXTRA_FLAGS       1017
 
+// Max simultaneous yt-dlp jobs (IDD_PREF_YOUTUBE)
+#define IDC_YTDLP_MAX_JOBS          1021
+
+// yt-dlp worker (IDD_PREF_YOUTUBE)
+#define IDC_YTDLP_WORKER            1030
+#define IDC_PYTHON_PATH             1031
+
+// yt-dlp downloads through aria2 (IDD_PREF_YOUTUBE)
+#define IDC_YTDLP_VIA_ARIA2         1032
+
+// Per-host politeness (IDD_PREF_ARIA2)
+#define IDC_ARIA2_MAX_PER_HOST      1022
+#define IDC_ARIA2_HOST_GAP          1023
+
+// Already-downloaded policy (IDD_PREFERENCES)
+#define IDC_DUPLICATE_POLICY        1024
+
+// Metrics snapshots (IDD_PREF_DIAGNOSTICS)
+#define IDC_METRICS_INTERVAL        1025
+#define IDC_METRICS_FORMAT          1026
+#define IDC_METRICS_PATH            1027
+#define IDC_BROWSE_METRICS          1028
+#define IDC_METRICS_DUMP            1029
+
 // Custom source (IDD_PREF_CUSTOM_SOURCE)
 #define IDC_CUSTOM_SOURCE_URL       1019
 #define IDC_TEST_CUSTOM_SOURCE      1020
@@ -65,3 +99,4 @@
 #define IDD_PREF_YOUTUBE            6000
 #define IDD_PREF_ARIA2              6001
 #define IDD_PREF_CUSTOM_SOURCE      6002
+#define IDD_PREF_DIAGNOSTICS        6003
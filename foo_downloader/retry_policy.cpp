@@ -0,0 +1,135 @@
+#include "retry_policy.h"
+
+#include <cstring>
+#include <random>
+
+// Backoff: 2 s, 4 s, 8 s, ... up to 5 min; rate limits start at 30 s
+static const uint64_t RETRY_BASE_MS = 2000;
+static const uint64_t RETRY_RATE_LIMIT_BASE_MS = 30000;
+static const uint64_t RETRY_MAX_MS = 5 * 60 * 1000;
+
+// Circuit cool-down: 30 s, doubling per re-trip, up to 10 min
+static const uint64_t BREAKER_COOLDOWN_MS = 30000;
+static const uint64_t BREAKER_MAX_COOLDOWN_MS = 10 * 60 * 1000;
+
+// ============================================================================
+// Classification
+// ============================================================================
+
+static FailureKind ClassifyHttpStatus(int status) {
+    if (status == 429) return FailureKind::RateLimited;
+    if (status == 408) return FailureKind::Transient;
+    if (status == 503) return FailureKind::RateLimited;
+    if (status >= 400 && status < 500) return FailureKind::Permanent;
+    return FailureKind::Transient;
+}
+
+// First 3-digit number after `marker` in `text`, or 0
+static int FindStatusAfter(const std::string& text, const char* marker) {
+    size_t pos = text.find(marker);
+    if (pos == std::string::npos) return 0;
+    pos += strlen(marker);
+    while (pos < text.size() && text[pos] == ' ') pos++;
+    if (pos + 3 > text.size()) return 0;
+    for (size_t i = pos; i < pos + 3; i++) {
+        if (text[i] < '0' || text[i] > '9') return 0;
+    }
+    return atoi(text.substr(pos, 3).c_str());
+}
+
+FailureKind ClassifyAria2Error(const std::string& errorCode, const std::string& message) {
+    // aria2 reports HTTP failures as "... status=404"
+    int http = FindStatusAfter(message, "status=");
+    if (http >= 400) return ClassifyHttpStatus(http);
+
+    // aria2 exit status codes; anything not listed (timeouts, network
+    // problems, name resolution, slow speed) is worth another try
+    static const int permanent[] = {
+        3,  // resource not found
+        4,  // too many "not found"
+        9,  // not enough disk space
+        13, // file already exists
+        16, // could not create file
+        18, // could not create directory
+        23, // too many redirects
+        24, // HTTP authorization failed
+        28, // bad option
+        32, // checksum failed
+    };
+    int code = atoi(errorCode.c_str());
+    for (int p : permanent) {
+        if (code == p) return FailureKind::Permanent;
+    }
+    if (code == 29) return FailureKind::RateLimited;   // Server overloaded / maintenance
+    return FailureKind::Transient;
+}
+
+FailureKind ClassifyYtDlpError(const std::string& output) {
+    int http = FindStatusAfter(output, "HTTP Error ");
+    if (http >= 400) return ClassifyHttpStatus(http);
+
+    static const char* permanent[] = {
+        "Video unavailable",
+        "Private video",
+        "This video is not available",
+        "This video has been removed",
+        "Unsupported URL",
+        "is not a valid URL",
+        "Sign in to confirm your age",
+        "members-only",
+        "Requested format is not available",
+    };
+    for (const char* p : permanent) {
+        if (output.find(p) != std::string::npos) return FailureKind::Permanent;
+    }
+    return FailureKind::Transient;
+}
+
+const char* FailureKindName(FailureKind kind) {
+    switch (kind) {
+    case FailureKind::Permanent:   return "permanent";
+    case FailureKind::RateLimited: return "rate limited";
+    default:                       return "transient";
+    }
+}
+
+uint64_t RetryDelayMs(int attempt, FailureKind kind) {
+    uint64_t delay = (kind == FailureKind::RateLimited) ? RETRY_RATE_LIMIT_BASE_MS : RETRY_BASE_MS;
+    for (int i = 1; i < attempt && delay < RETRY_MAX_MS; i++) delay *= 2;
+    if (delay > RETRY_MAX_MS) delay = RETRY_MAX_MS;
+
+    thread_local std::mt19937_64 rng{ std::random_device{}() };
+    std::uniform_int_distribution<uint64_t> jitter(0, delay / 2);
+    return delay / 2 + jitter(rng);
+}
+
+// ============================================================================
+// Circuit breaker
+// ============================================================================
+
+bool HostCircuitBreaker::AllowRequest(const std::string& host, uint64_t now, int inFlight) const {
+    auto it = m_hosts.find(host);
+    if (it == m_hosts.end() || it->second.failures < BREAKER_THRESHOLD) return true;
+    if (now < it->second.openUntil) return false;
+    return inFlight == 0;   // Half-open: one probe at a time
+}
+
+void HostCircuitBreaker::RecordSuccess(const std::string& host) {
+    m_hosts.erase(host);
+}
+
+uint64_t HostCircuitBreaker::RecordFailure(const std::string& host, uint64_t now) {
+    HostState& s = m_hosts[host];
+    s.failures++;
+    // Failures of requests that were already running while the circuit was
+    // open don't extend it; the first one at or after the threshold, or a
+    // failed probe, (re)opens it
+    if (s.failures < BREAKER_THRESHOLD || now < s.openUntil) return 0;
+
+    uint64_t cooldown = BREAKER_COOLDOWN_MS;
+    for (int i = 0; i < s.trips && cooldown < BREAKER_MAX_COOLDOWN_MS; i++) cooldown *= 2;
+    if (cooldown > BREAKER_MAX_COOLDOWN_MS) cooldown = BREAKER_MAX_COOLDOWN_MS;
+    s.trips++;
+    s.openUntil = now + cooldown;
+    return cooldown;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+// ============================================================================
+// Failure classification
+// ============================================================================
+// Permanent failures (404, 401, bad option, video unavailable, ...) are not
+// retried. Transient ones (5xx, timeouts, resets, DNS) are retried with
+// exponential backoff; RateLimited (429, 503 overload) backs off longer.
+// ============================================================================
+enum class FailureKind { Permanent, Transient, RateLimited };
+
+FailureKind ClassifyAria2Error(const std::string& errorCode, const std::string& message);
+FailureKind ClassifyYtDlpError(const std::string& output);
+const char* FailureKindName(FailureKind kind);
+
+// Delay before retry number `attempt` (1-based): doubling from a base,
+// capped, with equal jitter so failures from one burst don't retry in step
+uint64_t RetryDelayMs(int attempt, FailureKind kind);
+
+// ============================================================================
+// Per-host circuit breaker
+// ============================================================================
+// After BREAKER_THRESHOLD consecutive transient failures a host's circuit
+// opens and nothing new is submitted to it for a cool-down that doubles on
+// each re-trip. Once the cool-down passes a single probe request is let
+// through; its success closes the circuit, its failure reopens it.
+// Not thread-safe; DownloadManager guards it with its mutex.
+// ============================================================================
+class HostCircuitBreaker {
+public:
+    // `inFlight` is the number of transfers already running against `host`
+    bool AllowRequest(const std::string& host, uint64_t now, int inFlight) const;
+    void RecordSuccess(const std::string& host);
+    // Returns the cool-down in ms if this failure opened the circuit, else 0
+    uint64_t RecordFailure(const std::string& host, uint64_t now);
+
+private:
+    static const int BREAKER_THRESHOLD = 5;
+
+    struct HostState {
+        int failures = 0;           // Consecutive, reset by any success
+        int trips = 0;
+        uint64_t openUntil = 0;
+    };
+    std::map<std::string, HostState> m_hosts;
+};
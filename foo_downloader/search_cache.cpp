@@ -0,0 +1,329 @@
+#include "search_cache.h"
+#include "host.h"
+#include "metrics.h"
+#include "url_index.h"
+
+#include <sqlite3.h>
+
+#include <cctype>
+#include <ctime>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+// Rankings and view counts drift, but not noticeably within the hour
+static const int64_t CACHE_TTL_SECONDS = 60 * 60;
+
+// Result lists kept in memory; each is at most a few kilobytes
+static const size_t MEMORY_ENTRIES = 64;
+
+namespace {
+
+// Both providers' records are stored as YouTube records; a custom source
+// result leaves the view count and upload date empty
+struct CacheEntry {
+    std::string key;
+    int64_t fetchedAt = 0;
+    std::vector<YouTubeSearchResult> results;
+};
+
+struct SearchCache {
+    std::mutex mutex;
+    std::list<CacheEntry> lru;      // Most recently used first
+    std::unordered_map<std::string, std::list<CacheEntry>::iterator> index;
+    sqlite3* db = nullptr;
+    bool dbFailed = false;          // Memory only for the rest of the session
+};
+
+SearchCache& Cache() {
+    // Never destroyed: resolve workers may still be searching during static
+    // destruction
+    static SearchCache* cache = new SearchCache;
+    return *cache;
+}
+
+struct CacheMetrics {
+    MetricCounter& memoryHits;
+    MetricCounter& diskHits;
+    MetricCounter& misses;
+};
+
+CacheMetrics& Stats() {
+    static CacheMetrics metrics{
+        Metrics().Counter("foo_downloader_search_cache_hits_total", "Searches and URL lookups answered from the cache",
+                          { { "level", "memory" } }),
+        Metrics().Counter("foo_downloader_search_cache_hits_total", "Searches and URL lookups answered from the cache",
+                          { { "level", "disk" } }),
+        Metrics().Counter("foo_downloader_search_cache_misses_total", "Searches and URL lookups that had to run"),
+    };
+    return metrics;
+}
+
+} // namespace
+
+// ============================================================================
+// Keys
+// ============================================================================
+
+std::string SearchCacheKey(const std::string& provider, const std::string& query) {
+    std::string key = provider + "\n";
+    bool space = false;
+    for (unsigned char c : query) {
+        if (isspace(c)) {
+            space = true;
+            continue;
+        }
+        if (space && key.back() != '\n') key += ' ';
+        space = false;
+        key += (char)tolower(c);
+    }
+    return key;
+}
+
+std::string SearchCacheKey(const std::string& provider, const std::string& query, size_t offset, size_t count) {
+    return SearchCacheKey(provider + " " + std::to_string(offset) + "+" + std::to_string(count), query);
+}
+
+std::string LookupCacheKey(const std::string& provider, const std::string& url) {
+    std::string normalized = NormalizeUrl(url);
+    return normalized.empty() ? "" : provider + " url\n" + normalized;
+}
+
+// ============================================================================
+// SQLite level
+// ============================================================================
+
+// NOTE: callers hold the cache mutex
+static sqlite3* OpenCacheDb(SearchCache& cache) {
+    if (cache.db || cache.dbFailed) return cache.db;
+
+    std::string path = HostDataDirectory() + "search_cache.db";
+    sqlite3* db = nullptr;
+    if (sqlite3_open(path.c_str(), &db) != SQLITE_OK) {
+        LogLine() << "[foo_downloader] Search cache unavailable: " << (db ? sqlite3_errmsg(db) : "out of memory");
+        sqlite3_close(db);
+        cache.dbFailed = true;
+        return nullptr;
+    }
+    sqlite3_exec(db, "PRAGMA journal_mode=WAL;", nullptr, nullptr, nullptr);
+
+    char* errMsg = nullptr;
+    int rc = sqlite3_exec(db,
+        "CREATE TABLE IF NOT EXISTS searches ("
+        "  key TEXT PRIMARY KEY,"
+        "  fetched_at INTEGER NOT NULL"
+        ");"
+        "CREATE TABLE IF NOT EXISTS search_results ("
+        "  key TEXT NOT NULL,"
+        "  position INTEGER NOT NULL,"
+        "  video_id TEXT NOT NULL,"
+        "  title TEXT NOT NULL,"
+        "  artist TEXT NOT NULL,"
+        "  album TEXT NOT NULL,"
+        "  duration INTEGER NOT NULL,"
+        "  view_count INTEGER NOT NULL,"
+        "  upload_date TEXT NOT NULL,"
+        "  PRIMARY KEY (key, position)"
+        ") WITHOUT ROWID;", nullptr, nullptr, &errMsg);
+    if (rc != SQLITE_OK) {
+        LogLine() << "[foo_downloader] Search cache unavailable: " << (errMsg ? errMsg : "unknown error");
+        sqlite3_free(errMsg);
+        sqlite3_close(db);
+        cache.dbFailed = true;
+        return nullptr;
+    }
+
+    // Expired searches go once per session
+    sqlite3_stmt* stmt = nullptr;
+    int64_t cutoff = (int64_t)time(nullptr) - CACHE_TTL_SECONDS;
+    sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr);
+    if (sqlite3_prepare_v2(db, "DELETE FROM search_results WHERE key IN "
+                               "(SELECT key FROM searches WHERE fetched_at < ?);", -1, &stmt, nullptr) == SQLITE_OK) {
+        sqlite3_bind_int64(stmt, 1, cutoff);
+        sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+    }
+    if (sqlite3_prepare_v2(db, "DELETE FROM searches WHERE fetched_at < ?;", -1, &stmt, nullptr) == SQLITE_OK) {
+        sqlite3_bind_int64(stmt, 1, cutoff);
+        sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+    }
+    sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr);
+
+    cache.db = db;
+    return db;
+}
+
+static std::string ColumnText(sqlite3_stmt* stmt, int column) {
+    const unsigned char* text = sqlite3_column_text(stmt, column);
+    return text ? reinterpret_cast<const char*>(text) : "";
+}
+
+// Results of `key` if stored at or after `notBefore`
+static bool LoadResults(sqlite3* db, const std::string& key, int64_t notBefore,
+                        int64_t& fetchedAt, std::vector<YouTubeSearchResult>& results) {
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT fetched_at FROM searches WHERE key = ?;", -1, &stmt, nullptr) != SQLITE_OK) {
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, key.c_str(), (int)key.size(), SQLITE_TRANSIENT);
+    bool fresh = sqlite3_step(stmt) == SQLITE_ROW && (fetchedAt = sqlite3_column_int64(stmt, 0)) >= notBefore;
+    sqlite3_finalize(stmt);
+    if (!fresh) return false;
+
+    if (sqlite3_prepare_v2(db, "SELECT video_id, title, artist, album, duration, view_count, upload_date "
+                               "FROM search_results WHERE key = ? ORDER BY position;", -1, &stmt, nullptr) != SQLITE_OK) {
+        return false;
+    }
+    sqlite3_bind_text(stmt, 1, key.c_str(), (int)key.size(), SQLITE_TRANSIENT);
+    results.clear();
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        YouTubeSearchResult r;
+        r.id = ColumnText(stmt, 0);
+        r.title = ColumnText(stmt, 1);
+        r.artist = ColumnText(stmt, 2);
+        r.album = ColumnText(stmt, 3);
+        r.duration = sqlite3_column_int(stmt, 4);
+        r.viewCount = sqlite3_column_int64(stmt, 5);
+        r.uploadDate = ColumnText(stmt, 6);
+        results.push_back(std::move(r));
+    }
+    sqlite3_finalize(stmt);
+    return !results.empty();
+}
+
+static void SaveResults(sqlite3* db, const std::string& key, int64_t fetchedAt,
+                        const std::vector<YouTubeSearchResult>& results) {
+    sqlite3_exec(db, "BEGIN;", nullptr, nullptr, nullptr);
+
+    sqlite3_stmt* stmt = nullptr;
+    if (sqlite3_prepare_v2(db, "INSERT OR REPLACE INTO searches (key, fetched_at) VALUES (?, ?);",
+                           -1, &stmt, nullptr) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, key.c_str(), (int)key.size(), SQLITE_TRANSIENT);
+        sqlite3_bind_int64(stmt, 2, fetchedAt);
+        sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+    }
+    if (sqlite3_prepare_v2(db, "DELETE FROM search_results WHERE key = ?;", -1, &stmt, nullptr) == SQLITE_OK) {
+        sqlite3_bind_text(stmt, 1, key.c_str(), (int)key.size(), SQLITE_TRANSIENT);
+        sqlite3_step(stmt);
+        sqlite3_finalize(stmt);
+    }
+    if (sqlite3_prepare_v2(db, "INSERT INTO search_results (key, position, video_id, title, artist, album, "
+                               "duration, view_count, upload_date) VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?);",
+                           -1, &stmt, nullptr) == SQLITE_OK) {
+        for (size_t i = 0; i < results.size(); i++) {
+            const YouTubeSearchResult& r = results[i];
+            sqlite3_bind_text(stmt, 1, key.c_str(), (int)key.size(), SQLITE_TRANSIENT);
+            sqlite3_bind_int(stmt, 2, (int)i);
+            sqlite3_bind_text(stmt, 3, r.id.c_str(), (int)r.id.size(), SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt, 4, r.title.c_str(), (int)r.title.size(), SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt, 5, r.artist.c_str(), (int)r.artist.size(), SQLITE_TRANSIENT);
+            sqlite3_bind_text(stmt, 6, r.album.c_str(), (int)r.album.size(), SQLITE_TRANSIENT);
+            sqlite3_bind_int(stmt, 7, r.duration);
+            sqlite3_bind_int64(stmt, 8, r.viewCount);
+            sqlite3_bind_text(stmt, 9, r.uploadDate.c_str(), (int)r.uploadDate.size(), SQLITE_TRANSIENT);
+            sqlite3_step(stmt);
+            sqlite3_reset(stmt);
+        }
+        sqlite3_finalize(stmt);
+    }
+
+    if (sqlite3_exec(db, "COMMIT;", nullptr, nullptr, nullptr) != SQLITE_OK) {
+        LogLine() << "[foo_downloader] Search cache write failed: " << sqlite3_errmsg(db);
+        sqlite3_exec(db, "ROLLBACK;", nullptr, nullptr, nullptr);
+    }
+}
+
+// ============================================================================
+// Memory level
+// ============================================================================
+
+// NOTE: callers hold the cache mutex
+static void Remember(SearchCache& cache, const std::string& key, int64_t fetchedAt,
+                     const std::vector<YouTubeSearchResult>& results) {
+    auto it = cache.index.find(key);
+    if (it != cache.index.end()) {
+        cache.lru.erase(it->second);
+        cache.index.erase(it);
+    }
+    cache.lru.push_front({ key, fetchedAt, results });
+    cache.index[key] = cache.lru.begin();
+
+    if (cache.lru.size() > MEMORY_ENTRIES) {
+        cache.index.erase(cache.lru.back().key);
+        cache.lru.pop_back();
+    }
+}
+
+bool FindCachedResults(const std::string& key, std::vector<YouTubeSearchResult>& results) {
+    if (key.empty()) return false;
+    SearchCache& cache = Cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    int64_t notBefore = (int64_t)time(nullptr) - CACHE_TTL_SECONDS;
+
+    auto it = cache.index.find(key);
+    if (it != cache.index.end()) {
+        if (it->second->fetchedAt >= notBefore) {
+            cache.lru.splice(cache.lru.begin(), cache.lru, it->second);
+            results = it->second->results;
+            Stats().memoryHits.Add();
+            return true;
+        }
+        cache.lru.erase(it->second);
+        cache.index.erase(it);
+    }
+
+    int64_t fetchedAt = 0;
+    sqlite3* db = OpenCacheDb(cache);
+    if (db && LoadResults(db, key, notBefore, fetchedAt, results)) {
+        Remember(cache, key, fetchedAt, results);
+        Stats().diskHits.Add();
+        return true;
+    }
+
+    Stats().misses.Add();
+    return false;
+}
+
+void StoreCachedResults(const std::string& key, const std::vector<YouTubeSearchResult>& results) {
+    if (key.empty() || results.empty()) return;
+    SearchCache& cache = Cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    int64_t now = (int64_t)time(nullptr);
+
+    Remember(cache, key, now, results);
+    if (sqlite3* db = OpenCacheDb(cache)) SaveResults(db, key, now, results);
+}
+
+bool FindCachedResults(const std::string& key, std::vector<CustomSearchResult>& results) {
+    std::vector<YouTubeSearchResult> stored;
+    if (!FindCachedResults(key, stored)) return false;
+
+    results.clear();
+    for (auto& s : stored) {
+        CustomSearchResult r;
+        r.id = std::move(s.id);
+        r.title = std::move(s.title);
+        r.artist = std::move(s.artist);
+        r.album = std::move(s.album);
+        r.duration = s.duration;
+        results.push_back(std::move(r));
+    }
+    return true;
+}
+
+void StoreCachedResults(const std::string& key, const std::vector<CustomSearchResult>& results) {
+    std::vector<YouTubeSearchResult> stored;
+    stored.reserve(results.size());
+    for (const auto& r : results) {
+        YouTubeSearchResult s;
+        s.id = r.id;
+        s.title = r.title;
+        s.artist = r.artist;
+        s.album = r.album;
+        s.duration = r.duration;
+        stored.push_back(std::move(s));
+    }
+    StoreCachedResults(key, stored);
+}
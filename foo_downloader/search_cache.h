@@ -0,0 +1,38 @@
+#pragma once
+
+#include "search_results.h"
+
+#include <string>
+#include <vector>
+
+// ============================================================================
+// Search and lookup result cache
+// ============================================================================
+// Parsed result records of searches and URL lookups, so that running the
+// same search again does not start yt-dlp or hit the custom source's API.
+// Two levels: the most recently used results in memory, in front of a
+// SQLite table in <data dir>/search_cache.db that survives restarts. Both
+// levels treat results older than an hour as missing. Lookups are counted
+// per level in foo_downloader_search_cache_*_total.
+// ============================================================================
+
+// Key for a search: `provider` plus the query with case and runs of
+// whitespace normalized. `provider` should name anything else the results
+// depend on, such as the server being searched.
+std::string SearchCacheKey(const std::string& provider, const std::string& query);
+
+// Key for `count` results of a search starting at result `offset`
+std::string SearchCacheKey(const std::string& provider, const std::string& query, size_t offset, size_t count);
+
+// Key for a URL lookup: `provider` plus NormalizeUrl(url); "" if `url` is
+// not a URL, which is never cached
+std::string LookupCacheKey(const std::string& provider, const std::string& url);
+
+// Fresh results stored under `key`; false on a miss
+bool FindCachedResults(const std::string& key, std::vector<YouTubeSearchResult>& results);
+bool FindCachedResults(const std::string& key, std::vector<CustomSearchResult>& results);
+
+// Keep `results` under `key`, replacing what was there. Empty results are
+// not stored: a failed search should be retried, not remembered.
+void StoreCachedResults(const std::string& key, const std::vector<YouTubeSearchResult>& results);
+void StoreCachedResults(const std::string& key, const std::vector<CustomSearchResult>& results);
@@ -0,0 +1,56 @@
+#include "search_results.h"
+#include "json_scan.h"
+
+bool ParseYouTubeResultLine(const std::string& line, YouTubeSearchResult& r) {
+    if (line.empty() || line[0] != '{') return false;
+
+    r.id = JsonString(line, "id");
+    r.title = JsonString(line, "title");
+    r.artist = JsonString(line, "channel");
+    if (r.artist.empty()) r.artist = JsonString(line, "uploader");
+    r.duration = (int)JsonInt(line, "duration");
+    r.viewCount = JsonInt(line, "view_count");
+    r.uploadDate = JsonString(line, "upload_date");
+    return !r.id.empty();
+}
+
+std::vector<YouTubeSearchResult> ParseYouTubeSearchOutput(const std::string& output) {
+    std::vector<YouTubeSearchResult> results;
+    size_t start = 0;
+    while (start < output.size()) {
+        size_t end = output.find('\n', start);
+        if (end == std::string::npos) end = output.size();
+
+        YouTubeSearchResult r;
+        if (ParseYouTubeResultLine(output.substr(start, end - start), r) && !r.title.empty()) {
+            results.push_back(std::move(r));
+        }
+        start = end + 1;
+    }
+    return results;
+}
+
+std::vector<CustomSearchResult> ParseCustomSearchResponse(const std::string& response) {
+    std::vector<CustomSearchResult> results;
+
+    for (const auto& obj : JsonObjectArray(response, "data")) {
+        CustomSearchResult r;
+
+        // Track ID is numeric; entries without one can't be downloaded
+        int64_t id = JsonInt(obj, "id");
+        if (id <= 0) continue;
+        r.id = std::to_string(id);
+
+        r.title = JsonString(obj, "title");
+        r.duration = (int)JsonInt(obj, "duration");
+
+        // Artist and album are nested objects
+        r.artist = JsonNestedString(obj, "artist", "name");
+        r.album = JsonNestedString(obj, "album", "title");
+
+        if (!r.title.empty()) {
+            results.push_back(std::move(r));
+        }
+    }
+    return results;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// Search result records and their parsers
+// ============================================================================
+
+struct YouTubeSearchResult {
+    std::string id;         // Video ID
+    std::string title;
+    std::string artist;     // Channel/uploader
+    std::string album;
+    int duration = 0;       // Seconds
+    int64_t viewCount = 0;
+    std::string uploadDate; // YYYYMMDD from yt-dlp
+};
+
+struct CustomSearchResult {
+    std::string id;
+    std::string title;
+    std::string artist;
+    std::string album;
+    int duration = 0;
+};
+
+// One line of `yt-dlp -j` output. Returns false if the line is not a JSON
+// object or has no video id.
+bool ParseYouTubeResultLine(const std::string& line, YouTubeSearchResult& r);
+
+// Complete `yt-dlp -j` output, one JSON object per line; entries without a
+// title are dropped
+std::vector<YouTubeSearchResult> ParseYouTubeSearchOutput(const std::string& output);
+
+// Custom source search response: {"data": [...], "total": N}
+std::vector<CustomSearchResult> ParseCustomSearchResponse(const std::string& response);
@@ -1,14 +1,9 @@
-#include "stdafx.h"
 #include "source_manager.h"
+#include "host.h"
 #include "sources/source_direct_url.h"
 #include "sources/source_custom.h"
 #include "sources/source_youtube.h"
 
-// Declared in preferences.cpp
-extern bool GetConfigEnableCustomSource();
-extern bool GetConfigEnableYoutube();
-extern bool GetConfigEnableDirectUrl();
-
 SourceManager& SourceManager::instance() {
     static SourceManager inst;
     return inst;
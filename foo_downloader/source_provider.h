@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -18,6 +20,22 @@ struct DownloadItem {
     std::vector<std::string> headers;  // Custom HTTP headers (e.g., "Referer: https://...")
 };
 
+// ============================================================================
+// Cancellation flag for an in-flight Resolve()
+// ============================================================================
+// Set when the user cancels the pending entry or the component shuts down.
+// Long-running steps (child processes, dialogs) should check it and bail out.
+// A step that can also be stopped on its own (a search the user closes the
+// results of) gets a flag of its own with `parent` pointing at the resolve's.
+// `userWaitMs` is how long the resolve sat waiting for the user to pick
+// results (see CollectResultsFeed), which the latency figures leave out.
+struct ResolveCancel {
+    std::atomic<bool> cancelled{ false };
+    const ResolveCancel* parent = nullptr;
+    mutable std::atomic<uint64_t> userWaitMs{ 0 };
+    bool IsCancelled() const { return cancelled.load() || (parent && parent->IsCancelled()); }
+};
+
 // ============================================================================
 // Abstract source provider interface
 // ============================================================================
@@ -39,7 +57,26 @@ public:
     // Given user input (URL, search term, etc.), resolve to downloadable URLs.
     // Returns true on success, false on error.
     // On success, fills `items` with one or more DownloadItem entries.
-    virtual bool Resolve(const char* input, std::vector<DownloadItem>& items, std::string& errorMsg) = 0;
+    // Called on a worker thread: blocking I/O is fine, but any UI must be
+    // marshalled to the main thread (see CallInMainThread).
+    virtual bool Resolve(const char* input, std::vector<DownloadItem>& items, std::string& errorMsg,
+                         const ResolveCancel& cancel) = 0;
+
+    // Unattended variant used by bulk import; must not show any UI. Sources
+    // that normally let the user pick from search results take the top hit.
+    virtual bool ResolveUnattended(const char* input, std::vector<DownloadItem>& items, std::string& errorMsg,
+                                   const ResolveCancel& cancel) {
+        return Resolve(input, items, errorMsg, cancel);
+    }
+
+    // How many ResolveUnattended() calls a bulk import may run at once
+    virtual int GetBulkParallelism() const { return 4; }
+
+    // Optional: run the search Resolve() would start for `input`, without
+    // any UI, so its first results are in the search cache by the time the
+    // user asks for them. Called on a worker thread while the user is still
+    // typing; `cancel` is set once the input has moved on.
+    virtual void Prefetch(const char* /*input*/, const ResolveCancel& /*cancel*/) {}
 
     // Whether this source requires additional settings (API keys, auth, etc.)
     virtual bool HasSettings() const { return false; }
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "../source_provider.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// ============================================================================
+// Paged search results shared by a resolve worker and its results dialog
+// ============================================================================
+// The dialog opens when the search starts. The worker fetches a small first
+// page, adding results as they arrive, then bigger pages whenever the dialog
+// is scrolled near its last row. Tracks can be picked at any time; closing
+// the dialog, either way, stops the fetch in progress through `stop`.
+//
+// The dialog side sets `notify`, which the worker calls with `mutex` held
+// and which has to post a call to `refresh` to the main thread; both are
+// coalesced through `refreshPosted`. `refresh` is main thread only.
+// ============================================================================
+
+template <typename Result>
+struct ResultsFeed {
+    std::mutex mutex;
+    std::condition_variable changed;    // Wakes the worker: closed or more wanted
+    std::vector<Result> results;
+    bool searching = true;      // A page is being fetched
+    bool exhausted = false;     // The last page came back short
+    bool moreWanted = false;    // The dialog is scrolled near its end
+    bool refreshPosted = false;
+    bool closed = false;
+    bool accepted = false;
+    std::vector<int> selected;
+    int qualityIdx = 0;
+    ResolveCancel stop;
+    std::function<void()> notify;
+    std::function<void()> refresh;
+};
+
+enum class ResultsFeedOutcome { Selected, Closed, NoResults };
+
+// NOTE: caller must hold feed.mutex
+template <typename Result>
+void NotifyResultsFeed(ResultsFeed<Result>& feed) {
+    if (feed.refreshPosted || !feed.notify) return;
+    feed.refreshPosted = true;
+    feed.notify();
+}
+
+template <typename Result>
+void AddToResultsFeed(ResultsFeed<Result>& feed, const Result& r) {
+    std::lock_guard<std::mutex> lock(feed.mutex);
+    feed.results.push_back(r);
+    NotifyResultsFeed(feed);
+}
+
+// Dialog side, once the user is done scrolling near the last row
+template <typename Result>
+void WantMoreResults(ResultsFeed<Result>& feed) {
+    std::lock_guard<std::mutex> lock(feed.mutex);
+    if (feed.searching || feed.exhausted || feed.moreWanted || feed.closed) return;
+    feed.moreWanted = true;
+    feed.changed.notify_all();
+}
+
+// Either side: record the outcome and stop the search. Only the first call
+// counts; one made by the worker takes the dialog down on its next refresh.
+template <typename Result>
+void CloseResultsFeed(ResultsFeed<Result>& feed, bool accepted,
+                      std::vector<int> selected = {}, int qualityIdx = 0) {
+    feed.stop.cancelled = true;
+    std::lock_guard<std::mutex> lock(feed.mutex);
+    if (feed.closed) return;
+    feed.closed = true;
+    feed.accepted = accepted;
+    feed.selected = std::move(selected);
+    feed.qualityIdx = qualityIdx;
+    feed.changed.notify_all();
+    feed.refreshPosted = false;
+    NotifyResultsFeed(feed);
+}
+
+// ============================================================================
+// Worker side: fetch pages until the dialog is closed
+// ============================================================================
+// `fetch(offset, count)` runs one page of the search, checking feed.stop,
+// adds its results with AddToResultsFeed and returns how many the source
+// gave; fewer than `count` means there are no more. A first page with
+// nothing in it closes the dialog again (NoResults). The time spent with
+// nothing to fetch, waiting on the user, is added to cancel.userWaitMs.
+// ============================================================================
+template <typename Result, typename Fetch>
+ResultsFeedOutcome CollectResultsFeed(ResultsFeed<Result>& feed, size_t firstPage, size_t nextPage,
+                                      const ResolveCancel& cancel, Fetch fetch) {
+    size_t offset = 0;
+    size_t count = firstPage;
+
+    std::unique_lock<std::mutex> lock(feed.mutex);
+    while (!feed.closed) {
+        if (cancel.IsCancelled()) {
+            lock.unlock();
+            CloseResultsFeed(feed, false);
+            return ResultsFeedOutcome::Closed;
+        }
+
+        if (feed.searching) {
+            lock.unlock();
+            size_t got = fetch(offset, count);
+            lock.lock();
+            if (feed.closed) break;
+            if (feed.results.empty() && !cancel.IsCancelled()) {
+                lock.unlock();
+                CloseResultsFeed(feed, false);
+                return ResultsFeedOutcome::NoResults;
+            }
+            feed.exhausted = got < count;
+            feed.searching = false;
+            offset += count;
+            count = nextPage;
+            // The info line changes even when the page added no rows
+            feed.refreshPosted = false;
+            NotifyResultsFeed(feed);
+            continue;
+        }
+
+        if (feed.moreWanted) {
+            feed.moreWanted = false;
+            feed.searching = true;
+            feed.refreshPosted = false;
+            NotifyResultsFeed(feed);
+            continue;
+        }
+
+        auto waitStart = std::chrono::steady_clock::now();
+        feed.changed.wait_for(lock, std::chrono::milliseconds(100));
+        cancel.userWaitMs += (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - waitStart).count();
+    }
+    return feed.accepted ? ResultsFeedOutcome::Selected : ResultsFeedOutcome::Closed;
+}
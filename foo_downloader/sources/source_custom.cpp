@@ -1,102 +1,27 @@
-#include "../stdafx.h"
 #include "source_custom.h"
-#include "../resource.h"
 #include "../aria2_rpc.h"
-
-#include <helpers/atl-misc.h>
-#include <helpers/DarkMode.h>
-#include <commctrl.h>
-#include <sstream>
-
-extern const char* GetConfigCustomSourceUrl();
-
-// ============================================================================
-// Search results selection dialog
-// ============================================================================
-
-class CSearchResultsDialog : public CDialogImpl<CSearchResultsDialog> {
-public:
-    enum { IDD = IDD_SEARCH_RESULTS };
-
-    const std::vector<CustomSearchResult>& m_results;
-    std::vector<int> m_selected;
-
-    CSearchResultsDialog(const std::vector<CustomSearchResult>& results)
-        : m_results(results) {}
-
-    BEGIN_MSG_MAP_EX(CSearchResultsDialog)
-        MSG_WM_INITDIALOG(OnInitDialog)
-        COMMAND_ID_HANDLER_EX(IDOK, OnOk)
-        COMMAND_ID_HANDLER_EX(IDCANCEL, OnCancel)
-    END_MSG_MAP()
-
-    BOOL OnInitDialog(CWindow, LPARAM) {
-        m_dark.AddDialogWithControls(*this);
-        CenterWindow(GetParent());
-
-        // Set info text
-        pfc::string_formatter info;
-        info << "Found " << (unsigned)m_results.size() << " result(s). Select tracks to download:";
-        uSetDlgItemText(*this, IDC_RESULTS_INFO, info);
-
-        // Setup ListView
-        CListViewCtrl list(GetDlgItem(IDC_RESULTS_LIST));
-        list.SetExtendedListViewStyle(LVS_EX_FULLROWSELECT | LVS_EX_DOUBLEBUFFER | LVS_EX_CHECKBOXES);
-
-        list.InsertColumn(0, L"Title", LVCFMT_LEFT, 160);
-        list.InsertColumn(1, L"Artist", LVCFMT_LEFT, 100);
-        list.InsertColumn(2, L"Album", LVCFMT_LEFT, 120);
-        list.InsertColumn(3, L"Duration", LVCFMT_LEFT, 55);
-
-        for (int i = 0; i < (int)m_results.size(); i++) {
-            const auto& r = m_results[i];
-
-            pfc::stringcvt::string_wide_from_utf8 wTitle(r.title.c_str());
-            list.InsertItem(i, wTitle);
-
-            pfc::stringcvt::string_wide_from_utf8 wArtist(r.artist.c_str());
-            list.SetItemText(i, 1, wArtist);
-
-            pfc::stringcvt::string_wide_from_utf8 wAlbum(r.album.c_str());
-            list.SetItemText(i, 2, wAlbum);
-
-            // Format duration as m:ss
-            char durBuf[16];
-            snprintf(durBuf, sizeof(durBuf), "%d:%02d", r.duration / 60, r.duration % 60);
-            pfc::stringcvt::string_wide_from_utf8 wDur(durBuf);
-            list.SetItemText(i, 3, wDur);
-
-        }
-
-        return FALSE;
-    }
-
-    void OnOk(UINT, int, CWindow) {
-        CListViewCtrl list(GetDlgItem(IDC_RESULTS_LIST));
-        m_selected.clear();
-
-        for (int i = 0; i < (int)m_results.size(); i++) {
-            if (list.GetCheckState(i)) {
-                m_selected.push_back(i);
-            }
-        }
-
-        EndDialog(IDOK);
-    }
-
-    void OnCancel(UINT, int, CWindow) {
-        EndDialog(IDCANCEL);
-    }
-
-private:
-    fb2k::CDarkModeHooks m_dark;
-};
+#include "../host.h"
+#include "../search_cache.h"
+#include "../url_index.h"
 
 // ============================================================================
 // CustomSource implementation
 // ============================================================================
 
-bool CustomSource::Resolve(const char* input, std::vector<DownloadItem>& items, std::string& errorMsg) {
+// Results per search page. The first is small so the dialog fills quickly;
+// later ones are fetched while the user scrolls.
+static const size_t FIRST_PAGE_SIZE = 15;
+static const size_t NEXT_PAGE_SIZE = 50;
+
+#ifdef FOO_DOWNLOADER_HEADLESS
+bool CustomSource::Resolve(const char* input, std::vector<DownloadItem>& items, std::string& errorMsg,
+                           const ResolveCancel& cancel) {
+    // Nobody to show the results to; behave like a bulk import
+    return ResolveUnattended(input, items, errorMsg, cancel);
+}
+#else
+bool CustomSource::Resolve(const char* input, std::vector<DownloadItem>& items, std::string& errorMsg,
+                           const ResolveCancel& cancel) {
     std::string baseUrl = GetConfigCustomSourceUrl();
     if (baseUrl.empty()) {
         errorMsg = "Custom source URL is not configured. Set it in Preferences > Tools > Downloader.";
@@ -113,260 +38,143 @@ bool CustomSource::Resolve(const char* input, std::vector<DownloadItem>& items,
 
     std::string query(input);
 
-    // Search the API
-    auto results = Search(query, errorMsg);
-    if (results.empty()) {
+    // Search the API, a page at a time while the selection dialog is open
+    auto feed = std::make_shared<CustomResultsFeed>();
+    OpenResultsDialog(feed);
+
+    auto outcome = CollectResultsFeed(*feed, FIRST_PAGE_SIZE, NEXT_PAGE_SIZE, cancel,
+        [&](size_t offset, size_t count) {
+            std::string pageError;
+            auto page = Search(query, offset, count, pageError);
+            if (offset == 0) errorMsg = pageError;
+            // A server that ignores the paging parameters answers every page
+            // with the first one, or with everything at once
+            if (offset > 0 && !page.empty() && page[0].id == feed->results[0].id) return (size_t)0;
+            for (const auto& r : page) AddToResultsFeed(*feed, r);
+            return page.size() > count ? (size_t)0 : page.size();
+        });
+    if (outcome == ResultsFeedOutcome::NoResults) {
         if (errorMsg.empty()) errorMsg = "No results found for: " + query;
         return false;
     }
-
-    // Show selection dialog
-    std::vector<int> selectedIndices;
-    if (!ShowSelectionDialog(results, selectedIndices)) {
+    if (outcome != ResultsFeedOutcome::Selected) {
         errorMsg = ""; // User cancelled — not an error
         return false;
     }
 
-    if (selectedIndices.empty()) {
+    std::lock_guard<std::mutex> lock(feed->mutex);
+    if (feed->selected.empty()) {
         errorMsg = "No tracks selected.";
         return false;
     }
 
     // Convert selected results to download items
-    for (int idx : selectedIndices) {
-        const auto& r = results[idx];
-
-        DownloadItem item;
-        item.url = baseUrl + "/flac/download?t=" + r.id + "&f=FLAC";
-        item.filename = r.artist + " - " + r.title + ".flac";
-        item.title = r.artist + " - " + r.title;
-        item.artist = r.artist;
-        item.album = r.album;
-
-        // Set headers for this source
-        item.headers.push_back("Referer: " + baseUrl + "/");
-        item.headers.push_back("User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/144.0.0.0 Safari/537.36");
-        item.headers.push_back("Accept: */*");
-        item.headers.push_back("Accept-Language: en-US,en;q=0.9");
-        item.headers.push_back("Sec-Fetch-Dest: empty");
-        item.headers.push_back("Sec-Fetch-Mode: cors");
-        item.headers.push_back("Sec-Fetch-Site: same-origin");
-
-        // Sanitize filename (remove invalid chars)
-        for (char& c : item.filename) {
-            if (c == '\\' || c == '/' || c == ':' || c == '*' ||
-                c == '?' || c == '"' || c == '<' || c == '>' || c == '|') {
-                c = '_';
-            }
-        }
-
-        items.push_back(std::move(item));
+    for (int idx : feed->selected) {
+        if (idx >= 0 && idx < (int)feed->results.size()) items.push_back(MakeItem(baseUrl, feed->results[idx]));
     }
 
     return true;
 }
+#endif
 
-std::vector<CustomSearchResult> CustomSource::Search(const std::string& query, std::string& errorMsg) {
-    std::vector<CustomSearchResult> results;
-
+bool CustomSource::ResolveUnattended(const char* input, std::vector<DownloadItem>& items, std::string& errorMsg,
+                                     const ResolveCancel& cancel) {
     std::string baseUrl = GetConfigCustomSourceUrl();
+    while (!baseUrl.empty() && baseUrl.back() == '/') baseUrl.pop_back();
     if (baseUrl.empty()) {
         errorMsg = "Custom source URL is not configured.";
-        return results;
+        return false;
     }
-
-    // Strip trailing slash
-    while (!baseUrl.empty() && baseUrl.back() == '/') baseUrl.pop_back();
-
-    std::string url = baseUrl + "/flac/search?query=" + UrlEncode(query);
-
-    FB2K_console_formatter() << "[foo_downloader] Custom source search: " << query.c_str();
-
-    std::string response = Aria2RpcClient::HttpGetUrl(url);
-
-    if (response.empty()) {
-        errorMsg = "Failed to connect to custom source";
-        return results;
+    if (!input || !*input) {
+        errorMsg = "Empty query.";
+        return false;
     }
 
-    // Parse the JSON response: {"data": [...], "total": N}
-    auto dataArray = ExtractJsonArray(response, "data");
-
-    for (const auto& obj : dataArray) {
-        CustomSearchResult r;
-
-        // Extract track ID (numeric, convert to string)
-        int id = ExtractJsonInt(obj, "id");
-        if (id > 0) {
-            r.id = std::to_string(id);
-        } else {
-            continue; // Skip entries without valid ID
-        }
-
-        r.title = ExtractJsonString(obj, "title");
-        r.duration = ExtractJsonInt(obj, "duration");
-
-        // Artist and album are nested objects
-        r.artist = ExtractNestedString(obj, "artist", "name");
-        r.album = ExtractNestedString(obj, "album", "title");
-
-        if (!r.title.empty()) {
-            results.push_back(std::move(r));
-        }
+    // No dialog in bulk mode: the top hit is taken
+    auto results = Search(input, 0, FIRST_PAGE_SIZE, errorMsg);
+    if (cancel.IsCancelled()) return false;
+    if (results.empty()) {
+        if (errorMsg.empty()) errorMsg = std::string("No results found for: ") + input;
+        return false;
     }
 
-    FB2K_console_formatter() << "[foo_downloader] Found " << (uint32_t)results.size() << " result(s)";
-
-    return results;
+    items.push_back(MakeItem(baseUrl, results[0]));
+    return true;
 }
 
-bool CustomSource::ShowSelectionDialog(const std::vector<CustomSearchResult>& results,
-                                                std::vector<int>& selectedIndices) {
-    CSearchResultsDialog dlg(results);
-    if (dlg.DoModal(core_api::get_main_window()) == IDOK) {
-        selectedIndices = dlg.m_selected;
-        return true;
-    }
-    return false;
+void CustomSource::Prefetch(const char* input, const ResolveCancel& cancel) {
+    // One HTTP request, which can't be interrupted; just don't start it late
+    if (!input || !*input || cancel.IsCancelled()) return;
+    std::string errorMsg;
+    Search(input, 0, FIRST_PAGE_SIZE, errorMsg);
 }
 
-// ============================================================================
-// Utility functions
-// ============================================================================
-
-std::string CustomSource::UrlEncode(const std::string& str) {
-    std::string result;
-    for (unsigned char c : str) {
-        if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
-            result += c;
-        } else if (c == ' ') {
-            result += "%20";
-        } else {
-            char hex[4];
-            snprintf(hex, sizeof(hex), "%%%02X", c);
-            result += hex;
+DownloadItem CustomSource::MakeItem(const std::string& baseUrl, const CustomSearchResult& r) {
+    DownloadItem item;
+    item.url = baseUrl + "/flac/download?t=" + r.id + "&f=FLAC";
+    item.filename = r.artist + " - " + r.title + ".flac";
+    item.title = r.artist + " - " + r.title;
+    item.artist = r.artist;
+    item.album = r.album;
+
+    // Set headers for this source
+    item.headers.push_back("Referer: " + baseUrl + "/");
+    item.headers.push_back("User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/144.0.0.0 Safari/537.36");
+    item.headers.push_back("Accept: */*");
+    item.headers.push_back("Accept-Language: en-US,en;q=0.9");
+    item.headers.push_back("Sec-Fetch-Dest: empty");
+    item.headers.push_back("Sec-Fetch-Mode: cors");
+    item.headers.push_back("Sec-Fetch-Site: same-origin");
+
+    // Sanitize filename (remove invalid chars)
+    for (char& c : item.filename) {
+        if (c == '\\' || c == '/' || c == ':' || c == '*' ||
+            c == '?' || c == '"' || c == '<' || c == '>' || c == '|') {
+            c = '_';
         }
     }
-    return result;
+    return item;
 }
 
-std::string CustomSource::ExtractJsonString(const std::string& json, const std::string& key) {
-    std::string search = "\"" + key + "\":\"";
-    auto pos = json.find(search);
-    if (pos == std::string::npos) {
-        search = "\"" + key + "\": \"";
-        pos = json.find(search);
-        if (pos == std::string::npos) return "";
-    }
-    pos += search.size();
-
-    // Read until closing quote, handling escapes
-    std::string result;
-    while (pos < json.size()) {
-        char c = json[pos];
-        if (c == '"') break;
-        if (c == '\\' && pos + 1 < json.size()) {
-            char next = json[pos + 1];
-            if (next == '\\') { result += '\\'; pos += 2; continue; }
-            if (next == '"')  { result += '"';  pos += 2; continue; }
-            if (next == '/')  { result += '/';  pos += 2; continue; }
-            if (next == 'n')  { result += '\n'; pos += 2; continue; }
-            if (next == 'r')  { result += '\r'; pos += 2; continue; }
-            if (next == 't')  { result += '\t'; pos += 2; continue; }
-            result += next; pos += 2; continue;
-        }
-        result += c;
-        pos++;
-    }
-    return result;
-}
+std::vector<CustomSearchResult> CustomSource::Search(const std::string& query, size_t offset, size_t count,
+                                                     std::string& errorMsg) {
+    std::vector<CustomSearchResult> results;
 
-int CustomSource::ExtractJsonInt(const std::string& json, const std::string& key) {
-    // Look for "key":number (not quoted)
-    std::string search = "\"" + key + "\":";
-    auto pos = json.find(search);
-    if (pos == std::string::npos) {
-        search = "\"" + key + "\": ";
-        pos = json.find(search);
-        if (pos == std::string::npos) return 0;
+    std::string baseUrl = GetConfigCustomSourceUrl();
+    if (baseUrl.empty()) {
+        errorMsg = "Custom source URL is not configured.";
+        return results;
     }
-    pos += search.size();
 
-    // Skip whitespace
-    while (pos < json.size() && json[pos] == ' ') pos++;
+    // Strip trailing slash
+    while (!baseUrl.empty() && baseUrl.back() == '/') baseUrl.pop_back();
 
-    // Read digits
-    std::string num;
-    while (pos < json.size() && (isdigit(json[pos]) || json[pos] == '-')) {
-        num += json[pos++];
+    // Another server has other results for the same query
+    std::string cacheKey = SearchCacheKey(std::string(GetId()) + " " + baseUrl, query, offset, count);
+    if (FindCachedResults(cacheKey, results)) {
+        LogLine() << "[foo_downloader] Custom source search: " << query.c_str() << " [" << (uint32_t)(offset + 1) << "-"
+                  << (uint32_t)(offset + count) << "] (" << (uint32_t)results.size() << " cached result(s))";
+        return results;
     }
 
-    if (num.empty()) return 0;
-    try { return std::stoi(num); } catch (...) { return 0; }
-}
-
-std::string CustomSource::ExtractNestedString(const std::string& json,
-                                                       const std::string& object,
-                                                       const std::string& key) {
-    // Find the nested object first: "object":{...}
-    std::string search = "\"" + object + "\":{";
-    auto pos = json.find(search);
-    if (pos == std::string::npos) {
-        search = "\"" + object + "\": {";
-        pos = json.find(search);
-        if (pos == std::string::npos) return "";
-    }
+    // Pages are asked for as `index` (0-based first result) and `limit`
+    std::string url = baseUrl + "/flac/search?query=" + UrlEncode(query) +
+                      "&index=" + std::to_string(offset) + "&limit=" + std::to_string(count);
 
-    // Find the closing brace of this object
-    auto braceStart = json.find('{', pos);
-    if (braceStart == std::string::npos) return "";
+    LogLine() << "[foo_downloader] Custom source search: " << query.c_str() << " [" << (uint32_t)(offset + 1) << "-"
+              << (uint32_t)(offset + count) << "]";
 
-    int depth = 1;
-    size_t endPos = braceStart + 1;
-    while (endPos < json.size() && depth > 0) {
-        if (json[endPos] == '{') depth++;
-        else if (json[endPos] == '}') depth--;
-        endPos++;
-    }
-
-    std::string nestedObj = json.substr(braceStart, endPos - braceStart);
-    return ExtractJsonString(nestedObj, key);
-}
-
-std::vector<std::string> CustomSource::ExtractJsonArray(const std::string& json, const std::string& key) {
-    std::vector<std::string> result;
+    std::string response = Aria2RpcClient::HttpGetUrl(url);
 
-    std::string search = "\"" + key + "\":[";
-    auto pos = json.find(search);
-    if (pos == std::string::npos) {
-        search = "\"" + key + "\": [";
-        pos = json.find(search);
-        if (pos == std::string::npos) return result;
+    if (response.empty()) {
+        errorMsg = "Failed to connect to custom source";
+        return results;
     }
 
-    pos = json.find('[', pos);
-    if (pos == std::string::npos) return result;
-
-    pos++; // skip '['
-    while (pos < json.size()) {
-        while (pos < json.size() && (json[pos] == ' ' || json[pos] == ',' || json[pos] == '\n' || json[pos] == '\r')) pos++;
-
-        if (pos >= json.size() || json[pos] == ']') break;
+    results = ParseCustomSearchResponse(response);
+    StoreCachedResults(cacheKey, results);
 
-        if (json[pos] == '{') {
-            int depth = 1;
-            size_t start = pos;
-            pos++;
-            while (pos < json.size() && depth > 0) {
-                if (json[pos] == '{') depth++;
-                else if (json[pos] == '}') depth--;
-                pos++;
-            }
-            result.push_back(json.substr(start, pos - start));
-        } else {
-            pos++;
-        }
-    }
+    LogLine() << "[foo_downloader] Found " << (uint32_t)results.size() << " result(s)";
 
-    return result;
+    return results;
 }
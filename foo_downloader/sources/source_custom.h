@@ -1,16 +1,13 @@
 #pragma once
 
 #include "../source_provider.h"
+#include "../search_results.h"
+#include "results_feed.h"
+#include <memory>
 #include <string>
 #include <vector>
 
-struct CustomSearchResult {
-    std::string id;
-    std::string title;
-    std::string artist;
-    std::string album;
-    int duration = 0;
-};
+using CustomResultsFeed = ResultsFeed<CustomSearchResult>;
 
 class CustomSource : public ISourceProvider {
 public:
@@ -19,14 +16,19 @@ public:
     const char* GetDescription() const override { return "Search and download audio from a custom source"; }
     const char* GetActionLabel() const override { return "Search"; }
 
-    bool Resolve(const char* input, std::vector<DownloadItem>& items, std::string& errorMsg) override;
+    bool Resolve(const char* input, std::vector<DownloadItem>& items, std::string& errorMsg,
+                 const ResolveCancel& cancel) override;
+    bool ResolveUnattended(const char* input, std::vector<DownloadItem>& items, std::string& errorMsg,
+                           const ResolveCancel& cancel) override;
+    int GetBulkParallelism() const override { return 2; }
+    void Prefetch(const char* input, const ResolveCancel& cancel) override;
 
 private:
-    std::vector<CustomSearchResult> Search(const std::string& query, std::string& errorMsg);
-    bool ShowSelectionDialog(const std::vector<CustomSearchResult>& results, std::vector<int>& selectedIndices);
-    static std::string UrlEncode(const std::string& str);
-    static std::string ExtractJsonString(const std::string& json, const std::string& key);
-    static int ExtractJsonInt(const std::string& json, const std::string& key);
-    static std::string ExtractNestedString(const std::string& json, const std::string& object, const std::string& key);
-    static std::vector<std::string> ExtractJsonArray(const std::string& json, const std::string& key);
+    // `count` results starting at result `offset`
+    std::vector<CustomSearchResult> Search(const std::string& query, size_t offset, size_t count,
+                                           std::string& errorMsg);
+    // Opens the results dialog on `feed` (component only, see
+    // source_custom_dialog.cpp)
+    static void OpenResultsDialog(const std::shared_ptr<CustomResultsFeed>& feed);
+    static DownloadItem MakeItem(const std::string& baseUrl, const CustomSearchResult& r);
 };
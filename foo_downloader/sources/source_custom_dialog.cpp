@@ -0,0 +1,187 @@
+#include "../stdafx.h"
+#include "source_custom.h"
+#include "../resource.h"
+#include "../main_thread.h"
+
+#include <helpers/atl-misc.h>
+#include <helpers/DarkMode.h>
+#include <commctrl.h>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+
+// ============================================================================
+// Search results selection dialog
+// ============================================================================
+
+// Scrolling to within this many rows of the end fetches the next page
+static const int LOAD_MORE_MARGIN = 5;
+
+// Modeless, so pages can be added while it is open; see results_feed.h
+class CSearchResultsDialog : public CDialogImpl<CSearchResultsDialog> {
+public:
+    enum { IDD = IDD_SEARCH_RESULTS };
+
+    explicit CSearchResultsDialog(std::shared_ptr<CustomResultsFeed> feed)
+        : m_feed(std::move(feed)) {}
+
+    BEGIN_MSG_MAP_EX(CSearchResultsDialog)
+        MSG_WM_INITDIALOG(OnInitDialog)
+        MSG_WM_DESTROY(OnDestroy)
+        COMMAND_ID_HANDLER_EX(IDOK, OnOk)
+        COMMAND_ID_HANDLER_EX(IDCANCEL, OnCancel)
+        NOTIFY_HANDLER_EX(IDC_RESULTS_LIST, LVN_ENDSCROLL, OnListScrolled)
+        NOTIFY_HANDLER_EX(IDC_RESULTS_LIST, LVN_ITEMCHANGED, OnListScrolled)
+    END_MSG_MAP()
+
+    BOOL OnInitDialog(CWindow, LPARAM) {
+        m_dark.AddDialogWithControls(*this);
+        CenterWindow(GetParent());
+        // Modeless: foobar2000 routes Tab/Enter/Esc to it only when registered
+        modeless_dialog_manager::g_add(m_hWnd);
+
+        // Setup ListView
+        CListViewCtrl list(GetDlgItem(IDC_RESULTS_LIST));
+        list.SetExtendedListViewStyle(LVS_EX_FULLROWSELECT | LVS_EX_DOUBLEBUFFER | LVS_EX_CHECKBOXES);
+
+        list.InsertColumn(0, L"Title", LVCFMT_LEFT, 160);
+        list.InsertColumn(1, L"Artist", LVCFMT_LEFT, 100);
+        list.InsertColumn(2, L"Album", LVCFMT_LEFT, 120);
+        list.InsertColumn(3, L"Duration", LVCFMT_LEFT, 55);
+
+        m_feed->refresh = [this]() { Refresh(); };
+        Refresh();
+        return FALSE;
+    }
+
+    // Append the rows that arrived since the last call and update the info line
+    void Refresh() {
+        std::vector<CustomSearchResult> added;
+        bool searching, exhausted, closed;
+        {
+            std::lock_guard<std::mutex> lock(m_feed->mutex);
+            m_feed->refreshPosted = false;
+            closed = m_feed->closed;
+            added.assign(m_feed->results.begin() + m_rows, m_feed->results.end());
+            searching = m_feed->searching;
+            exhausted = m_feed->exhausted;
+        }
+        if (closed) {
+            // Closed by the worker: cancelled, or nothing found
+            DestroyWindow();
+            return;
+        }
+
+        CListViewCtrl list(GetDlgItem(IDC_RESULTS_LIST));
+        for (const auto& r : added) {
+            int i = m_rows++;
+
+            pfc::stringcvt::string_wide_from_utf8 wTitle(r.title.c_str());
+            list.InsertItem(i, wTitle);
+
+            pfc::stringcvt::string_wide_from_utf8 wArtist(r.artist.c_str());
+            list.SetItemText(i, 1, wArtist);
+
+            pfc::stringcvt::string_wide_from_utf8 wAlbum(r.album.c_str());
+            list.SetItemText(i, 2, wAlbum);
+
+            // Format duration as m:ss
+            char durBuf[16];
+            snprintf(durBuf, sizeof(durBuf), "%d:%02d", r.duration / 60, r.duration % 60);
+            pfc::stringcvt::string_wide_from_utf8 wDur(durBuf);
+            list.SetItemText(i, 3, wDur);
+        }
+
+        // Set info text
+        pfc::string_formatter info;
+        if (searching) {
+            info << "Searching... " << (unsigned)m_rows << " result(s) so far. Select tracks to download:";
+        } else if (!exhausted) {
+            info << "Showing " << (unsigned)m_rows << " result(s); scroll down for more. Select tracks to download:";
+        } else {
+            info << "Found " << (unsigned)m_rows << " result(s). Select tracks to download:";
+        }
+        uSetDlgItemText(*this, IDC_RESULTS_INFO, info);
+
+        // A short first page may not even fill the list
+        if (!searching) CheckNearEnd();
+    }
+
+    // Ask for the next page once the last rows are in view
+    void CheckNearEnd() {
+        CListViewCtrl list(GetDlgItem(IDC_RESULTS_LIST));
+        int lastVisible = list.GetTopIndex() + list.GetCountPerPage();
+        int focused = list.GetNextItem(-1, LVNI_FOCUSED);
+        if ((std::max)(lastVisible, focused) + LOAD_MORE_MARGIN >= m_rows) {
+            WantMoreResults(*m_feed);
+        }
+    }
+
+    LRESULT OnListScrolled(LPNMHDR) {
+        CheckNearEnd();
+        return 0;
+    }
+
+    void OnOk(UINT, int, CWindow) {
+        CListViewCtrl list(GetDlgItem(IDC_RESULTS_LIST));
+        std::vector<int> selected;
+
+        for (int i = 0; i < m_rows; i++) {
+            if (list.GetCheckState(i)) {
+                selected.push_back(i);
+            }
+        }
+
+        CloseResultsFeed(*m_feed, true, std::move(selected));
+        DestroyWindow();
+    }
+
+    void OnCancel(UINT, int, CWindow) {
+        CloseResultsFeed(*m_feed, false);
+        DestroyWindow();
+    }
+
+    void OnDestroy() {
+        modeless_dialog_manager::g_remove(m_hWnd);
+        // Also reached when foobar2000 closes with the dialog still open
+        CloseResultsFeed(*m_feed, false);
+        m_feed->refresh = nullptr;
+    }
+
+    void OnFinalMessage(HWND) override {
+        delete this;
+    }
+
+private:
+    std::shared_ptr<CustomResultsFeed> m_feed;
+    int m_rows = 0;     // Rows shown so far
+    fb2k::CDarkModeHooks m_dark;
+};
+
+// ============================================================================
+// Opening the dialog (component only)
+// ============================================================================
+
+void CustomSource::OpenResultsDialog(const std::shared_ptr<CustomResultsFeed>& feed) {
+    // Resolve runs on a worker thread; the dialog has to live on the main one
+    std::weak_ptr<CustomResultsFeed> weak = feed;
+    feed->notify = [weak]() {
+        PostToMainThread([weak]() {
+            auto feed = weak.lock();
+            // A copy: the dialog drops `refresh` when a refresh destroys it
+            auto refresh = feed ? feed->refresh : nullptr;
+            if (refresh) refresh();
+        });
+    };
+
+    PostToMainThread([feed]() {
+        auto* dlg = new CSearchResultsDialog(feed);
+        if (!dlg->Create(core_api::get_main_window())) {
+            delete dlg;
+            CloseResultsFeed(*feed, false);
+            return;
+        }
+        dlg->ShowWindow(SW_SHOW);
+    });
+}
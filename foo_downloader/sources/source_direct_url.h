@@ -18,7 +18,8 @@ public:
     const char* GetName() const override { return "Direct URL"; }
     const char* GetDescription() const override { return "Download a file directly from a URL"; }
 
-    bool Resolve(const char* input, std::vector<DownloadItem>& items, std::string& errorMsg) override {
+    bool Resolve(const char* input, std::vector<DownloadItem>& items, std::string& errorMsg,
+                 const ResolveCancel&) override {
         if (!input || !*input) {
             errorMsg = "URL cannot be empty.";
             return false;
@@ -1,18 +1,19 @@
-#include "../stdafx.h"
 #include "source_youtube.h"
-#include "../resource.h"
-
-#include <helpers/atl-misc.h>
-#include <helpers/DarkMode.h>
-#include <commctrl.h>
-#include <shellapi.h>
+#include "../host.h"
+#include "../metrics.h"
+#include "../platform.h"
+#include "../search_cache.h"
+#include "../ytdlp_info_cache.h"
+#include "../ytdlp_worker.h"
+
+#include <mutex>
 #include <sstream>
 
 // ============================================================================
 // Quality options
 // ============================================================================
 
-static const YouTubeQuality g_qualities[] = {
+const YouTubeQuality g_ytQualities[] = {
     { "FLAC (lossless)",       "flac", "0" },
     { "WAV (lossless)",        "wav",  "0" },
     { "MP3 320kbps (best)",    "mp3",  "0" },
@@ -25,131 +26,26 @@ static const YouTubeQuality g_qualities[] = {
     { "Opus (best)",           "opus", "0" },
     { "Vorbis (best)",         "vorbis","0" },
 };
-static const int g_numQualities = sizeof(g_qualities) / sizeof(g_qualities[0]);
-
-// ============================================================================
-// Search results selection dialog with quality picker
-// ============================================================================
-
-class CYouTubeResultsDialog : public CDialogImpl<CYouTubeResultsDialog> {
-public:
-    enum { IDD = IDD_YT_SEARCH_RESULTS };
-
-    const std::vector<YouTubeSearchResult>& m_results;
-    std::vector<int> m_selected;
-    int m_qualityIdx = 0;
-
-    CYouTubeResultsDialog(const std::vector<YouTubeSearchResult>& results)
-        : m_results(results) {}
-
-    BEGIN_MSG_MAP_EX(CYouTubeResultsDialog)
-        MSG_WM_INITDIALOG(OnInitDialog)
-        COMMAND_ID_HANDLER_EX(IDOK, OnOk)
-        COMMAND_ID_HANDLER_EX(IDCANCEL, OnCancel)
-        NOTIFY_HANDLER_EX(IDC_YT_RESULTS_LIST, NM_DBLCLK, OnListDblClick)
-    END_MSG_MAP()
-
-    BOOL OnInitDialog(CWindow, LPARAM) {
-        m_dark.AddDialogWithControls(*this);
-        CenterWindow(GetParent());
-
-        // Info text
-        pfc::string_formatter info;
-        info << "Found " << (unsigned)m_results.size() << " result(s). Select tracks to download:";
-        uSetDlgItemText(*this, IDC_YT_RESULTS_INFO, info);
-
-        // Setup ListView
-        CListViewCtrl list(GetDlgItem(IDC_YT_RESULTS_LIST));
-        list.SetExtendedListViewStyle(LVS_EX_FULLROWSELECT | LVS_EX_DOUBLEBUFFER | LVS_EX_CHECKBOXES);
-
-        list.InsertColumn(0, L"Title", LVCFMT_LEFT, 170);
-        list.InsertColumn(1, L"Artist", LVCFMT_LEFT, 90);
-        list.InsertColumn(2, L"Duration", LVCFMT_LEFT, 48);
-        list.InsertColumn(3, L"Views", LVCFMT_RIGHT, 58);
-        list.InsertColumn(4, L"URL", LVCFMT_LEFT, 150);
-
-        for (int i = 0; i < (int)m_results.size(); i++) {
-            const auto& r = m_results[i];
-
-            pfc::stringcvt::string_wide_from_utf8 wTitle(r.title.c_str());
-            list.InsertItem(i, wTitle);
-
-            pfc::stringcvt::string_wide_from_utf8 wArtist(r.artist.c_str());
-            list.SetItemText(i, 1, wArtist);
-
-            // Duration
-            char durBuf[16];
-            if (r.duration >= 3600) {
-                snprintf(durBuf, sizeof(durBuf), "%d:%02d:%02d", r.duration / 3600, (r.duration % 3600) / 60, r.duration % 60);
-            } else {
-                snprintf(durBuf, sizeof(durBuf), "%d:%02d", r.duration / 60, r.duration % 60);
-            }
-            pfc::stringcvt::string_wide_from_utf8 wDur(durBuf);
-            list.SetItemText(i, 2, wDur);
-
-            // View count
-            std::string views = YouTubeSource::FormatViewCount(r.viewCount);
-            pfc::stringcvt::string_wide_from_utf8 wViews(views.c_str());
-            list.SetItemText(i, 3, wViews);
-
-            // URL
-            std::string url = "youtube.com/watch?v=" + r.id;
-            pfc::stringcvt::string_wide_from_utf8 wUrl(url.c_str());
-            list.SetItemText(i, 4, wUrl);
-        }
-
-        // Setup quality dropdown
-        CComboBox combo(GetDlgItem(IDC_YT_QUALITY_COMBO));
-        for (int i = 0; i < g_numQualities; i++) {
-            pfc::stringcvt::string_wide_from_utf8 wLabel(g_qualities[i].label);
-            combo.AddString(wLabel);
-        }
-        combo.SetCurSel(0);
-
-        return FALSE;
-    }
-
-    LRESULT OnListDblClick(LPNMHDR pnmh) {
-        LPNMITEMACTIVATE pItem = (LPNMITEMACTIVATE)pnmh;
-        int idx = pItem->iItem;
-        if (idx >= 0 && idx < (int)m_results.size()) {
-            std::string url = "https://www.youtube.com/watch?v=" + m_results[idx].id;
-            pfc::stringcvt::string_wide_from_utf8 wUrl(url.c_str());
-            ShellExecuteW(NULL, L"open", wUrl, NULL, NULL, SW_SHOWNORMAL);
-        }
-        return 0;
-    }
+const int g_ytQualityCount = sizeof(g_ytQualities) / sizeof(g_ytQualities[0]);
 
-    void OnOk(UINT, int, CWindow) {
-        CListViewCtrl list(GetDlgItem(IDC_YT_RESULTS_LIST));
-        m_selected.clear();
-
-        for (int i = 0; i < (int)m_results.size(); i++) {
-            if (list.GetCheckState(i)) {
-                m_selected.push_back(i);
-            }
-        }
-
-        CComboBox combo(GetDlgItem(IDC_YT_QUALITY_COMBO));
-        m_qualityIdx = combo.GetCurSel();
-        if (m_qualityIdx < 0) m_qualityIdx = 0;
-
-        EndDialog(IDOK);
-    }
-
-    void OnCancel(UINT, int, CWindow) {
-        EndDialog(IDCANCEL);
-    }
-
-private:
-    fb2k::CDarkModeHooks m_dark;
-};
+// Results per search page. The first is small so the dialog fills quickly;
+// later ones are fetched while the user scrolls.
+static const size_t FIRST_PAGE_SIZE = 10;
+static const size_t NEXT_PAGE_SIZE = 20;
 
 // ============================================================================
 // YouTubeSource implementation
 // ============================================================================
 
-bool YouTubeSource::Resolve(const char* input, std::vector<DownloadItem>& items, std::string& errorMsg) {
+#ifdef FOO_DOWNLOADER_HEADLESS
+bool YouTubeSource::Resolve(const char* input, std::vector<DownloadItem>& items, std::string& errorMsg,
+                            const ResolveCancel& cancel) {
+    // No results list to pick from without a UI: take the top hit
+    return ResolveUnattended(input, items, errorMsg, cancel);
+}
+#else
+bool YouTubeSource::Resolve(const char* input, std::vector<DownloadItem>& items, std::string& errorMsg,
+                            const ResolveCancel& cancel) {
     if (!input || !*input) {
         errorMsg = "Please enter a search query or YouTube URL.";
         return false;
@@ -162,37 +58,35 @@ bool YouTubeSource::Resolve(const char* input, std::vector<DownloadItem>& items,
         return false;
     }
 
-    // Check if input is already a YouTube URL
-    bool isUrl = (query.find("youtube.com/") != std::string::npos ||
-                  query.find("youtu.be/") != std::string::npos ||
-                  query.find("music.youtube.com/") != std::string::npos);
-
-    if (isUrl) {
+    if (IsYouTubeUrl(query)) {
         // Direct URL — skip search, just queue it
         // Still show quality dialog with a single item
         std::vector<YouTubeSearchResult> results;
-
-        // Use yt-dlp to get video info
-        std::string ytdlpPath = GetYtDlpPath();
-        std::string cmd = "\"" + ytdlpPath + "\" --no-download -j \"" + query + "\"";
-
-        std::string output = RunProcess(cmd, 30000);
-        if (!output.empty()) {
-            // Parse each line as a JSON object (playlists may have multiple)
-            std::istringstream iss(output);
-            std::string line;
-            while (std::getline(iss, line)) {
-                if (line.empty() || line[0] != '{') continue;
-                YouTubeSearchResult r;
-                r.id = ExtractJsonString(line, "id");
-                r.title = ExtractJsonString(line, "title");
-                r.artist = ExtractJsonString(line, "channel");
-                if (r.artist.empty()) r.artist = ExtractJsonString(line, "uploader");
-                r.duration = ExtractJsonInt(line, "duration");
-                r.viewCount = ExtractJsonInt64(line, "view_count");
-                r.uploadDate = ExtractJsonString(line, "upload_date");
-                if (!r.id.empty()) results.push_back(std::move(r));
+        std::vector<std::string> infoLines;     // Parallel to results; empty if cached
+
+        std::string cacheKey = LookupCacheKey(GetId(), query);
+        if (!FindCachedResults(cacheKey, results)) {
+            // Use yt-dlp to get video info
+            std::string ytdlpPath = GetYtDlpPath();
+            std::string cmd = "\"" + ytdlpPath + "\" --no-download -j \"" + query + "\"";
+
+            bool completed = false;
+            std::string output = RunProcess(cmd, 30000, &cancel, nullptr, &completed);
+            if (cancel.IsCancelled()) return false;
+            if (!output.empty()) {
+                // Parse each line as a JSON object (playlists may have multiple)
+                std::istringstream iss(output);
+                std::string line;
+                while (std::getline(iss, line)) {
+                    YouTubeSearchResult r;
+                    if (ParseYouTubeResultLine(line, r)) {
+                        results.push_back(std::move(r));
+                        infoLines.push_back(std::move(line));
+                    }
+                }
             }
+            // A lookup cut short by an error or the timeout is used, not kept
+            if (completed) StoreCachedResults(cacheKey, results);
         }
 
         if (results.empty()) {
@@ -200,116 +94,200 @@ bool YouTubeSource::Resolve(const char* input, std::vector<DownloadItem>& items,
             return false;
         }
 
-        std::vector<int> selectedIndices;
-        int qualityIdx = 0;
-        if (!ShowSelectionDialog(results, selectedIndices, qualityIdx)) {
+        // Nothing more to page in: the dialog just shows the lookup
+        auto feed = std::make_shared<YouTubeResultsFeed>();
+        feed->results = results;
+        feed->searching = false;
+        feed->exhausted = true;
+        OpenResultsDialog(feed);
+        auto outcome = CollectResultsFeed(*feed, 0, 0, cancel, [](size_t, size_t) { return (size_t)0; });
+        if (outcome != ResultsFeedOutcome::Selected) {
             errorMsg = "";
             return false;
         }
 
-        if (selectedIndices.empty()) {
+        if (feed->selected.empty()) {
             errorMsg = "No tracks selected.";
             return false;
         }
 
-        for (int idx : selectedIndices) {
-            const auto& r = results[idx];
-            DownloadItem item;
-            item.url = "https://www.youtube.com/watch?v=" + r.id;
-            item.title = r.artist.empty() ? r.title : (r.artist + " - " + r.title);
-            item.artist = r.artist;
-            item.useYtDlp = true;
-            item.audioFormat = g_qualities[qualityIdx].format;
-            item.audioQuality = g_qualities[qualityIdx].quality;
-            items.push_back(std::move(item));
+        int qualityIdx = feed->qualityIdx;
+        if (qualityIdx < 0 || qualityIdx >= g_ytQualityCount) qualityIdx = 0;
+        for (int idx : feed->selected) {
+            if (idx < 0 || idx >= (int)results.size()) continue;
+            // The download starts from this lookup instead of extracting again
+            if (!infoLines.empty()) StoreYtDlpInfo(results[idx].id, infoLines[idx]);
+            items.push_back(MakeItem(results[idx], qualityIdx));
         }
         return true;
     }
 
-    // Search mode
-    auto results = Search(query, errorMsg);
-    if (results.empty()) {
+    // Search mode: the dialog opens right away, fills in as yt-dlp prints and
+    // asks for the next page when scrolled near its end
+    auto feed = std::make_shared<YouTubeResultsFeed>();
+    feed->stop.parent = &cancel;
+    OpenResultsDialog(feed);
+
+    auto outcome = CollectResultsFeed(*feed, FIRST_PAGE_SIZE, NEXT_PAGE_SIZE, cancel,
+        [&](size_t offset, size_t count) {
+            std::string pageError;
+            auto page = Search(query, offset, count, pageError, feed->stop,
+                [&feed](const YouTubeSearchResult& r) { AddToResultsFeed(*feed, r); });
+            if (offset == 0) errorMsg = pageError;
+            return page.size();
+        });
+    if (outcome == ResultsFeedOutcome::NoResults) {
         if (errorMsg.empty()) errorMsg = "No results found for: " + query;
         return false;
     }
-
-    std::vector<int> selectedIndices;
-    int qualityIdx = 0;
-    if (!ShowSelectionDialog(results, selectedIndices, qualityIdx)) {
+    if (outcome != ResultsFeedOutcome::Selected) {
         errorMsg = "";
         return false;
     }
 
-    if (selectedIndices.empty()) {
+    std::lock_guard<std::mutex> lock(feed->mutex);
+    if (feed->selected.empty()) {
         errorMsg = "No tracks selected.";
         return false;
     }
 
-    for (int idx : selectedIndices) {
-        const auto& r = results[idx];
+    int qualityIdx = feed->qualityIdx;
+    if (qualityIdx < 0 || qualityIdx >= g_ytQualityCount) qualityIdx = 0;
+    for (int idx : feed->selected) {
+        if (idx >= 0 && idx < (int)feed->results.size()) items.push_back(MakeItem(feed->results[idx], qualityIdx));
+    }
+
+    return true;
+}
+#endif
+
+bool YouTubeSource::ResolveUnattended(const char* input, std::vector<DownloadItem>& items, std::string& errorMsg,
+                                      const ResolveCancel& cancel) {
+    if (!input || !*input) {
+        errorMsg = "Empty query.";
+        return false;
+    }
+    if (!EnsureYtDlp(errorMsg)) return false;
+
+    int qualityIdx = GetConfigYtQuality();
+    if (qualityIdx < 0 || qualityIdx >= g_ytQualityCount) qualityIdx = 0;
+
+    std::string query(input);
+    if (IsYouTubeUrl(query)) {
+        // No metadata lookup: the download itself reports the real title
         DownloadItem item;
-        item.url = "https://www.youtube.com/watch?v=" + r.id;
-        item.title = r.artist.empty() ? r.title : (r.artist + " - " + r.title);
-        item.artist = r.artist;
+        item.url = query;
+        item.title = query;
         item.useYtDlp = true;
-        item.audioFormat = g_qualities[qualityIdx].format;
-        item.audioQuality = g_qualities[qualityIdx].quality;
+        item.audioFormat = g_ytQualities[qualityIdx].format;
+        item.audioQuality = g_ytQualities[qualityIdx].quality;
         items.push_back(std::move(item));
+        return true;
     }
 
+    // No dialog in bulk mode: the top hit is taken
+    auto results = Search(query, 0, FIRST_PAGE_SIZE, errorMsg, cancel);
+    if (cancel.IsCancelled()) return false;
+    if (results.empty()) {
+        if (errorMsg.empty()) errorMsg = "No results found for: " + query;
+        return false;
+    }
+    items.push_back(MakeItem(results[0], qualityIdx));
     return true;
 }
 
-std::vector<YouTubeSearchResult> YouTubeSource::Search(const std::string& query, std::string& errorMsg) {
+void YouTubeSource::Prefetch(const char* input, const ResolveCancel& cancel) {
+    // Only searches: a pasted URL is looked up once Search is pressed. Never
+    // starts the yt-dlp download EnsureYtDlp() would.
+    if (!input || !*input || IsYouTubeUrl(input) || !PathExists(GetYtDlpPath())) return;
+    std::string errorMsg;
+    Search(input, 0, FIRST_PAGE_SIZE, errorMsg, cancel);
+}
+
+bool YouTubeSource::IsYouTubeUrl(const std::string& input) {
+    // Also matches music.youtube.com
+    return input.find("youtube.com/") != std::string::npos ||
+           input.find("youtu.be/") != std::string::npos;
+}
+
+DownloadItem YouTubeSource::MakeItem(const YouTubeSearchResult& r, int qualityIdx) {
+    DownloadItem item;
+    item.url = "https://www.youtube.com/watch?v=" + r.id;
+    item.title = r.artist.empty() ? r.title : (r.artist + " - " + r.title);
+    item.artist = r.artist;
+    item.useYtDlp = true;
+    item.audioFormat = g_ytQualities[qualityIdx].format;
+    item.audioQuality = g_ytQualities[qualityIdx].quality;
+    return item;
+}
+
+std::vector<YouTubeSearchResult> YouTubeSource::Search(const std::string& query, size_t offset, size_t count,
+                                                       std::string& errorMsg, const ResolveCancel& cancel,
+                                                       const ResultCallback& onResult) {
+    static MetricHistogram& firstResultHistogram = Metrics().Histogram("foo_downloader_search_seconds",
+        "Time from starting a search to its first and to its last result", { { "until", "first_result" } });
+    static MetricHistogram& totalHistogram = Metrics().Histogram("foo_downloader_search_seconds",
+        "Time from starting a search to its first and to its last result", { { "until", "done" } });
+
     std::vector<YouTubeSearchResult> results;
 
+    std::string cacheKey = SearchCacheKey(GetId(), query, offset, count);
+    if (FindCachedResults(cacheKey, results)) {
+        LogLine() << "[foo_downloader] YouTube search: " << query.c_str() << " [" << (uint32_t)(offset + 1) << "-"
+                  << (uint32_t)(offset + count) << "] (" << (uint32_t)results.size() << " cached result(s))";
+        if (onResult) {
+            for (const auto& r : results) onResult(r);
+        }
+        return results;
+    }
+
     std::string ytdlpPath = GetYtDlpPath();
-    FB2K_console_formatter() << "[foo_downloader] YouTube search: " << query.c_str();
+    LogLine() << "[foo_downloader] YouTube search: " << query.c_str() << " [" << (uint32_t)(offset + 1) << "-"
+              << (uint32_t)(offset + count) << "]";
+
+    // Use --flat-playlist for fast search. A page is a range of the first
+    // offset+count hits; yt-dlp fetches the search pages lazily, so earlier
+    // entries cost no lookups. Each line is a JSON object, handed on as soon
+    // as it is printed rather than when the process exits.
+    std::string cmd = "\"" + ytdlpPath + "\" \"ytsearch" + std::to_string(offset + count) + ":" + query + "\"" +
+                      " --playlist-start " + std::to_string(offset + 1) + " --playlist-end " + std::to_string(offset + count) +
+                      " --flat-playlist -j --no-download --no-warnings";
+    uint64_t startUs = MetricNowMicros();
+    uint64_t firstUs = 0;
+    bool completed = false;
+    std::string output = RunProcess(cmd, 30000, &cancel, [&](const std::string& line) {
+        YouTubeSearchResult r;
+        if (!ParseYouTubeResultLine(line, r) || r.title.empty()) return;
+        if (results.empty()) {
+            firstUs = MetricNowMicros() - startUs;
+            firstResultHistogram.Record(firstUs);
+        }
+        results.push_back(std::move(r));
+        if (onResult) onResult(results.back());
+    }, &completed);
+    uint64_t totalUs = MetricNowMicros() - startUs;
 
-    // Use --flat-playlist for fast search
-    std::string cmd = "\"" + ytdlpPath + "\" \"ytsearch15:" + query + "\" --flat-playlist -j --no-download --no-warnings";
-    std::string output = RunProcess(cmd, 30000);
+    // Stopped early: what arrived is shown, but not remembered as the answer
+    if (cancel.IsCancelled()) return results;
 
     if (output.empty()) {
         errorMsg = "yt-dlp search failed. Check console for details.";
         return results;
     }
 
-    // Each line is a JSON object
-    std::istringstream iss(output);
-    std::string line;
-    while (std::getline(iss, line)) {
-        if (line.empty() || line[0] != '{') continue;
-
-        YouTubeSearchResult r;
-        r.id = ExtractJsonString(line, "id");
-        r.title = ExtractJsonString(line, "title");
-        r.artist = ExtractJsonString(line, "channel");
-        if (r.artist.empty()) r.artist = ExtractJsonString(line, "uploader");
-        r.duration = ExtractJsonInt(line, "duration");
-        r.viewCount = ExtractJsonInt64(line, "view_count");
-        r.uploadDate = ExtractJsonString(line, "upload_date");
-
-        if (!r.id.empty() && !r.title.empty()) {
-            results.push_back(std::move(r));
-        }
+    // A page cut short by an error or the timeout is shown, but only a clean
+    // run is remembered: a short cached page would read as the last one
+    if (!completed) {
+        LogLine() << "[foo_downloader] YouTube: search incomplete, " << (uint32_t)results.size() << " result(s)";
+        return results;
     }
 
-    FB2K_console_formatter() << "[foo_downloader] YouTube: found " << (uint32_t)results.size() << " result(s)";
-    return results;
-}
+    totalHistogram.Record(totalUs);
+    StoreCachedResults(cacheKey, results);
 
-bool YouTubeSource::ShowSelectionDialog(const std::vector<YouTubeSearchResult>& results,
-                                         std::vector<int>& selectedIndices,
-                                         int& qualityIdx) {
-    CYouTubeResultsDialog dlg(results);
-    if (dlg.DoModal(core_api::get_main_window()) == IDOK) {
-        selectedIndices = dlg.m_selected;
-        qualityIdx = dlg.m_qualityIdx;
-        if (qualityIdx < 0 || qualityIdx >= g_numQualities) qualityIdx = 0;
-        return true;
-    }
-    return false;
+    LogLine() << "[foo_downloader] YouTube: found " << (uint32_t)results.size() << " result(s) in "
+              << (uint32_t)(totalUs / 1000) << " ms (first after " << (uint32_t)(firstUs / 1000) << " ms)";
+    return results;
 }
 
 // ============================================================================
@@ -317,31 +295,25 @@ bool YouTubeSource::ShowSelectionDialog(const std::vector<YouTubeSearchResult>&
 // ============================================================================
 
 std::string YouTubeSource::GetYtDlpPath() {
-    // Look for yt-dlp.exe next to our DLL
-    char dllPath[MAX_PATH] = {};
-    HMODULE hMod = NULL;
-    GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
-                       (LPCSTR)&GetYtDlpPath, &hMod);
-    if (hMod) {
-        GetModuleFileNameA(hMod, dllPath, MAX_PATH);
-        std::string dir(dllPath);
-        auto lastSlash = dir.find_last_of("\\/");
-        if (lastSlash != std::string::npos) {
-            dir = dir.substr(0, lastSlash + 1);
-        }
-        return dir + "yt-dlp.exe";
-    }
-    return "yt-dlp.exe";
+    // A path set in the preferences wins; otherwise yt-dlp.exe next to our
+    // DLL (on Linux, the one on PATH)
+    const char* cfgPath = GetConfigYtDlpPath();
+    if (cfgPath && *cfgPath) return cfgPath;
+    return FindTool("yt-dlp");
 }
 
 bool YouTubeSource::EnsureYtDlp(std::string& errorMsg) {
+    // Concurrent resolves must not race each other downloading the same file
+    static std::mutex s_downloadMutex;
+    std::lock_guard<std::mutex> lock(s_downloadMutex);
+
     std::string path = GetYtDlpPath();
-    DWORD attr = GetFileAttributesA(path.c_str());
-    if (attr != INVALID_FILE_ATTRIBUTES) {
+    if (PathExists(path)) {
         return true; // Already exists
     }
 
-    FB2K_console_formatter() << "[foo_downloader] yt-dlp.exe not found, downloading...";
+#ifdef _WIN32
+    LogLine() << "[foo_downloader] yt-dlp.exe not found, downloading...";
 
     if (!DownloadYtDlp()) {
         errorMsg = "Failed to download yt-dlp.exe. Please place it manually next to the component DLL.";
@@ -349,14 +321,17 @@ bool YouTubeSource::EnsureYtDlp(std::string& errorMsg) {
     }
 
     // Verify it exists now
-    attr = GetFileAttributesA(path.c_str());
-    if (attr == INVALID_FILE_ATTRIBUTES) {
+    if (!PathExists(path)) {
         errorMsg = "yt-dlp.exe download seemed to succeed but file not found.";
         return false;
     }
 
-    FB2K_console_formatter() << "[foo_downloader] yt-dlp.exe downloaded successfully.";
+    LogLine() << "[foo_downloader] yt-dlp.exe downloaded successfully.";
     return true;
+#else
+    errorMsg = "yt-dlp not found. Install it or set its path.";
+    return false;
+#endif
 }
 
 bool YouTubeSource::DownloadYtDlp() {
@@ -368,28 +343,16 @@ bool YouTubeSource::DownloadYtDlp() {
         "[Net.ServicePointManager]::SecurityProtocol = [Net.SecurityProtocolType]::Tls12; "
         "Invoke-WebRequest -Uri '" + url + "' -OutFile '" + destPath + "'\"";
 
-    FB2K_console_formatter() << "[foo_downloader] Downloading yt-dlp.exe...";
+    LogLine() << "[foo_downloader] Downloading yt-dlp.exe...";
 
-    STARTUPINFOA si = {};
-    si.cb = sizeof(si);
-    si.dwFlags = STARTF_USESHOWWINDOW;
-    si.wShowWindow = SW_HIDE;
-    PROCESS_INFORMATION pi = {};
-
-    std::vector<char> cmdBuf(psCmd.begin(), psCmd.end());
-    cmdBuf.push_back(0);
-
-    if (!CreateProcessA(NULL, cmdBuf.data(), NULL, NULL, FALSE, CREATE_NO_WINDOW, NULL, NULL, &si, &pi)) {
-        FB2K_console_formatter() << "[foo_downloader] Failed to start PowerShell for yt-dlp download.";
+    ChildProcess powershell;
+    if (!powershell.Start(psCmd, false)) {
+        LogLine() << "[foo_downloader] Failed to start PowerShell for yt-dlp download.";
         return false;
     }
 
-    WaitForSingleObject(pi.hProcess, 120000); // 2 min timeout
-    DWORD exitCode = 1;
-    GetExitCodeProcess(pi.hProcess, &exitCode);
-    CloseHandle(pi.hProcess);
-    CloseHandle(pi.hThread);
-
+    int exitCode = 1;
+    powershell.Wait(120000, exitCode); // 2 min timeout
     return exitCode == 0;
 }
 
@@ -397,175 +360,87 @@ bool YouTubeSource::DownloadYtDlp() {
 // Process execution utility
 // ============================================================================
 
-std::string YouTubeSource::RunProcess(const std::string& cmdLine, int timeoutMs) {
-    SECURITY_ATTRIBUTES sa = {};
-    sa.nLength = sizeof(sa);
-    sa.bInheritHandle = TRUE;
+std::string YouTubeSource::RunProcess(const std::string& cmdLine, int timeoutMs, const ResolveCancel* cancel,
+                                      const std::function<void(const std::string&)>& onLine, bool* completed) {
+    if (completed) *completed = false;
 
-    HANDLE hReadPipe = NULL, hWritePipe = NULL;
-    if (!CreatePipe(&hReadPipe, &hWritePipe, &sa, 0)) {
+    // A warm worker when there is one, see ytdlp_worker.h. This is a resolve
+    // worker, so it can wait for the one-time version probe.
+    ProbeYtDlpVersion(GetYtDlpPath());
+    YtDlpRun process;
+    if (!process.Start(cmdLine)) {
+        LogLine() << "[foo_downloader] Failed to run: " << cmdLine.c_str();
         return "";
     }
-    SetHandleInformation(hReadPipe, HANDLE_FLAG_INHERIT, 0);
-
-    STARTUPINFOA si = {};
-    si.cb = sizeof(si);
-    si.dwFlags = STARTF_USESTDHANDLES | STARTF_USESHOWWINDOW;
-    si.hStdOutput = hWritePipe;
-    si.hStdError = hWritePipe;
-    si.wShowWindow = SW_HIDE;
-
-    PROCESS_INFORMATION pi = {};
-
-    std::vector<char> cmdBuf(cmdLine.begin(), cmdLine.end());
-    cmdBuf.push_back(0);
 
-    if (!CreateProcessA(NULL, cmdBuf.data(), NULL, NULL, TRUE, CREATE_NO_WINDOW, NULL, NULL, &si, &pi)) {
-        CloseHandle(hReadPipe);
-        CloseHandle(hWritePipe);
-        FB2K_console_formatter() << "[foo_downloader] Failed to run: " << cmdLine.c_str();
-        return "";
-    }
-
-    CloseHandle(hWritePipe); // Close write end in parent
-    CloseHandle(pi.hThread);
-
-    // Non-blocking read loop with message pumping to keep UI responsive
+    // Runs on a resolve worker, so polling the pipe here blocks no UI
     std::string output;
-    DWORD startTime = GetTickCount();
+    size_t lineStart = 0;   // First byte of output not yet passed to onLine
+    uint64_t startTime = TickMs();
+
+    // Hand complete lines (or, once the process is gone, the rest) to onLine
+    auto deliverLines = [&](bool flush) {
+        if (!onLine) return;
+        size_t end;
+        while ((end = output.find('\n', lineStart)) != std::string::npos) {
+            size_t len = end - lineStart;
+            if (len > 0 && output[end - 1] == '\r') len--;
+            onLine(output.substr(lineStart, len));
+            lineStart = end + 1;
+        }
+        if (flush && lineStart < output.size()) {
+            onLine(output.substr(lineStart));
+            lineStart = output.size();
+        }
+    };
 
     while (true) {
-        // Pump Windows messages so foobar2000 doesn't freeze
-        MSG msg;
-        while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE)) {
-            TranslateMessage(&msg);
-            DispatchMessage(&msg);
+        if (cancel && cancel->IsCancelled()) {
+            process.Terminate();
+            output.clear();
+            break;
         }
 
         // Check for data on pipe
-        DWORD avail = 0;
-        if (PeekNamedPipe(hReadPipe, NULL, 0, NULL, &avail, NULL) && avail > 0) {
-            char buf[4096];
-            DWORD toRead = (avail < sizeof(buf) - 1) ? avail : (DWORD)(sizeof(buf) - 1);
-            DWORD bytesRead = 0;
-            if (ReadFile(hReadPipe, buf, toRead, &bytesRead, NULL) && bytesRead > 0) {
-                buf[bytesRead] = 0;
-                output += buf;
-            }
+        size_t before = output.size();
+        process.ReadAvailable(output);
+        if (output.size() > before) {
+            deliverLines(false);
             continue; // Keep reading if data was available
         }
 
         // Check if process has exited
-        DWORD exitCode = STILL_ACTIVE;
-        GetExitCodeProcess(pi.hProcess, &exitCode);
-        if (exitCode != STILL_ACTIVE) {
+        int exitCode = 0;
+        if (process.HasExited(exitCode)) {
             // Drain any remaining pipe data
-            while (PeekNamedPipe(hReadPipe, NULL, 0, NULL, &avail, NULL) && avail > 0) {
-                char buf[4096];
-                DWORD toRead = (avail < sizeof(buf) - 1) ? avail : (DWORD)(sizeof(buf) - 1);
-                DWORD bytesRead = 0;
-                if (ReadFile(hReadPipe, buf, toRead, &bytesRead, NULL) && bytesRead > 0) {
-                    buf[bytesRead] = 0;
-                    output += buf;
-                } else {
-                    break;
-                }
-            }
+            process.ReadAvailable(output);
+            deliverLines(true);
 
             if (exitCode != 0) {
-                FB2K_console_formatter() << "[foo_downloader] yt-dlp exited with code " << (uint32_t)exitCode;
+                LogLine() << "[foo_downloader] yt-dlp exited with code " << exitCode;
+            } else if (completed) {
+                *completed = true;
             }
             break;
         }
 
         // Timeout check
-        if (GetTickCount() - startTime > (DWORD)timeoutMs) {
-            FB2K_console_formatter() << "[foo_downloader] yt-dlp timed out after " << timeoutMs << "ms";
-            TerminateProcess(pi.hProcess, 1);
+        if (TickMs() - startTime > (uint64_t)timeoutMs) {
+            LogLine() << "[foo_downloader] yt-dlp timed out after " << timeoutMs << "ms";
+            process.Terminate();
             break;
         }
 
-        Sleep(10); // Don't spin too hard
+        SleepMs(10); // Don't spin too hard
     }
 
-    CloseHandle(hReadPipe);
-    CloseHandle(pi.hProcess);
-
     return output;
 }
 
 // ============================================================================
-// JSON helpers (minimal, same pattern as FLAC downloader)
+// Display helpers
 // ============================================================================
 
-std::string YouTubeSource::ExtractJsonString(const std::string& json, const std::string& key) {
-    std::string search = "\"" + key + "\": \"";
-    auto pos = json.find(search);
-    if (pos == std::string::npos) {
-        search = "\"" + key + "\":\"";
-        pos = json.find(search);
-        if (pos == std::string::npos) return "";
-    }
-    pos += search.size();
-
-    std::string result;
-    while (pos < json.size()) {
-        char c = json[pos];
-        if (c == '"') break;
-        if (c == '\\' && pos + 1 < json.size()) {
-            char next = json[pos + 1];
-            if (next == '\\') { result += '\\'; pos += 2; continue; }
-            if (next == '"')  { result += '"';  pos += 2; continue; }
-            if (next == '/')  { result += '/';  pos += 2; continue; }
-            if (next == 'n')  { result += '\n'; pos += 2; continue; }
-            if (next == 'r')  { result += '\r'; pos += 2; continue; }
-            if (next == 't')  { result += '\t'; pos += 2; continue; }
-            result += next; pos += 2; continue;
-        }
-        result += c;
-        pos++;
-    }
-    return result;
-}
-
-int YouTubeSource::ExtractJsonInt(const std::string& json, const std::string& key) {
-    std::string search = "\"" + key + "\": ";
-    auto pos = json.find(search);
-    if (pos == std::string::npos) {
-        search = "\"" + key + "\":";
-        pos = json.find(search);
-        if (pos == std::string::npos) return 0;
-    }
-    pos += search.size();
-    while (pos < json.size() && json[pos] == ' ') pos++;
-
-    std::string num;
-    while (pos < json.size() && (isdigit(json[pos]) || json[pos] == '-')) {
-        num += json[pos++];
-    }
-    if (num.empty()) return 0;
-    try { return std::stoi(num); } catch (...) { return 0; }
-}
-
-int64_t YouTubeSource::ExtractJsonInt64(const std::string& json, const std::string& key) {
-    std::string search = "\"" + key + "\": ";
-    auto pos = json.find(search);
-    if (pos == std::string::npos) {
-        search = "\"" + key + "\":";
-        pos = json.find(search);
-        if (pos == std::string::npos) return 0;
-    }
-    pos += search.size();
-    while (pos < json.size() && json[pos] == ' ') pos++;
-
-    std::string num;
-    while (pos < json.size() && (isdigit(json[pos]) || json[pos] == '-')) {
-        num += json[pos++];
-    }
-    if (num.empty()) return 0;
-    try { return std::stoll(num); } catch (...) { return 0; }
-}
-
 std::string YouTubeSource::FormatViewCount(int64_t count) {
     if (count <= 0) return "-";
     if (count >= 1000000000) {
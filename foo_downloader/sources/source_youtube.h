@@ -1,25 +1,25 @@
 #pragma once
 
 #include "../source_provider.h"
+#include "../search_results.h"
+#include "results_feed.h"
+#include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 
-struct YouTubeSearchResult {
-    std::string id;         // Video ID
-    std::string title;
-    std::string artist;     // Channel/uploader
-    std::string album;
-    int duration = 0;       // Seconds
-    int64_t viewCount = 0;
-    std::string uploadDate; // YYYYMMDD from yt-dlp
-};
-
 struct YouTubeQuality {
     const char* label;      // Display name
     const char* format;     // yt-dlp --audio-format value
     const char* quality;    // yt-dlp --audio-quality value
 };
 
+// Indexed by the yt_quality preference and the results dialog's combo box
+extern const YouTubeQuality g_ytQualities[];
+extern const int g_ytQualityCount;
+
+using YouTubeResultsFeed = ResultsFeed<YouTubeSearchResult>;
+
 class YouTubeSource : public ISourceProvider {
 public:
     const char* GetId() const override { return "youtube"; }
@@ -27,7 +27,13 @@ public:
     const char* GetDescription() const override { return "Search and download audio from YouTube"; }
     const char* GetActionLabel() const override { return "Search"; }
 
-    bool Resolve(const char* input, std::vector<DownloadItem>& items, std::string& errorMsg) override;
+    bool Resolve(const char* input, std::vector<DownloadItem>& items, std::string& errorMsg,
+                 const ResolveCancel& cancel) override;
+    bool ResolveUnattended(const char* input, std::vector<DownloadItem>& items, std::string& errorMsg,
+                           const ResolveCancel& cancel) override;
+    // Each resolve is a yt-dlp (Python) process
+    int GetBulkParallelism() const override { return 2; }
+    void Prefetch(const char* input, const ResolveCancel& cancel) override;
 
     static std::string GetYtDlpPath();
     static bool EnsureYtDlp(std::string& errorMsg);
@@ -35,14 +41,25 @@ public:
     static std::string FormatUploadDate(const std::string& yyyymmdd);
 
 private:
-    std::vector<YouTubeSearchResult> Search(const std::string& query, std::string& errorMsg);
-    bool ShowSelectionDialog(const std::vector<YouTubeSearchResult>& results,
-                             std::vector<int>& selectedIndices,
-                             int& qualityIdx);
+    // `count` results starting at result `offset`. `onResult` sees each
+    // result as soon as yt-dlp prints it (cached ones included), while the
+    // search is still running.
+    using ResultCallback = std::function<void(const YouTubeSearchResult&)>;
+    std::vector<YouTubeSearchResult> Search(const std::string& query, size_t offset, size_t count,
+                                            std::string& errorMsg, const ResolveCancel& cancel,
+                                            const ResultCallback& onResult = nullptr);
+    // Opens the results dialog on `feed` (component only, see
+    // source_youtube_dialog.cpp)
+    static void OpenResultsDialog(const std::shared_ptr<YouTubeResultsFeed>& feed);
 
-    static std::string RunProcess(const std::string& cmdLine, int timeoutMs = 30000);
+    static bool IsYouTubeUrl(const std::string& input);
+    static DownloadItem MakeItem(const YouTubeSearchResult& r, int qualityIdx);
+    // `onLine`, if set, gets each line of output as it arrives. `completed`,
+    // if set, tells whether the process exited with code 0 by itself; the
+    // output of one that failed, timed out or was cancelled may be partial.
+    static std::string RunProcess(const std::string& cmdLine, int timeoutMs = 30000,
+                                  const ResolveCancel* cancel = nullptr,
+                                  const std::function<void(const std::string&)>& onLine = nullptr,
+                                  bool* completed = nullptr);
     static bool DownloadYtDlp();
-    static std::string ExtractJsonString(const std::string& json, const std::string& key);
-    static int ExtractJsonInt(const std::string& json, const std::string& key);
-    static int64_t ExtractJsonInt64(const std::string& json, const std::string& key);
 };
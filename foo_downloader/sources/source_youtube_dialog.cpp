@@ -0,0 +1,224 @@
+#include "../stdafx.h"
+#include "source_youtube.h"
+#include "../resource.h"
+#include "../main_thread.h"
+
+#include <helpers/atl-misc.h>
+#include <helpers/DarkMode.h>
+#include <commctrl.h>
+#include <shellapi.h>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+
+// ============================================================================
+// Search results selection dialog with quality picker
+// ============================================================================
+
+// Scrolling to within this many rows of the end fetches the next page
+static const int LOAD_MORE_MARGIN = 5;
+
+// Modeless, so rows can be added while it is open; see results_feed.h
+class CYouTubeResultsDialog : public CDialogImpl<CYouTubeResultsDialog> {
+public:
+    enum { IDD = IDD_YT_SEARCH_RESULTS };
+
+    explicit CYouTubeResultsDialog(std::shared_ptr<YouTubeResultsFeed> feed)
+        : m_feed(std::move(feed)) {}
+
+    BEGIN_MSG_MAP_EX(CYouTubeResultsDialog)
+        MSG_WM_INITDIALOG(OnInitDialog)
+        MSG_WM_DESTROY(OnDestroy)
+        COMMAND_ID_HANDLER_EX(IDOK, OnOk)
+        COMMAND_ID_HANDLER_EX(IDCANCEL, OnCancel)
+        NOTIFY_HANDLER_EX(IDC_YT_RESULTS_LIST, NM_DBLCLK, OnListDblClick)
+        NOTIFY_HANDLER_EX(IDC_YT_RESULTS_LIST, LVN_ENDSCROLL, OnListScrolled)
+        NOTIFY_HANDLER_EX(IDC_YT_RESULTS_LIST, LVN_ITEMCHANGED, OnListScrolled)
+    END_MSG_MAP()
+
+    BOOL OnInitDialog(CWindow, LPARAM) {
+        m_dark.AddDialogWithControls(*this);
+        CenterWindow(GetParent());
+        // Modeless: foobar2000 routes Tab/Enter/Esc to it only when registered
+        modeless_dialog_manager::g_add(m_hWnd);
+
+        // Setup ListView
+        CListViewCtrl list(GetDlgItem(IDC_YT_RESULTS_LIST));
+        list.SetExtendedListViewStyle(LVS_EX_FULLROWSELECT | LVS_EX_DOUBLEBUFFER | LVS_EX_CHECKBOXES);
+
+        list.InsertColumn(0, L"Title", LVCFMT_LEFT, 170);
+        list.InsertColumn(1, L"Artist", LVCFMT_LEFT, 90);
+        list.InsertColumn(2, L"Duration", LVCFMT_LEFT, 48);
+        list.InsertColumn(3, L"Views", LVCFMT_RIGHT, 58);
+        list.InsertColumn(4, L"URL", LVCFMT_LEFT, 150);
+
+        // Setup quality dropdown
+        CComboBox combo(GetDlgItem(IDC_YT_QUALITY_COMBO));
+        for (int i = 0; i < g_ytQualityCount; i++) {
+            pfc::stringcvt::string_wide_from_utf8 wLabel(g_ytQualities[i].label);
+            combo.AddString(wLabel);
+        }
+        combo.SetCurSel(0);
+
+        m_feed->refresh = [this]() { Refresh(); };
+        Refresh();
+        return FALSE;
+    }
+
+    // Append the rows that arrived since the last call and update the info line
+    void Refresh() {
+        std::vector<YouTubeSearchResult> added;
+        bool searching, exhausted, closed;
+        {
+            std::lock_guard<std::mutex> lock(m_feed->mutex);
+            m_feed->refreshPosted = false;
+            closed = m_feed->closed;
+            added.assign(m_feed->results.begin() + m_ids.size(), m_feed->results.end());
+            searching = m_feed->searching;
+            exhausted = m_feed->exhausted;
+        }
+        if (closed) {
+            // Closed by the worker: cancelled, or nothing found
+            DestroyWindow();
+            return;
+        }
+
+        CListViewCtrl list(GetDlgItem(IDC_YT_RESULTS_LIST));
+        for (const auto& r : added) {
+            int i = (int)m_ids.size();
+            m_ids.push_back(r.id);
+
+            pfc::stringcvt::string_wide_from_utf8 wTitle(r.title.c_str());
+            list.InsertItem(i, wTitle);
+
+            pfc::stringcvt::string_wide_from_utf8 wArtist(r.artist.c_str());
+            list.SetItemText(i, 1, wArtist);
+
+            // Duration
+            char durBuf[16];
+            if (r.duration >= 3600) {
+                snprintf(durBuf, sizeof(durBuf), "%d:%02d:%02d", r.duration / 3600, (r.duration % 3600) / 60, r.duration % 60);
+            } else {
+                snprintf(durBuf, sizeof(durBuf), "%d:%02d", r.duration / 60, r.duration % 60);
+            }
+            pfc::stringcvt::string_wide_from_utf8 wDur(durBuf);
+            list.SetItemText(i, 2, wDur);
+
+            // View count
+            std::string views = YouTubeSource::FormatViewCount(r.viewCount);
+            pfc::stringcvt::string_wide_from_utf8 wViews(views.c_str());
+            list.SetItemText(i, 3, wViews);
+
+            // URL
+            std::string url = "youtube.com/watch?v=" + r.id;
+            pfc::stringcvt::string_wide_from_utf8 wUrl(url.c_str());
+            list.SetItemText(i, 4, wUrl);
+        }
+
+        // Info text
+        pfc::string_formatter info;
+        if (searching) {
+            info << "Searching... " << (unsigned)m_ids.size() << " result(s) so far. Select tracks to download:";
+        } else if (!exhausted) {
+            info << "Showing " << (unsigned)m_ids.size() << " result(s); scroll down for more. Select tracks to download:";
+        } else {
+            info << "Found " << (unsigned)m_ids.size() << " result(s). Select tracks to download:";
+        }
+        uSetDlgItemText(*this, IDC_YT_RESULTS_INFO, info);
+
+        // A short first page may not even fill the list
+        if (!searching) CheckNearEnd();
+    }
+
+    // Ask for the next page once the last rows are in view
+    void CheckNearEnd() {
+        CListViewCtrl list(GetDlgItem(IDC_YT_RESULTS_LIST));
+        int lastVisible = list.GetTopIndex() + list.GetCountPerPage();
+        int focused = list.GetNextItem(-1, LVNI_FOCUSED);
+        if ((std::max)(lastVisible, focused) + LOAD_MORE_MARGIN >= (int)m_ids.size()) {
+            WantMoreResults(*m_feed);
+        }
+    }
+
+    LRESULT OnListScrolled(LPNMHDR) {
+        CheckNearEnd();
+        return 0;
+    }
+
+    LRESULT OnListDblClick(LPNMHDR pnmh) {
+        LPNMITEMACTIVATE pItem = (LPNMITEMACTIVATE)pnmh;
+        int idx = pItem->iItem;
+        if (idx >= 0 && idx < (int)m_ids.size()) {
+            std::string url = "https://www.youtube.com/watch?v=" + m_ids[idx];
+            pfc::stringcvt::string_wide_from_utf8 wUrl(url.c_str());
+            ShellExecuteW(NULL, L"open", wUrl, NULL, NULL, SW_SHOWNORMAL);
+        }
+        return 0;
+    }
+
+    void OnOk(UINT, int, CWindow) {
+        CListViewCtrl list(GetDlgItem(IDC_YT_RESULTS_LIST));
+        std::vector<int> selected;
+        for (int i = 0; i < (int)m_ids.size(); i++) {
+            if (list.GetCheckState(i)) {
+                selected.push_back(i);
+            }
+        }
+
+        CComboBox combo(GetDlgItem(IDC_YT_QUALITY_COMBO));
+        int qualityIdx = combo.GetCurSel();
+        if (qualityIdx < 0) qualityIdx = 0;
+
+        CloseResultsFeed(*m_feed, true, std::move(selected), qualityIdx);
+        DestroyWindow();
+    }
+
+    void OnCancel(UINT, int, CWindow) {
+        CloseResultsFeed(*m_feed, false);
+        DestroyWindow();
+    }
+
+    void OnDestroy() {
+        modeless_dialog_manager::g_remove(m_hWnd);
+        // Also reached when foobar2000 closes with the dialog still open
+        CloseResultsFeed(*m_feed, false);
+        m_feed->refresh = nullptr;
+    }
+
+    void OnFinalMessage(HWND) override {
+        delete this;
+    }
+
+private:
+    std::shared_ptr<YouTubeResultsFeed> m_feed;
+    std::vector<std::string> m_ids;     // Rows shown so far
+    fb2k::CDarkModeHooks m_dark;
+};
+
+// ============================================================================
+// Opening the dialog (component only; see source_youtube.cpp)
+// ============================================================================
+
+void YouTubeSource::OpenResultsDialog(const std::shared_ptr<YouTubeResultsFeed>& feed) {
+    // Resolve runs on a worker thread; the dialog has to live on the main one
+    std::weak_ptr<YouTubeResultsFeed> weak = feed;
+    feed->notify = [weak]() {
+        PostToMainThread([weak]() {
+            auto feed = weak.lock();
+            // A copy: the dialog drops `refresh` when a refresh destroys it
+            auto refresh = feed ? feed->refresh : nullptr;
+            if (refresh) refresh();
+        });
+    };
+
+    PostToMainThread([feed]() {
+        auto* dlg = new CYouTubeResultsDialog(feed);
+        if (!dlg->Create(core_api::get_main_window())) {
+            delete dlg;
+            CloseResultsFeed(*feed, false);
+            return;
+        }
+        dlg->ShowWindow(SW_SHOW);
+    });
+}
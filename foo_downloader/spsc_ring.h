@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// ============================================================================
+// Lock-free single-producer / single-consumer ring buffer
+// ============================================================================
+// Exactly one thread may call TryPush() and exactly one (other) thread may
+// call TryPop(). Neither side ever blocks: a full ring rejects the push and
+// leaves the item with the caller, an empty ring rejects the pop.
+//
+// Capacity must be a power of two. Head and tail are free-running counters,
+// so all Capacity slots are usable.
+// ============================================================================
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    // Producer side. On success the item is moved into the ring; on failure
+    // (ring full) it is left untouched.
+    bool TryPush(T&& item) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) >= Capacity) return false;
+        m_slots[tail & (Capacity - 1)] = std::move(item);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side
+    bool TryPop(T& out) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) return false;
+        out = std::move(m_slots[head & (Capacity - 1)]);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool IsEmpty() const {
+        return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+    }
+
+private:
+    T m_slots[Capacity];
+    alignas(64) std::atomic<size_t> m_head{ 0 };   // Next slot to pop (consumer)
+    alignas(64) std::atomic<size_t> m_tail{ 0 };   // Next slot to push (producer)
+};
@@ -0,0 +1,123 @@
+#include "trace.h"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct TraceEvent {
+    const char* name = nullptr;
+    uint64_t start = 0;
+    uint64_t duration = 0;
+};
+
+// Written only by its thread; `written` is published with release so a
+// dump sees complete events. A dump racing a wrap-around may see a span
+// that is being overwritten; that span is garbage, the rest are fine.
+struct ThreadRing {
+    uint32_t tid = 0;
+    std::string threadName;
+    std::unique_ptr<TraceEvent[]> events{ new TraceEvent[TRACE_RING_SIZE] };
+    std::atomic<uint64_t> written{ 0 };
+};
+
+// Rings outlive their threads so spans of finished threads still dump
+std::mutex g_ringsMutex;
+std::vector<std::shared_ptr<ThreadRing>> g_rings;
+
+ThreadRing& CurrentRing() {
+    thread_local std::shared_ptr<ThreadRing> ring;
+    if (!ring) {
+        ring = std::make_shared<ThreadRing>();
+        std::lock_guard<std::mutex> lock(g_ringsMutex);
+        ring->tid = (uint32_t)g_rings.size() + 1;
+        g_rings.push_back(ring);
+    }
+    return *ring;
+}
+
+void AppendJsonString(std::string& out, const std::string& s) {
+    out += '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') { out += '\\'; out += c; }
+        else if ((unsigned char)c < 0x20) out += ' ';
+        else out += c;
+    }
+    out += '"';
+}
+
+} // namespace
+
+uint64_t TraceNowMicros() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void TraceRecord(const char* name, uint64_t startMicros, uint64_t endMicros) {
+    ThreadRing& ring = CurrentRing();
+    uint64_t n = ring.written.load(std::memory_order_relaxed);
+    TraceEvent& e = ring.events[n % TRACE_RING_SIZE];
+    e.name = name;
+    e.start = startMicros;
+    e.duration = endMicros - startMicros;
+    ring.written.store(n + 1, std::memory_order_release);
+}
+
+void TraceSetThreadName(const char* name) {
+    if (!TRACE_ENABLED) return;
+    ThreadRing& ring = CurrentRing();
+    std::lock_guard<std::mutex> lock(g_ringsMutex);
+    ring.threadName = name;
+}
+
+bool TraceWriteChromeJson(const std::string& path) {
+    std::vector<std::shared_ptr<ThreadRing>> rings;
+    {
+        std::lock_guard<std::mutex> lock(g_ringsMutex);
+        rings = g_rings;
+    }
+
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    auto separator = [&]() {
+        if (!first) out += ",";
+        first = false;
+        out += "\n";
+    };
+
+    for (const auto& ring : rings) {
+        std::string threadName;
+        {
+            std::lock_guard<std::mutex> lock(g_ringsMutex);
+            threadName = ring->threadName;
+        }
+        if (threadName.empty()) threadName = "thread " + std::to_string(ring->tid);
+        separator();
+        out += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(ring->tid)
+             + ",\"args\":{\"name\":";
+        AppendJsonString(out, threadName);
+        out += "}}";
+
+        uint64_t written = ring->written.load(std::memory_order_acquire);
+        uint64_t begin = written > TRACE_RING_SIZE ? written - TRACE_RING_SIZE : 0;
+        for (uint64_t i = begin; i < written; i++) {
+            const TraceEvent& e = ring->events[i % TRACE_RING_SIZE];
+            if (!e.name) continue;
+            separator();
+            out += "{\"name\":";
+            AppendJsonString(out, e.name);
+            out += ",\"ph\":\"X\",\"pid\":1,\"tid\":" + std::to_string(ring->tid)
+                 + ",\"ts\":" + std::to_string(e.start) + ",\"dur\":" + std::to_string(e.duration) + "}";
+        }
+    }
+    out += "\n]}\n";
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) return false;
+    file << out;
+    return (bool)file;
+}
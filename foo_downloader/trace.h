@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// ============================================================================
+// Scoped trace spans
+// ============================================================================
+// Off by default. Build with FOO_DOWNLOADER_TRACE=1 (C/C++ > Preprocessor)
+// to record spans; otherwise TraceSpan is an empty type and TRACE_SCOPE
+// compiles to nothing.
+//
+// Each thread records into its own fixed-size ring, so tracing never takes
+// a lock after a thread's first span; when a ring is full the oldest spans
+// are overwritten. TraceWriteChromeJson() dumps every ring as Chrome
+// trace-event JSON, which loads in Perfetto (ui.perfetto.dev) or
+// chrome://tracing.
+// ============================================================================
+
+#ifndef FOO_DOWNLOADER_TRACE
+#define FOO_DOWNLOADER_TRACE 0
+#endif
+
+constexpr bool TRACE_ENABLED = FOO_DOWNLOADER_TRACE != 0;
+
+// Spans kept per thread
+static const size_t TRACE_RING_SIZE = 16384;
+
+uint64_t TraceNowMicros();
+// `name` must be a string literal (only the pointer is stored)
+void TraceRecord(const char* name, uint64_t startMicros, uint64_t endMicros);
+// Label for the calling thread in the trace viewer
+void TraceSetThreadName(const char* name);
+// Returns false if the file could not be written
+bool TraceWriteChromeJson(const std::string& path);
+
+template <bool Enabled>
+class BasicTraceSpan {
+public:
+    explicit BasicTraceSpan(const char* name) : m_name(name), m_start(TraceNowMicros()) {}
+    ~BasicTraceSpan() { TraceRecord(m_name, m_start, TraceNowMicros()); }
+
+    BasicTraceSpan(const BasicTraceSpan&) = delete;
+    BasicTraceSpan& operator=(const BasicTraceSpan&) = delete;
+
+private:
+    const char* m_name;
+    uint64_t m_start;
+};
+
+template <>
+class BasicTraceSpan<false> {
+public:
+    explicit BasicTraceSpan(const char*) {}
+};
+
+using TraceSpan = BasicTraceSpan<TRACE_ENABLED>;
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceSpan TRACE_CONCAT(traceSpan_, __LINE__)(name)
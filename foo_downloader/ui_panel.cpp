@@ -3,6 +3,7 @@
 #include "resource.h"
 #include "download_manager.h"
 #include "source_manager.h"
+#include "trace.h"
 
 #include <libPPUI/win32_utility.h>
 #include <libPPUI/win32_op.h>
@@ -18,6 +19,17 @@ static const int TOOLBAR_HEIGHT = 24;
 static const int STATUSBAR_HEIGHT = 18;
 static const int MARGIN = 2;
 
+// Older history is pulled from the database in pages of this size once the
+// list is scrolled within HISTORY_PREFETCH_ROWS of its top.
+static const int HISTORY_PAGE_SIZE = 100;
+static const int HISTORY_PREFETCH_ROWS = 10;
+
+// Search-as-you-type: the input is searched in the background once it has
+// been left alone this long, and only from this many characters on
+static const UINT_PTR PREFETCH_TIMER_ID = 2;
+static const UINT PREFETCH_DELAY_MS = 600;
+static const size_t PREFETCH_MIN_CHARS = 3;
+
 enum {
     ID_CTX_PLAY = 5000,
     ID_CTX_OPEN_FOLDER,
@@ -25,8 +37,13 @@ enum {
     ID_CTX_CANCEL,
     ID_CTX_PAUSE,
     ID_CTX_RESUME,
+    ID_CTX_BULK_IMPORT,
+    ID_CTX_LATENCY_STATS,
 };
 
+extern void ShowBulkImportDialog(HWND parent);
+extern bool GetConfigSearchPrefetch();
+
 class CDownloaderPanel : public CDialogImpl<CDownloaderPanel>, public ui_element_instance {
 public:
     CDownloaderPanel(ui_element_config::ptr cfg, ui_element_instance_callback::ptr cb)
@@ -42,6 +59,8 @@ public:
         COMMAND_HANDLER_EX(IDC_DOWNLOAD_BTN, BN_CLICKED, OnDownloadClick)
         COMMAND_HANDLER_EX(IDC_CLEAR_COMPLETED_BTN, BN_CLICKED, OnClearClick)
         COMMAND_HANDLER_EX(IDC_SOURCE_COMBO, CBN_SELCHANGE, OnSourceChanged)
+        COMMAND_HANDLER_EX(IDC_URL_INPUT, EN_CHANGE, OnUrlChanged)
+        NOTIFY_HANDLER_EX(IDC_QUEUE_LIST, LVN_ENDSCROLL, OnQueueScroll)
         MSG_WM_CONTEXTMENU(OnContextMenu)
     END_MSG_MAP()
 
@@ -87,6 +106,12 @@ private:
         PopulateSourceCombo();
 
         InitListView();
+        auto& mgr = DownloadManager::instance();
+        m_historyBoundary = mgr.GetHistoryWindowStart();
+        m_updateToken = mgr.AddUpdateListener([this](const std::vector<DownloadUpdate>& updates) {
+            ApplyUpdates(updates);
+        });
+        RefreshDownloadList();
         SetTimer(1, 500);
 
         return FALSE;
@@ -94,7 +119,8 @@ private:
 
     void OnDestroy() {
         KillTimer(1);
-
+        KillTimer(PREFETCH_TIMER_ID);
+        DownloadManager::instance().RemoveUpdateListener(m_updateToken);
     }
 
     void OnSize(UINT, CSize size) {
@@ -152,7 +178,25 @@ private:
     }
 
     void OnTimer(UINT_PTR id) {
-        if (id == 1) RefreshDownloadList();
+        if (id == 1) {
+            // Progress arrives as per-entry deltas; anything else is pulled
+            // from the manager's change log when the list version moves.
+            // The log goes first, so rows it adds get this tick's progress.
+            auto& mgr = DownloadManager::instance();
+            if (mgr.GetListVersion() != m_listVersion) {
+                SyncChanges();
+            }
+            mgr.DispatchUpdates();
+            LoadOlderHistoryIfNeeded();
+        } else if (id == PREFETCH_TIMER_ID) {
+            KillTimer(PREFETCH_TIMER_ID);
+            StartPrefetch();
+        }
+    }
+
+    LRESULT OnQueueScroll(LPNMHDR) {
+        LoadOlderHistoryIfNeeded();
+        return 0;
     }
 
     void OnDownloadClick(UINT, int, CWindow) {
@@ -174,19 +218,45 @@ private:
             return;
         }
 
+        KillTimer(PREFETCH_TIMER_ID);
         if (DownloadManager::instance().StartDownload(sourceId, url.get_ptr())) {
+            // Not an edit: a prefetch of what was just submitted is kept
+            m_clearingInput = true;
             uSetDlgItemText(*this, IDC_URL_INPUT, "");
+            m_clearingInput = false;
         }
     }
 
+    // Restart the idle countdown on every keystroke
+    void OnUrlChanged(UINT, int, CWindow) {
+        if (m_clearingInput || !GetConfigSearchPrefetch()) return;
+        SetTimer(PREFETCH_TIMER_ID, PREFETCH_DELAY_MS);
+    }
+
+    void StartPrefetch() {
+        CComboBox combo(GetDlgItem(IDC_SOURCE_COMBO));
+        int selIdx = combo.GetCurSel();
+        if (selIdx < 0 || selIdx >= (int)m_enabledSources.size()) return;
+
+        pfc::string8 text;
+        uGetDlgItemText(*this, IDC_URL_INPUT, text);
+        std::string input(text.get_ptr());
+        // Too short to be worth a search: only drop the stale one
+        if (input.size() < PREFETCH_MIN_CHARS) input.clear();
+        DownloadManager::instance().Prefetch(m_enabledSources[selIdx]->GetId(), input);
+    }
+
     void OnClearClick(UINT, int, CWindow) {
         DownloadManager::instance().ClearCompleted();
-        RefreshDownloadList();
+        DropOlderHistory();
+        SyncChanges();
     }
 
     void OnSourceChanged(UINT, int, CWindow) {
         CComboBox combo(GetDlgItem(IDC_SOURCE_COMBO));
         UpdateButtonLabel(combo.GetCurSel());
+        // The same text means other results on another source
+        if (GetConfigSearchPrefetch()) SetTimer(PREFETCH_TIMER_ID, PREFETCH_DELAY_MS);
     }
 
     void PopulateSourceCombo() {
@@ -225,12 +295,34 @@ private:
         LVHITTESTINFO hti = {};
         hti.pt = clientPt;
         int idx = list.HitTest(&hti);
-        if (idx < 0) return;
+        if (idx < 0) {
+            // Empty space below the rows
+            CMenu menu;
+            menu.CreatePopupMenu();
+            menu.AppendMenu(MF_STRING, ID_CTX_BULK_IMPORT, L"Bulk import...");
+            menu.AppendMenu(MF_STRING, ID_CTX_LATENCY_STATS, L"Latency statistics");
+            int cmd = menu.TrackPopupMenu(TPM_RETURNCMD | TPM_NONOTIFY, pt.x, pt.y, m_hWnd);
+            if (cmd == ID_CTX_BULK_IMPORT) {
+                ShowBulkImportDialog(m_hWnd);
+                SyncChanges();
+            } else if (cmd == ID_CTX_LATENCY_STATS) {
+                std::string report = FormatLatencyReport(DownloadManager::instance().GetLatencySummary());
+                popup_message::g_show(report.c_str(), "foo_downloader: download latency");
+            }
+            return;
+        }
 
-        auto downloads = DownloadManager::instance().GetDownloads();
-        if (idx >= (int)downloads.size()) return;
+        // Rows above the in-memory window are paged-in history
+        const int olderCount = (int)m_olderRows.size();
+        const bool isOlder = idx < olderCount;
 
-        const auto& dl = downloads[idx];
+        DownloadEntry dl;
+        if (isOlder) {
+            dl = m_olderRows[idx];
+        } else {
+            if (idx - olderCount >= (int)m_rows.size()) return;
+            dl = m_rows[idx - olderCount];
+        }
 
         // Build context menu based on status
         CMenu menu;
@@ -243,15 +335,23 @@ private:
         }
 
         if (dl.status == "active" || dl.status == "queued") {
-            if (dl.engine == "aria2") {
+            // Followers share another entry's transfer and can't pause it
+            if (dl.engine == "aria2" && dl.leaderId == 0) {
                 menu.AppendMenu(MF_STRING, ID_CTX_PAUSE, L"Pause");
             }
             menu.AppendMenu(MF_STRING, ID_CTX_CANCEL, L"Cancel");
             menu.AppendMenu(MF_SEPARATOR);
         }
 
+        if (dl.status == "resolving") {
+            menu.AppendMenu(MF_STRING, ID_CTX_CANCEL, L"Cancel");
+            menu.AppendMenu(MF_SEPARATOR);
+        }
+
         if (dl.status == "paused") {
-            menu.AppendMenu(MF_STRING, ID_CTX_RESUME, L"Resume");
+            if (dl.leaderId == 0) {
+                menu.AppendMenu(MF_STRING, ID_CTX_RESUME, L"Resume");
+            }
             menu.AppendMenu(MF_STRING, ID_CTX_CANCEL, L"Cancel");
             menu.AppendMenu(MF_SEPARATOR);
         }
@@ -264,18 +364,25 @@ private:
             PlayFile(dl.outputPath);
         } else if (cmd == ID_CTX_OPEN_FOLDER) {
             OpenContainingFolder(dl.outputPath);
+        } else if (cmd == ID_CTX_REMOVE && isOlder) {
+            DownloadManager::instance().RemoveHistoryEntry(dl.historyId);
+            m_olderRows.erase(m_olderRows.begin() + idx);
+            list.DeleteItem(idx);
+            UpdateStatusBar();
+        } else if (isOlder) {
+            return;
         } else if (cmd == ID_CTX_PAUSE) {
-            DownloadManager::instance().PauseByIndex(idx);
-            RefreshDownloadList();
+            DownloadManager::instance().PauseById(dl.id);
+            SyncChanges();
         } else if (cmd == ID_CTX_RESUME) {
-            DownloadManager::instance().ResumeByIndex(idx);
-            RefreshDownloadList();
+            DownloadManager::instance().ResumeById(dl.id);
+            SyncChanges();
         } else if (cmd == ID_CTX_CANCEL) {
-            DownloadManager::instance().CancelByIndex(idx);
-            RefreshDownloadList();
+            DownloadManager::instance().CancelById(dl.id);
+            SyncChanges();
         } else if (cmd == ID_CTX_REMOVE) {
-            DownloadManager::instance().RemoveByIndex(idx);
-            RefreshDownloadList();
+            DownloadManager::instance().RemoveById(dl.id);
+            SyncChanges();
         }
     }
 
@@ -331,14 +438,30 @@ private:
     }
 
     void RefreshDownloadList() {
+        TRACE_SCOPE("RefreshDownloadList");
         CListViewCtrl list(GetDlgItem(IDC_QUEUE_LIST));
         if (!list.IsWindow()) return;
 
-        auto downloads = DownloadManager::instance().GetDownloads();
+        auto& mgr = DownloadManager::instance();
+
+        // The manager moved its in-memory window; rows we paged in may now
+        // overlap or leave a gap, so start paging again from the new boundary.
+        int64_t boundary = mgr.GetHistoryWindowStart();
+        if (boundary != m_historyBoundary) {
+            DropOlderHistory();
+            m_historyBoundary = boundary;
+        }
+
+        // Read the list version first: a change racing with GetDownloads()
+        // then just causes one more sync on the next tick.
+        m_listVersion = mgr.GetListVersion();
+        m_rows = mgr.GetDownloads(&m_changeVersion);
 
-        // Only rebuild if count changed, otherwise update in-place
+        // Paged-in history occupies the top rows and is written once when
+        // loaded; only the in-memory rows below it are refreshed here.
+        const int olderCount = (int)m_olderRows.size();
         int existingCount = list.GetItemCount();
-        int newCount = (int)downloads.size();
+        int newCount = olderCount + (int)m_rows.size();
 
         // Add/remove rows to match
         while (existingCount < newCount) {
@@ -350,52 +473,89 @@ private:
             list.DeleteItem(existingCount);
         }
 
+        for (int i = 0; i < (int)m_rows.size(); i++) {
+            SetRowText(list, olderCount + i, m_rows[i]);
+        }
+
+        UpdateStatusBar();
+    }
+
+    // Pull inserted/updated/removed entries since the last sync; falls back
+    // to a full refresh only if the change log has moved past us.
+    void SyncChanges() {
+        CListViewCtrl list(GetDlgItem(IDC_QUEUE_LIST));
+        if (!list.IsWindow()) return;
+
+        auto& mgr = DownloadManager::instance();
+
+        // A moved history window invalidates the paged-in rows; let the full
+        // refresh handle it.
+        if (mgr.GetHistoryWindowStart() != m_historyBoundary) {
+            RefreshDownloadList();
+            return;
+        }
+
+        uint64_t listVersion = mgr.GetListVersion();
+        DownloadChanges changes = mgr.GetChangesSince(m_changeVersion);
+        if (changes.resync) {
+            RefreshDownloadList();
+            return;
+        }
+        m_listVersion = listVersion;
+        m_changeVersion = changes.version;
+
+        const int olderCount = (int)m_olderRows.size();
+        for (uint64_t id : changes.removed) {
+            int i = FindRow(id);
+            if (i < 0) continue;
+            m_rows.erase(m_rows.begin() + i);
+            list.DeleteItem(olderCount + i);
+        }
+        for (auto& entry : changes.inserted) {
+            int i = (int)m_rows.size();
+            m_rows.push_back(std::move(entry));
+            list.InsertItem(olderCount + i, L"");
+            SetRowText(list, olderCount + i, m_rows[i]);
+        }
+        ApplyUpdates(changes.updated);
+    }
+
+    // Apply a batch of coalesced deltas, rewriting only the rows they touch
+    void ApplyUpdates(const std::vector<DownloadUpdate>& updates) {
+        CListViewCtrl list(GetDlgItem(IDC_QUEUE_LIST));
+        if (!list.IsWindow()) return;
+
+        const int olderCount = (int)m_olderRows.size();
+        for (const auto& u : updates) {
+            int i = FindRow(u.id);
+            if (i < 0) continue;
+            ApplyDownloadUpdate(m_rows[i], u);
+            SetRowText(list, olderCount + i, m_rows[i]);
+        }
+
+        UpdateStatusBar();
+    }
+
+    int FindRow(uint64_t id) const {
+        for (int i = 0; i < (int)m_rows.size(); i++) {
+            if (m_rows[i].id == id) return i;
+        }
+        return -1;
+    }
+
+    void UpdateStatusBar() {
         uint64_t totalSpeed = 0;
         int activeCount = 0;
         int completeCount = 0;
         int errorCount = 0;
+        int newCount = (int)(m_olderRows.size() + m_rows.size());
 
-        for (int i = 0; i < newCount; i++) {
-            const auto& dl = downloads[i];
-
-            pfc::stringcvt::string_wide_from_utf8 wTitle(dl.title.c_str());
-            list.SetItemText(i, 0, wTitle);
-
-            // Format status display
-            std::string statusDisplay;
-            if (dl.status == "active") statusDisplay = "Downloading";
-            else if (dl.status == "complete") statusDisplay = "Done";
-            else if (dl.status == "error") statusDisplay = "Failed";
-            else if (dl.status == "queued") statusDisplay = "Queued";
-            else if (dl.status == "paused") statusDisplay = "Paused";
-            else statusDisplay = dl.status;
-
-            pfc::stringcvt::string_wide_from_utf8 wStatus(statusDisplay.c_str());
-            list.SetItemText(i, 1, wStatus);
-
-            // Format progress
-            char progBuf[32];
-            if (dl.status == "complete") {
-                snprintf(progBuf, sizeof(progBuf), "100%%");
-            } else if (dl.totalSize > 0) {
-                snprintf(progBuf, sizeof(progBuf), "%.1f%%", dl.progress);
-            } else if (dl.status == "active") {
-                snprintf(progBuf, sizeof(progBuf), "...");
-            } else {
-                progBuf[0] = '-'; progBuf[1] = 0;
-            }
-            pfc::stringcvt::string_wide_from_utf8 wProg(progBuf);
-            list.SetItemText(i, 2, wProg);
-
-            // Format speed
-            char speedBuf[32];
-            FormatSpeed(dl.speed, speedBuf, sizeof(speedBuf));
-            pfc::stringcvt::string_wide_from_utf8 wSpeed(speedBuf);
-            list.SetItemText(i, 3, wSpeed);
-
-            pfc::stringcvt::string_wide_from_utf8 wSource(dl.sourceId.c_str());
-            list.SetItemText(i, 4, wSource);
+        for (const auto& dl : m_olderRows) {
+            if (dl.status == "complete") completeCount++;
+            else if (dl.status == "error") errorCount++;
+        }
 
+        for (const auto& dl : m_rows) {
             if (dl.status == "active") {
                 totalSpeed += dl.speed;
                 activeCount++;
@@ -427,6 +587,85 @@ private:
         uSetDlgItemText(*this, IDC_STATUS_BAR, statusMsg);
     }
 
+    void SetRowText(CListViewCtrl& list, int i, const DownloadEntry& dl) {
+        pfc::stringcvt::string_wide_from_utf8 wTitle(dl.title.c_str());
+        list.SetItemText(i, 0, wTitle);
+
+        // Format status display
+        std::string statusDisplay;
+        if (dl.status == "active") statusDisplay = "Downloading";
+        else if (dl.status == "complete") statusDisplay = "Done";
+        else if (dl.status == "error") statusDisplay = "Failed";
+        else if (dl.status == "queued") statusDisplay = dl.errorMessage.empty() ? "Queued" : "Retrying";
+        else if (dl.status == "paused") statusDisplay = "Paused";
+        else if (dl.status == "resolving") statusDisplay = "Resolving";
+        else statusDisplay = dl.status;
+
+        pfc::stringcvt::string_wide_from_utf8 wStatus(statusDisplay.c_str());
+        list.SetItemText(i, 1, wStatus);
+
+        // Format progress
+        char progBuf[32];
+        if (dl.status == "complete") {
+            snprintf(progBuf, sizeof(progBuf), "100%%");
+        } else if (dl.totalSize > 0 || (dl.status == "resolving" && dl.progress > 0)) {
+            snprintf(progBuf, sizeof(progBuf), "%.1f%%", dl.progress);
+        } else if (dl.status == "active") {
+            snprintf(progBuf, sizeof(progBuf), "...");
+        } else {
+            progBuf[0] = '-'; progBuf[1] = 0;
+        }
+        pfc::stringcvt::string_wide_from_utf8 wProg(progBuf);
+        list.SetItemText(i, 2, wProg);
+
+        // Format speed
+        char speedBuf[32];
+        FormatSpeed(dl.speed, speedBuf, sizeof(speedBuf));
+        pfc::stringcvt::string_wide_from_utf8 wSpeed(speedBuf);
+        list.SetItemText(i, 3, wSpeed);
+
+        pfc::stringcvt::string_wide_from_utf8 wSource(dl.sourceId.c_str());
+        list.SetItemText(i, 4, wSource);
+    }
+
+    void LoadOlderHistoryIfNeeded() {
+        if (m_historyExhausted) return;
+
+        CListViewCtrl list(GetDlgItem(IDC_QUEUE_LIST));
+        if (!list.IsWindow()) return;
+        if (list.GetItemCount() > 0 && list.GetTopIndex() >= HISTORY_PREFETCH_ROWS) return;
+
+        int64_t beforeId = m_olderRows.empty() ? m_historyBoundary : m_olderRows.front().historyId;
+        auto page = DownloadManager::instance().QueryHistory(beforeId, HISTORY_PAGE_SIZE);
+        if ((int)page.size() < HISTORY_PAGE_SIZE) m_historyExhausted = true;
+        if (page.empty()) return;
+
+        // Pages come back newest first; prepend them oldest first
+        std::reverse(page.begin(), page.end());
+        for (int i = 0; i < (int)page.size(); i++) {
+            list.InsertItem(i, L"");
+            SetRowText(list, i, page[i]);
+        }
+        m_olderRows.insert(m_olderRows.begin(), page.begin(), page.end());
+
+        // Keep the rows the user was looking at in place
+        CRect rcItem;
+        if (list.GetItemRect(0, &rcItem, LVIR_BOUNDS)) {
+            list.Scroll(CSize(0, rcItem.Height() * (int)page.size()));
+        }
+    }
+
+    void DropOlderHistory() {
+        CListViewCtrl list(GetDlgItem(IDC_QUEUE_LIST));
+        if (list.IsWindow()) {
+            for (size_t i = 0; i < m_olderRows.size(); i++) {
+                list.DeleteItem(0);
+            }
+        }
+        m_olderRows.clear();
+        m_historyExhausted = false;
+    }
+
     static void FormatSpeed(uint64_t bytesPerSec, char* buf, size_t bufSize) {
         if (bytesPerSec == 0) {
             snprintf(buf, bufSize, "-");
@@ -442,6 +681,19 @@ private:
     const ui_element_instance_callback::ptr m_callback;
     std::vector<ISourceProvider*> m_enabledSources;
 
+    // Mirror of the manager's in-memory entries, kept current by deltas
+    std::vector<DownloadEntry> m_rows;
+    uint64_t m_listVersion = 0;
+    uint64_t m_changeVersion = 0;
+    int m_updateToken = 0;
+
+    // History rows older than the manager's in-memory window, oldest first
+    std::vector<DownloadEntry> m_olderRows;
+    int64_t m_historyBoundary = 0;
+    bool m_historyExhausted = false;
+
+    bool m_clearingInput = false;   // Emptying the input after a submit
+
     DarkMode::CHooks m_dark;
 };
 
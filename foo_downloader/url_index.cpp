@@ -0,0 +1,178 @@
+#include "url_index.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+
+// ============================================================================
+// URL normalization
+// ============================================================================
+
+static bool IsVideoIdChar(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' || c == '_';
+}
+
+// YouTube video ids are 11 characters of [A-Za-z0-9_-]
+static std::string TakeVideoId(const std::string& s, size_t pos) {
+    size_t end = pos;
+    while (end < s.size() && IsVideoIdChar(s[end])) end++;
+    if (end - pos != 11) return "";
+    return s.substr(pos, 11);
+}
+
+static std::string QueryParam(const std::string& query, const char* name) {
+    std::string key = std::string(name) + "=";
+    size_t pos = 0;
+    while (pos < query.size()) {
+        size_t amp = query.find('&', pos);
+        if (amp == std::string::npos) amp = query.size();
+        if (query.compare(pos, key.size(), key) == 0) {
+            return query.substr(pos + key.size(), amp - pos - key.size());
+        }
+        pos = amp + 1;
+    }
+    return "";
+}
+
+static std::string YouTubeKey(const std::string& host, const std::string& path, const std::string& query) {
+    if (host == "youtu.be") {
+        std::string id = TakeVideoId(path, 1);
+        return id.empty() ? "" : "youtube:" + id;
+    }
+
+    bool isYouTube = host == "youtube.com" || host == "m.youtube.com" || host == "music.youtube.com"
+        || host == "youtube-nocookie.com";
+    if (!isYouTube) return "";
+
+    if (path == "/watch") {
+        std::string v = QueryParam(query, "v");
+        std::string id = TakeVideoId(v, 0);
+        return id.empty() ? "" : "youtube:" + id;
+    }
+
+    for (const char* prefix : { "/shorts/", "/embed/", "/v/", "/live/" }) {
+        size_t len = strlen(prefix);
+        if (path.compare(0, len, prefix) == 0) {
+            std::string id = TakeVideoId(path, len);
+            return id.empty() ? "" : "youtube:" + id;
+        }
+    }
+    return "";
+}
+
+std::string NormalizeUrl(const std::string& url) {
+    size_t b = url.find_first_not_of(" \t\r\n");
+    if (b == std::string::npos) return "";
+    size_t e = url.find_last_not_of(" \t\r\n");
+    std::string s = url.substr(b, e - b + 1);
+
+    // Scheme; bare "youtube.com/watch?v=..." style input is taken as https
+    std::string scheme = "https";
+    size_t sep = s.find("://");
+    if (sep != std::string::npos) {
+        scheme = s.substr(0, sep);
+        for (auto& c : scheme) c = (char)tolower((unsigned char)c);
+        s = s.substr(sep + 3);
+    }
+
+    size_t hash = s.find('#');
+    if (hash != std::string::npos) s.erase(hash);
+
+    size_t pathStart = s.find_first_of("/?");
+    std::string host = s.substr(0, pathStart);
+    std::string rest = pathStart == std::string::npos ? "" : s.substr(pathStart);
+    if (host.empty()) return "";
+
+    // Userinfo never identifies the resource
+    size_t at = host.rfind('@');
+    if (at != std::string::npos) host = host.substr(at + 1);
+    for (auto& c : host) c = (char)tolower((unsigned char)c);
+    if (host.compare(0, 4, "www.") == 0) host = host.substr(4);
+
+    size_t colon = host.rfind(':');
+    if (colon != std::string::npos) {
+        std::string port = host.substr(colon + 1);
+        if ((scheme == "http" && port == "80") || (scheme == "https" && port == "443") ||
+            (scheme == "ftp" && port == "21")) {
+            host.erase(colon);
+        }
+    }
+
+    size_t q = rest.find('?');
+    std::string path = rest.substr(0, q);
+    std::string query = q == std::string::npos ? "" : rest.substr(q + 1);
+    if (path.empty()) path = "/";
+
+    std::string ytKey = YouTubeKey(host, path, query);
+    if (!ytKey.empty()) return ytKey;
+
+    if (sep == std::string::npos) return "";
+    std::string key = scheme + "://" + host + path;
+    if (!query.empty()) key += "?" + query;
+    return key;
+}
+
+std::string UrlEncode(const std::string& str) {
+    std::string result;
+    for (unsigned char c : str) {
+        if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+            result += c;
+        } else if (c == ' ') {
+            result += "%20";
+        } else {
+            char hex[4];
+            snprintf(hex, sizeof(hex), "%%%02X", c);
+            result += hex;
+        }
+    }
+    return result;
+}
+
+// ============================================================================
+// Bloom filter
+// ============================================================================
+
+void BloomFilter::Reset(size_t expectedKeys) {
+    // ~10 bits per key, at least 64 Kbit so a small history doesn't need an
+    // immediate rebuild as it grows
+    uint64_t bits = (std::max)((uint64_t)expectedKeys * 10, (uint64_t)1 << 16);
+    m_bitCount = (bits + 63) & ~(uint64_t)63;
+    m_bits.assign((size_t)(m_bitCount / 64), 0);
+    m_keyCount = 0;
+}
+
+void BloomFilter::Hashes(const std::string& key, uint64_t& h1, uint64_t& h2) const {
+    // Two independent FNV-1a variants; the k probes are h1 + i*h2
+    // (Kirsch-Mitzenmacher), which performs like k independent hashes
+    h1 = 14695981039346656037ULL;
+    h2 = 0x9e3779b97f4a7c15ULL;
+    for (unsigned char c : key) {
+        h1 = (h1 ^ c) * 1099511628211ULL;
+        h2 = (h2 ^ c) * 0x100000001b3ULL;
+        h2 ^= h2 >> 29;
+    }
+    h2 |= 1;
+}
+
+void BloomFilter::Add(const std::string& key) {
+    if (m_bits.empty()) Reset(0);
+    uint64_t h1, h2;
+    Hashes(key, h1, h2);
+    for (int i = 0; i < HASH_COUNT; i++) {
+        uint64_t bit = (h1 + i * h2) % m_bitCount;
+        m_bits[(size_t)(bit / 64)] |= (uint64_t)1 << (bit % 64);
+    }
+    m_keyCount++;
+}
+
+bool BloomFilter::MayContain(const std::string& key) const {
+    if (m_bits.empty()) return false;
+    uint64_t h1, h2;
+    Hashes(key, h1, h2);
+    for (int i = 0; i < HASH_COUNT; i++) {
+        uint64_t bit = (h1 + i * h2) % m_bitCount;
+        if ((m_bits[(size_t)(bit / 64)] & ((uint64_t)1 << (bit % 64))) == 0) return false;
+    }
+    return true;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// URL identity for duplicate detection
+// ============================================================================
+// NormalizeUrl() maps every spelling of the same resource to one key:
+// YouTube links (youtu.be/X, youtube.com/watch?v=X, music.youtube.com,
+// shorts, embeds) become "youtube:X"; other URLs get a lowercased scheme and
+// host, no "www.", no default port and no fragment. Returns "" for input
+// that is not a URL.
+// ============================================================================
+std::string NormalizeUrl(const std::string& url);
+
+// Percent-encode everything but RFC 3986 unreserved characters, for query
+// string values
+std::string UrlEncode(const std::string& str);
+
+// ============================================================================
+// Bloom filter over URL keys
+// ============================================================================
+// Answers "definitely not seen" in O(1) so the history table is only queried
+// for likely duplicates. Sized for an expected key count at ~1% false
+// positives; adding far more keys than that raises the rate but never
+// produces false negatives.
+// ============================================================================
+class BloomFilter {
+public:
+    void Reset(size_t expectedKeys);
+    void Add(const std::string& key);
+    bool MayContain(const std::string& key) const;
+    size_t GetKeyCount() const { return m_keyCount; }
+
+private:
+    static const int HASH_COUNT = 7;       // Optimal for ~10 bits per key
+
+    void Hashes(const std::string& key, uint64_t& h1, uint64_t& h2) const;
+
+    std::vector<uint64_t> m_bits;
+    uint64_t m_bitCount = 0;
+    size_t m_keyCount = 0;
+};
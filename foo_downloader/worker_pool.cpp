@@ -0,0 +1,54 @@
+#include "worker_pool.h"
+#include "host.h"
+#include "trace.h"
+
+bool WorkerPool::Submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stopping) return false;
+
+        if (m_threads.empty()) {
+            for (size_t i = 0; i < m_threadCount; i++) {
+                m_threads.emplace_back(&WorkerPool::WorkerLoop, this);
+            }
+        }
+        m_tasks.push_back(std::move(task));
+    }
+    m_cv.notify_one();
+    return true;
+}
+
+void WorkerPool::Shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stopping) return;
+        m_stopping = true;
+        m_tasks.clear();
+    }
+    m_cv.notify_all();
+
+    for (auto& t : m_threads) {
+        if (t.joinable()) t.join();
+    }
+    m_threads.clear();
+}
+
+void WorkerPool::WorkerLoop() {
+    TraceSetThreadName("worker");
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+            if (m_stopping) return;
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+
+        try {
+            task();
+        } catch (const std::exception& e) {
+            LogLine() << "[foo_downloader] Worker task failed: " << e.what();
+        }
+    }
+}
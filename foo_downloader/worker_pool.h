@@ -0,0 +1,40 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// ============================================================================
+// Fixed-size worker pool for blocking jobs (resolves, searches)
+// ============================================================================
+// Threads are started on the first Submit(), not at construction, so owning
+// singletons can be created during component load.
+// ============================================================================
+class WorkerPool {
+public:
+    explicit WorkerPool(size_t threadCount) : m_threadCount(threadCount ? threadCount : 1) {}
+    ~WorkerPool() { Shutdown(); }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Returns false once Shutdown() has been called
+    bool Submit(std::function<void()> task);
+
+    // Drop queued tasks, wait for running ones to return, join all threads.
+    // Callers must make running tasks return promptly (e.g. cancel flags).
+    void Shutdown();
+
+private:
+    void WorkerLoop();
+
+    const size_t m_threadCount;
+    std::vector<std::thread> m_threads;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_stopping = false;
+};
@@ -0,0 +1,115 @@
+#include "ytdlp_info_cache.h"
+#include "host.h"
+#include "platform.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <mutex>
+
+// YouTube signs stream URLs for about six hours; leave room for downloads
+// that wait in the queue and for slow transfers
+static const int64_t INFO_TTL_SECONDS = 2 * 60 * 60;
+
+static const char* INFO_SUFFIX = ".info.json";
+
+static std::mutex& CacheMutex() {
+    static std::mutex m;
+    return m;
+}
+
+static std::string CacheDirectory() {
+    return HostDataDirectory() + "info_cache";
+}
+
+// Video ids become file names; YouTube's are [A-Za-z0-9_-]{11}
+static bool IsValidId(const std::string& id) {
+    if (id.empty() || id.size() > 64) return false;
+    for (char c : id) {
+        if (!isalnum((unsigned char)c) && c != '_' && c != '-') return false;
+    }
+    return true;
+}
+
+// Files are named "<video id>.<unix time of the lookup>.info.json"
+static bool ParseName(const std::string& name, std::string& id, int64_t& fetchedAt) {
+    size_t suffixLen = strlen(INFO_SUFFIX);
+    if (name.size() <= suffixLen || name.compare(name.size() - suffixLen, suffixLen, INFO_SUFFIX) != 0) {
+        return false;
+    }
+    std::string stem = name.substr(0, name.size() - suffixLen);
+    size_t dot = stem.rfind('.');
+    if (dot == std::string::npos || dot == 0) return false;
+    char* end = nullptr;
+    fetchedAt = strtoll(stem.c_str() + dot + 1, &end, 10);
+    if (*end != '\0') return false;
+    id = stem.substr(0, dot);
+    return true;
+}
+
+// Path for a new entry of `videoId`, "" if the directory can't be created.
+// NOTE: caller must hold CacheMutex()
+static std::string NewEntryPath(const std::string& videoId) {
+    std::string dir = CacheDirectory();
+    if (!MakeDirectory(dir)) return "";
+    int64_t now = (int64_t)time(nullptr);
+
+    // Expired entries of any video, and an older lookup of this one
+    for (const auto& name : ListFiles(dir)) {
+        std::string id;
+        int64_t fetchedAt = 0;
+        if (!ParseName(name, id, fetchedAt)) continue;
+        if (id == videoId || now - fetchedAt > INFO_TTL_SECONDS) RemoveFile(JoinPath(dir, name));
+    }
+    return JoinPath(dir, videoId + "." + std::to_string(now) + INFO_SUFFIX);
+}
+
+void StoreYtDlpInfo(const std::string& videoId, const std::string& infoJson) {
+    if (!IsValidId(videoId) || infoJson.empty()) return;
+
+    std::lock_guard<std::mutex> lock(CacheMutex());
+    std::string path = NewEntryPath(videoId);
+    if (path.empty()) return;
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << infoJson;
+    out.close();
+    if (!out) {
+        LogLine() << "[foo_downloader] Cannot write " << path;
+        RemoveFile(path);
+    }
+}
+
+std::string NewYtDlpInfoPath(const std::string& videoId) {
+    if (!IsValidId(videoId)) return "";
+
+    std::lock_guard<std::mutex> lock(CacheMutex());
+    return NewEntryPath(videoId);
+}
+
+std::string FindYtDlpInfo(const std::string& videoId) {
+    if (!IsValidId(videoId)) return "";
+
+    std::lock_guard<std::mutex> lock(CacheMutex());
+    std::string dir = CacheDirectory();
+    int64_t now = (int64_t)time(nullptr);
+
+    std::string found;
+    for (const auto& name : ListFiles(dir)) {
+        std::string id;
+        int64_t fetchedAt = 0;
+        if (!ParseName(name, id, fetchedAt) || id != videoId) continue;
+        if (now - fetchedAt > INFO_TTL_SECONDS) {
+            RemoveFile(JoinPath(dir, name));
+        } else {
+            found = JoinPath(dir, name);
+        }
+    }
+    return found;
+}
+
+void ForgetYtDlpInfo(const std::string& path) {
+    std::lock_guard<std::mutex> lock(CacheMutex());
+    RemoveFile(path);
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+
+// ============================================================================
+// Info JSON carried from resolve to download
+// ============================================================================
+// Looking up a pasted YouTube URL (`yt-dlp -j`) already does all of the
+// extractor's work: page fetch, player JS, signature decryption. The JSON it
+// prints is kept in <data dir>/info_cache, one file per video id, and the
+// download starts from it with --load-info-json instead of extracting again.
+// A download whose stream aria2 fetches saves its own lookup's JSON here
+// too, so the conversion after the transfer doesn't extract again either.
+// The stream URLs inside are signed and expire, so entries are only used for
+// a couple of hours after the lookup.
+// ============================================================================
+
+// Keep the info JSON printed for `videoId`
+void StoreYtDlpInfo(const std::string& videoId, const std::string& infoJson);
+
+// Where yt-dlp can write a new info JSON for `videoId` itself
+// (--print-to-file), or ""; FindYtDlpInfo() returns it from then on
+std::string NewYtDlpInfoPath(const std::string& videoId);
+
+// Path of a still fresh info JSON for `videoId`, or ""
+std::string FindYtDlpInfo(const std::string& videoId);
+
+// Drop an entry, once downloaded or if the download failed with it
+void ForgetYtDlpInfo(const std::string& path);
@@ -0,0 +1,219 @@
+#include "ytdlp_output.h"
+#include "json_scan.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+// Markers for the lines requested by YtDlpReportingFlags()
+static const char* PROGRESS_MARKER = "[fdl-progress] ";
+static const char* FILE_MARKER = "[fdl-file] ";
+static const char* STREAM_MARKER = "[fdl-stream] ";
+
+// A line longer than this is cut. yt-dlp's lines are a few hundred bytes;
+// the stream line carries a signed URL of up to a few kilobytes.
+static const size_t MAX_LINE_LENGTH = 16384;
+// Non-progress lines kept for error classification
+static const size_t MAX_RECENT_LINES = 32;
+
+static bool StartsWith(const std::string& s, const char* prefix) {
+    return s.compare(0, strlen(prefix), prefix) == 0;
+}
+
+// `line` after `prefix`, without trailing blanks
+static std::string ValueAfter(const std::string& line, const char* prefix) {
+    std::string value = line.substr(strlen(prefix));
+    while (!value.empty() && value.back() == ' ') value.pop_back();
+    return value;
+}
+
+// ============================================================================
+// Templated lines
+// ============================================================================
+
+std::string YtDlpReportingFlags() {
+    // --print implies --quiet, which would also hide progress without
+    // --progress. Fields are JSON-encoded; unknown ones come out as null
+    // (or "NA" on some versions) and are skipped.
+    return std::string("--progress ") +
+        "--progress-template \"download:" + PROGRESS_MARKER +
+            "%(progress.downloaded_bytes)j %(progress.total_bytes)j "
+            "%(progress.total_bytes_estimate)j %(progress.speed)j %(progress.eta)j\" "
+        "--print \"after_move:" + FILE_MARKER + "%(filepath)s\" ";
+}
+
+std::string YtDlpStreamFlags() {
+    // A dict of the chosen format's fields, as JSON; "filename" follows -o
+    return std::string("--print \"video:") + STREAM_MARKER +
+        "%(.{url,protocol,format_id,filename,http_headers,cookies})j\" ";
+}
+
+bool ParseYtDlpStream(const std::string& streamInfo, YtDlpStream& stream) {
+    std::string protocol = JsonString(streamInfo, "protocol");
+    if (protocol != "https" && protocol != "http") return false;
+    if (!JsonString(streamInfo, "cookies").empty()) return false;
+
+    stream.url = JsonString(streamInfo, "url");
+    stream.formatId = JsonString(streamInfo, "format_id");
+    stream.filePath = JsonString(streamInfo, "filename");
+    if (stream.url.empty() || stream.filePath.empty()) return false;
+    if (stream.formatId.find('+') != std::string::npos) return false;
+
+    stream.headers.clear();
+    for (const auto& [name, value] : JsonStringMembers(streamInfo, "http_headers")) {
+        stream.headers.push_back(name + ": " + value);
+    }
+    return true;
+}
+
+// Next space-separated JSON number from `p`; false for null or anything
+// else that isn't a number
+static bool NextJsonNumber(const char*& p, double& value) {
+    while (*p == ' ') p++;
+    const char* start = p;
+    while (*p && *p != ' ') p++;
+    if (start == p) return false;
+    char* end = nullptr;
+    value = strtod(start, &end);
+    return end == p && value >= 0;
+}
+
+bool ParseYtDlpTemplateLine(const std::string& line, YtDlpOutput& state) {
+    if (line.compare(0, strlen(PROGRESS_MARKER), PROGRESS_MARKER) != 0) return false;
+    const char* p = line.c_str() + strlen(PROGRESS_MARKER);
+
+    double downloaded = 0, total = 0, estimate = 0, speed = 0, eta = 0;
+    bool hasDownloaded = NextJsonNumber(p, downloaded);
+    bool hasTotal = NextJsonNumber(p, total) && total > 0;
+    bool hasEstimate = NextJsonNumber(p, estimate) && estimate > 0;
+    bool hasSpeed = NextJsonNumber(p, speed);
+    bool hasEta = NextJsonNumber(p, eta);
+
+    if (hasDownloaded) {
+        state.hasBytes = true;
+        state.downloadedBytes = (uint64_t)downloaded;
+        state.totalBytes = hasTotal ? (uint64_t)total : hasEstimate ? (uint64_t)estimate : 0;
+        if (state.totalBytes > 0) {
+            double pct = downloaded * 100.0 / (double)state.totalBytes;
+            state.progress = pct > 100.0 ? 100.0 : pct;
+            state.hasProgress = true;
+        }
+    }
+    if (hasSpeed) {
+        state.speed = (uint64_t)speed;
+        state.hasSpeed = true;
+    }
+    state.eta = hasEta ? (int64_t)eta : -1;
+    return true;
+}
+
+// ============================================================================
+// Human-readable lines
+// ============================================================================
+
+void ParseYtDlpProgressLine(const std::string& line, YtDlpOutput& state) {
+    auto pctPos = line.find('%');
+    if (pctPos != std::string::npos) {
+        size_t numStart = pctPos;
+        while (numStart > 0 && (isdigit((unsigned char)line[numStart - 1]) || line[numStart - 1] == '.')) {
+            numStart--;
+        }
+        try {
+            state.progress = std::stod(line.substr(numStart, pctPos - numStart));
+            state.hasProgress = true;
+        } catch (...) {}
+    }
+
+    auto atPos = line.find(" at ");
+    if (atPos == std::string::npos) return;
+    std::string speedPart = line.substr(atPos + 4);
+    size_t start = speedPart.find_first_not_of(' ');
+    if (start == std::string::npos) return;
+    speedPart = speedPart.substr(start);
+
+    double speedVal = 0;
+    try { speedVal = std::stod(speedPart); } catch (...) {}
+
+    double unit = 0;
+    if (speedPart.find("GiB/s") != std::string::npos) unit = 1024.0 * 1024 * 1024;
+    else if (speedPart.find("MiB/s") != std::string::npos) unit = 1024.0 * 1024;
+    else if (speedPart.find("KiB/s") != std::string::npos) unit = 1024.0;
+    else if (speedPart.find("B/s") != std::string::npos) unit = 1.0;
+    if (unit == 0) return;
+
+    state.speed = (uint64_t)(speedVal * unit);
+    state.hasSpeed = true;
+}
+
+// ============================================================================
+// Incremental parser
+// ============================================================================
+
+void YtDlpOutputParser::Feed(const char* data, size_t size) {
+    const char* end = data + size;
+    while (data < end) {
+        const char* brk = data;
+        while (brk < end && *brk != '\n' && *brk != '\r') brk++;
+
+        size_t room = MAX_LINE_LENGTH - m_partial.size();
+        size_t take = (size_t)(brk - data);
+        if (take > room) take = room;
+        m_partial.append(data, take);
+        if (brk == end) return;
+
+        // "\r\n" and runs of blank lines end up as empty lines, skipped here
+        if (!m_partial.empty()) ParseLine(m_partial);
+        m_partial.clear();
+        data = brk + 1;
+    }
+}
+
+void YtDlpOutputParser::Finish() {
+    if (!m_partial.empty()) ParseLine(m_partial);
+    m_partial.clear();
+}
+
+void YtDlpOutputParser::ParseLine(const std::string& line) {
+    static const char* DOWNLOAD_DEST = "[download] Destination: ";
+    static const char* EXTRACT_DEST = "[ExtractAudio] Destination: ";
+
+    if (ParseYtDlpTemplateLine(line, m_state)) return;
+
+    if (StartsWith(line, STREAM_MARKER)) {
+        // Too long to be worth keeping for error classification
+        m_state.streamInfo = ValueAfter(line, STREAM_MARKER);
+        return;
+    }
+    if (StartsWith(line, FILE_MARKER)) {
+        m_state.filePath = ValueAfter(line, FILE_MARKER);
+    } else if (StartsWith(line, DOWNLOAD_DEST)) {
+        m_state.downloadPath = ValueAfter(line, DOWNLOAD_DEST);
+    } else if (StartsWith(line, "[download]")) {
+        // Progress lines are most of the output and carry nothing else
+        ParseYtDlpProgressLine(line, m_state);
+        return;
+    } else if (StartsWith(line, EXTRACT_DEST)) {
+        m_state.extractPath = ValueAfter(line, EXTRACT_DEST);
+    } else if (StartsWith(line, "ERROR:")) {
+        m_state.errorLine = line;
+    }
+
+    m_recent.push_back(line);
+    if (m_recent.size() > MAX_RECENT_LINES) m_recent.pop_front();
+}
+
+std::string YtDlpOutputParser::RecentLines() const {
+    std::string text;
+    for (const auto& line : m_recent) {
+        text += line;
+        text += '\n';
+    }
+    return text;
+}
+
+YtDlpOutput ParseYtDlpOutput(const std::string& captured) {
+    YtDlpOutputParser parser;
+    parser.Feed(captured);
+    parser.Finish();
+    return parser.State();
+}
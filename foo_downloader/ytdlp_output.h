@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+// ============================================================================
+// yt-dlp console output
+// ============================================================================
+// State of a download as reported by yt-dlp. StartYtDlpDownload asks for
+// machine-readable lines (see YtDlpReportingFlags()): byte counts, speed
+// and ETA as JSON values, and the final file path once it has been moved
+// into place. The human-readable "[download]  42.3% of 5.12MiB at
+// 1.23MiB/s" and "Destination:" lines are still understood, for older
+// yt-dlp builds and for extra flags that override the template.
+// ============================================================================
+
+struct YtDlpOutput {
+    bool hasProgress = false;
+    double progress = 0.0;      // Percent
+    bool hasSpeed = false;
+    uint64_t speed = 0;         // Bytes/s
+    bool hasBytes = false;
+    uint64_t downloadedBytes = 0;
+    uint64_t totalBytes = 0;    // Exact if yt-dlp knows it, else its estimate; 0 = unknown
+    int64_t eta = -1;           // Seconds, -1 = unknown
+    std::string filePath;       // The finished file, after all post-processing
+    std::string extractPath;    // "[ExtractAudio] Destination: ", the converted file
+    std::string downloadPath;   // "[download] Destination: ", before conversion
+    std::string errorLine;      // Last "ERROR:" line
+    std::string streamInfo;     // JSON printed for YtDlpStreamFlags()
+};
+
+// A format yt-dlp has chosen, for aria2 to fetch in its place
+struct YtDlpStream {
+    std::string url;
+    std::string formatId;
+    std::string filePath;               // Where yt-dlp would have saved it
+    std::vector<std::string> headers;   // "Name: value", as yt-dlp would send them
+};
+
+// Arguments that make yt-dlp print the lines the parser prefers, with a
+// trailing space
+std::string YtDlpReportingFlags();
+
+// Arguments that make a simulated run print the chosen format's URL, request
+// headers and file name (see ParseYtDlpStream()), with a trailing space
+std::string YtDlpStreamFlags();
+
+// The stream described by `streamInfo`; false if aria2 cannot fetch it on
+// its own: fragmented (DASH, HLS) or merged formats, and formats that need
+// cookies
+bool ParseYtDlpStream(const std::string& streamInfo, YtDlpStream& stream);
+
+// Byte counts, speed and ETA from one templated progress line; false if
+// `line` is not one
+bool ParseYtDlpTemplateLine(const std::string& line, YtDlpOutput& state);
+
+// Progress and speed from one "[download] ..." line; fields the line does
+// not carry are left untouched
+void ParseYtDlpProgressLine(const std::string& line, YtDlpOutput& state);
+
+// Parses output as it arrives, one line at a time. Only the unfinished last
+// line and a few recent non-progress lines are kept, so feeding a chunk costs
+// the same however long the download has been running.
+class YtDlpOutputParser {
+public:
+    // Accepts any split of the stream; lines end at '\n' or '\r'
+    void Feed(const char* data, size_t size);
+    void Feed(const std::string& data) { Feed(data.data(), data.size()); }
+
+    // The process has exited: parse a last line that had no line break
+    void Finish();
+
+    const YtDlpOutput& State() const { return m_state; }
+
+    // The most recent lines other than progress lines, oldest first; what
+    // ClassifyYtDlpError() needs to see
+    std::string RecentLines() const;
+
+private:
+    void ParseLine(const std::string& line);
+
+    YtDlpOutput m_state;
+    std::string m_partial;
+    std::deque<std::string> m_recent;
+};
+
+// Everything yt-dlp has printed so far, in one go
+YtDlpOutput ParseYtDlpOutput(const std::string& captured);
@@ -0,0 +1,490 @@
+#include "ytdlp_worker.h"
+#include "host.h"
+#include "json_scan.h"
+#include "trace.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Idle workers are stopped after this long; each holds a Python runtime
+static const uint64_t WORKER_IDLE_TIMEOUT_MS = 3 * 60 * 1000;
+
+// `yt-dlp --version`, once per executable and session
+static const uint64_t VERSION_TIMEOUT_MS = 30000;
+
+// Worker lines meant for us rather than for the caller start with an ASCII
+// record separator, which yt-dlp never prints
+static const char CONTROL_MARK = '\x1e';
+
+// The helper, written next to downloads.db. Each stdin line is a JSON array
+// of yt-dlp arguments; yt-dlp's output follows on stdout, then a control line
+// with its exit status.
+static const char* WORKER_SCRIPT = R"PY(# foo_downloader yt-dlp worker; rewritten by the component, do not edit
+import json, os, sys, zipfile
+
+ytdlp = sys.argv[1] if len(sys.argv) > 1 else ''
+if ytdlp and os.path.isfile(ytdlp) and zipfile.is_zipfile(ytdlp):
+    sys.path.insert(0, ytdlp)   # The zipapp release: run exactly that yt-dlp
+try:
+    import yt_dlp
+    from yt_dlp.version import __version__
+except Exception as e:
+    print('\x1efdl-unavailable %s' % str(e).replace('\n', ' '), flush=True)
+    sys.exit(3)
+print('\x1efdl-ready %s' % __version__, flush=True)
+
+for line in sys.stdin:
+    if not line.strip():
+        continue
+    code = 0
+    try:
+        yt_dlp.main(json.loads(line))
+    except SystemExit as e:
+        if isinstance(e.code, str):
+            sys.stderr.write(e.code + '\n')
+            code = 1
+        else:
+            code = e.code or 0
+    except BaseException as e:
+        sys.stderr.write('ERROR: %s\n' % e)
+        code = 1
+    sys.stderr.flush()
+    print('\x1efdl-exit %d' % code, flush=True)
+)PY";
+
+struct YtDlpWorker {
+    ChildProcess process;
+    std::string key;            // Python and yt-dlp it was started with
+    std::string version;        // What that yt-dlp executable reports
+    bool ready = false;         // Has imported yt_dlp
+    uint64_t idleSince = 0;
+};
+
+// ============================================================================
+// Pool
+// ============================================================================
+
+namespace {
+
+struct WorkerPool {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<YtDlpWorker>> idle;   // Most recently used last
+    std::string unavailableKey;     // Python/yt-dlp pair that cannot run a worker
+    std::string scriptPath;         // Written once per session
+    std::map<std::string, std::string> versions;   // yt-dlp path -> its --version, "" if it did not run
+    std::set<std::string> probing;  // yt-dlp paths ProbeYtDlpVersion() is asking
+};
+
+WorkerPool& Pool() {
+    // Never destroyed: runs may still hand workers back during static
+    // destruction
+    static WorkerPool* pool = new WorkerPool;
+    return *pool;
+}
+
+} // namespace
+
+static std::string PythonPath() {
+    const char* configured = GetConfigPythonPath();
+    if (configured && *configured) return configured;
+    std::string python = FindOnPath("python3");
+    return python.empty() ? FindOnPath("python") : python;
+}
+
+// NOTE: caller must hold the pool mutex
+static bool WriteWorkerScript(WorkerPool& pool) {
+    if (!pool.scriptPath.empty()) return true;
+    std::string path = HostDataDirectory() + "ytdlp_worker.py";
+
+    std::ifstream in(path, std::ios::binary);
+    std::stringstream existing;
+    existing << in.rdbuf();
+    if (existing.str() != WORKER_SCRIPT) {
+        in.close();
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out << WORKER_SCRIPT;
+        if (!out) {
+            LogLine() << "[foo_downloader] Cannot write " << path << "; yt-dlp runs without a worker.";
+            return false;
+        }
+    }
+    pool.scriptPath = path;
+    return true;
+}
+
+// What `ytdlpPath --version` prints, or "" if it does not run. Unless it
+// is the zipapp, the worker imports the yt_dlp module installed for Python,
+// which may be a different release than the executable the settings name
+// (and the component keeps up to date); the two are compared once the
+// worker is up.
+static std::string ExecutableVersion(const std::string& ytdlpPath) {
+    ChildProcess process;
+    if (!process.Start("\"" + ytdlpPath + "\" --version", true)) return "";
+
+    std::string output;
+    uint64_t start = TickMs();
+    while (process.ReadAvailable(output)) {
+        if (TickMs() - start > VERSION_TIMEOUT_MS) {
+            process.Terminate();
+            return "";
+        }
+        SleepMs(10);
+    }
+    int exitCode = -1;
+    if (!process.Wait(1000, exitCode) || exitCode != 0) return "";
+
+    size_t end = output.find_first_of("\r\n");
+    return output.substr(0, end);
+}
+
+void ProbeYtDlpVersion(const std::string& ytdlpPath) {
+    if (!GetConfigYtDlpWorker() || PythonPath().empty()) return;
+
+    WorkerPool& pool = Pool();
+    {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        if (pool.versions.count(ytdlpPath) || !pool.probing.insert(ytdlpPath).second) return;
+    }
+
+    // Asked outside the lock: a one-time cost of one yt-dlp start
+    std::string version = ExecutableVersion(ytdlpPath);
+    if (version.empty()) {
+        LogLine() << "[foo_downloader] Cannot run " << ytdlpPath << " --version; yt-dlp runs without a worker.";
+    }
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    pool.probing.erase(ytdlpPath);
+    pool.versions[ytdlpPath] = version;
+}
+
+static void MarkUnavailable(const std::string& key) {
+    std::lock_guard<std::mutex> lock(Pool().mutex);
+    Pool().unavailableKey = key;
+}
+
+// An idle worker for `ytdlpPath`, or a newly started one; null if jobs have
+// to run one-shot
+static std::unique_ptr<YtDlpWorker> AcquireWorker(const std::string& ytdlpPath) {
+    if (!GetConfigYtDlpWorker()) return nullptr;
+    std::string python = PythonPath();
+    if (python.empty()) return nullptr;
+    std::string key = python + "\n" + ytdlpPath;
+
+    WorkerPool& pool = Pool();
+    std::string script;
+    std::string version;
+    {
+        std::lock_guard<std::mutex> lock(pool.mutex);
+        if (pool.unavailableKey == key) return nullptr;
+
+        while (!pool.idle.empty()) {
+            std::unique_ptr<YtDlpWorker> worker = std::move(pool.idle.back());
+            pool.idle.pop_back();
+            int exitCode = 0;
+            if (worker->key == key && !worker->process.HasExited(exitCode)) return worker;
+            worker->process.Terminate();   // Settings changed, or it died
+        }
+        // Not asked yet, or the executable does not run
+        auto known = pool.versions.find(ytdlpPath);
+        if (known == pool.versions.end() || known->second.empty()) return nullptr;
+        version = known->second;
+
+        if (!WriteWorkerScript(pool)) {
+            pool.unavailableKey = key;
+            return nullptr;
+        }
+        script = pool.scriptPath;
+    }
+
+    auto worker = std::make_unique<YtDlpWorker>();
+    worker->key = key;
+    worker->version = version;
+    // UTF-8 both ways whatever the system code page
+    std::string cmd = "\"" + python + "\" -X utf8 -u \"" + script + "\" \"" + ytdlpPath + "\"";
+    if (!worker->process.Start(cmd, true, true)) {
+        LogLine() << "[foo_downloader] Cannot start " << python << "; yt-dlp runs without a worker.";
+        MarkUnavailable(key);
+        return nullptr;
+    }
+    return worker;
+}
+
+static void ReleaseWorker(std::unique_ptr<YtDlpWorker> worker) {
+    // Enough for every download slot plus a couple of searches
+    size_t keep = (size_t)GetConfigYtDlpMaxJobs() + 2;
+
+    WorkerPool& pool = Pool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    if (pool.idle.size() >= keep) {
+        worker->process.Terminate();
+        return;
+    }
+    worker->idleSince = TickMs();
+    pool.idle.push_back(std::move(worker));
+}
+
+void ReapIdleYtDlpWorkers(uint64_t now) {
+    WorkerPool& pool = Pool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    // Oldest first, so stop at the first one still within its timeout
+    while (!pool.idle.empty() && now - pool.idle.front()->idleSince > WORKER_IDLE_TIMEOUT_MS) {
+        pool.idle.front()->process.Terminate();
+        pool.idle.erase(pool.idle.begin());
+    }
+}
+
+void ShutdownYtDlpWorkers() {
+    WorkerPool& pool = Pool();
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    for (auto& worker : pool.idle) worker->process.Terminate();
+    pool.idle.clear();
+}
+
+// ============================================================================
+// YtDlpRun
+// ============================================================================
+// A reader thread drives each run: it reads the output as it arrives, acts
+// on the worker's control lines (falling back to a process of its own where
+// needed) and collects the exit status, so the end of a run is known the
+// moment it happens rather than at the caller's next poll.
+// ============================================================================
+
+struct YtDlpRun::State {
+    std::string commandLine;
+    std::function<void()> onFinish;
+    std::thread reader;
+    std::string pending;                    // Start of a control line still arriving (reader only)
+
+    // Guards the fields below. The reader holds it while it starts, reaps
+    // or gives back a process, Terminate() while it kills one.
+    std::mutex mutex;
+    ChildProcess process;                   // One-shot mode
+    std::unique_ptr<YtDlpWorker> worker;    // Worker mode
+    std::string output;                     // Read, not yet taken by ReadAvailable()
+    bool done = false;
+    std::atomic<bool> killed{ false };
+    int exitCode = 0;
+};
+
+YtDlpRun::YtDlpRun() = default;
+
+YtDlpRun::~YtDlpRun() {
+    Terminate();
+}
+
+YtDlpRun::YtDlpRun(YtDlpRun&& other) noexcept = default;
+
+YtDlpRun& YtDlpRun::operator=(YtDlpRun&& other) noexcept {
+    if (this != &other) {
+        Terminate();
+        m_state = std::move(other.m_state);
+    }
+    return *this;
+}
+
+bool YtDlpRun::Start(const std::string& commandLine, std::function<void()> onFinish) {
+    Terminate();
+    m_state = std::make_unique<State>();
+    State& s = *m_state;
+    s.commandLine = commandLine;
+    s.onFinish = std::move(onFinish);
+
+    std::vector<std::string> args = SplitCommandLine(commandLine);
+    if (args.empty()) return false;
+
+    s.worker = AcquireWorker(args[0]);
+    if (s.worker) {
+        std::string request = "[";
+        for (size_t i = 1; i < args.size(); i++) {
+            if (i > 1) request += ", ";
+            request += JsonQuote(args[i]);
+        }
+        request += "]\n";
+        if (!s.worker->process.WriteInput(request)) {
+            // Exited before reading anything
+            if (!s.worker->ready) MarkUnavailable(s.worker->key);
+            s.worker->process.Terminate();
+            s.worker.reset();
+        }
+    }
+    if (!s.worker && !s.process.Start(commandLine, true)) return false;
+
+    s.reader = std::thread(&YtDlpRun::ReadLoop, &s);
+    return true;
+}
+
+// Acts on a worker control line other than the exit status; false if the
+// run has to fall back to its own process
+static bool HandleControl(YtDlpWorker& worker, const std::string& line) {
+    if (line.compare(0, 10, "fdl-ready ") == 0) {
+        if (!worker.ready) {
+            std::string version = line.substr(10);
+            if (version != worker.version) {
+                // Another extractor than the one the user picked: don't use it
+                LogLine() << "[foo_downloader] yt-dlp worker imports yt-dlp " << version << " but the executable is "
+                          << worker.version << "; running yt-dlp directly.";
+                MarkUnavailable(worker.key);
+                return false;
+            }
+            worker.ready = true;
+            LogLine() << "[foo_downloader] yt-dlp worker started (yt-dlp " << version << ")";
+        }
+    } else if (line.compare(0, 16, "fdl-unavailable ") == 0) {
+        LogLine() << "[foo_downloader] yt-dlp worker unavailable (" << line.substr(16)
+                  << "); running yt-dlp directly.";
+        MarkUnavailable(worker.key);
+        return false;
+    }
+    return true;
+}
+
+void YtDlpRun::ReadLoop(State* state) {
+    TraceSetThreadName("ytdlp-reader");
+    State& s = *state;
+
+    auto finish = [&s](int exitCode) {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        if (s.worker) ReleaseWorker(std::move(s.worker));
+        s.done = true;
+        s.exitCode = s.killed ? -1 : exitCode;
+    };
+
+    // Worker to one-shot process; false if the run ends here instead
+    auto fallBack = [&s, &finish]() {
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            s.worker->process.Terminate();
+            s.worker.reset();
+            s.pending.clear();
+            if (!s.killed && s.process.Start(s.commandLine, true)) return true;
+            if (!s.killed) LogLine() << "[foo_downloader] Failed to run: " << s.commandLine;
+        }
+        finish(-1);
+        return false;
+    };
+
+    for (bool running = true; running;) {
+        std::string chunk;
+        bool open = s.worker ? s.worker->process.ReadSome(chunk) : s.process.ReadSome(chunk);
+
+        if (!s.worker) {
+            {
+                std::lock_guard<std::mutex> lock(s.mutex);
+                s.output += chunk;
+            }
+            if (open) continue;
+            // The pipe closes as the process exits; reap it in slices, so a
+            // Terminate() can still get in should it linger
+            int exitCode = -1;
+            for (;;) {
+                std::lock_guard<std::mutex> lock(s.mutex);
+                if (s.process.Wait(100, exitCode)) break;
+            }
+            finish(exitCode);
+            break;
+        }
+
+        // Pass everything through except control lines; a control line that
+        // has not fully arrived stays in `pending`
+        s.pending += chunk;
+        std::string passed;
+        bool switched = false;
+        for (;;) {
+            size_t mark = s.pending.find(CONTROL_MARK);
+            if (mark == std::string::npos) {
+                passed += s.pending;
+                s.pending.clear();
+                break;
+            }
+            passed.append(s.pending, 0, mark);
+            s.pending.erase(0, mark);
+            size_t eol = s.pending.find('\n');
+            if (eol == std::string::npos) break;
+
+            std::string line = s.pending.substr(1, eol - 1);
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            s.pending.erase(0, eol + 1);
+            if (line.compare(0, 9, "fdl-exit ") == 0) {
+                {
+                    std::lock_guard<std::mutex> lock(s.mutex);
+                    s.output += passed;
+                }
+                finish(atoi(line.c_str() + 9));
+                running = false;
+                switched = true;
+                break;
+            }
+            if (!HandleControl(*s.worker, line)) {
+                running = fallBack();
+                switched = true;
+                break;
+            }
+        }
+        if (switched) continue;
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            s.output += passed;
+        }
+        if (open) continue;
+
+        int exitCode = -1;
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            s.worker->process.Wait(1000, exitCode);
+        }
+        if (!s.worker->ready && !s.killed) {
+            // Python itself failed, e.g. too old for -X utf8
+            LogLine() << "[foo_downloader] yt-dlp worker exited at startup (code " << exitCode
+                      << "); running yt-dlp directly.";
+            MarkUnavailable(s.worker->key);
+            running = fallBack();
+            continue;
+        }
+        if (!s.killed) LogLine() << "[foo_downloader] yt-dlp worker exited mid-job (code " << exitCode << ")";
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            s.worker.reset();
+        }
+        finish(exitCode != 0 ? exitCode : 1);
+        break;
+    }
+
+    if (s.onFinish) s.onFinish();
+}
+
+bool YtDlpRun::ReadAvailable(std::string& out) {
+    if (!m_state) return false;
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    out += m_state->output;
+    m_state->output.clear();
+    return !m_state->done;
+}
+
+bool YtDlpRun::HasExited(int& exitCode) {
+    if (!m_state) return true;
+    std::lock_guard<std::mutex> lock(m_state->mutex);
+    if (!m_state->done) return false;
+    exitCode = m_state->exitCode;
+    return true;
+}
+
+void YtDlpRun::Terminate() {
+    if (!m_state) return;
+    {
+        // A worker still busy with this run cannot be reused
+        std::lock_guard<std::mutex> lock(m_state->mutex);
+        if (!m_state->done) {
+            m_state->killed = true;
+            if (m_state->worker) m_state->worker->process.Terminate();
+            m_state->process.Terminate();
+        }
+    }
+    if (m_state->reader.joinable()) m_state->reader.join();
+}
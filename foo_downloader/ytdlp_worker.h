@@ -0,0 +1,69 @@
+#pragma once
+
+#include "platform.h"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+// ============================================================================
+// Warm yt-dlp interpreters
+// ============================================================================
+// Starting yt-dlp costs one to three seconds before any network I/O (the
+// Windows build unpacks a whole Python runtime each time). When a Python
+// that can import yt_dlp is around, jobs run in long-lived worker processes
+// instead: a small helper script imports yt_dlp once and then runs one
+// command line per request read from stdin. Idle workers are kept for the
+// next search or download. Without such a Python, or with the worker turned
+// off in the settings, every job is its own yt-dlp process as before. So is
+// every job when the yt_dlp Python imports is another release than the
+// configured executable reports with --version.
+// ============================================================================
+
+struct YtDlpWorker;
+
+// One yt-dlp command line, run by a warm worker if possible. Mirrors the
+// ChildProcess calls the callers already use; output is always captured,
+// by a thread of the run's own.
+class YtDlpRun {
+public:
+    YtDlpRun();
+    ~YtDlpRun();
+    YtDlpRun(YtDlpRun&& other) noexcept;
+    YtDlpRun& operator=(YtDlpRun&& other) noexcept;
+    YtDlpRun(const YtDlpRun&) = delete;
+    YtDlpRun& operator=(const YtDlpRun&) = delete;
+
+    // `commandLine` starts with the yt-dlp executable, as for ChildProcess.
+    // `onFinish`, if given, is called on the reader thread once the run has
+    // ended and all its output can be read; it must not call back into the run.
+    bool Start(const std::string& commandLine, std::function<void()> onFinish = nullptr);
+
+    // Same contracts as ChildProcess: output so far without blocking (false
+    // once it has all been read), exit status, and a forced stop. Unlike a
+    // ChildProcess, destroying a run stops it.
+    bool ReadAvailable(std::string& out);
+    bool HasExited(int& exitCode);
+    void Terminate();
+
+private:
+    struct State;
+    static void ReadLoop(State* state);
+
+    std::unique_ptr<State> m_state;     // Where the reader thread points
+};
+
+// Ask `ytdlpPath --version` and keep the answer for the session; a no-op
+// once known. Runs for that executable use a worker only after this: the
+// worker's yt_dlp has to be the same release, and asking takes a yt-dlp
+// start (up to 30 s), so it blocks. Call it from a resolve thread, never the
+// poll thread; runs started before it has finished go one-shot.
+void ProbeYtDlpVersion(const std::string& ytdlpPath);
+
+// Stop idle workers that have not been used for a while; called from the
+// poll thread
+void ReapIdleYtDlpWorkers(uint64_t now);
+
+// Stop all idle workers (busy ones go with their YtDlpRun)
+void ShutdownYtDlpWorkers();